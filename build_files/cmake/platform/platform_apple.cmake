@@ -446,6 +446,15 @@ if(WITH_GMP)
   endif()
 endif()
 
+if(WITH_ZSTD)
+  set(ZSTD_ROOT_DIR ${LIBDIR}/zstd)
+  find_package(Zstd)
+  if(NOT ZSTD_FOUND)
+    message(WARNING "Zstd not found, disabling WITH_ZSTD")
+    set(WITH_ZSTD OFF)
+  endif()
+endif()
+
 set(EXETYPE MACOSX_BUNDLE)
 
 set(CMAKE_C_FLAGS_DEBUG "-fno-strict-aliasing -g")
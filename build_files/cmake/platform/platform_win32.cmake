@@ -760,3 +760,15 @@ if(WITH_GMP)
   set(GMP_ROOT_DIR ${LIBDIR}/gmp)
   set(GMP_FOUND On)
 endif()
+
+if(WITH_ZSTD)
+  if(EXISTS ${LIBDIR}/zstd)
+    set(ZSTD_INCLUDE_DIRS ${LIBDIR}/zstd/include)
+    set(ZSTD_LIBRARIES ${LIBDIR}/zstd/lib/zstd_static.lib)
+    set(ZSTD_ROOT_DIR ${LIBDIR}/zstd)
+    set(ZSTD_FOUND On)
+  else()
+    message(WARNING "Zstd was not found, disabling WITH_ZSTD")
+    set(WITH_ZSTD OFF)
+  endif()
+endif()
@@ -100,6 +100,16 @@ def blend_extract_thumb(path):
         blendfile.close()
         blendfile = gzip.GzipFile('', 'rb', 0, open_wrapper(path, 'rb'))
         head = blendfile.read(12)
+    elif head[0:4] == b'\x28\xb5\x2f\xfd':  # Zstandard magic
+        blendfile.close()
+        try:
+            import zstandard as zstd
+        except ImportError:
+            return None, 0, 0
+        # Files are written as multiple frames, followed by a seek table.
+        blendfile = zstd.ZstdDecompressor().stream_reader(
+            open_wrapper(path, 'rb'), read_across_frames=True)
+        head = blendfile.read(12)
 
     if not head.startswith(b'BLENDER'):
         blendfile.close()
@@ -97,7 +97,11 @@ IFACEMETHODIMP CBlendThumb::Initialize(IStream *pStream, DWORD)
 #include "Wincodec.h"
 #include <math.h>
 #include <zlib.h>
+#ifdef WITH_ZSTD
+#  include <zstd.h>
+#endif
 const unsigned char gzip_magic[3] = {0x1f, 0x8b, 0x08};
+const unsigned char zstd_magic[4] = {0x28, 0xb5, 0x2f, 0xfd};
 
 // IThumbnailProvider
 IFACEMETHODIMP CBlendThumb::GetThumbnail(UINT cx, HBITMAP *phbmp, WTS_ALPHATYPE *pdwAlpha)
@@ -107,14 +111,20 @@ IFACEMETHODIMP CBlendThumb::GetThumbnail(UINT cx, HBITMAP *phbmp, WTS_ALPHATYPE
   LARGE_INTEGER SeekPos;
 
   // Compressed?
-  unsigned char in_magic[3];
-  _pStream->Read(&in_magic, 3, &BytesRead);
+  unsigned char in_magic[4];
+  _pStream->Read(&in_magic, 4, &BytesRead);
   bool gzipped = true;
   for (int i = 0; i < 3; i++)
     if (in_magic[i] != gzip_magic[i]) {
       gzipped = false;
       break;
     }
+  bool zstd_compressed = true;
+  for (int i = 0; i < 4; i++)
+    if (in_magic[i] != zstd_magic[i]) {
+      zstd_compressed = false;
+      break;
+    }
 
   if (gzipped) {
     // Zlib inflate
@@ -167,6 +177,45 @@ IFACEMETHODIMP CBlendThumb::GetThumbnail(UINT cx, HBITMAP *phbmp, WTS_ALPHATYPE
     delete[] src;
     delete[] dest;
   }
+  else if (zstd_compressed) {
+#ifdef WITH_ZSTD
+    // Zstandard decompression, the file consists of multiple frames followed by a seek table.
+    // Frames are decompressed in order until the start of the file, which contains the
+    // thumbnail, is available.
+    size_t dest_size = 1024 * 70;  // see the gzip case
+    size_t src_size = ZSTD_DStreamInSize();
+    Bytef *src = new Bytef[src_size];
+    Bytef *dest = new Bytef[dest_size];
+    ZSTD_DCtx *dctx = ZSTD_createDCtx();
+    ZSTD_outBuffer output = {dest, dest_size, 0};
+    bool failed = false;
+
+    SeekPos.QuadPart = 0;
+    _pStream->Seek(SeekPos, STREAM_SEEK_SET, NULL);
+    while (!failed && output.pos < output.size) {
+      if (_pStream->Read(src, (ULONG)src_size, &BytesRead) != S_OK || BytesRead == 0) {
+        break;  // eof
+      }
+      ZSTD_inBuffer input = {src, BytesRead, 0};
+      while (input.pos < input.size && output.pos < output.size) {
+        if (ZSTD_isError(ZSTD_decompressStream(dctx, &output, &input))) {
+          failed = true;
+          break;
+        }
+      }
+    }
+    ZSTD_freeDCtx(dctx);
+
+    // Replace the IStream, which is read-only
+    _pStream->Release();
+    _pStream = SHCreateMemStream(dest, (UINT)output.pos);
+
+    delete[] src;
+    delete[] dest;
+#else
+    return S_FALSE;
+#endif
+  }
 
   // Blender version, early out if sub 2.5
   SeekPos.QuadPart = 9;
@@ -155,7 +155,9 @@ enum {
   G_DEBUG_XR = (1 << 21),                    /* XR/OpenXR messages */
   G_DEBUG_XR_TIME = (1 << 22),               /* XR/OpenXR timing messages */
 
-  G_DEBUG_GHOST = (1 << 23), /* Debug GHOST module. */
+  G_DEBUG_GHOST = (1 << 23),     /* Debug GHOST module. */
+  G_DEBUG_IO_TIMING = (1 << 24), /* Timing of blend-file reading. */
+  G_DEBUG_TASK_STATS = (1 << 25), /* Task scheduler statistics, printed on exit. */
 };
 
 #define G_DEBUG_ALL \
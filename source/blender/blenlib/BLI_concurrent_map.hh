@@ -0,0 +1,548 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+/** \file
+ * \ingroup bli
+ *
+ * A `blender::ConcurrentMap<Key, Value>` is an unordered associative container that allows many
+ * threads to add and lookup keys at the same time without taking a lock. It is meant for parallel
+ * code that would otherwise serialize behind a mutex around a `blender::Map`, or build a map per
+ * thread and merge them afterwards.
+ *
+ * Like blender::Map, it is implemented using open addressing in a slot array with a power-of-two
+ * size, and it uses the same probing strategies. Every slot has an atomic state: empty,
+ * constructing or occupied. A thread adds a key by claiming an empty slot with a compare-and-swap,
+ * constructing the key and value in it and publishing it as occupied afterwards. A thread that
+ * probes a slot which is still being constructed waits until it is published. That is the only
+ * situation in which one thread waits for another.
+ *
+ * Some noteworthy information:
+ * - The map does not grow while keys are added. Before going parallel, reserve() has to be called
+ *   with the maximum number of keys that will be added. Adding more keys is a bug and asserts.
+ * - Keys cannot be removed. reserve() and clear() must not run concurrently with other methods.
+ * - When multiple threads add the same key at the same time, exactly one of them adds it. The
+ *   other threads get the already added value (`lookup_or_add_cb` creates only a single value).
+ * - Pointers to keys and values stay valid until the map is reserved, cleared or destructed.
+ *   Concurrent access to the values themselves has to be synchronized by the caller, e.g. by using
+ *   atomic value types.
+ * - Unlike blender::Map, the hash of every key is stored in its slot, so that most unequal keys
+ *   can be skipped without calling the is-equal function.
+ */
+
+#include <atomic>
+#include <thread>
+
+#include "BLI_allocator.hh"
+#include "BLI_hash.hh"
+#include "BLI_hash_tables.hh"
+#include "BLI_memory_utils.hh"
+#include "BLI_probing_strategies.hh"
+#include "BLI_utildefines.h"
+
+namespace blender {
+
+template<
+    /**
+     * Type of the keys stored in the map. Keys have to be movable. Furthermore, the hash and
+     * is-equal functions have to support it.
+     */
+    typename Key,
+    /**
+     * Type of the value that is stored per key.
+     */
+    typename Value,
+    /**
+     * The strategy used to deal with collisions. They are defined in BLI_probing_strategies.hh.
+     */
+    typename ProbingStrategy = DefaultProbingStrategy,
+    /**
+     * The hash function used to hash the keys. There is a default for many types. See BLI_hash.hh
+     * for examples on how to define a custom hash function.
+     */
+    typename Hash = DefaultHash<Key>,
+    /**
+     * The equality operator used to compare keys. By default it will simply compare keys using the
+     * `==` operator.
+     */
+    typename IsEqual = DefaultEquality,
+    /**
+     * The allocator used by this map. Should rarely be changed, except when you don't want that
+     * MEM_* is used internally.
+     */
+    typename Allocator = GuardedAllocator>
+class ConcurrentMap {
+ private:
+  enum SlotState : uint8_t {
+    Empty = 0,
+    Constructing = 1,
+    Occupied = 2,
+  };
+
+  struct Slot {
+    std::atomic<uint8_t> state;
+    uint64_t hash;
+    TypedBuffer<Key> key;
+    TypedBuffer<Value> value;
+  };
+
+  /**
+   * The number of occupied slots. It is only incremented by concurrent adds.
+   */
+  std::atomic<int64_t> occupied_slots_;
+
+  /**
+   * The maximum number of slots that can be occupied. This is the total number of slots times the
+   * max load factor. It is only changed by reserve().
+   */
+  int64_t usable_slots_;
+
+  /**
+   * The number of slots minus one. This is a bit mask that can be used to turn any integer into a
+   * valid slot index efficiently.
+   */
+  uint64_t slot_mask_;
+
+  /** This is called to hash incoming keys. */
+  Hash hash_;
+
+  /** This is called to check equality of two keys. */
+  IsEqual is_equal_;
+
+  /** The max load factor is 1/2 = 50%, like for blender::Map. */
+  LoadFactor max_load_factor_ = LoadFactor(1, 2);
+
+  /**
+   * This is the array that contains the actual slots. There is always at least one empty slot and
+   * the size of the array is a power of two.
+   */
+  Slot *slots_;
+
+  Allocator allocator_;
+
+  /** Iterate over a slot index sequence for a given hash. */
+#define CONCURRENT_MAP_SLOT_PROBING_BEGIN(HASH, R_SLOT) \
+  SLOT_PROBING_BEGIN (ProbingStrategy, HASH, slot_mask_, SLOT_INDEX) \
+    auto &R_SLOT = slots_[SLOT_INDEX];
+#define CONCURRENT_MAP_SLOT_PROBING_END() SLOT_PROBING_END()
+
+ public:
+  /**
+   * Initialize an empty map that can hold at least the given number of key-value-pairs. Unlike
+   * blender::Map, this always allocates the slot array, because it cannot grow on the first
+   * insertion.
+   */
+  ConcurrentMap(const int64_t min_usable_slots = 0, Allocator allocator = {})
+      : occupied_slots_(0), usable_slots_(0), slot_mask_(0), slots_(nullptr), allocator_(allocator)
+  {
+    this->realloc_and_reinsert(min_usable_slots);
+  }
+
+  ~ConcurrentMap()
+  {
+    this->destruct_slots();
+    allocator_.deallocate(slots_);
+  }
+
+  ConcurrentMap(const ConcurrentMap &other) = delete;
+  ConcurrentMap &operator=(const ConcurrentMap &other) = delete;
+
+  /**
+   * Add a key-value-pair to the map. If the map contains the key already, nothing is changed.
+   * Returns true when the key has been added by this call. This is thread-safe.
+   */
+  bool add(const Key &key, const Value &value)
+  {
+    return this->add_as(key, value);
+  }
+  bool add(const Key &key, Value &&value)
+  {
+    return this->add_as(key, std::move(value));
+  }
+  bool add(Key &&key, const Value &value)
+  {
+    return this->add_as(std::move(key), value);
+  }
+  bool add(Key &&key, Value &&value)
+  {
+    return this->add_as(std::move(key), std::move(value));
+  }
+  template<typename ForwardKey, typename ForwardValue>
+  bool add_as(ForwardKey &&key, ForwardValue &&value)
+  {
+    bool added = false;
+    this->lookup_or_add__impl(
+        std::forward<ForwardKey>(key),
+        [&]() { return Value(std::forward<ForwardValue>(value)); },
+        hash_(key),
+        &added);
+    return added;
+  }
+
+  /**
+   * Returns a reference to the value that corresponds to the given key. If the key is not yet in
+   * the map, it will be added with the given value first. This is thread-safe.
+   */
+  Value &lookup_or_add(const Key &key, const Value &value)
+  {
+    return this->lookup_or_add_as(key, value);
+  }
+  Value &lookup_or_add(const Key &key, Value &&value)
+  {
+    return this->lookup_or_add_as(key, std::move(value));
+  }
+  Value &lookup_or_add(Key &&key, const Value &value)
+  {
+    return this->lookup_or_add_as(std::move(key), value);
+  }
+  Value &lookup_or_add(Key &&key, Value &&value)
+  {
+    return this->lookup_or_add_as(std::move(key), std::move(value));
+  }
+  template<typename ForwardKey, typename ForwardValue>
+  Value &lookup_or_add_as(ForwardKey &&key, ForwardValue &&value)
+  {
+    return this->lookup_or_add__impl(
+        std::forward<ForwardKey>(key),
+        [&]() { return Value(std::forward<ForwardValue>(value)); },
+        hash_(key),
+        nullptr);
+  }
+
+  /**
+   * Returns a reference to the value that corresponds to the given key. If the key is not yet in
+   * the map, it will be added with the value returned by create_value. This is thread-safe, when
+   * multiple threads add the same key, create_value is only called by the thread that adds it.
+   */
+  template<typename CreateValueF>
+  Value &lookup_or_add_cb(const Key &key, const CreateValueF &create_value)
+  {
+    return this->lookup_or_add_cb_as(key, create_value);
+  }
+  template<typename CreateValueF>
+  Value &lookup_or_add_cb(Key &&key, const CreateValueF &create_value)
+  {
+    return this->lookup_or_add_cb_as(std::move(key), create_value);
+  }
+  template<typename ForwardKey, typename CreateValueF>
+  Value &lookup_or_add_cb_as(ForwardKey &&key, const CreateValueF &create_value)
+  {
+    return this->lookup_or_add__impl(
+        std::forward<ForwardKey>(key), create_value, hash_(key), nullptr);
+  }
+
+  /**
+   * Returns true if there is a key in the map that compares equal to the given key. This is
+   * thread-safe.
+   */
+  bool contains(const Key &key) const
+  {
+    return this->contains_as(key);
+  }
+  template<typename ForwardKey> bool contains_as(const ForwardKey &key) const
+  {
+    return this->lookup_slot_ptr(key, hash_(key)) != nullptr;
+  }
+
+  /**
+   * Returns a pointer to the value that corresponds to the given key. If the key is not in the
+   * map, nullptr is returned. This is thread-safe.
+   */
+  const Value *lookup_ptr(const Key &key) const
+  {
+    return this->lookup_ptr_as(key);
+  }
+  Value *lookup_ptr(const Key &key)
+  {
+    return this->lookup_ptr_as(key);
+  }
+  template<typename ForwardKey> const Value *lookup_ptr_as(const ForwardKey &key) const
+  {
+    const Slot *slot = this->lookup_slot_ptr(key, hash_(key));
+    return (slot != nullptr) ? slot->value.ptr() : nullptr;
+  }
+  template<typename ForwardKey> Value *lookup_ptr_as(const ForwardKey &key)
+  {
+    return const_cast<Value *>(const_cast<const ConcurrentMap *>(this)->lookup_ptr_as(key));
+  }
+
+  /**
+   * Returns a reference to the value that corresponds to the given key. This invokes undefined
+   * behavior when the key is not in the map.
+   */
+  const Value &lookup(const Key &key) const
+  {
+    return this->lookup_as(key);
+  }
+  Value &lookup(const Key &key)
+  {
+    return this->lookup_as(key);
+  }
+  template<typename ForwardKey> const Value &lookup_as(const ForwardKey &key) const
+  {
+    const Value *ptr = this->lookup_ptr_as(key);
+    BLI_assert(ptr != nullptr);
+    return *ptr;
+  }
+  template<typename ForwardKey> Value &lookup_as(const ForwardKey &key)
+  {
+    Value *ptr = this->lookup_ptr_as(key);
+    BLI_assert(ptr != nullptr);
+    return *ptr;
+  }
+
+  /**
+   * Returns a copy of the value that corresponds to the given key. If the key is not in the
+   * map, the provided default_value is returned.
+   */
+  Value lookup_default(const Key &key, const Value &default_value) const
+  {
+    return this->lookup_default_as(key, default_value);
+  }
+  template<typename ForwardKey, typename ForwardValue>
+  Value lookup_default_as(const ForwardKey &key, ForwardValue &&default_value) const
+  {
+    const Value *ptr = this->lookup_ptr_as(key);
+    if (ptr != nullptr) {
+      return *ptr;
+    }
+    return std::forward<ForwardValue>(default_value);
+  }
+
+  /**
+   * Calls the provided callback for every key-value-pair in the map. The callback is expected
+   * to take a `const Key &` as first and a `const Value &` as second parameter. This must not run
+   * concurrently with adding keys.
+   */
+  template<typename FuncT> void foreach_item(const FuncT &func) const
+  {
+    const int64_t size = this->capacity();
+    for (int64_t i = 0; i < size; i++) {
+      const Slot &slot = slots_[i];
+      if (slot.state.load(std::memory_order_relaxed) == Occupied) {
+        func(*slot.key, *slot.value);
+      }
+    }
+  }
+
+  /**
+   * Return the number of key-value-pairs that are stored in the map.
+   */
+  int64_t size() const
+  {
+    return occupied_slots_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Returns true if there are no elements in the map.
+   */
+  bool is_empty() const
+  {
+    return this->size() == 0;
+  }
+
+  /**
+   * Returns the number of available slots. This is mostly for debugging purposes.
+   */
+  int64_t capacity() const
+  {
+    return static_cast<int64_t>(slot_mask_ + 1);
+  }
+
+  /**
+   * Returns the number of key-value-pairs that can be added before reserve() has to be called
+   * again.
+   */
+  int64_t usable_capacity() const
+  {
+    return usable_slots_;
+  }
+
+  /**
+   * Returns the approximate memory requirements of the map in bytes.
+   */
+  int64_t size_in_bytes() const
+  {
+    return static_cast<int64_t>(sizeof(Slot)) * this->capacity();
+  }
+
+  /**
+   * Make sure that at least n key-value-pairs can be stored in the map. This is not thread-safe.
+   */
+  void reserve(const int64_t n)
+  {
+    if (usable_slots_ < n) {
+      this->realloc_and_reinsert(n);
+    }
+  }
+
+  /**
+   * Removes all key-value-pairs from the map, but keeps the memory. This is not thread-safe.
+   */
+  void clear()
+  {
+    this->destruct_slots();
+    occupied_slots_.store(0, std::memory_order_relaxed);
+  }
+
+  /**
+   * Get the number of collisions that the probing strategy has to go through to find the key or
+   * determine that it is not in the map.
+   */
+  int64_t count_collisions(const Key &key) const
+  {
+    int64_t collisions = 0;
+    const uint64_t hash = hash_(key);
+
+    CONCURRENT_MAP_SLOT_PROBING_BEGIN (hash, slot) {
+      const uint8_t state = this->wait_for_slot(slot);
+      if (state == Empty) {
+        return collisions;
+      }
+      if (slot.hash == hash && is_equal_(key, *slot.key)) {
+        return collisions;
+      }
+      collisions++;
+    }
+    CONCURRENT_MAP_SLOT_PROBING_END();
+  }
+
+ private:
+  BLI_NOINLINE void realloc_and_reinsert(const int64_t min_usable_slots)
+  {
+    int64_t total_slots, usable_slots;
+    max_load_factor_.compute_total_and_usable_slots(
+        1, min_usable_slots, &total_slots, &usable_slots);
+    BLI_assert(total_slots >= 1);
+    const uint64_t new_slot_mask = static_cast<uint64_t>(total_slots) - 1;
+
+    Slot *new_slots = static_cast<Slot *>(allocator_.allocate(
+        sizeof(Slot) * static_cast<size_t>(total_slots), alignof(Slot), __func__));
+    for (int64_t i = 0; i < total_slots; i++) {
+      new (&new_slots[i].state) std::atomic<uint8_t>(Empty);
+    }
+
+    /* Move the existing key-value-pairs, this is single threaded. */
+    if (slots_ != nullptr) {
+      for (int64_t i = 0; i < this->capacity(); i++) {
+        Slot &old_slot = slots_[i];
+        if (old_slot.state.load(std::memory_order_relaxed) == Occupied) {
+          this->add_after_grow(old_slot, new_slots, new_slot_mask);
+        }
+      }
+      this->destruct_slots();
+      allocator_.deallocate(slots_);
+    }
+
+    slots_ = new_slots;
+    slot_mask_ = new_slot_mask;
+    usable_slots_ = usable_slots;
+  }
+
+  void add_after_grow(Slot &old_slot, Slot *new_slots, const uint64_t new_slot_mask)
+  {
+    SLOT_PROBING_BEGIN (ProbingStrategy, old_slot.hash, new_slot_mask, slot_index) {
+      Slot &slot = new_slots[slot_index];
+      if (slot.state.load(std::memory_order_relaxed) == Empty) {
+        new (slot.key) Key(std::move(*old_slot.key));
+        new (slot.value) Value(std::move(*old_slot.value));
+        slot.hash = old_slot.hash;
+        slot.state.store(Occupied, std::memory_order_relaxed);
+        return;
+      }
+    }
+    SLOT_PROBING_END();
+  }
+
+  void destruct_slots()
+  {
+    for (int64_t i = 0; i < this->capacity(); i++) {
+      Slot &slot = slots_[i];
+      if (slot.state.load(std::memory_order_relaxed) == Occupied) {
+        slot.key.ptr()->~Key();
+        slot.value.ptr()->~Value();
+      }
+      slot.state.store(Empty, std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * Returns the state of the slot after it has been published, when another thread is still
+   * constructing its key and value.
+   */
+  uint8_t wait_for_slot(const Slot &slot) const
+  {
+    uint8_t state = slot.state.load(std::memory_order_acquire);
+    while (state == Constructing) {
+      std::this_thread::yield();
+      state = slot.state.load(std::memory_order_acquire);
+    }
+    return state;
+  }
+
+  template<typename ForwardKey, typename CreateValueF>
+  Value &lookup_or_add__impl(ForwardKey &&key,
+                             const CreateValueF &create_value,
+                             const uint64_t hash,
+                             bool *r_added)
+  {
+    CONCURRENT_MAP_SLOT_PROBING_BEGIN (hash, slot) {
+      uint8_t state = slot.state.load(std::memory_order_acquire);
+      if (state == Empty) {
+        if (slot.state.compare_exchange_strong(state, Constructing, std::memory_order_acquire)) {
+          const int64_t occupied_slots = occupied_slots_.fetch_add(1, std::memory_order_relaxed);
+          BLI_assert(occupied_slots < usable_slots_);
+          UNUSED_VARS_NDEBUG(occupied_slots);
+
+          new (slot.key) Key(std::forward<ForwardKey>(key));
+          new (slot.value) Value(create_value());
+          slot.hash = hash;
+          slot.state.store(Occupied, std::memory_order_release);
+          if (r_added != nullptr) {
+            *r_added = true;
+          }
+          return *slot.value;
+        }
+        /* Another thread claimed the slot first, the failed exchange updated the state. */
+      }
+      if (state == Constructing) {
+        state = this->wait_for_slot(slot);
+      }
+      if (slot.hash == hash && is_equal_(key, *slot.key)) {
+        return *slot.value;
+      }
+    }
+    CONCURRENT_MAP_SLOT_PROBING_END();
+  }
+
+  template<typename ForwardKey>
+  const Slot *lookup_slot_ptr(const ForwardKey &key, const uint64_t hash) const
+  {
+    CONCURRENT_MAP_SLOT_PROBING_BEGIN (hash, slot) {
+      const uint8_t state = this->wait_for_slot(slot);
+      if (state == Empty) {
+        return nullptr;
+      }
+      if (slot.hash == hash && is_equal_(key, *slot.key)) {
+        return &slot;
+      }
+    }
+    CONCURRENT_MAP_SLOT_PROBING_END();
+  }
+};
+
+}  // namespace blender
@@ -112,6 +112,9 @@ extern "C" {
  * checks to see if some vertices are within epsilon of other edges, and
  * snapping them to those edges if so. You can skip this pass by setting
  * skip_input_modify to true. (This is also useful in some unit tests.)
+ * If use_threading is true, the initial Delaunay triangulation of large inputs
+ * is split into parts that are triangulated and merged on multiple threads.
+ * The output is the same as without threading.
  */
 typedef struct CDT_input {
   int verts_len;
@@ -124,6 +127,7 @@ typedef struct CDT_input {
   int *faces_len_table;
   float epsilon;
   bool skip_input_modify;
+  bool use_threading;
 } CDT_input;
 
 /**
@@ -0,0 +1,71 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+/** \file
+ * \ingroup bli
+ *
+ * Math on whole arrays of vectors and matrices at once.
+ *
+ * The operators of float3 and float4x4 handle one element at a time and loops over arrays of them
+ * are rarely vectorized by the compiler, because every element is an array of structs. These
+ * functions load a group of vectors into registers per component, compute the result for the
+ * whole group and store it back. On x86 the SSE2 version processes four vectors at a time, and
+ * CPUs with AVX2 process eight at a time with fused multiply-add. The version is chosen once at
+ * run-time, so the same binary works on all CPUs.
+ *
+ * Results are the same as those of the single element functions, up to rounding differences
+ * caused by the different order of operations and fused multiply-add.
+ *
+ * All functions are single threaded, call them per chunk from a parallel loop when needed.
+ * Source and destination may be the same memory, but must not overlap otherwise.
+ */
+
+#include "BLI_float3.hh"
+#include "BLI_float4x4.hh"
+#include "BLI_span.hh"
+
+namespace blender {
+
+/**
+ * Same as `dst[i] = matrix * src[i]`, including the translation of the matrix.
+ */
+void transform_points(const float4x4 &matrix, Span<float3> src, MutableSpan<float3> dst);
+void transform_points(const float4x4 &matrix, MutableSpan<float3> points);
+
+/**
+ * Same as `dst[i] = matrix.ref_3x3() * src[i]`, ignoring the translation of the matrix.
+ */
+void transform_directions(const float4x4 &matrix, Span<float3> src, MutableSpan<float3> dst);
+void transform_directions(const float4x4 &matrix, MutableSpan<float3> directions);
+
+/**
+ * Same as `vectors[i].normalize()`, vectors that are too short become zero.
+ */
+void normalize_vectors(MutableSpan<float3> vectors);
+
+void dot_products(Span<float3> a, Span<float3> b, MutableSpan<float> r_dots);
+void cross_products(Span<float3> a, Span<float3> b, MutableSpan<float3> r_crosses);
+
+/**
+ * Same as `r_matrices[i] = matrix * matrices[i]`.
+ */
+void multiply_matrices(const float4x4 &matrix,
+                       Span<float4x4> matrices,
+                       MutableSpan<float4x4> r_matrices);
+
+}  // namespace blender
@@ -0,0 +1,106 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+/** \file
+ * \ingroup bli
+ *
+ * Parallel prefix sums, mostly used to turn per-element counts into offsets:
+ *
+ *  Array<int> offsets(counts.size());
+ *  const int total = parallel_exclusive_scan(counts.as_span(), offsets.as_mutable_span());
+ *
+ * Large arrays are split into blocks. The sum of every block is computed in parallel, then the
+ * block sums are scanned serially and finally every block is scanned again in parallel, starting
+ * at the offset of its block. This reads the input twice, so small arrays are scanned serially.
+ */
+
+#include "BLI_array.hh"
+#include "BLI_span.hh"
+#include "BLI_task.hh"
+
+namespace blender {
+
+/* Arrays up to this size are scanned on the calling thread. */
+constexpr int64_t parallel_scan_block_size = 16384;
+
+/**
+ * Write the exclusive prefix sum of #src into #dst, starting at #init, and return the total sum.
+ * The spans must have the same size, but may be the same memory to scan in place.
+ */
+template<typename T> T parallel_exclusive_scan(Span<T> src, MutableSpan<T> dst, T init = T(0))
+{
+  BLI_assert(src.size() == dst.size());
+  const int64_t size = src.size();
+
+  auto scan_block = [&](IndexRange range, T sum) {
+    for (const int64_t i : range) {
+      /* Read before writing, the spans may alias. */
+      const T value = src[i];
+      dst[i] = sum;
+      sum += value;
+    }
+    return sum;
+  };
+
+  if (size <= parallel_scan_block_size) {
+    return scan_block(IndexRange(size), init);
+  }
+
+  const int64_t blocks_num = (size + parallel_scan_block_size - 1) / parallel_scan_block_size;
+  Array<T> block_offsets(blocks_num);
+  auto block_range = [&](const int64_t block) {
+    const int64_t start = block * parallel_scan_block_size;
+    return IndexRange(start, std::min(parallel_scan_block_size, size - start));
+  };
+
+  parallel_for(IndexRange(blocks_num), 1, [&](IndexRange blocks) {
+    for (const int64_t block : blocks) {
+      T sum = T(0);
+      for (const int64_t i : block_range(block)) {
+        sum += src[i];
+      }
+      block_offsets[block] = sum;
+    }
+  });
+
+  T total = init;
+  for (const int64_t block : IndexRange(blocks_num)) {
+    const T block_sum = block_offsets[block];
+    block_offsets[block] = total;
+    total += block_sum;
+  }
+
+  parallel_for(IndexRange(blocks_num), 1, [&](IndexRange blocks) {
+    for (const int64_t block : blocks) {
+      scan_block(block_range(block), block_offsets[block]);
+    }
+  });
+
+  return total;
+}
+
+/**
+ * Replace every value by the sum of all values before it, starting at #init. Returns the total
+ * sum, which is often needed as the size of the array the offsets point into.
+ */
+template<typename T> T parallel_exclusive_scan(MutableSpan<T> values, T init = T(0))
+{
+  return parallel_exclusive_scan(values.as_span(), values, init);
+}
+
+}  // namespace blender
@@ -0,0 +1,257 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+/** \file
+ * \ingroup bli
+ *
+ * Parallel sorting algorithms. Both sorts are stable and need a temporary buffer with the size of
+ * the input.
+ *
+ * - `parallel_sort` is a merge sort for any type and comparison. Blocks are sorted in parallel,
+ *   then merged in pairs. Every merge is split into pieces of about the same size using binary
+ *   searches, so that the last merges, of which there are only a few, still use all threads.
+ * - `parallel_radix_sort` sorts by an unsigned integer key, one byte per pass. It does not compare
+ *   elements at all and is usually much faster for integer keys, like vertex or face indices.
+ *   Every pass counts the digits per block in parallel, turns the counts into offsets and scatters
+ *   the elements in parallel. Passes in which all keys share the same digit are skipped, so
+ *   sorting small indices in 32 bit integers only does as many passes as needed.
+ *
+ *  parallel_radix_sort(corner_edges.as_mutable_span(), [](const CornerEdge &item) {
+ *    return uint32_t(item.edge);
+ *  });
+ */
+
+#include <algorithm>
+#include <type_traits>
+
+#include "BLI_array.hh"
+#include "BLI_span.hh"
+#include "BLI_task.hh"
+
+namespace blender {
+
+/* Number of elements sorted by a single task. Smaller inputs are sorted serially. */
+constexpr int64_t parallel_sort_block_size = 8192;
+
+namespace parallel_sort_detail {
+
+/**
+ * Number of elements of #a that come before #diagonal elements of the merged sequence. Equal
+ * elements of #a come first, which keeps the merge stable.
+ */
+template<typename T, typename Compare>
+int64_t merge_path_split(Span<T> a, Span<T> b, const int64_t diagonal, const Compare &compare)
+{
+  int64_t low = std::max<int64_t>(0, diagonal - b.size());
+  int64_t high = std::min(diagonal, a.size());
+  while (low < high) {
+    const int64_t mid = (low + high) / 2;
+    if (compare(b[diagonal - mid - 1], a[mid])) {
+      high = mid;
+    }
+    else {
+      low = mid + 1;
+    }
+  }
+  return low;
+}
+
+template<typename T> void parallel_move(MutableSpan<T> src, MutableSpan<T> dst)
+{
+  BLI_assert(src.size() == dst.size());
+  parallel_for(IndexRange(src.size()), parallel_sort_block_size, [&](IndexRange range) {
+    std::move(src.begin() + range.start(),
+              src.begin() + range.one_after_last(),
+              dst.begin() + range.start());
+  });
+}
+
+}  // namespace parallel_sort_detail
+
+/**
+ * Stable merge sort, #compare is a strict weak ordering like for `std::stable_sort`.
+ */
+template<typename T, typename Compare>
+void parallel_sort(MutableSpan<T> values, const Compare &compare)
+{
+  const int64_t size = values.size();
+  if (size <= parallel_sort_block_size) {
+    std::stable_sort(values.begin(), values.end(), compare);
+    return;
+  }
+
+  const int64_t blocks_num = (size + parallel_sort_block_size - 1) / parallel_sort_block_size;
+  parallel_for(IndexRange(blocks_num), 1, [&](IndexRange blocks) {
+    for (const int64_t block : blocks) {
+      const int64_t start = block * parallel_sort_block_size;
+      const int64_t end = std::min(start + parallel_sort_block_size, size);
+      std::stable_sort(values.begin() + start, values.begin() + end, compare);
+    }
+  });
+
+  Array<T> buffer(size);
+  MutableSpan<T> src = values;
+  MutableSpan<T> dst = buffer;
+
+  /* Sorted runs are always a multiple of the block size, so a piece of the output never spans
+   * two merges. */
+  for (int64_t run_size = parallel_sort_block_size; run_size < size; run_size *= 2) {
+    parallel_for(IndexRange(blocks_num), 1, [&](IndexRange pieces) {
+      for (const int64_t piece : pieces) {
+        const int64_t piece_start = piece * parallel_sort_block_size;
+        const int64_t piece_end = std::min(piece_start + parallel_sort_block_size, size);
+        const int64_t merge_start = piece_start - piece_start % (run_size * 2);
+        const int64_t a_end = std::min(merge_start + run_size, size);
+        const int64_t b_end = std::min(merge_start + run_size * 2, size);
+        const Span<T> a = src.as_span().slice(merge_start, a_end - merge_start);
+        const Span<T> b = src.as_span().slice(a_end, b_end - a_end);
+
+        const int64_t diagonal_start = piece_start - merge_start;
+        const int64_t diagonal_end = piece_end - merge_start;
+        const int64_t a_start = parallel_sort_detail::merge_path_split(
+            a, b, diagonal_start, compare);
+        const int64_t a_stop = parallel_sort_detail::merge_path_split(
+            a, b, diagonal_end, compare);
+        const int64_t b_start = diagonal_start - a_start;
+        const int64_t b_stop = diagonal_end - a_stop;
+
+        T *a_data = src.data() + merge_start;
+        T *b_data = src.data() + a_end;
+        std::merge(std::make_move_iterator(a_data + a_start),
+                   std::make_move_iterator(a_data + a_stop),
+                   std::make_move_iterator(b_data + b_start),
+                   std::make_move_iterator(b_data + b_stop),
+                   dst.begin() + piece_start,
+                   compare);
+      }
+    });
+    std::swap(src, dst);
+  }
+
+  if (src.data() != values.data()) {
+    parallel_sort_detail::parallel_move(src, values);
+  }
+}
+
+template<typename T> void parallel_sort(MutableSpan<T> values)
+{
+  parallel_sort(values, std::less<T>());
+}
+
+/**
+ * Stable radix sort. #get_key maps an element to an unsigned integer, elements are sorted by
+ * increasing key. The elements are copied with memcpy semantics and therefore have to be
+ * trivially copyable.
+ */
+template<typename T, typename GetKey>
+void parallel_radix_sort(MutableSpan<T> values, const GetKey &get_key)
+{
+  using Key = std::decay_t<decltype(get_key(values[0]))>;
+  static_assert(std::is_unsigned_v<Key>, "The sort key has to be an unsigned integer");
+  static_assert(std::is_trivially_copyable_v<T>, "Elements are copied as plain memory");
+
+  constexpr int digit_bits = 8;
+  constexpr int64_t digits_num = 1 << digit_bits;
+  constexpr int passes_num = sizeof(Key) * 8 / digit_bits;
+
+  const int64_t size = values.size();
+  if (size <= 1) {
+    return;
+  }
+
+  /* Every block has its own digit counts, so using more blocks than threads only costs memory. */
+  const int64_t threads_num = std::max(BLI_task_scheduler_num_threads(), 1);
+  const int64_t blocks_num = std::clamp<int64_t>(size / parallel_sort_block_size, 1, threads_num);
+  const int64_t block_size = (size + blocks_num - 1) / blocks_num;
+  auto block_range = [&](const int64_t block) {
+    const int64_t start = std::min(block * block_size, size);
+    return IndexRange(start, std::min(block_size, size - start));
+  };
+
+  Array<T> buffer(size, NoInitialization());
+  Array<int64_t> offsets(blocks_num * digits_num);
+  MutableSpan<T> src = values;
+  MutableSpan<T> dst = buffer;
+
+  for (int pass = 0; pass < passes_num; pass++) {
+    const int shift = pass * digit_bits;
+    auto digit_of = [&](const T &value) {
+      return static_cast<int64_t>((get_key(value) >> shift) & Key(digits_num - 1));
+    };
+
+    parallel_for(IndexRange(blocks_num), 1, [&](IndexRange blocks) {
+      for (const int64_t block : blocks) {
+        int64_t *counts = &offsets[block * digits_num];
+        std::fill_n(counts, digits_num, 0);
+        for (const int64_t i : block_range(block)) {
+          counts[digit_of(src[i])]++;
+        }
+      }
+    });
+
+    /* Elements with a smaller digit come first, ties are ordered by block to keep the sort
+     * stable. */
+    int64_t offset = 0;
+    bool is_single_digit = false;
+    for (const int64_t digit : IndexRange(digits_num)) {
+      const int64_t digit_start = offset;
+      for (const int64_t block : IndexRange(blocks_num)) {
+        const int64_t count = offsets[block * digits_num + digit];
+        offsets[block * digits_num + digit] = offset;
+        offset += count;
+      }
+      if (offset - digit_start == size) {
+        is_single_digit = true;
+        break;
+      }
+    }
+    if (is_single_digit) {
+      /* Nothing would move. */
+      continue;
+    }
+
+    parallel_for(IndexRange(blocks_num), 1, [&](IndexRange blocks) {
+      for (const int64_t block : blocks) {
+        int64_t *block_offsets = &offsets[block * digits_num];
+        for (const int64_t i : block_range(block)) {
+          dst[block_offsets[digit_of(src[i])]++] = src[i];
+        }
+      }
+    });
+    std::swap(src, dst);
+  }
+
+  if (src.data() != values.data()) {
+    parallel_sort_detail::parallel_move(src, values);
+  }
+}
+
+/**
+ * Sort integers in increasing order.
+ */
+template<typename T> void parallel_radix_sort(MutableSpan<T> values)
+{
+  static_assert(std::is_integral_v<T>, "Only integers can be their own sort key");
+  using Key = std::make_unsigned_t<T>;
+  /* Flipping the sign bit orders negative values before positive ones. */
+  constexpr Key sign_flip = std::is_signed_v<T> ? Key(Key(1) << (sizeof(T) * 8 - 1)) : Key(0);
+  parallel_radix_sort(values,
+                      [&](const T value) { return Key(static_cast<Key>(value) ^ sign_flip); });
+}
+
+}  // namespace blender
@@ -33,6 +33,8 @@ extern "C" {
 #endif
 
 struct BLI_mempool;
+struct MemArena;
+struct TaskParallelMemArenas;
 
 /* Task Scheduler
  *
@@ -47,6 +49,58 @@ void BLI_task_scheduler_init(void);
 void BLI_task_scheduler_exit(void);
 int BLI_task_scheduler_num_threads(void);
 
+/* Task Scheduler Statistics
+ *
+ * Lightweight per-worker counters to diagnose how well threads are utilized.
+ * Collection is disabled by default, when enabled every executed task and
+ * parallel range chunk costs two timer queries.
+ *
+ * Workers are numbered in the order in which they first executed a task, so
+ * indices are stable for the lifetime of a thread but do not match TBB slots.
+ * Values are gathered without locking, reading them while tasks are running
+ * gives an approximate snapshot. */
+
+typedef struct TaskSchedulerWorkerStats {
+  /* Number of tasks and parallel range chunks executed by this worker. */
+  uint64_t tasks_run;
+  /* Tasks executed by this worker that were created by another thread. */
+  uint64_t tasks_stolen;
+  /* Time spent executing tasks, in seconds. */
+  double busy_time;
+  /* Time a worker thread spent inside the scheduler without executing a task,
+   * in seconds. Always zero for threads which are not TBB workers. */
+  double idle_time;
+} TaskSchedulerWorkerStats;
+
+void BLI_task_scheduler_stats_enable(bool enable);
+bool BLI_task_scheduler_stats_is_enabled(void);
+void BLI_task_scheduler_stats_reset(void);
+/* Copy statistics of up to stats_len workers, returns the number of workers
+ * that executed tasks so far (which may be bigger than stats_len). */
+int BLI_task_scheduler_stats_get(TaskSchedulerWorkerStats *r_stats, int stats_len);
+void BLI_task_scheduler_stats_print(void);
+
+/* NUMA Arenas
+ *
+ * On machines with multiple NUMA nodes the scheduler can create one task arena
+ * per node, with its worker threads pinned to the processors of that node.
+ * BLI_task_parallel_range() then splits its range into one contiguous block
+ * per node, sized by the number of processors on the node, and runs every
+ * block inside the arena of its node.
+ *
+ * The partition only depends on the range and the topology, so memory which
+ * is first touched (initialized) by a parallel range is allocated on the same
+ * node that accesses those indices in later parallel ranges over that data.
+ *
+ * Must be called from the main thread, like init/exit. Enabling returns false
+ * and leaves the scheduler unchanged when NUMA is not available or there is
+ * only a single node. */
+
+bool BLI_task_scheduler_numa_arenas_enable(void);
+void BLI_task_scheduler_numa_arenas_disable(void);
+/* Number of NUMA arenas in use, zero when disabled. */
+int BLI_task_scheduler_numa_arenas_num(void);
+
 /* Task Pool
  *
  * Pool of tasks that will be executed by the central task scheduler. For each
@@ -121,6 +175,9 @@ typedef struct TaskParallelTLS {
    * worker threads. This is similar to OpenMP's firstprivate.
    */
   void *userdata_chunk;
+  /* Private, use BLI_task_parallel_tls_memarena() to access the arena. */
+  struct MemArena *memarena;
+  struct TaskParallelMemArenas *memarenas;
 } TaskParallelTLS;
 
 typedef void (*TaskParallelRangeFunc)(void *__restrict userdata,
@@ -176,6 +233,13 @@ void BLI_task_parallel_range(const int start,
                              TaskParallelRangeFunc func,
                              const TaskParallelSettings *settings);
 
+/* Memory arena of the calling thread for scratch allocations in the callback
+ * of BLI_task_parallel_range(), which can be used without locking. The arena
+ * is created on first use, and everything allocated from it is freed in bulk
+ * when the whole range has been processed (after func_reduce and func_free).
+ * Arenas are recycled between ranges, so don't change their settings. */
+struct MemArena *BLI_task_parallel_tls_memarena(const TaskParallelTLS *tls);
+
 /* This data is shared between all tasks, its access needs thread lock or similar protection.
  */
 typedef struct TaskParallelIteratorStateShared {
@@ -0,0 +1,93 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+/** \file
+ * \ingroup bli
+ *
+ * C++ wrappers around the task scheduler in BLI_task.h.
+ *
+ * `blender::parallel_for` splits an IndexRange into chunks of roughly `grain_size` indices and
+ * calls the function once per chunk, possibly on different threads:
+ *
+ *  parallel_for(IndexRange(values.size()), 512, [&](IndexRange range) {
+ *    for (const int64_t i : range) {
+ *      values[i] = compute(i);
+ *    }
+ *  });
+ *
+ * Passing a chunk instead of single indices keeps the per-index overhead out of the inner loop
+ * and lets the function keep local state for a whole chunk.
+ */
+
+#include "BLI_index_range.hh"
+#include "BLI_task.h"
+
+namespace blender {
+
+namespace parallel_for_detail {
+
+template<typename Function> struct ParallelForData {
+  const Function *function;
+  IndexRange range;
+  int64_t grain_size;
+};
+
+template<typename Function>
+void parallel_for_chunk_func(void *__restrict userdata,
+                             const int chunk_index,
+                             const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const ParallelForData<Function> *data = static_cast<ParallelForData<Function> *>(userdata);
+  const int64_t start = data->range.start() + chunk_index * data->grain_size;
+  const int64_t size = std::min(data->grain_size, data->range.one_after_last() - start);
+  (*data->function)(IndexRange(start, size));
+}
+
+}  // namespace parallel_for_detail
+
+/**
+ * Call the function for chunks of the range, in parallel when the range is larger than a single
+ * chunk. The chunks don't overlap and together cover the whole range.
+ */
+template<typename Function>
+void parallel_for(IndexRange range, int64_t grain_size, const Function &function)
+{
+  if (range.size() == 0) {
+    return;
+  }
+  grain_size = std::max<int64_t>(grain_size, 1);
+  if (range.size() <= grain_size) {
+    function(range);
+    return;
+  }
+
+  const int64_t chunks_num = (range.size() + grain_size - 1) / grain_size;
+  BLI_assert(chunks_num <= INT32_MAX);
+
+  parallel_for_detail::ParallelForData<Function> data = {&function, range, grain_size};
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1;
+  BLI_task_parallel_range(0,
+                          static_cast<int>(chunks_num),
+                          &data,
+                          parallel_for_detail::parallel_for_chunk_func<Function>,
+                          &settings);
+}
+
+}  // namespace blender
@@ -46,12 +46,17 @@
 #include "BLI_heap_simple.h"
 #include "BLI_kdopbvh.h"
 #include "BLI_math.h"
+#include "BLI_math_bits.h"
 #include "BLI_stack.h"
 #include "BLI_task.h"
 #include "BLI_utildefines.h"
 
 #include "BLI_strict_flags.h"
 
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
 /* used for iterative_raycast */
 // #define USE_SKIP_LINKS
 
@@ -72,6 +77,18 @@
 #  define KDOPBVH_THREAD_LEAF_THRESHOLD 1024
 #endif
 
+/* Branches with more leafs are split using multiple threads (instead of one thread per branch),
+ * this is needed for the first levels of the tree which only have a few branches. */
+#ifdef DEBUG
+#  define KDOPBVH_THREAD_SPLIT_THRESHOLD 1024
+#else
+#  define KDOPBVH_THREAD_SPLIT_THRESHOLD 65536
+#endif
+/* Number of leafs handled by each task when splitting a branch using multiple threads. */
+#define KDOPBVH_SPLIT_CHUNK_SIZE 4096
+/* Number of bins the leafs are sorted into when splitting a branch using multiple threads. */
+#define KDOPBVH_SPLIT_BINS 1024
+
 /* -------------------------------------------------------------------- */
 /** \name Struct Definitions
  * \{ */
@@ -90,6 +107,43 @@ typedef struct BVHNode {
   char main_axis; /* Axis used to split this node */
 } BVHNode;
 
+/** Unused child slot of a #BVHCompactNode. */
+#define BVH_COMPACT_NONE INT_MIN
+/** Number of quantization steps used for the bounds of a #BVHCompactNode. */
+#define BVH_COMPACT_QUANTIZE_STEPS 65533.0f
+
+/**
+ * Node of the optional compact layout (see #BLI_bvhtree_compact_layout_build),
+ * only used for quad-trees of axis aligned bounding boxes (tree_type 4, axis 6).
+ * The bounds of all children are quantized to 16 bits and stored per axis,
+ * so a node fits in a single cache line and its children can be tested without
+ * following any pointer.
+ */
+typedef struct BVHCompactNode {
+  /** Quantized bounds of the children: `[axis][min, max][child]`. */
+  uint16_t bounds[3][2][4];
+  /**
+   * A positive value is the index of a compact node,
+   * a negative value is the leaf `tree->nodearray[-(value + 1)]`.
+   * Unused slots (always at the end) are #BVH_COMPACT_NONE.
+   */
+  int children[4];
+} BVHCompactNode;
+
+BLI_STATIC_ASSERT(sizeof(BVHCompactNode) == 64, "compact node must fit a cache line")
+
+typedef struct BVHTreeCompact {
+  /** Branches in depth first order, the root is the first node. */
+  BVHCompactNode *nodes;
+  /** Branch of the tree each compact node was created from, used to update the bounds. */
+  const BVHNode **nodes_orig;
+  int nodes_num;
+  /** Quantized bounds are `origin + value * scale`. */
+  float origin[3];
+  float scale[3];
+  float scale_inv[3];
+} BVHTreeCompact;
+
 /* keep under 26 bytes for speed purposes */
 struct BVHTree {
   BVHNode **nodes;
@@ -102,17 +156,20 @@ struct BVHTree {
   axis_t start_axis, stop_axis; /* bvhtree_kdop_axes array indices according to axis */
   axis_t axis;                  /* kdop type (6 => OBB, 7 => AABB, ...) */
   char tree_type;               /* type of tree (4 => quadtree) */
+  BVHTreeCompact *compact;      /* optional, see #BLI_bvhtree_compact_layout_build */
 };
 
 /* optimization, ensure we stay small */
-BLI_STATIC_ASSERT((sizeof(void *) == 8 && sizeof(BVHTree) <= 48) ||
-                      (sizeof(void *) == 4 && sizeof(BVHTree) <= 32),
+BLI_STATIC_ASSERT((sizeof(void *) == 8 && sizeof(BVHTree) <= 56) ||
+                      (sizeof(void *) == 4 && sizeof(BVHTree) <= 36),
                   "over sized")
 
 /* avoid duplicating vars in BVHOverlapData_Thread */
 typedef struct BVHOverlapData_Shared {
   const BVHTree *tree1, *tree2;
   axis_t start_axis, stop_axis;
+  /* both trees have a compact layout, only used without max_interactions */
+  bool use_compact;
 
   /* use for callbacks */
   BVHTree_OverlapCallback callback;
@@ -157,6 +214,20 @@ typedef struct BVHRayCastData {
   BVHTreeRayHit hit;
 } BVHRayCastData;
 
+/** Number of rays traversed together by #BLI_bvhtree_ray_cast_batch (the SSE register width). */
+#define BVH_RAYCAST_PACKET_SIZE 4
+
+typedef struct BVHRayCastPacketData {
+  /** Rays of the packet, unused lanes point to the first ray (and are never active). */
+  BVHRayCastData *rays[BVH_RAYCAST_PACKET_SIZE];
+
+  /* Ray data as arrays per axis, for testing all rays against a node at once. */
+  float origin[3][BVH_RAYCAST_PACKET_SIZE];
+  float idot_axis[3][BVH_RAYCAST_PACKET_SIZE];
+  /** All bits set for negative directions (swapping the near & far planes of the axis). */
+  uint sign_mask[3][BVH_RAYCAST_PACKET_SIZE];
+} BVHRayCastPacketData;
+
 typedef struct BVHNearestProjectedData {
   const BVHTree *tree;
   struct DistProjectedAABBPrecalc precalc;
@@ -690,6 +761,187 @@ static void split_leafs(BVHNode **leafs_array,
   }
 }
 
+/* -------------------------------------------------------------------- */
+/* Multi-threaded refit & split of large branches. */
+
+typedef struct BVHRefitChunksData {
+  const BVHTree *tree;
+  int start, end;
+  /** Bounding volume of each chunk of leafs. */
+  float (*chunks_bv)[13 * 2];
+} BVHRefitChunksData;
+
+static void refit_kdop_hull_chunk_task_cb(void *__restrict userdata,
+                                          const int chunk,
+                                          const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BVHRefitChunksData *data = userdata;
+  const int start = data->start + chunk * KDOPBVH_SPLIT_CHUNK_SIZE;
+  const int end = min_ii(start + KDOPBVH_SPLIT_CHUNK_SIZE, data->end);
+  BVHNode chunk_node = {.bv = data->chunks_bv[chunk]};
+
+  refit_kdop_hull(data->tree, &chunk_node, start, end);
+}
+
+/**
+ * Same as #refit_kdop_hull, using multiple threads.
+ */
+static void refit_kdop_hull_parallel(const BVHTree *tree, BVHNode *node, int start, int end)
+{
+  BVHRefitChunksData data = {
+      .tree = tree,
+      .start = start,
+      .end = end,
+  };
+  const int chunks_num = (end - start + KDOPBVH_SPLIT_CHUNK_SIZE - 1) / KDOPBVH_SPLIT_CHUNK_SIZE;
+  data.chunks_bv = MEM_mallocN(sizeof(*data.chunks_bv) * (size_t)chunks_num, __func__);
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  BLI_task_parallel_range(0, chunks_num, &data, refit_kdop_hull_chunk_task_cb, &settings);
+
+  node_minmax_init(tree, node);
+  for (int chunk = 0; chunk < chunks_num; chunk++) {
+    const float *chunk_bv = data.chunks_bv[chunk];
+    for (axis_t axis_iter = tree->start_axis; axis_iter < tree->stop_axis; axis_iter++) {
+      if (chunk_bv[(2 * axis_iter)] < node->bv[(2 * axis_iter)]) {
+        node->bv[(2 * axis_iter)] = chunk_bv[(2 * axis_iter)];
+      }
+      if (chunk_bv[(2 * axis_iter) + 1] > node->bv[(2 * axis_iter) + 1]) {
+        node->bv[(2 * axis_iter) + 1] = chunk_bv[(2 * axis_iter) + 1];
+      }
+    }
+  }
+
+  MEM_freeN(data.chunks_bv);
+}
+
+typedef struct BVHSplitBinsData {
+  BVHNode **leafs_array;
+  /** Leafs sorted by bin (offset by `leafs_begin`). */
+  BVHNode **leafs_binned;
+  int leafs_begin, leafs_end;
+
+  int split_axis;
+  float key_min, key_scale;
+
+  /** Number of leafs in each bin per chunk, then the position of the chunk in each bin. */
+  int (*chunks_bins)[KDOPBVH_SPLIT_BINS];
+} BVHSplitBinsData;
+
+BLI_INLINE int split_leafs_bin(const BVHSplitBinsData *data, const BVHNode *leaf)
+{
+  const int bin = (int)((leaf->bv[data->split_axis] - data->key_min) * data->key_scale);
+  return CLAMPIS(bin, 0, KDOPBVH_SPLIT_BINS - 1);
+}
+
+static void split_leafs_bins_count_task_cb(void *__restrict userdata,
+                                           const int chunk,
+                                           const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BVHSplitBinsData *data = userdata;
+  const int start = data->leafs_begin + chunk * KDOPBVH_SPLIT_CHUNK_SIZE;
+  const int end = min_ii(start + KDOPBVH_SPLIT_CHUNK_SIZE, data->leafs_end);
+  int *bins = data->chunks_bins[chunk];
+
+  memset(bins, 0, sizeof(*data->chunks_bins));
+  for (int i = start; i < end; i++) {
+    bins[split_leafs_bin(data, data->leafs_array[i])]++;
+  }
+}
+
+static void split_leafs_bins_scatter_task_cb(void *__restrict userdata,
+                                             const int chunk,
+                                             const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BVHSplitBinsData *data = userdata;
+  const int start = data->leafs_begin + chunk * KDOPBVH_SPLIT_CHUNK_SIZE;
+  const int end = min_ii(start + KDOPBVH_SPLIT_CHUNK_SIZE, data->leafs_end);
+  int *bins = data->chunks_bins[chunk];
+
+  for (int i = start; i < end; i++) {
+    BVHNode *leaf = data->leafs_array[i];
+    data->leafs_binned[bins[split_leafs_bin(data, leaf)]++ - data->leafs_begin] = leaf;
+  }
+}
+
+/**
+ * Same as #split_leafs, using multiple threads.
+ *
+ * The leafs are sorted into bins along the split axis (a counting sort in parallel),
+ * only the bins containing the split positions need to be partitioned further.
+ *
+ * \param bv: The bounding volume of all leafs being split.
+ */
+static void split_leafs_parallel(BVHNode **leafs_array,
+                                 const int nth[],
+                                 const int partitions,
+                                 const int split_axis,
+                                 const float *bv)
+{
+  /* The key is the maximum of the leafs on the axis, see #get_largest_axis. */
+  BLI_assert(split_axis % 2 == 1);
+  const float key_min = bv[split_axis - 1];
+  const float key_range = bv[split_axis] - key_min;
+  if (!(key_range > 0.0f)) {
+    split_leafs(leafs_array, nth, partitions, split_axis);
+    return;
+  }
+
+  BVHSplitBinsData data = {
+      .leafs_array = leafs_array,
+      .leafs_begin = nth[0],
+      .leafs_end = nth[partitions],
+      .split_axis = split_axis,
+      .key_min = key_min,
+      .key_scale = (float)KDOPBVH_SPLIT_BINS / key_range,
+  };
+  const int leafs_num = data.leafs_end - data.leafs_begin;
+  /* Chunks don't depend on the number of threads so the resulting tree doesn't either. */
+  const int chunks_num = (leafs_num + KDOPBVH_SPLIT_CHUNK_SIZE - 1) / KDOPBVH_SPLIT_CHUNK_SIZE;
+  data.chunks_bins = MEM_mallocN(sizeof(*data.chunks_bins) * (size_t)chunks_num, __func__);
+  data.leafs_binned = MEM_mallocN(sizeof(*data.leafs_binned) * (size_t)leafs_num, __func__);
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  BLI_task_parallel_range(0, chunks_num, &data, split_leafs_bins_count_task_cb, &settings);
+
+  /* Position of each bin, and of each chunk within the bins. */
+  int bins_begin[KDOPBVH_SPLIT_BINS + 1];
+  int offset = data.leafs_begin;
+  for (int bin = 0; bin < KDOPBVH_SPLIT_BINS; bin++) {
+    bins_begin[bin] = offset;
+    for (int chunk = 0; chunk < chunks_num; chunk++) {
+      const int bin_len = data.chunks_bins[chunk][bin];
+      data.chunks_bins[chunk][bin] = offset;
+      offset += bin_len;
+    }
+  }
+  bins_begin[KDOPBVH_SPLIT_BINS] = offset;
+  BLI_assert(offset == data.leafs_end);
+
+  BLI_task_parallel_range(0, chunks_num, &data, split_leafs_bins_scatter_task_cb, &settings);
+  memcpy(&leafs_array[data.leafs_begin],
+         data.leafs_binned,
+         sizeof(*data.leafs_binned) * (size_t)leafs_num);
+
+  MEM_freeN(data.chunks_bins);
+  MEM_freeN(data.leafs_binned);
+
+  int bin = 0;
+  for (int i = 1; i < partitions; i++) {
+    if (nth[i] >= nth[partitions]) {
+      break;
+    }
+    while (bins_begin[bin + 1] <= nth[i]) {
+      bin++;
+    }
+    /* Leafs before the previous split position are already partitioned. */
+    const int begin = max_ii(bins_begin[bin], nth[i - 1]);
+    partition_nth_element(leafs_array, begin, bins_begin[bin + 1], nth[i], split_axis);
+  }
+}
+
 typedef struct BVHDivNodesData {
   const BVHTree *tree;
   BVHNode *branches_array;
@@ -719,10 +971,17 @@ static void non_recursive_bvh_div_nodes_task_cb(void *__restrict userdata,
 
   int parent_leafs_begin = implicit_leafs_index(data->data, data->depth, parent_level_index);
   int parent_leafs_end = implicit_leafs_index(data->data, data->depth, parent_level_index + 1);
+  const bool use_threading = (parent_leafs_end - parent_leafs_begin >
+                              KDOPBVH_THREAD_SPLIT_THRESHOLD);
 
   /* This calculates the bounding box of this branch
    * and chooses the largest axis as the axis to divide leafs */
-  refit_kdop_hull(data->tree, parent, parent_leafs_begin, parent_leafs_end);
+  if (use_threading) {
+    refit_kdop_hull_parallel(data->tree, parent, parent_leafs_begin, parent_leafs_end);
+  }
+  else {
+    refit_kdop_hull(data->tree, parent, parent_leafs_begin, parent_leafs_end);
+  }
   split_axis = get_largest_axis(parent->bv);
 
   /* Save split axis (this can be used on ray-tracing to speedup the query time) */
@@ -741,7 +1000,13 @@ static void non_recursive_bvh_div_nodes_task_cb(void *__restrict userdata,
     nth_positions[k] = implicit_leafs_index(data->data, data->depth + 1, child_level_index);
   }
 
-  split_leafs(data->leafs_array, nth_positions, data->tree_type, split_axis);
+  if (use_threading) {
+    split_leafs_parallel(
+        data->leafs_array, nth_positions, data->tree_type, split_axis, parent->bv);
+  }
+  else {
+    split_leafs(data->leafs_array, nth_positions, data->tree_type, split_axis);
+  }
 
   /* Setup children and totnode counters
    * Not really needed but currently most of BVH code
@@ -865,6 +1130,194 @@ static void non_recursive_bvh_div_nodes(const BVHTree *tree,
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name BLI_bvhtree_compact_layout
+ *
+ * Optional copy of the branches of a tree with quantized bounds, stored contiguously
+ * in depth first order. Queries on large trees are mostly limited by cache misses,
+ * the regular nodes need to follow a pointer per child & bounding volume.
+ * \{ */
+
+BLI_INLINE float bvhtree_compact_dequantize(const BVHTreeCompact *compact,
+                                            const int axis,
+                                            const uint16_t value)
+{
+  return compact->origin[axis] + (float)value * compact->scale[axis];
+}
+
+/**
+ * Quantize a bound, rounding outwards with an extra step (so the quantized bounds always contain
+ * the original bounds regardless of the floating point error of #bvhtree_compact_dequantize).
+ */
+static uint16_t bvhtree_compact_quantize(const BVHTreeCompact *compact,
+                                         const int axis,
+                                         const float value,
+                                         const bool is_max)
+{
+  float step = (value - compact->origin[axis]) * compact->scale_inv[axis];
+  /* Truncating is flooring as the steps are clamped to positive values. */
+  step = is_max ? step + 2.0f : step - 1.0f;
+  CLAMP(step, 0.0f, 65535.0f);
+  return (uint16_t)step;
+}
+
+/**
+ * Get the bounding volume of a child of a compact node, in the regular `bv` layout.
+ */
+BLI_INLINE void bvhtree_compact_child_bv(const BVHTreeCompact *compact,
+                                         const BVHCompactNode *cnode,
+                                         const int child,
+                                         float r_bv[6])
+{
+  for (int axis = 0; axis < 3; axis++) {
+    r_bv[axis * 2] = bvhtree_compact_dequantize(compact, axis, cnode->bounds[axis][0][child]);
+    r_bv[axis * 2 + 1] = bvhtree_compact_dequantize(compact, axis, cnode->bounds[axis][1][child]);
+  }
+}
+
+/**
+ * Quantize a bounding volume (in the regular `bv` layout) to the range of the compact layout.
+ */
+static void bvhtree_compact_quantize_bv(const BVHTreeCompact *compact,
+                                        const float bv[6],
+                                        uint16_t r_bv_quantized[3][2])
+{
+  for (int axis = 0; axis < 3; axis++) {
+    r_bv_quantized[axis][0] = bvhtree_compact_quantize(compact, axis, bv[axis * 2], false);
+    r_bv_quantized[axis][1] = bvhtree_compact_quantize(compact, axis, bv[axis * 2 + 1], true);
+  }
+}
+
+BLI_INLINE bool bvhtree_compact_child_overlap_test(const BVHCompactNode *cnode,
+                                                   const int child,
+                                                   const uint16_t bv_quantized[3][2])
+{
+  for (int axis = 0; axis < 3; axis++) {
+    if ((cnode->bounds[axis][0][child] > bv_quantized[axis][1]) ||
+        (bv_quantized[axis][0] > cnode->bounds[axis][1][child])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static int bvhtree_compact_build_recursive(BVHTreeCompact *compact,
+                                           const BVHTree *tree,
+                                           const BVHNode *node)
+{
+  const int index = compact->nodes_num++;
+  BVHCompactNode *cnode = &compact->nodes[index];
+
+  compact->nodes_orig[index] = node;
+  for (int i = 0; i < 4; i++) {
+    if (i < node->totnode) {
+      const BVHNode *child = node->children[i];
+      cnode->children[i] = child->totnode ? bvhtree_compact_build_recursive(compact, tree, child) :
+                                            -(int)(child - tree->nodearray) - 1;
+    }
+    else {
+      cnode->children[i] = BVH_COMPACT_NONE;
+    }
+  }
+  return index;
+}
+
+static void bvhtree_compact_quantize_task_cb(void *__restrict userdata,
+                                             const int index,
+                                             const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const BVHTreeCompact *compact = userdata;
+  BVHCompactNode *cnode = &compact->nodes[index];
+  const BVHNode *node = compact->nodes_orig[index];
+
+  for (int i = 0; i < 4; i++) {
+    uint16_t bv_quantized[3][2] = {{0}};
+    if (i < node->totnode) {
+      bvhtree_compact_quantize_bv(compact, node->children[i]->bv, bv_quantized);
+    }
+    for (int axis = 0; axis < 3; axis++) {
+      cnode->bounds[axis][0][i] = bv_quantized[axis][0];
+      cnode->bounds[axis][1][i] = bv_quantized[axis][1];
+    }
+  }
+}
+
+/**
+ * Quantize the bounds of all compact nodes, the quantization range is the root bounds.
+ */
+static void bvhtree_compact_update(BVHTree *tree)
+{
+  BVHTreeCompact *compact = tree->compact;
+  const float *root_bv = tree->nodes[tree->totleaf]->bv;
+
+  for (int axis = 0; axis < 3; axis++) {
+    const float extent = root_bv[axis * 2 + 1] - root_bv[axis * 2];
+    compact->origin[axis] = root_bv[axis * 2];
+    compact->scale[axis] = (extent > 0.0f) ? extent / BVH_COMPACT_QUANTIZE_STEPS : 1.0f;
+    compact->scale_inv[axis] = 1.0f / compact->scale[axis];
+  }
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (compact->nodes_num > KDOPBVH_THREAD_LEAF_THRESHOLD);
+  BLI_task_parallel_range(
+      0, compact->nodes_num, compact, bvhtree_compact_quantize_task_cb, &settings);
+}
+
+static void bvhtree_compact_free(BVHTree *tree)
+{
+  if (tree->compact) {
+    MEM_freeN(tree->compact->nodes);
+    MEM_freeN((void *)tree->compact->nodes_orig);
+    MEM_freeN(tree->compact);
+    tree->compact = NULL;
+  }
+}
+
+/**
+ * Build a compact copy of the tree, used by #BLI_bvhtree_find_nearest_ex
+ * (without #BVH_NEAREST_OPTIMAL_ORDER) and #BLI_bvhtree_overlap_ex (without `max_interactions`,
+ * when both trees have it). It's kept up to date by #BLI_bvhtree_update_tree.
+ *
+ * Call after #BLI_bvhtree_balance, this is additional memory (64 bytes per branch)
+ * so it's only worth it for trees that are queried often.
+ *
+ * \return false when the tree isn't supported (only `tree_type` 4 with `axis` 6 is).
+ */
+bool BLI_bvhtree_compact_layout_build(BVHTree *tree)
+{
+  if (tree->tree_type != 4 || tree->axis != 6 || tree->totleaf == 0) {
+    return false;
+  }
+  /* Not balanced yet. */
+  if (tree->totbranch == 0) {
+    BLI_assert(0);
+    return false;
+  }
+
+  bvhtree_compact_free(tree);
+
+  BVHTreeCompact *compact = MEM_callocN(sizeof(*compact), __func__);
+  compact->nodes = MEM_mallocN_aligned(
+      sizeof(*compact->nodes) * (size_t)tree->totbranch, 64, "BVHCompactNode");
+  compact->nodes_orig = MEM_mallocN(sizeof(*compact->nodes_orig) * (size_t)tree->totbranch,
+                                    "BVHCompactNodeOrig");
+  tree->compact = compact;
+
+  bvhtree_compact_build_recursive(compact, tree, tree->nodes[tree->totleaf]);
+  BLI_assert(compact->nodes_num <= tree->totbranch);
+  bvhtree_compact_update(tree);
+
+  return true;
+}
+
+bool BLI_bvhtree_has_compact_layout(const BVHTree *tree)
+{
+  return tree->compact != NULL;
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name BLI_bvhtree API
  * \{ */
@@ -947,6 +1400,7 @@ fail:
 void BLI_bvhtree_free(BVHTree *tree)
 {
   if (tree) {
+    bvhtree_compact_free(tree);
     MEM_SAFE_FREE(tree->nodes);
     MEM_SAFE_FREE(tree->nodearray);
     MEM_SAFE_FREE(tree->nodebv);
@@ -963,6 +1417,10 @@ void BLI_bvhtree_balance(BVHTree *tree)
    * (some big bug goes here if its being called more than once per tree) */
   BLI_assert(tree->totbranch == 0);
 
+  /* The compact nodes reference the branches, rebuild them once the branches are. */
+  const bool use_compact = (tree->compact != NULL);
+  bvhtree_compact_free(tree);
+
   /* Build the implicit tree */
   non_recursive_bvh_div_nodes(
       tree, tree->nodearray + (tree->totleaf - 1), leafs_array, tree->totleaf);
@@ -985,6 +1443,10 @@ void BLI_bvhtree_balance(BVHTree *tree)
 #ifdef USE_PRINT_TREE
   bvhtree_info(tree);
 #endif
+
+  if (use_compact) {
+    BLI_bvhtree_compact_layout_build(tree);
+  }
 }
 
 static void bvhtree_node_inflate(const BVHTree *tree, BVHNode *node, const float dist)
@@ -1040,20 +1502,45 @@ bool BLI_bvhtree_update_node(
   return true;
 }
 
+static void bvhtree_update_tree_task_cb(void *__restrict userdata,
+                                        const int i,
+                                        const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BVHTree *tree = userdata;
+  node_join(tree, tree->nodes[tree->totleaf + i]);
+}
+
 /**
  * Call #BLI_bvhtree_update_node() first for every node/point/triangle.
  */
 void BLI_bvhtree_update_tree(BVHTree *tree)
 {
-  /* Update bottom=>top
-   * TRICKY: the way we build the tree all the children have an index greater than the parent
-   * This allows us todo a bottom up update by starting on the bigger numbered branch. */
+  /* Update bottom=>top, one level of the tree at a time.
+   * TRICKY: the way we build the tree (see #non_recursive_bvh_div_nodes) the children of all
+   * branches of a level are in the next level, so the branches of a level can be updated
+   * in parallel once the next level is done. */
+  const int tree_offset = 2 - tree->tree_type;
+  int levels_begin[32];
+  int levels_num = 0;
 
-  BVHNode **root = tree->nodes + tree->totleaf;
-  BVHNode **index = tree->nodes + tree->totleaf + tree->totbranch - 1;
+  /* Branch indices are one based, as in #non_recursive_bvh_div_nodes. */
+  for (int i = 1; i <= tree->totbranch; i = i * tree->tree_type + tree_offset) {
+    BLI_assert(levels_num < (int)ARRAY_SIZE(levels_begin));
+    levels_begin[levels_num++] = i;
+  }
+
+  for (int level = levels_num - 1; level >= 0; level--) {
+    const int start = levels_begin[level] - 1;
+    const int stop = (level + 1 < levels_num) ? levels_begin[level + 1] - 1 : tree->totbranch;
+
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    settings.use_threading = (stop - start > KDOPBVH_THREAD_LEAF_THRESHOLD);
+    BLI_task_parallel_range(start, stop, tree, bvhtree_update_tree_task_cb, &settings);
+  }
 
-  for (; index >= root; index--) {
-    node_join(tree, *index);
+  if (tree->compact) {
+    bvhtree_compact_update(tree);
   }
 }
 /**
@@ -1247,6 +1734,78 @@ static bool tree_overlap_traverse_num(BVHOverlapData_Thread *data_thread,
   return false;
 }
 
+static bool tree_overlap_test_aabb(const float bv1[6], const float bv2[6])
+{
+  for (int i = 0; i < 6; i += 2) {
+    if ((bv1[i] > bv2[i + 1]) || (bv2[i] > bv1[i + 1])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * a version of #tree_overlap_traverse_cb for the compact layout of both trees,
+ * nodes are compact node indices or encoded leafs (see #BVHCompactNode.children).
+ * The caller must check `bv1` & `bv2` overlap.
+ */
+static void tree_overlap_traverse_compact(BVHOverlapData_Thread *data_thread,
+                                          const int node1,
+                                          const float bv1[6],
+                                          const int node2,
+                                          const float bv2[6])
+{
+  BVHOverlapData_Shared *data = data_thread->shared;
+  float bv_child[6];
+  int j;
+
+  if (node1 >= 0 || node2 >= 0) {
+    /* Descend node1 first, the children are tested against the other bounds quantized
+     * the same way, only the bounds of overlapping children are converted back. */
+    const bool use_node1 = (node1 >= 0);
+    const BVHTreeCompact *compact = use_node1 ? data->tree1->compact : data->tree2->compact;
+    const BVHCompactNode *cnode = &compact->nodes[use_node1 ? node1 : node2];
+    const float *bv_other = use_node1 ? bv2 : bv1;
+    uint16_t bv_other_quantized[3][2];
+    bvhtree_compact_quantize_bv(compact, bv_other, bv_other_quantized);
+
+    for (j = 0; j < 4 && cnode->children[j] != BVH_COMPACT_NONE; j++) {
+      if (!bvhtree_compact_child_overlap_test(cnode, j, bv_other_quantized)) {
+        continue;
+      }
+      bvhtree_compact_child_bv(compact, cnode, j, bv_child);
+      if (use_node1) {
+        tree_overlap_traverse_compact(data_thread, cnode->children[j], bv_child, node2, bv2);
+      }
+      else {
+        tree_overlap_traverse_compact(data_thread, node1, bv1, cnode->children[j], bv_child);
+      }
+    }
+  }
+  else {
+    const BVHNode *leaf1 = &data->tree1->nodearray[-(node1 + 1)];
+    const BVHNode *leaf2 = &data->tree2->nodearray[-(node2 + 1)];
+    BVHTreeOverlap *overlap;
+
+    if (UNLIKELY(leaf1 == leaf2)) {
+      return;
+    }
+
+    /* The quantized bounds are larger, test the leaf bounds. */
+    if (!tree_overlap_test(leaf1, leaf2, data->start_axis, data->stop_axis)) {
+      return;
+    }
+
+    if (!data->callback ||
+        data->callback(data->userdata, leaf1->index, leaf2->index, data_thread->thread)) {
+      /* both leafs, insert overlap! */
+      overlap = BLI_stack_push_r(data_thread->overlap);
+      overlap->indexA = leaf1->index;
+      overlap->indexB = leaf2->index;
+    }
+  }
+}
+
 /**
  * Use to check the total number of threads #BLI_bvhtree_overlap will use.
  *
@@ -1264,7 +1823,16 @@ static void bvhtree_overlap_task_cb(void *__restrict userdata,
   BVHOverlapData_Thread *data = &((BVHOverlapData_Thread *)userdata)[j];
   BVHOverlapData_Shared *data_shared = data->shared;
 
-  if (data->max_interactions) {
+  if (data_shared->use_compact) {
+    const BVHTreeCompact *compact1 = data_shared->tree1->compact;
+    const float *bv2 = data_shared->tree2->nodes[data_shared->tree2->totleaf]->bv;
+    float bv1[6];
+    bvhtree_compact_child_bv(compact1, &compact1->nodes[0], j, bv1);
+    if (tree_overlap_test_aabb(bv1, bv2)) {
+      tree_overlap_traverse_compact(data, compact1->nodes[0].children[j], bv1, 0, bv2);
+    }
+  }
+  else if (data->max_interactions) {
     tree_overlap_traverse_num(data,
                               data_shared->tree1->nodes[data_shared->tree1->totleaf]->children[j],
                               data_shared->tree2->nodes[data_shared->tree2->totleaf]);
@@ -1329,6 +1897,7 @@ BVHTreeOverlap *BLI_bvhtree_overlap_ex(
   data_shared.tree2 = tree2;
   data_shared.start_axis = start_axis;
   data_shared.stop_axis = stop_axis;
+  data_shared.use_compact = (tree1->compact && tree2->compact && max_interactions == 0);
 
   /* can be NULL */
   data_shared.callback = callback;
@@ -1351,7 +1920,10 @@ BVHTreeOverlap *BLI_bvhtree_overlap_ex(
     BLI_task_parallel_range(0, root_node_len, data, bvhtree_overlap_task_cb, &settings);
   }
   else {
-    if (max_interactions) {
+    if (data_shared.use_compact) {
+      tree_overlap_traverse_compact(data, 0, root1->bv, 0, root2->bv);
+    }
+    else if (max_interactions) {
       tree_overlap_traverse_num(data, root1, root2);
     }
     else if (callback) {
@@ -1540,6 +2112,79 @@ static void dfs_find_nearest_begin(BVHNearestData *data, BVHNode *node)
   dfs_find_nearest_dfs(data, node);
 }
 
+/* Depth first search on the compact layout, children are visited from nearest to farthest. */
+static void dfs_find_nearest_compact_dfs(BVHNearestData *data,
+                                         const BVHTreeCompact *compact,
+                                         const int index)
+{
+  const BVHCompactNode *cnode = &compact->nodes[index];
+  float dist_sq[4];
+  int order[4];
+  int children_num = 0;
+
+  for (int i = 0; i < 4 && cnode->children[i] != BVH_COMPACT_NONE; i++) {
+    dist_sq[i] = 0.0f;
+    for (int axis = 0; axis < 3; axis++) {
+      const float bv_min = bvhtree_compact_dequantize(compact, axis, cnode->bounds[axis][0][i]);
+      const float bv_max = bvhtree_compact_dequantize(compact, axis, cnode->bounds[axis][1][i]);
+      const float val = data->proj[axis];
+      const float dist = (val < bv_min) ? bv_min - val : ((val > bv_max) ? val - bv_max : 0.0f);
+      dist_sq[i] += dist * dist;
+    }
+
+    /* Insertion sort by distance. */
+    int j = children_num++;
+    for (; j > 0 && dist_sq[order[j - 1]] > dist_sq[i]; j--) {
+      order[j] = order[j - 1];
+    }
+    order[j] = i;
+  }
+
+  for (int j = 0; j < children_num; j++) {
+    const int i = order[j];
+    if (dist_sq[i] >= data->nearest.dist_sq) {
+      /* All remaining children are further away. */
+      break;
+    }
+
+    const int child = cnode->children[i];
+    if (child >= 0) {
+      dfs_find_nearest_compact_dfs(data, compact, child);
+    }
+    else {
+      /* The quantized bounds are larger, test the leaf bounds so the callback isn't called
+       * for leafs the exact bounds exclude. Note that the callback may still be called for
+       * other leafs (and in another order) than with #dfs_find_nearest_dfs,
+       * since children are visited nearest first. */
+      BVHNode *leaf = &data->tree->nodearray[-(child + 1)];
+      float nearest[3];
+      const float leaf_dist_sq = calc_nearest_point_squared(data->proj, leaf, nearest);
+      if (leaf_dist_sq >= data->nearest.dist_sq) {
+        continue;
+      }
+
+      if (data->callback) {
+        data->callback(data->userdata, leaf->index, data->co, &data->nearest);
+      }
+      else {
+        data->nearest.index = leaf->index;
+        data->nearest.dist_sq = leaf_dist_sq;
+        copy_v3_v3(data->nearest.co, nearest);
+      }
+    }
+  }
+}
+
+static void dfs_find_nearest_compact_begin(BVHNearestData *data, BVHNode *root)
+{
+  float nearest[3], dist_sq;
+  dist_sq = calc_nearest_point_squared(data->proj, root, nearest);
+  if (dist_sq >= data->nearest.dist_sq) {
+    return;
+  }
+  dfs_find_nearest_compact_dfs(data, data->tree->compact, 0);
+}
+
 /* Priority queue method */
 static void heap_find_nearest_inner(BVHNearestData *data, HeapSimple *heap, BVHNode *node)
 {
@@ -1621,6 +2266,9 @@ int BLI_bvhtree_find_nearest_ex(BVHTree *tree,
     if (flag & BVH_NEAREST_OPTIMAL_ORDER) {
       heap_find_nearest_begin(&data, root);
     }
+    else if (tree->compact) {
+      dfs_find_nearest_compact_begin(&data, root);
+    }
     else {
       dfs_find_nearest_begin(&data, root);
     }
@@ -2060,6 +2708,214 @@ void BLI_bvhtree_ray_cast_all(BVHTree *tree,
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name BLI_bvhtree_ray_cast_batch
+ *
+ * Coherent rays (with similar origins & directions) mostly visit the same nodes,
+ * so they're traversed together in packets, testing all rays of the packet against a node
+ * at once. Once only a single ray of the packet remains it continues with #dfs_raycast.
+ *
+ * \{ */
+
+/**
+ * Test all active rays of the packet against the bounding volume of the node,
+ * the same test as #fast_ray_nearest_hit (with the same results).
+ *
+ * \return The mask of rays that hit the node before their current hit,
+ * the distance to the node is written to \a r_dist.
+ */
+static int ray_packet_nearest_hit(const BVHRayCastPacketData *data,
+                                  const BVHNode *node,
+                                  const int mask,
+                                  float r_dist[BVH_RAYCAST_PACKET_SIZE])
+{
+#ifdef __SSE2__
+  const float *bv = node->bv;
+  __m128 t1[3], t2[3];
+
+  for (int axis = 0; axis < 3; axis++) {
+    const __m128 origin = _mm_loadu_ps(data->origin[axis]);
+    const __m128 idot = _mm_loadu_ps(data->idot_axis[axis]);
+    const __m128 sign = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)data->sign_mask[axis]));
+    const __m128 ta = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bv[2 * axis]), origin), idot);
+    const __m128 tb = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bv[2 * axis + 1]), origin), idot);
+    t1[axis] = _mm_or_ps(_mm_and_ps(sign, tb), _mm_andnot_ps(sign, ta));
+    t2[axis] = _mm_or_ps(_mm_and_ps(sign, ta), _mm_andnot_ps(sign, tb));
+  }
+
+  const __m128 zero = _mm_setzero_ps();
+  __m128 miss = _mm_or_ps(_mm_cmpgt_ps(t1[0], t2[1]), _mm_cmplt_ps(t2[0], t1[1]));
+  miss = _mm_or_ps(miss, _mm_or_ps(_mm_cmpgt_ps(t1[0], t2[2]), _mm_cmplt_ps(t2[0], t1[2])));
+  miss = _mm_or_ps(miss, _mm_or_ps(_mm_cmpgt_ps(t1[1], t2[2]), _mm_cmplt_ps(t2[1], t1[2])));
+  miss = _mm_or_ps(miss, _mm_or_ps(_mm_cmplt_ps(t2[0], zero), _mm_cmplt_ps(t2[1], zero)));
+  miss = _mm_or_ps(miss, _mm_cmplt_ps(t2[2], zero));
+
+  const __m128 hit_dist = _mm_setr_ps(data->rays[0]->hit.dist,
+                                      data->rays[1]->hit.dist,
+                                      data->rays[2]->hit.dist,
+                                      data->rays[3]->hit.dist);
+  /* Same as #max_fff. */
+  const __m128 dist = _mm_max_ps(_mm_max_ps(t1[0], t1[1]), t1[2]);
+  const __m128 hit = _mm_andnot_ps(miss, _mm_cmpnge_ps(dist, hit_dist));
+
+  _mm_storeu_ps(r_dist, dist);
+  return _mm_movemask_ps(hit) & mask;
+#else
+  int hit_mask = 0;
+  for (int i = 0; i < BVH_RAYCAST_PACKET_SIZE; i++) {
+    if (mask & (1 << i)) {
+      r_dist[i] = fast_ray_nearest_hit(data->rays[i], node);
+      if (!(r_dist[i] >= data->rays[i]->hit.dist)) {
+        hit_mask |= (1 << i);
+      }
+    }
+  }
+  return hit_mask;
+#endif
+}
+
+static void dfs_raycast_packet(BVHRayCastPacketData *data, BVHNode *node, int mask)
+{
+  int i;
+  float dist[BVH_RAYCAST_PACKET_SIZE];
+
+  mask = ray_packet_nearest_hit(data, node, mask, dist);
+  if (mask == 0) {
+    return;
+  }
+
+  if (node->totnode == 0) {
+    for (int lane = 0; lane < BVH_RAYCAST_PACKET_SIZE; lane++) {
+      if (mask & (1 << lane)) {
+        BVHRayCastData *ray_data = data->rays[lane];
+        if (ray_data->callback) {
+          ray_data->callback(ray_data->userdata, node->index, &ray_data->ray, &ray_data->hit);
+        }
+        else {
+          ray_data->hit.index = node->index;
+          ray_data->hit.dist = dist[lane];
+          madd_v3_v3v3fl(
+              ray_data->hit.co, ray_data->ray.origin, ray_data->ray.direction, dist[lane]);
+        }
+      }
+    }
+    return;
+  }
+
+  /* The rays diverged, continue with the single remaining ray. */
+  if (count_bits_i((uint)mask) == 1) {
+    BVHRayCastData *ray_data = data->rays[bitscan_forward_i(mask)];
+    if (ray_data->ray_dot_axis[node->main_axis] > 0.0f) {
+      for (i = 0; i != node->totnode; i++) {
+        dfs_raycast(ray_data, node->children[i]);
+      }
+    }
+    else {
+      for (i = node->totnode - 1; i >= 0; i--) {
+        dfs_raycast(ray_data, node->children[i]);
+      }
+    }
+    return;
+  }
+
+  /* Every ray visits the children in its own loop direction as #dfs_raycast does, so ties are
+   * resolved the same way. Rays going the other way continue as a packet of their own. */
+  int mask_forward = 0;
+  for (int lane = 0; lane < BVH_RAYCAST_PACKET_SIZE; lane++) {
+    if ((mask & (1 << lane)) && data->rays[lane]->ray_dot_axis[node->main_axis] > 0.0f) {
+      mask_forward |= (1 << lane);
+    }
+  }
+  const int mask_backward = mask & ~mask_forward;
+  if (mask_forward) {
+    for (i = 0; i != node->totnode; i++) {
+      dfs_raycast_packet(data, node->children[i], mask_forward);
+    }
+  }
+  if (mask_backward) {
+    for (i = node->totnode - 1; i >= 0; i--) {
+      dfs_raycast_packet(data, node->children[i], mask_backward);
+    }
+  }
+}
+
+/**
+ * Cast many rays, giving the same results as calling #BLI_bvhtree_ray_cast_ex for each ray.
+ *
+ * Neighboring rays (in the arrays) are traversed together, so this is faster
+ * than casting the rays one at a time when neighboring rays are similar
+ * (casting from adjacent vertices or pixels for example).
+ *
+ * \param hits: The hit of each ray, initialized by the caller as for #BLI_bvhtree_ray_cast_ex
+ * (with `index = -1` and `dist` set to the maximum distance).
+ * \param callback: Called for each ray separately (as for #BLI_bvhtree_ray_cast_ex),
+ * the same \a userdata is used for all rays.
+ */
+void BLI_bvhtree_ray_cast_batch(BVHTree *tree,
+                                const float (*co)[3],
+                                const float (*dir)[3],
+                                const int rays_num,
+                                float radius,
+                                BVHTreeRayHit *hits,
+                                BVHTree_RayCastCallback callback,
+                                void *userdata,
+                                int flag)
+{
+  BVHNode *root = tree->nodes[tree->totleaf];
+  if (root == NULL) {
+    return;
+  }
+
+  /* The packet test doesn't support a radius (like #fast_ray_nearest_hit). */
+  if (radius != 0.0f) {
+    for (int i = 0; i < rays_num; i++) {
+      BLI_bvhtree_ray_cast_ex(tree, co[i], dir[i], radius, &hits[i], callback, userdata, flag);
+    }
+    return;
+  }
+
+  BVHRayCastData rays[BVH_RAYCAST_PACKET_SIZE];
+  BVHRayCastPacketData data;
+
+  for (int ray_start = 0; ray_start < rays_num; ray_start += BVH_RAYCAST_PACKET_SIZE) {
+    const int packet_len = min_ii(rays_num - ray_start, BVH_RAYCAST_PACKET_SIZE);
+
+    for (int lane = 0; lane < BVH_RAYCAST_PACKET_SIZE; lane++) {
+      const int ray_index = ray_start + min_ii(lane, packet_len - 1);
+      BVHRayCastData *ray_data = &rays[lane];
+
+      BLI_ASSERT_UNIT_V3(dir[ray_index]);
+
+      ray_data->tree = tree;
+      ray_data->callback = callback;
+      ray_data->userdata = userdata;
+
+      copy_v3_v3(ray_data->ray.origin, co[ray_index]);
+      copy_v3_v3(ray_data->ray.direction, dir[ray_index]);
+      ray_data->ray.radius = radius;
+
+      bvhtree_ray_cast_data_precalc(ray_data, flag);
+      memcpy(&ray_data->hit, &hits[ray_index], sizeof(ray_data->hit));
+
+      /* Unused lanes are inactive, they only need valid data. */
+      data.rays[lane] = (lane < packet_len) ? ray_data : &rays[0];
+      for (int axis = 0; axis < 3; axis++) {
+        data.origin[axis][lane] = ray_data->ray.origin[axis];
+        data.idot_axis[axis][lane] = ray_data->idot_axis[axis];
+        data.sign_mask[axis][lane] = (ray_data->idot_axis[axis] < 0.0f) ? ~0u : 0u;
+      }
+    }
+
+    dfs_raycast_packet(&data, root, (1 << packet_len) - 1);
+
+    for (int lane = 0; lane < packet_len; lane++) {
+      memcpy(&hits[ray_start + lane], &rays[lane].hit, sizeof(*hits));
+    }
+  }
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name BLI_bvhtree_range_query
  *
@@ -28,6 +28,7 @@
 #include "BLI_math.h"
 #include "BLI_memarena.h"
 #include "BLI_mempool.h"
+#include "BLI_task.h"
 
 #include "BLI_delaunay_2d.h"
 
@@ -86,13 +87,22 @@ typedef struct CDT_state {
   int face_edge_offset;  /* Input edge id where we start numbering the face edges. */
   MemArena *arena;       /* Most allocations are done from here, so can free all at once at end. */
   BLI_mempool *listpool; /* Allocations of ListNodes done from this pool. */
+  MemArena **task_arenas; /* Arenas of the parallel initial triangulation, or NULL. */
+  int task_arenas_len;    /* Length of task_arenas. */
   double epsilon;        /* The user-specified nearness limit. */
   double epsilon_squared; /* Square of epsilon. */
   bool output_prepared;   /* Set after the mesh has been modified for output (may not be all
                              triangles now). */
+  bool use_threading;     /* Do the initial triangulation of large inputs in parallel. */
 } CDT_state;
 
 #define DLNY_ARENASIZE 1 << 14
+/* Minimum number of sites that each task of the parallel initial triangulation handles. */
+#define DLNY_PARALLEL_SITES 4096
+/* Maximum depth of the tree of tasks of the parallel initial triangulation. */
+#define DLNY_PARALLEL_MAX_DEPTH 8
+/* Arena bytes per site in a task, enough for its edges and faces (with list nodes). */
+#define DLNY_PARALLEL_SITE_BYTES 512
 
 #ifdef DEBUG_CDT
 #  ifdef __GNUC__
@@ -565,6 +575,7 @@ static CDT_state *cdt_init(const CDT_input *in)
   cdt->epsilon = (double)in->epsilon;
   cdt->epsilon_squared = cdt->epsilon * cdt->epsilon;
   cdt->arena = arena;
+  cdt->use_threading = in->use_threading;
   cdt->input_vert_tot = in->verts_len;
   cdt->vert_array_len_alloc = 2 * in->verts_len;
   cdt->vert_array = BLI_memarena_alloc(arena,
@@ -581,6 +592,13 @@ static CDT_state *cdt_init(const CDT_input *in)
 
 static void new_cdt_free(CDT_state *cdt)
 {
+  int i;
+
+  for (i = 0; i < cdt->task_arenas_len; i++) {
+    if (cdt->task_arenas[i] != NULL) {
+      BLI_memarena_free(cdt->task_arenas[i]);
+    }
+  }
   BLI_mempool_destroy(cdt->listpool);
   BLI_memarena_free(cdt->arena);
 }
@@ -634,89 +652,24 @@ BLI_INLINE bool dc_tri_valid(SymEdge *se, SymEdge *basel, SymEdge *basel_sym)
   return orient2d(se->next->vert->co, basel_sym->vert->co, basel->vert->co) > 0.0;
 }
 
-/* Delaunay triangulate sites[start} to sites[end-1].
- * Assume sites are lexicographically sorted by coordinate.
- * Return SymEdge of ccw convex hull at left-most point in *r_le
- * and that of right-most point of cw convex null in *r_re.
+/* Merge the Delaunay triangulations of two sets of sites L and R, where all sites of L
+ * are lexicographically before those of R.
+ * ldo and ldi are the symedges that dc_tri returned for L, rdi and rdo those returned for R.
+ * Return the symedges for the merged triangulation in *r_le and *r_re, as dc_tri does.
  */
-static void dc_tri(
-    CDT_state *cdt, SiteInfo *sites, int start, int end, SymEdge **r_le, SymEdge **r_re)
+static void dc_tri_merge(CDT_state *cdt,
+                         SymEdge *ldo,
+                         SymEdge *ldi,
+                         SymEdge *rdi,
+                         SymEdge *rdo,
+                         SymEdge **r_le,
+                         SymEdge **r_re)
 {
-  int n = end - start;
-  int n2;
-  CDTVert *v1, *v2, *v3;
-  CDTEdge *ea, *eb, *ebasel;
-  SymEdge *ldo, *ldi, *rdi, *rdo, *basel, *basel_sym, *lcand, *rcand, *t;
-  double orient;
+  CDTEdge *ebasel;
+  SymEdge *basel, *basel_sym, *lcand, *rcand, *t;
   bool valid_lcand, valid_rcand;
 #ifdef DEBUG_CDT
-  char label_buf[100];
   int dbg_level = 0;
-
-  if (dbg_level > 0) {
-    fprintf(stderr, "DC_TRI start=%d end=%d\n", start, end);
-  }
-#endif
-
-  BLI_assert(r_le != NULL && r_re != NULL);
-  if (n <= 1) {
-    *r_le = NULL;
-    *r_re = NULL;
-    return;
-  }
-  if (n <= 3) {
-    v1 = sites[start].v;
-    v2 = sites[start + 1].v;
-    ea = add_cdtedge(cdt, v1, v2, cdt->outer_face, cdt->outer_face);
-    ea->symedges[0].next = &ea->symedges[1];
-    ea->symedges[1].next = &ea->symedges[0];
-    ea->symedges[0].rot = &ea->symedges[0];
-    ea->symedges[1].rot = &ea->symedges[1];
-    if (n == 2) {
-      *r_le = &ea->symedges[0];
-      *r_re = &ea->symedges[1];
-      return;
-    }
-    v3 = sites[start + 2].v;
-    eb = add_vert_to_symedge_edge(cdt, v3, &ea->symedges[1]);
-    orient = orient2d(v1->co, v2->co, v3->co);
-    if (orient > 0.0) {
-      add_diagonal(cdt, &eb->symedges[0], &ea->symedges[0]);
-      *r_le = &ea->symedges[0];
-      *r_re = &eb->symedges[0];
-    }
-    else if (orient < 0.0) {
-      add_diagonal(cdt, &ea->symedges[0], &eb->symedges[0]);
-      *r_le = ea->symedges[0].rot;
-      *r_re = eb->symedges[0].rot;
-    }
-    else {
-      /* Collinear points. Just return a line. */
-      *r_le = &ea->symedges[0];
-      *r_re = &eb->symedges[0];
-    }
-    return;
-  }
-  /* Here: n >= 4.  Divide and conquer. */
-  n2 = n / 2;
-  BLI_assert(n2 >= 2 && end - (start + n2) >= 2);
-
-  /* Delaunay triangulate two halves, L and R. */
-  dc_tri(cdt, sites, start, start + n2, &ldo, &ldi);
-  dc_tri(cdt, sites, start + n2, end, &rdi, &rdo);
-#ifdef DEBUG_CDT
-  if (dbg_level > 0) {
-    fprintf(stderr, "\nDC_TRI merge step for start=%d, end=%d\n", start, end);
-    dump_se(ldo, "ldo");
-    dump_se(ldi, "ldi");
-    dump_se(rdi, "rdi");
-    dump_se(rdo, "rdo");
-    if (dbg_level > 1) {
-      sprintf(label_buf, "dc_tri(%d,%d)(%d,%d)", start, start + n2, start + n2, end);
-      /* dump_cdt(cdt, label_buf); */
-      cdt_draw(cdt, label_buf);
-    }
-  }
 #endif
 
   /* Find lower common tangent of L and R. */
@@ -868,6 +821,237 @@ static void dc_tri(
   BLI_assert(sym(ldo)->face == cdt->outer_face && rdo->face == cdt->outer_face);
 }
 
+/* Delaunay triangulate sites[start} to sites[end-1].
+ * Assume sites are lexicographically sorted by coordinate.
+ * Return SymEdge of ccw convex hull at left-most point in *r_le
+ * and that of right-most point of cw convex null in *r_re.
+ */
+static void dc_tri(
+    CDT_state *cdt, SiteInfo *sites, int start, int end, SymEdge **r_le, SymEdge **r_re)
+{
+  int n = end - start;
+  int n2;
+  CDTVert *v1, *v2, *v3;
+  CDTEdge *ea, *eb;
+  SymEdge *ldo, *ldi, *rdi, *rdo;
+  double orient;
+#ifdef DEBUG_CDT
+  char label_buf[100];
+  int dbg_level = 0;
+
+  if (dbg_level > 0) {
+    fprintf(stderr, "DC_TRI start=%d end=%d\n", start, end);
+  }
+#endif
+
+  BLI_assert(r_le != NULL && r_re != NULL);
+  if (n <= 1) {
+    *r_le = NULL;
+    *r_re = NULL;
+    return;
+  }
+  if (n <= 3) {
+    v1 = sites[start].v;
+    v2 = sites[start + 1].v;
+    ea = add_cdtedge(cdt, v1, v2, cdt->outer_face, cdt->outer_face);
+    ea->symedges[0].next = &ea->symedges[1];
+    ea->symedges[1].next = &ea->symedges[0];
+    ea->symedges[0].rot = &ea->symedges[0];
+    ea->symedges[1].rot = &ea->symedges[1];
+    if (n == 2) {
+      *r_le = &ea->symedges[0];
+      *r_re = &ea->symedges[1];
+      return;
+    }
+    v3 = sites[start + 2].v;
+    eb = add_vert_to_symedge_edge(cdt, v3, &ea->symedges[1]);
+    orient = orient2d(v1->co, v2->co, v3->co);
+    if (orient > 0.0) {
+      add_diagonal(cdt, &eb->symedges[0], &ea->symedges[0]);
+      *r_le = &ea->symedges[0];
+      *r_re = &eb->symedges[0];
+    }
+    else if (orient < 0.0) {
+      add_diagonal(cdt, &ea->symedges[0], &eb->symedges[0]);
+      *r_le = ea->symedges[0].rot;
+      *r_re = eb->symedges[0].rot;
+    }
+    else {
+      /* Collinear points. Just return a line. */
+      *r_le = &ea->symedges[0];
+      *r_re = &eb->symedges[0];
+    }
+    return;
+  }
+  /* Here: n >= 4.  Divide and conquer. */
+  n2 = n / 2;
+  BLI_assert(n2 >= 2 && end - (start + n2) >= 2);
+
+  /* Delaunay triangulate two halves, L and R. */
+  dc_tri(cdt, sites, start, start + n2, &ldo, &ldi);
+  dc_tri(cdt, sites, start + n2, end, &rdi, &rdo);
+#ifdef DEBUG_CDT
+  if (dbg_level > 0) {
+    fprintf(stderr, "\nDC_TRI merge step for start=%d, end=%d\n", start, end);
+    dump_se(ldo, "ldo");
+    dump_se(ldi, "ldi");
+    dump_se(rdi, "rdi");
+    dump_se(rdo, "rdo");
+    if (dbg_level > 1) {
+      sprintf(label_buf, "dc_tri(%d,%d)(%d,%d)", start, start + n2, start + n2, end);
+      /* dump_cdt(cdt, label_buf); */
+      cdt_draw(cdt, label_buf);
+    }
+  }
+#endif
+
+  dc_tri_merge(cdt, ldo, ldi, rdi, rdo, r_le, r_re);
+}
+
+/* A part of the sites in the parallel version of dc_tri.
+ * The parts form a complete binary tree, stored in an array with the children of
+ * node i at 2 * i + 1 and 2 * i + 2, split at the same places as dc_tri splits the sites.
+ */
+typedef struct DCTriNode {
+  int start; /* Sites of the node are sites[start] to sites[end-1]. */
+  int end;
+  SymEdge *le; /* Result of dc_tri for the sites of the node. */
+  SymEdge *re;
+  LinkNodePair edges; /* Edges made for the node and its descendants, in cdt->edges order. */
+  LinkNodePair faces; /* Faces made for the node and its descendants, in cdt->faces order. */
+} DCTriNode;
+
+typedef struct DCTriParallelData {
+  CDT_state *cdt;
+  SiteInfo *sites;
+  DCTriNode *nodes;
+  int level_start; /* Index of the first node of the level being processed. */
+  bool is_leaf_level;
+} DCTriParallelData;
+
+/* Append list src to the end of list dst. */
+static void linklist_pair_concat(LinkNodePair *dst, const LinkNodePair *src)
+{
+  if (src->list == NULL) {
+    return;
+  }
+  if (dst->list == NULL) {
+    *dst = *src;
+    return;
+  }
+  dst->last_node->next = src->list;
+  dst->last_node = src->last_node;
+}
+
+/* Triangulate the sites of a leaf, or merge the triangulations of the children of a node.
+ * Every task allocates from its own arena and makes its own edge and face lists, with a copy
+ * of cdt that is only used by this task.
+ * The lists are joined in the order that dc_tri would have prepended the elements in, so that
+ * the output is the same as that of the serial version.
+ * Neither dc_tri nor dc_tri_merge change the outer face or use the shared cdt->listpool.
+ */
+static void dc_tri_parallel_task_cb(void *__restrict userdata,
+                                    const int iter,
+                                    const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  DCTriParallelData *data = userdata;
+  const int node_index = data->level_start + iter;
+  DCTriNode *node = &data->nodes[node_index];
+  DCTriNode *left = NULL, *right = NULL;
+  CDT_state task_cdt = *data->cdt;
+  size_t arena_size = DLNY_ARENASIZE;
+
+  if (data->is_leaf_level) {
+    /* All elements of a leaf are made together, keep them in one block of memory. */
+    arena_size = (size_t)(node->end - node->start) * DLNY_PARALLEL_SITE_BYTES;
+  }
+  task_cdt.arena = BLI_memarena_new(arena_size, __func__);
+  task_cdt.listpool = NULL;
+  task_cdt.edges = NULL;
+  task_cdt.faces = NULL;
+  data->cdt->task_arenas[node_index] = task_cdt.arena;
+
+  if (data->is_leaf_level) {
+    dc_tri(&task_cdt, data->sites, node->start, node->end, &node->le, &node->re);
+  }
+  else {
+    left = &data->nodes[2 * node_index + 1];
+    right = &data->nodes[2 * node_index + 2];
+    dc_tri_merge(&task_cdt, left->le, left->re, right->le, right->re, &node->le, &node->re);
+  }
+  BLI_assert(task_cdt.outer_face == data->cdt->outer_face);
+
+  node->edges.list = task_cdt.edges;
+  node->edges.last_node = BLI_linklist_find_last(task_cdt.edges);
+  node->faces.list = task_cdt.faces;
+  node->faces.last_node = BLI_linklist_find_last(task_cdt.faces);
+  if (!data->is_leaf_level) {
+    linklist_pair_concat(&node->edges, &right->edges);
+    linklist_pair_concat(&node->edges, &left->edges);
+    linklist_pair_concat(&node->faces, &right->faces);
+    linklist_pair_concat(&node->faces, &left->faces);
+  }
+}
+
+/* Same as dc_tri(cdt, sites, 0, n, ...), but splits the sites into parts of at least
+ * DLNY_PARALLEL_SITES sites, which are triangulated in parallel.
+ * The parts are then merged level by level, with all merges of one level in parallel.
+ */
+static void dc_tri_parallel(CDT_state *cdt, SiteInfo *sites, int n)
+{
+  DCTriParallelData data;
+  DCTriNode *nodes;
+  LinkNodePair edges, faces;
+  TaskParallelSettings settings;
+  int depth, level, level_start, nodes_len, i, n2;
+
+  depth = 1;
+  while (depth < DLNY_PARALLEL_MAX_DEPTH && (n >> (depth + 1)) >= DLNY_PARALLEL_SITES) {
+    depth++;
+  }
+  nodes_len = (1 << (depth + 1)) - 1;
+  nodes = MEM_malloc_arrayN(nodes_len, sizeof(*nodes), __func__);
+  nodes[0].start = 0;
+  nodes[0].end = n;
+  for (i = 0; i < (1 << depth) - 1; i++) {
+    n2 = (nodes[i].end - nodes[i].start) / 2;
+    nodes[2 * i + 1].start = nodes[i].start;
+    nodes[2 * i + 1].end = nodes[i].start + n2;
+    nodes[2 * i + 2].start = nodes[i].start + n2;
+    nodes[2 * i + 2].end = nodes[i].end;
+  }
+  cdt->task_arenas = BLI_memarena_calloc(cdt->arena, nodes_len * sizeof(*cdt->task_arenas));
+  cdt->task_arenas_len = nodes_len;
+
+  data.cdt = cdt;
+  data.sites = sites;
+  data.nodes = nodes;
+  BLI_parallel_range_settings_defaults(&settings);
+  /* Every node is a lot of work, even at the top levels where there are only a few. */
+  settings.min_iter_per_thread = 1;
+  for (level = depth; level >= 0; level--) {
+    level_start = (1 << level) - 1;
+    data.level_start = level_start;
+    data.is_leaf_level = (level == depth);
+    BLI_task_parallel_range(0, level_start + 1, &data, dc_tri_parallel_task_cb, &settings);
+  }
+
+  /* The serial version prepends everything to the existing lists. */
+  edges = nodes[0].edges;
+  faces = nodes[0].faces;
+  if (cdt->edges != NULL) {
+    LinkNodePair old_edges = {cdt->edges, BLI_linklist_find_last(cdt->edges)};
+    linklist_pair_concat(&edges, &old_edges);
+  }
+  if (cdt->faces != NULL) {
+    LinkNodePair old_faces = {cdt->faces, BLI_linklist_find_last(cdt->faces)};
+    linklist_pair_concat(&faces, &old_faces);
+  }
+  cdt->edges = edges.list;
+  cdt->faces = faces.list;
+  MEM_freeN(nodes);
+}
+
 /* Guibas-Stolfi Divide-and_Conquer algorithm. */
 static void dc_triangulate(CDT_state *cdt, SiteInfo *sites, int nsites)
 {
@@ -888,6 +1072,10 @@ static void dc_triangulate(CDT_state *cdt, SiteInfo *sites, int nsites)
   if (n == 0) {
     return;
   }
+  if (cdt->use_threading && n >= 2 * DLNY_PARALLEL_SITES) {
+    dc_tri_parallel(cdt, sites, n);
+    return;
+  }
   dc_tri(cdt, sites, 0, n, &le, &re);
 }
 
@@ -902,6 +1090,8 @@ static void dc_triangulate(CDT_state *cdt, SiteInfo *sites, int nsites)
  * the quad-edge structure described in that paper.
  * The incircle and ccw tests are done using Shewchuk's exact
  * primitives (see below), so that this routine is robust.
+ * If cdt->use_threading is set, large inputs are triangulated in parallel
+ * by dc_tri_parallel, with the same result.
  *
  * As a preprocessing step, we want to merge all vertices that are
  * within cdt->epsilon of each other. This is accomplished by lexicographically
@@ -1991,6 +2181,50 @@ typedef struct EdgeVertLambda {
   double lambda;
 } EdgeVertLambda;
 
+/* Bounding box of an edge constraint, grown by epsilon. */
+typedef struct EdgeBox {
+  int e_id;
+  int v1;
+  int v2;
+  double min[2];
+  double max[2];
+} EdgeBox;
+
+static int edge_box_cmp(const void *a, const void *b)
+{
+  const EdgeBox *box_a = a;
+  const EdgeBox *box_b = b;
+
+  if (box_a->min[0] < box_b->min[0]) {
+    return -1;
+  }
+  if (box_a->min[0] > box_b->min[0]) {
+    return 1;
+  }
+  return 0;
+}
+
+/* Get the verts of edge constraint e, numbered as in modify_input_for_near_edge_ends.
+ * Return false if e is a face edge that doesn't exist. */
+static bool get_edge_constraint_verts(const CDT_input *in, int e, int *r_v1, int *r_v2)
+{
+  int f, fi, start, flen;
+
+  if (e < in->edges_len) {
+    *r_v1 = in->edges[e][0];
+    *r_v2 = in->edges[e][1];
+    return true;
+  }
+  if (!get_face_edge_id_indices(in, e, &f, &fi)) {
+    return false;
+  }
+  start = in->faces_start_table[f];
+  flen = in->faces_len_table[f];
+  *r_v1 = in->faces[start + fi];
+  *r_v2 = in->faces[(fi == flen - 1) ? start : start + fi + 1];
+  return true;
+}
+
 /* For sorting first by edge id, then by lambda, then by vert id. */
 static int evl_cmp(const void *a, const void *b)
 {
@@ -2029,13 +2263,11 @@ static int evl_cmp(const void *a, const void *b)
  *
  * If any such splits are found, make a new CDT_input reflecting this change, and provide an
  * edge map to map from edge ids in the new input space to edge ids in the old input space.
- *
- * TODO: replace naive O(n^2) algorithm with kdopbvh-based one.
  */
 static const CDT_input *modify_input_for_near_edge_ends(const CDT_input *input, int **r_edge_map)
 {
   CDT_input *new_input = NULL;
-  int e, eprev, e1, e2, f, fi, flen, start, i, j;
+  int e, eprev, e1, e2, f, flen, i, j;
   int i_new, i_old, i_evl;
   int v11, v12, v21, v22;
   double co11[2], co12[2], co21[2], co22[2];
@@ -2046,11 +2278,13 @@ static const CDT_input *modify_input_for_near_edge_ends(const CDT_input *input,
   int new_tot_face_edges, new_tot_con_edges;
   int delta_con_edges, delta_face_edges, cur_e_cnt;
   int *edge_map;
-  int evl_len;
+  int evl_len, boxes_len;
+  EdgeBox *edge_boxes, *box1, *box2;
   EdgeVertLambda *edge_vert_lambda = NULL;
   BLI_array_staticdeclare(edge_vert_lambda, 128);
 #ifdef DEBUG_CDT
   EdgeVertLambda *evl;
+  int start;
   int dbg_level = 0;
 
   if (dbg_level > 0) {
@@ -2085,41 +2319,44 @@ static const CDT_input *modify_input_for_near_edge_ends(const CDT_input *input,
   }
   tot_edge_constraints = edges_len + tot_face_edges;
 
-  for (e1 = 0; e1 < tot_edge_constraints - 1; e1++) {
-    if (e1 < edges_len) {
-      v11 = input->edges[e1][0];
-      v12 = input->edges[e1][1];
+  /* Only edges whose bounding boxes overlap when grown by epsilon can come near each other.
+   * Sweep over the edges in order of the left side of their boxes to find those pairs. */
+  edge_boxes = MEM_malloc_arrayN(tot_edge_constraints, sizeof(*edge_boxes), __func__);
+  boxes_len = 0;
+  for (e = 0; e < tot_edge_constraints; e++) {
+    if (!get_edge_constraint_verts(input, e, &v11, &v12)) {
+      /* Must be bad input. Will be caught later so don't need to signal here. */
+      continue;
     }
-    else {
-      if (!get_face_edge_id_indices(input, e1, &f, &fi)) {
-        /* Must be bad input. Will be caught later so don't need to signal here. */
+    box1 = &edge_boxes[boxes_len++];
+    box1->e_id = e;
+    box1->v1 = v11;
+    box1->v2 = v12;
+    for (i = 0; i < 2; i++) {
+      box1->min[i] = (double)min_ff(input->vert_coords[v11][i], input->vert_coords[v12][i]) - eps;
+      box1->max[i] = (double)max_ff(input->vert_coords[v11][i], input->vert_coords[v12][i]) + eps;
+    }
+  }
+  qsort(edge_boxes, boxes_len, sizeof(*edge_boxes), edge_box_cmp);
+
+  for (i = 0; i < boxes_len; i++) {
+    box1 = &edge_boxes[i];
+    for (j = i + 1; j < boxes_len && edge_boxes[j].min[0] <= box1->max[0]; j++) {
+      box2 = &edge_boxes[j];
+      if (box2->min[1] > box1->max[1] || box2->max[1] < box1->min[1]) {
         continue;
       }
-      start = input->faces_start_table[f];
-      flen = input->faces_len_table[f];
-      v11 = input->faces[start + fi];
-      v12 = input->faces[(fi == flen - 1) ? start : start + fi + 1];
-    }
-    for (e2 = e1 + 1; e2 < tot_edge_constraints; e2++) {
-      if (e2 < edges_len) {
-        v21 = input->edges[e2][0];
-        v22 = input->edges[e2][1];
-      }
-      else {
-        if (!get_face_edge_id_indices(input, e2, &f, &fi)) {
-          continue;
-        }
-        start = input->faces_start_table[f];
-        flen = input->faces_len_table[f];
-        v21 = input->faces[start + fi];
-        v22 = input->faces[(fi == flen - 1) ? start : start + fi + 1];
-      }
+      e1 = box1->e_id;
+      e2 = box2->e_id;
+      v11 = box1->v1;
+      v12 = box1->v2;
+      v21 = box2->v1;
+      v22 = box2->v2;
       copy_v2db_v2fl(co11, input->vert_coords[v11]);
       copy_v2db_v2fl(co12, input->vert_coords[v12]);
       copy_v2db_v2fl(co21, input->vert_coords[v21]);
       copy_v2db_v2fl(co22, input->vert_coords[v22]);
       if (check_vert_near_segment(co11, co21, co22, eps_sq, &lambda)) {
-
         BLI_array_append(edge_vert_lambda, ((EdgeVertLambda){e2, v11, lambda}));
       }
       if (check_vert_near_segment(co12, co21, co22, eps_sq, &lambda)) {
@@ -2133,6 +2370,7 @@ static const CDT_input *modify_input_for_near_edge_ends(const CDT_input *input,
       }
     }
   }
+  MEM_freeN(edge_boxes);
 
   evl_len = BLI_array_len(edge_vert_lambda);
   if (evl_len > 0) {
@@ -2232,6 +2470,7 @@ static const CDT_input *modify_input_for_near_edge_ends(const CDT_input *input,
      */
     new_input = MEM_callocN(sizeof(CDT_input), __func__);
     new_input->epsilon = input->epsilon;
+    new_input->use_threading = input->use_threading;
     new_input->verts_len = input->verts_len;
     new_input->vert_coords = (float(*)[2])MEM_malloc_arrayN(
         new_input->verts_len, sizeof(float[2]), __func__);
@@ -23,6 +23,7 @@
 #include "BLI_kdtree_impl.h"
 #include "BLI_math.h"
 #include "BLI_strict_flags.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 
 #define _CONCAT_AUX(MACRO_ARG1, MACRO_ARG2) MACRO_ARG1##MACRO_ARG2
@@ -56,6 +57,14 @@ struct KDTree {
 #define KD_NEAR_ALLOC_INC 100 /* alloc increment for collecting nearest */
 #define KD_FOUND_ALLOC_INC 50 /* alloc increment for collecting nearest */
 
+/* Batch queries are run in parallel when there are more queries than this. */
+#define KD_BATCH_THREAD_THRESHOLD 1024
+
+/* Searching for duplicates uses a grid instead of the tree when there are more points. */
+#define KD_DUPLICATES_GRID_THRESHOLD 256
+/* Limit the grid size, as the number of cells depends on the range. */
+#define KD_DUPLICATES_GRID_CELLS_PER_NODE 8
+
 #define KD_NODE_UNSET ((uint)-1)
 
 /**
@@ -473,25 +482,28 @@ static void nearest_ordered_insert(KDTreeNearest *nearest,
 }
 
 /**
- * Find \a nearest_len_capacity nearest returns number of points found, with results in nearest.
+ * Implementation of #BLI_kdtree_3d_find_nearest_n_with_len_squared_cb,
+ * using the callers stack (so it can be reused between queries).
  *
- * \param r_nearest: An array of nearest, sized at least \a nearest_len_capacity.
+ * \param stack_default: The initial stack of the caller (which must not be freed) or NULL.
  */
-int BLI_kdtree_nd_(find_nearest_n_with_len_squared_cb)(
-    const KDTree *tree,
-    const float co[KD_DIMS],
-    KDTreeNearest r_nearest[],
-    const uint nearest_len_capacity,
-    float (*len_sq_fn)(const float co_search[KD_DIMS],
-                       const float co_test[KD_DIMS],
-                       const void *user_data),
-    const void *user_data)
+static int kdtree_find_nearest_n_impl(const KDTree *tree,
+                                      const float co[KD_DIMS],
+                                      KDTreeNearest r_nearest[],
+                                      const uint nearest_len_capacity,
+                                      float (*len_sq_fn)(const float co_search[KD_DIMS],
+                                                         const float co_test[KD_DIMS],
+                                                         const void *user_data),
+                                      const void *user_data,
+                                      uint **stack_p,
+                                      uint *stack_len_capacity_p,
+                                      const uint *stack_default)
 {
   const KDTreeNode *nodes = tree->nodes;
   const KDTreeNode *root;
-  uint *stack, stack_default[KD_STACK_INIT];
+  uint *stack = *stack_p;
   float cur_dist;
-  uint stack_len_capacity, cur = 0;
+  uint stack_len_capacity = *stack_len_capacity_p, cur = 0;
   uint i, nearest_len = 0;
 
 #ifdef DEBUG
@@ -507,9 +519,6 @@ int BLI_kdtree_nd_(find_nearest_n_with_len_squared_cb)(
     BLI_assert(user_data == NULL);
   }
 
-  stack = stack_default;
-  stack_len_capacity = ARRAY_SIZE(stack_default);
-
   root = &nodes[tree->root];
 
   cur_dist = len_sq_fn(co, root->co, user_data);
@@ -584,11 +593,46 @@ int BLI_kdtree_nd_(find_nearest_n_with_len_squared_cb)(
     r_nearest[i].dist = sqrtf(r_nearest[i].dist);
   }
 
+  *stack_p = stack;
+  *stack_len_capacity_p = stack_len_capacity;
+
+  return (int)nearest_len;
+}
+
+/**
+ * Find \a nearest_len_capacity nearest returns number of points found, with results in nearest.
+ *
+ * \param r_nearest: An array of nearest, sized at least \a nearest_len_capacity.
+ */
+int BLI_kdtree_nd_(find_nearest_n_with_len_squared_cb)(
+    const KDTree *tree,
+    const float co[KD_DIMS],
+    KDTreeNearest r_nearest[],
+    const uint nearest_len_capacity,
+    float (*len_sq_fn)(const float co_search[KD_DIMS],
+                       const float co_test[KD_DIMS],
+                       const void *user_data),
+    const void *user_data)
+{
+  uint *stack, stack_default[KD_STACK_INIT];
+  uint stack_len_capacity = ARRAY_SIZE(stack_default);
+  stack = stack_default;
+
+  const int nearest_len = kdtree_find_nearest_n_impl(tree,
+                                                     co,
+                                                     r_nearest,
+                                                     nearest_len_capacity,
+                                                     len_sq_fn,
+                                                     user_data,
+                                                     &stack,
+                                                     &stack_len_capacity,
+                                                     stack_default);
+
   if (stack != stack_default) {
     MEM_freeN(stack);
   }
 
-  return (int)nearest_len;
+  return nearest_len;
 }
 
 int BLI_kdtree_nd_(find_nearest_n)(const KDTree *tree,
@@ -732,26 +776,26 @@ int BLI_kdtree_nd_(range_search)(const KDTree *tree,
 }
 
 /**
- * A version of #BLI_kdtree_3d_range_search which runs a callback
- * instead of allocating an array.
+ * Implementation of #BLI_kdtree_3d_range_search_cb,
+ * using the callers stack (so it can be reused between queries).
  *
- * \param search_cb: Called for every node found in \a range,
- * false return value performs an early exit.
- *
- * \note the order of calls isn't sorted based on distance.
+ * \param stack_default: The initial stack of the caller (which must not be freed) or NULL.
  */
-void BLI_kdtree_nd_(range_search_cb)(
+static void kdtree_range_search_cb_impl(
     const KDTree *tree,
     const float co[KD_DIMS],
     float range,
     bool (*search_cb)(void *user_data, int index, const float co[KD_DIMS], float dist_sq),
-    void *user_data)
+    void *user_data,
+    uint **stack_p,
+    uint *stack_len_capacity_p,
+    const uint *stack_default)
 {
   const KDTreeNode *nodes = tree->nodes;
 
-  uint *stack, stack_default[KD_STACK_INIT];
+  uint *stack = *stack_p;
   float range_sq = range * range, dist_sq;
-  uint stack_len_capacity, cur = 0;
+  uint stack_len_capacity = *stack_len_capacity_p, cur = 0;
 
 #ifdef DEBUG
   BLI_assert(tree->is_balanced == true);
@@ -761,9 +805,6 @@ void BLI_kdtree_nd_(range_search_cb)(
     return;
   }
 
-  stack = stack_default;
-  stack_len_capacity = ARRAY_SIZE(stack_default);
-
   stack[cur++] = tree->root;
 
   while (cur--) {
@@ -801,11 +842,208 @@ void BLI_kdtree_nd_(range_search_cb)(
   }
 
 finally:
+  *stack_p = stack;
+  *stack_len_capacity_p = stack_len_capacity;
+}
+
+/**
+ * A version of #BLI_kdtree_3d_range_search which runs a callback
+ * instead of allocating an array.
+ *
+ * \param search_cb: Called for every node found in \a range,
+ * false return value performs an early exit.
+ *
+ * \note the order of calls isn't sorted based on distance.
+ */
+void BLI_kdtree_nd_(range_search_cb)(
+    const KDTree *tree,
+    const float co[KD_DIMS],
+    float range,
+    bool (*search_cb)(void *user_data, int index, const float co[KD_DIMS], float dist_sq),
+    void *user_data)
+{
+  uint *stack, stack_default[KD_STACK_INIT];
+  uint stack_len_capacity = ARRAY_SIZE(stack_default);
+  stack = stack_default;
+
+  kdtree_range_search_cb_impl(
+      tree, co, range, search_cb, user_data, &stack, &stack_len_capacity, stack_default);
+
   if (stack != stack_default) {
     MEM_freeN(stack);
   }
 }
 
+/* -------------------------------------------------------------------- */
+/** \name BLI_kdtree_3d_*_batch
+ *
+ * Run many queries in parallel, each thread reusing its own traversal stack.
+ * \{ */
+
+typedef struct KDTreeBatchTLS {
+  uint *stack;
+  uint stack_len_capacity;
+} KDTreeBatchTLS;
+
+static void kdtree_batch_tls_ensure(KDTreeBatchTLS *tls)
+{
+  if (tls->stack == NULL) {
+    tls->stack_len_capacity = KD_STACK_INIT;
+    tls->stack = MEM_mallocN(sizeof(*tls->stack) * tls->stack_len_capacity, __func__);
+  }
+}
+
+static void kdtree_batch_tls_free(const void *__restrict UNUSED(userdata),
+                                  void *__restrict chunk)
+{
+  KDTreeBatchTLS *tls = chunk;
+  MEM_SAFE_FREE(tls->stack);
+}
+
+static void kdtree_batch_settings_init(TaskParallelSettings *settings,
+                                       const int co_len,
+                                       KDTreeBatchTLS *tls)
+{
+  BLI_parallel_range_settings_defaults(settings);
+  settings->use_threading = (co_len > KD_BATCH_THREAD_THRESHOLD);
+  settings->min_iter_per_thread = KD_BATCH_THREAD_THRESHOLD;
+  settings->userdata_chunk = tls;
+  settings->userdata_chunk_size = sizeof(*tls);
+  settings->func_free = kdtree_batch_tls_free;
+}
+
+struct FindNearestNBatchData {
+  const KDTree *tree;
+  const float (*co)[KD_DIMS];
+  KDTreeNearest *r_nearest;
+  uint nearest_len_capacity;
+  int *r_nearest_len;
+};
+
+static void kdtree_find_nearest_n_batch_cb(void *__restrict userdata,
+                                           const int i,
+                                           const TaskParallelTLS *__restrict tls)
+{
+  const struct FindNearestNBatchData *data = userdata;
+  KDTreeBatchTLS *batch_tls = tls->userdata_chunk;
+  kdtree_batch_tls_ensure(batch_tls);
+
+  data->r_nearest_len[i] = kdtree_find_nearest_n_impl(
+      data->tree,
+      data->co[i],
+      &data->r_nearest[(size_t)i * data->nearest_len_capacity],
+      data->nearest_len_capacity,
+      NULL,
+      NULL,
+      &batch_tls->stack,
+      &batch_tls->stack_len_capacity,
+      NULL);
+}
+
+/**
+ * A version of #BLI_kdtree_3d_find_nearest_n for many coordinates, searched in parallel.
+ *
+ * \param r_nearest: An array sized `co_len * nearest_len_capacity`,
+ * the results of `co[i]` start at `r_nearest[i * nearest_len_capacity]`.
+ * \param r_nearest_len: An array sized \a co_len, the number of points found for each query.
+ */
+void BLI_kdtree_nd_(find_nearest_n_batch)(const KDTree *tree,
+                                          const float (*co)[KD_DIMS],
+                                          const int co_len,
+                                          KDTreeNearest *r_nearest,
+                                          const uint nearest_len_capacity,
+                                          int *r_nearest_len)
+{
+  struct FindNearestNBatchData data = {
+      .tree = tree,
+      .co = co,
+      .r_nearest = r_nearest,
+      .nearest_len_capacity = nearest_len_capacity,
+      .r_nearest_len = r_nearest_len,
+  };
+  KDTreeBatchTLS tls = {NULL};
+  TaskParallelSettings settings;
+  kdtree_batch_settings_init(&settings, co_len, &tls);
+  BLI_task_parallel_range(0, co_len, &data, kdtree_find_nearest_n_batch_cb, &settings);
+}
+
+struct RangeSearchBatchData {
+  const KDTree *tree;
+  const float (*co)[KD_DIMS];
+  float range;
+  bool (*search_cb)(
+      void *user_data, int co_index, int index, const float co[KD_DIMS], float dist_sq);
+  void *user_data;
+};
+
+/** Passes the index of the query to the callback of #BLI_kdtree_3d_range_search_cb_batch. */
+struct RangeSearchBatchQuery {
+  const struct RangeSearchBatchData *data;
+  int co_index;
+};
+
+static bool kdtree_range_search_batch_query_cb(void *user_data,
+                                               int index,
+                                               const float co[KD_DIMS],
+                                               float dist_sq)
+{
+  const struct RangeSearchBatchQuery *query = user_data;
+  return query->data->search_cb(query->data->user_data, query->co_index, index, co, dist_sq);
+}
+
+static void kdtree_range_search_cb_batch_cb(void *__restrict userdata,
+                                            const int i,
+                                            const TaskParallelTLS *__restrict tls)
+{
+  const struct RangeSearchBatchData *data = userdata;
+  KDTreeBatchTLS *batch_tls = tls->userdata_chunk;
+  kdtree_batch_tls_ensure(batch_tls);
+
+  struct RangeSearchBatchQuery query = {
+      .data = data,
+      .co_index = i,
+  };
+  kdtree_range_search_cb_impl(data->tree,
+                              data->co[i],
+                              data->range,
+                              kdtree_range_search_batch_query_cb,
+                              &query,
+                              &batch_tls->stack,
+                              &batch_tls->stack_len_capacity,
+                              NULL);
+}
+
+/**
+ * A version of #BLI_kdtree_3d_range_search_cb for many coordinates, searched in parallel.
+ *
+ * \param search_cb: Called for every node found in \a range of `co[co_index]`,
+ * false return value stops searching for this coordinate.
+ * Must be thread-safe, as it's called from multiple threads.
+ */
+void BLI_kdtree_nd_(range_search_cb_batch)(
+    const KDTree *tree,
+    const float (*co)[KD_DIMS],
+    const int co_len,
+    float range,
+    bool (*search_cb)(
+        void *user_data, int co_index, int index, const float co[KD_DIMS], float dist_sq),
+    void *user_data)
+{
+  struct RangeSearchBatchData data = {
+      .tree = tree,
+      .co = co,
+      .range = range,
+      .search_cb = search_cb,
+      .user_data = user_data,
+  };
+  KDTreeBatchTLS tls = {NULL};
+  TaskParallelSettings settings;
+  kdtree_batch_settings_init(&settings, co_len, &tls);
+  BLI_task_parallel_range(0, co_len, &data, kdtree_range_search_cb_batch_cb, &settings);
+}
+
+/** \} */
+
 /**
  * Use when we want to loop over nodes ordered by index.
  * Requires indices to be aligned with nodes.
@@ -837,6 +1075,16 @@ struct DeDuplicateParams {
   int search;
 };
 
+BLI_INLINE void deduplicate_test_node(const struct DeDuplicateParams *p, const KDTreeNode *node)
+{
+  if ((p->search != node->index) && (p->duplicates[node->index] == -1)) {
+    if (len_squared_vnvn(node->co, p->search_co) <= p->range_sq) {
+      p->duplicates[node->index] = (int)p->search;
+      *p->duplicates_found += 1;
+    }
+  }
+}
+
 static void deduplicate_recursive(const struct DeDuplicateParams *p, uint i)
 {
   const KDTreeNode *node = &p->nodes[i];
@@ -851,12 +1099,7 @@ static void deduplicate_recursive(const struct DeDuplicateParams *p, uint i)
     }
   }
   else {
-    if ((p->search != node->index) && (p->duplicates[node->index] == -1)) {
-      if (len_squared_vnvn(node->co, p->search_co) <= p->range_sq) {
-        p->duplicates[node->index] = (int)p->search;
-        *p->duplicates_found += 1;
-      }
-    }
+    deduplicate_test_node(p, node);
     if (node->left != KD_NODE_UNSET) {
       deduplicate_recursive(p, node->left);
     }
@@ -866,6 +1109,148 @@ static void deduplicate_recursive(const struct DeDuplicateParams *p, uint i)
   }
 }
 
+/**
+ * Uniform grid with cells at least \a range wide, so all points in range of a coordinate
+ * are in the cell of the coordinate or its direct neighbors.
+ * Used instead of the tree when searching for duplicates in many points,
+ * as it avoids traversing the tree from the root for each point.
+ */
+typedef struct DeDuplicateGrid {
+  float min[KD_DIMS];
+  float cell_size_inv;
+  uint res[KD_DIMS];
+  /**
+   * Copy of the nodes sorted by cell (so the nodes of neighboring cells are close in memory),
+   * nodes of each cell are `nodes[cell_offsets[cell] .. cell_offsets[cell + 1]]`.
+   */
+  uint *cell_offsets;
+  KDTreeNode *nodes;
+} DeDuplicateGrid;
+
+BLI_INLINE uint deduplicate_grid_cell_axis(const DeDuplicateGrid *grid,
+                                           const uint axis,
+                                           const float co)
+{
+  const float cell = (co - grid->min[axis]) * grid->cell_size_inv;
+  const uint cell_last = grid->res[axis] - 1;
+  if (cell <= 0.0f) {
+    return 0;
+  }
+  return ((uint)cell < cell_last) ? (uint)cell : cell_last;
+}
+
+static uint deduplicate_grid_cell_index(const DeDuplicateGrid *grid, const uint cell[KD_DIMS])
+{
+  uint index = 0;
+  for (uint j = KD_DIMS; j--;) {
+    index = index * grid->res[j] + cell[j];
+  }
+  return index;
+}
+
+/**
+ * \return false when the grid would need too many cells for the points (when \a range is
+ * small compared to the bounds of the points), the tree is used in that case.
+ */
+static bool deduplicate_grid_init(DeDuplicateGrid *grid, const KDTree *tree, const float range)
+{
+  const KDTreeNode *nodes = tree->nodes;
+  float max[KD_DIMS];
+
+  copy_vn_vn(grid->min, nodes[0].co);
+  copy_vn_vn(max, nodes[0].co);
+  for (uint i = 1; i < tree->nodes_len; i++) {
+    for (uint j = 0; j < KD_DIMS; j++) {
+      grid->min[j] = min_ff(grid->min[j], nodes[i].co[j]);
+      max[j] = max_ff(max[j], nodes[i].co[j]);
+    }
+  }
+
+  /* Slightly larger than the range, so rounding can't move points in range further
+   * than the neighboring cells. */
+  const float cell_size = max_ff(range * 1.001f, FLT_EPSILON);
+  const uint64_t cells_len_max = (uint64_t)tree->nodes_len * KD_DUPLICATES_GRID_CELLS_PER_NODE;
+  uint64_t cells_len = 1;
+  grid->cell_size_inv = 1.0f / cell_size;
+  for (uint j = 0; j < KD_DIMS; j++) {
+    const float res = (max[j] - grid->min[j]) * grid->cell_size_inv + 1.0f;
+    if (!(res < (float)cells_len_max)) {
+      return false;
+    }
+    grid->res[j] = (uint)res;
+    cells_len *= grid->res[j];
+    if (cells_len > cells_len_max) {
+      return false;
+    }
+  }
+
+  /* Counting sort of the nodes by cell. */
+  uint *node_cells = MEM_mallocN(sizeof(*node_cells) * tree->nodes_len, __func__);
+  grid->cell_offsets = MEM_callocN(sizeof(*grid->cell_offsets) * (size_t)(cells_len + 1),
+                                   __func__);
+  grid->nodes = MEM_mallocN(sizeof(*grid->nodes) * tree->nodes_len, __func__);
+  for (uint i = 0; i < tree->nodes_len; i++) {
+    uint cell[KD_DIMS];
+    for (uint j = 0; j < KD_DIMS; j++) {
+      cell[j] = deduplicate_grid_cell_axis(grid, j, nodes[i].co[j]);
+    }
+    node_cells[i] = deduplicate_grid_cell_index(grid, cell);
+    grid->cell_offsets[node_cells[i] + 1]++;
+  }
+  for (uint i = 0; i < cells_len; i++) {
+    grid->cell_offsets[i + 1] += grid->cell_offsets[i];
+  }
+  for (uint i = 0; i < tree->nodes_len; i++) {
+    grid->nodes[grid->cell_offsets[node_cells[i]]++] = nodes[i];
+  }
+  /* Filling moved each offset to the start of the next cell, shift them back. */
+  for (uint i = (uint)cells_len; i > 0; i--) {
+    grid->cell_offsets[i] = grid->cell_offsets[i - 1];
+  }
+  grid->cell_offsets[0] = 0;
+
+  MEM_freeN(node_cells);
+  return true;
+}
+
+static void deduplicate_grid_free(DeDuplicateGrid *grid)
+{
+  MEM_freeN(grid->cell_offsets);
+  MEM_freeN(grid->nodes);
+}
+
+static void deduplicate_grid_search(const struct DeDuplicateParams *p,
+                                    const DeDuplicateGrid *grid)
+{
+  uint cell_min[KD_DIMS], cell_max[KD_DIMS], cell[KD_DIMS];
+  for (uint j = 0; j < KD_DIMS; j++) {
+    const uint cell_axis = deduplicate_grid_cell_axis(grid, j, p->search_co[j]);
+    cell_min[j] = (cell_axis > 0) ? cell_axis - 1 : 0;
+    cell_max[j] = (cell_axis + 1 < grid->res[j]) ? cell_axis + 1 : cell_axis;
+    cell[j] = cell_min[j];
+  }
+
+  while (true) {
+    const uint cell_index = deduplicate_grid_cell_index(grid, cell);
+    for (uint i = grid->cell_offsets[cell_index]; i < grid->cell_offsets[cell_index + 1]; i++) {
+      deduplicate_test_node(p, &grid->nodes[i]);
+    }
+
+    /* Step to the next neighboring cell. */
+    uint j;
+    for (j = 0; j < KD_DIMS; j++) {
+      if (cell[j] < cell_max[j]) {
+        cell[j]++;
+        break;
+      }
+      cell[j] = cell_min[j];
+    }
+    if (j == KD_DIMS) {
+      break;
+    }
+  }
+}
+
 /**
  * Find duplicate points in \a range.
  * Favors speed over quality since it doesn't find the best target vertex for merging.
@@ -898,6 +1283,10 @@ int BLI_kdtree_nd_(calc_duplicates_fast)(const KDTree *tree,
       .duplicates_found = &found,
   };
 
+  DeDuplicateGrid grid;
+  const bool use_grid = (tree->nodes_len > KD_DUPLICATES_GRID_THRESHOLD) &&
+                        deduplicate_grid_init(&grid, tree, range);
+
   if (use_index_order) {
     uint *order = kdtree_order(tree);
     for (uint i = 0; i < tree->nodes_len; i++) {
@@ -907,7 +1296,12 @@ int BLI_kdtree_nd_(calc_duplicates_fast)(const KDTree *tree,
         p.search = index;
         copy_vn_vn(p.search_co, tree->nodes[node_index].co);
         int found_prev = found;
-        deduplicate_recursive(&p, tree->root);
+        if (use_grid) {
+          deduplicate_grid_search(&p, &grid);
+        }
+        else {
+          deduplicate_recursive(&p, tree->root);
+        }
         if (found != found_prev) {
           /* Prevent chains of doubles. */
           duplicates[index] = index;
@@ -924,7 +1318,12 @@ int BLI_kdtree_nd_(calc_duplicates_fast)(const KDTree *tree,
         p.search = index;
         copy_vn_vn(p.search_co, tree->nodes[node_index].co);
         int found_prev = found;
-        deduplicate_recursive(&p, tree->root);
+        if (use_grid) {
+          deduplicate_grid_search(&p, &grid);
+        }
+        else {
+          deduplicate_recursive(&p, tree->root);
+        }
         if (found != found_prev) {
           /* Prevent chains of doubles. */
           duplicates[index] = index;
@@ -932,6 +1331,10 @@ int BLI_kdtree_nd_(calc_duplicates_fast)(const KDTree *tree,
       }
     }
   }
+
+  if (use_grid) {
+    deduplicate_grid_free(&grid);
+  }
   return found;
 }
 
@@ -0,0 +1,245 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup bli
+ *
+ * SSE2 and scalar kernels of BLI_math_batch.hh and the run-time selection of the kernels.
+ */
+
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
+#include "BLI_math_batch.h"
+#include "BLI_math_batch.hh"
+#include "BLI_system.h"
+
+#include "math_batch_kernels.hh"
+
+namespace blender {
+
+namespace math_batch {
+
+#ifdef __SSE2__
+
+struct SimdSSE2 {
+  using Vec = __m128;
+  static constexpr int64_t size = 4;
+
+  static Vec set1(const float value)
+  {
+    return _mm_set1_ps(value);
+  }
+  static Vec add(const Vec a, const Vec b)
+  {
+    return _mm_add_ps(a, b);
+  }
+  static Vec sub(const Vec a, const Vec b)
+  {
+    return _mm_sub_ps(a, b);
+  }
+  static Vec mul(const Vec a, const Vec b)
+  {
+    return _mm_mul_ps(a, b);
+  }
+  static Vec div(const Vec a, const Vec b)
+  {
+    return _mm_div_ps(a, b);
+  }
+  static Vec sqrt(const Vec a)
+  {
+    return _mm_sqrt_ps(a);
+  }
+  static Vec madd(const Vec a, const Vec b, const Vec c)
+  {
+    return _mm_add_ps(_mm_mul_ps(a, b), c);
+  }
+  static Vec select_greater(const Vec a, const Vec b, const Vec value)
+  {
+    return _mm_and_ps(_mm_cmpgt_ps(a, b), value);
+  }
+
+  static void store(float *dst, const Vec a)
+  {
+    _mm_storeu_ps(dst, a);
+  }
+
+  /* Four float3 are three registers `x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3`. */
+  static void load3(const float *src, Vec &r_x, Vec &r_y, Vec &r_z)
+  {
+    const Vec a = _mm_loadu_ps(src);
+    const Vec b = _mm_loadu_ps(src + 4);
+    const Vec c = _mm_loadu_ps(src + 8);
+    const Vec x23 = _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2));
+    const Vec y01 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1));
+    const Vec y23 = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3));
+    const Vec z01 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2));
+    const Vec z23 = _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0));
+    r_x = _mm_shuffle_ps(a, x23, _MM_SHUFFLE(2, 0, 3, 0));
+    r_y = _mm_shuffle_ps(y01, y23, _MM_SHUFFLE(2, 0, 2, 0));
+    r_z = _mm_shuffle_ps(z01, z23, _MM_SHUFFLE(2, 0, 2, 0));
+  }
+
+  static void store3(float *dst, const Vec x, const Vec y, const Vec z)
+  {
+    const Vec x0y0 = _mm_shuffle_ps(x, y, _MM_SHUFFLE(0, 0, 0, 0));
+    const Vec z0x1 = _mm_shuffle_ps(z, x, _MM_SHUFFLE(1, 1, 0, 0));
+    const Vec y1z1 = _mm_shuffle_ps(y, z, _MM_SHUFFLE(1, 1, 1, 1));
+    const Vec x2y2 = _mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 2, 2, 2));
+    const Vec z2x3 = _mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 3, 2, 2));
+    const Vec y3z3 = _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 3, 3, 3));
+    _mm_storeu_ps(dst, _mm_shuffle_ps(x0y0, z0x1, _MM_SHUFFLE(2, 0, 2, 0)));
+    _mm_storeu_ps(dst + 4, _mm_shuffle_ps(y1z1, x2y2, _MM_SHUFFLE(2, 0, 2, 0)));
+    _mm_storeu_ps(dst + 8, _mm_shuffle_ps(z2x3, y3z3, _MM_SHUFFLE(2, 0, 2, 0)));
+  }
+};
+
+static void multiply_matrices_sse2(const float4x4 &matrix,
+                                   const float4x4 *src,
+                                   float4x4 *dst,
+                                   const int64_t size)
+{
+  /* Same as #mul_m4_m4m4_uniq, but without reloading the first matrix. */
+  const __m128 a0 = _mm_loadu_ps(matrix.values[0]);
+  const __m128 a1 = _mm_loadu_ps(matrix.values[1]);
+  const __m128 a2 = _mm_loadu_ps(matrix.values[2]);
+  const __m128 a3 = _mm_loadu_ps(matrix.values[3]);
+
+  for (int64_t i = 0; i < size; i++) {
+    __m128 columns[4];
+    for (int col = 0; col < 4; col++) {
+      const __m128 b = _mm_loadu_ps(src[i].values[col]);
+      const __m128 b0 = _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 0, 0, 0));
+      const __m128 b1 = _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 1, 1, 1));
+      const __m128 b2 = _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 2, 2, 2));
+      const __m128 b3 = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 3, 3));
+      columns[col] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(b0, a0), _mm_mul_ps(b1, a1)),
+                                _mm_add_ps(_mm_mul_ps(b2, a2), _mm_mul_ps(b3, a3)));
+    }
+    /* Store after all columns are computed, the source may be the destination. */
+    for (int col = 0; col < 4; col++) {
+      _mm_storeu_ps(dst[i].values[col], columns[col]);
+    }
+  }
+}
+
+static const Kernels kernels_default = {
+    transform_points_simd<SimdSSE2>,
+    transform_directions_simd<SimdSSE2>,
+    normalize_simd<SimdSSE2>,
+    dot_simd<SimdSSE2>,
+    cross_simd<SimdSSE2>,
+    multiply_matrices_sse2,
+};
+
+#else
+
+static const Kernels kernels_default = {
+    transform_points_scalar,
+    transform_directions_scalar,
+    normalize_scalar,
+    dot_scalar,
+    cross_scalar,
+    multiply_matrices_scalar,
+};
+
+#endif /* __SSE2__ */
+
+static const Kernels &get_kernels()
+{
+  static const Kernels *kernels = []() {
+    /* Check the CPU first, no code compiled with AVX2 may run on CPUs without it. */
+    if (BLI_cpu_support_avx2()) {
+      const Kernels *avx2 = kernels_avx2();
+      if (avx2 != nullptr) {
+        return avx2;
+      }
+    }
+    return &kernels_default;
+  }();
+  return *kernels;
+}
+
+}  // namespace math_batch
+
+void transform_points(const float4x4 &matrix, Span<float3> src, MutableSpan<float3> dst)
+{
+  BLI_assert(src.size() == dst.size());
+  math_batch::get_kernels().transform_points(matrix, src.data(), dst.data(), src.size());
+}
+
+void transform_points(const float4x4 &matrix, MutableSpan<float3> points)
+{
+  transform_points(matrix, points.as_span(), points);
+}
+
+void transform_directions(const float4x4 &matrix, Span<float3> src, MutableSpan<float3> dst)
+{
+  BLI_assert(src.size() == dst.size());
+  math_batch::get_kernels().transform_directions(matrix, src.data(), dst.data(), src.size());
+}
+
+void transform_directions(const float4x4 &matrix, MutableSpan<float3> directions)
+{
+  transform_directions(matrix, directions.as_span(), directions);
+}
+
+void normalize_vectors(MutableSpan<float3> vectors)
+{
+  math_batch::get_kernels().normalize(vectors.data(), vectors.size());
+}
+
+void dot_products(Span<float3> a, Span<float3> b, MutableSpan<float> r_dots)
+{
+  BLI_assert(a.size() == b.size() && a.size() == r_dots.size());
+  math_batch::get_kernels().dot(a.data(), b.data(), r_dots.data(), a.size());
+}
+
+void cross_products(Span<float3> a, Span<float3> b, MutableSpan<float3> r_crosses)
+{
+  BLI_assert(a.size() == b.size() && a.size() == r_crosses.size());
+  math_batch::get_kernels().cross(a.data(), b.data(), r_crosses.data(), a.size());
+}
+
+void multiply_matrices(const float4x4 &matrix,
+                       Span<float4x4> matrices,
+                       MutableSpan<float4x4> r_matrices)
+{
+  BLI_assert(matrices.size() == r_matrices.size());
+  math_batch::get_kernels().multiply_matrices(
+      matrix, matrices.data(), r_matrices.data(), matrices.size());
+}
+
+}  // namespace blender
+
+/* -------------------------------------------------------------------- */
+/** \name C API
+ * \{ */
+
+using blender::float3;
+using blender::float4x4;
+using blender::MutableSpan;
+
+void BLI_math_batch_transform_points(const float matrix[4][4],
+                                     float (*points)[3],
+                                     const int points_len)
+{
+  blender::transform_points(float4x4(matrix),
+                            MutableSpan<float3>(reinterpret_cast<float3 *>(points), points_len));
+}
+
+/** \} */
@@ -0,0 +1,161 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup bli
+ *
+ * AVX2 kernels of BLI_math_batch.hh. This file is compiled with AVX2 and FMA enabled, nothing in
+ * it may run before checking that the CPU supports them.
+ */
+
+#ifdef __AVX2__
+#  include <immintrin.h>
+#endif
+
+#include "math_batch_kernels.hh"
+
+namespace blender::math_batch {
+
+#ifdef __AVX2__
+
+struct SimdAVX2 {
+  using Vec = __m256;
+  static constexpr int64_t size = 8;
+
+  static Vec set1(const float value)
+  {
+    return _mm256_set1_ps(value);
+  }
+  static Vec add(const Vec a, const Vec b)
+  {
+    return _mm256_add_ps(a, b);
+  }
+  static Vec sub(const Vec a, const Vec b)
+  {
+    return _mm256_sub_ps(a, b);
+  }
+  static Vec mul(const Vec a, const Vec b)
+  {
+    return _mm256_mul_ps(a, b);
+  }
+  static Vec div(const Vec a, const Vec b)
+  {
+    return _mm256_div_ps(a, b);
+  }
+  static Vec sqrt(const Vec a)
+  {
+    return _mm256_sqrt_ps(a);
+  }
+  static Vec madd(const Vec a, const Vec b, const Vec c)
+  {
+    return _mm256_fmadd_ps(a, b, c);
+  }
+  static Vec select_greater(const Vec a, const Vec b, const Vec value)
+  {
+    return _mm256_and_ps(_mm256_cmp_ps(a, b, _CMP_GT_OQ), value);
+  }
+
+  static void store(float *dst, const Vec a)
+  {
+    _mm256_storeu_ps(dst, a);
+  }
+
+  /* The lower halves of the registers hold the first four float3 and the upper halves the last
+   * four, so that all shuffles stay within the 128 bit lanes. The lanes are laid out like in the
+   * SSE2 version, but with different shuffles to save instructions. */
+  static void load3(const float *src, Vec &r_x, Vec &r_y, Vec &r_z)
+  {
+    Vec m03 = _mm256_castps128_ps256(_mm_loadu_ps(src));
+    Vec m14 = _mm256_castps128_ps256(_mm_loadu_ps(src + 4));
+    Vec m25 = _mm256_castps128_ps256(_mm_loadu_ps(src + 8));
+    m03 = _mm256_insertf128_ps(m03, _mm_loadu_ps(src + 12), 1);
+    m14 = _mm256_insertf128_ps(m14, _mm_loadu_ps(src + 16), 1);
+    m25 = _mm256_insertf128_ps(m25, _mm_loadu_ps(src + 20), 1);
+
+    const Vec xy = _mm256_shuffle_ps(m14, m25, _MM_SHUFFLE(2, 1, 3, 2));
+    const Vec yz = _mm256_shuffle_ps(m03, m14, _MM_SHUFFLE(1, 0, 2, 1));
+    r_x = _mm256_shuffle_ps(m03, xy, _MM_SHUFFLE(2, 0, 3, 0));
+    r_y = _mm256_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+    r_z = _mm256_shuffle_ps(yz, m25, _MM_SHUFFLE(3, 0, 3, 1));
+  }
+
+  static void store3(float *dst, const Vec x, const Vec y, const Vec z)
+  {
+    const Vec xy = _mm256_shuffle_ps(x, y, _MM_SHUFFLE(2, 0, 2, 0));
+    const Vec yz = _mm256_shuffle_ps(y, z, _MM_SHUFFLE(3, 1, 3, 1));
+    const Vec zx = _mm256_shuffle_ps(z, x, _MM_SHUFFLE(3, 1, 2, 0));
+    const Vec m03 = _mm256_shuffle_ps(xy, zx, _MM_SHUFFLE(2, 0, 2, 0));
+    const Vec m14 = _mm256_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+    const Vec m25 = _mm256_shuffle_ps(zx, yz, _MM_SHUFFLE(3, 1, 3, 1));
+    _mm_storeu_ps(dst, _mm256_castps256_ps128(m03));
+    _mm_storeu_ps(dst + 4, _mm256_castps256_ps128(m14));
+    _mm_storeu_ps(dst + 8, _mm256_castps256_ps128(m25));
+    _mm_storeu_ps(dst + 12, _mm256_extractf128_ps(m03, 1));
+    _mm_storeu_ps(dst + 16, _mm256_extractf128_ps(m14, 1));
+    _mm_storeu_ps(dst + 20, _mm256_extractf128_ps(m25, 1));
+  }
+};
+
+static void multiply_matrices_avx2(const float4x4 &matrix,
+                                   const float4x4 *src,
+                                   float4x4 *dst,
+                                   const int64_t size)
+{
+  /* Two columns of the result at once, one per 128 bit lane. */
+  const __m256 a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(matrix.values[0]));
+  const __m256 a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(matrix.values[1]));
+  const __m256 a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(matrix.values[2]));
+  const __m256 a3 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(matrix.values[3]));
+
+  for (int64_t i = 0; i < size; i++) {
+    __m256 columns[2];
+    for (int half = 0; half < 2; half++) {
+      const __m256 b = _mm256_loadu_ps(src[i].values[half * 2]);
+      __m256 sum = _mm256_mul_ps(_mm256_permute_ps(b, _MM_SHUFFLE(0, 0, 0, 0)), a0);
+      sum = _mm256_fmadd_ps(_mm256_permute_ps(b, _MM_SHUFFLE(1, 1, 1, 1)), a1, sum);
+      sum = _mm256_fmadd_ps(_mm256_permute_ps(b, _MM_SHUFFLE(2, 2, 2, 2)), a2, sum);
+      columns[half] = _mm256_fmadd_ps(_mm256_permute_ps(b, _MM_SHUFFLE(3, 3, 3, 3)), a3, sum);
+    }
+    /* Store after all columns are computed, the source may be the destination. */
+    _mm256_storeu_ps(dst[i].values[0], columns[0]);
+    _mm256_storeu_ps(dst[i].values[2], columns[1]);
+  }
+}
+
+static const Kernels kernels = {
+    transform_points_simd<SimdAVX2>,
+    transform_directions_simd<SimdAVX2>,
+    normalize_simd<SimdAVX2>,
+    dot_simd<SimdAVX2>,
+    cross_simd<SimdAVX2>,
+    multiply_matrices_avx2,
+};
+
+const Kernels *kernels_avx2()
+{
+  return &kernels;
+}
+
+#else
+
+const Kernels *kernels_avx2()
+{
+  return nullptr;
+}
+
+#endif /* __AVX2__ */
+
+}  // namespace blender::math_batch
@@ -0,0 +1,268 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup bli
+ *
+ * Kernels of BLI_math_batch.hh, shared between the files that are compiled for different
+ * instruction sets.
+ *
+ * The vector kernels are written once against a `Simd` type that wraps the intrinsics of an
+ * instruction set and processes `Simd::size` vectors at a time:
+ * - `Vec`: register with one component of `size` vectors.
+ * - `set1`, `add`, `sub`, `mul`, `div`, `sqrt`: like their scalar equivalents.
+ * - `madd(a, b, c)`: `a * b + c`, fused where supported.
+ * - `select_greater(a, b, value)`: `value` where `a > b` and zero otherwise.
+ * - `load3`, `store3`: convert between `size` float3 and one register per component.
+ * - `store`: store a register into `size` floats.
+ *
+ * The remainder that doesn't fill a register uses the scalar functions.
+ *
+ * Everything here has internal linkage and doesn't call the inline methods of float3 and
+ * float4x4. Otherwise the linker could pick a copy compiled with AVX2 for code that runs on
+ * CPUs without it.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstring>
+
+#include "BLI_math_batch.hh"
+
+namespace blender::math_batch {
+
+struct Kernels {
+  void (*transform_points)(const float4x4 &matrix, const float3 *src, float3 *dst, int64_t size);
+  void (*transform_directions)(const float4x4 &matrix,
+                               const float3 *src,
+                               float3 *dst,
+                               int64_t size);
+  void (*normalize)(float3 *vectors, int64_t size);
+  void (*dot)(const float3 *a, const float3 *b, float *r_dots, int64_t size);
+  void (*cross)(const float3 *a, const float3 *b, float3 *r_crosses, int64_t size);
+  void (*multiply_matrices)(const float4x4 &matrix,
+                            const float4x4 *src,
+                            float4x4 *dst,
+                            int64_t size);
+};
+
+/* Kernels compiled with AVX2 and FMA enabled, null when the compiler doesn't support them. Only
+ * call this after checking that the CPU supports AVX2, see #BLI_cpu_support_avx2. */
+const Kernels *kernels_avx2();
+
+/* -------------------------------------------------------------------- */
+/** \name Scalar Kernels
+ * \{ */
+
+static inline void transform_points_scalar(const float4x4 &matrix,
+                                           const float3 *src,
+                                           float3 *dst,
+                                           const int64_t size)
+{
+  const float(*m)[4] = matrix.values;
+  for (int64_t i = 0; i < size; i++) {
+    const float x = src[i].x, y = src[i].y, z = src[i].z;
+    dst[i].x = x * m[0][0] + y * m[1][0] + z * m[2][0] + m[3][0];
+    dst[i].y = x * m[0][1] + y * m[1][1] + z * m[2][1] + m[3][1];
+    dst[i].z = x * m[0][2] + y * m[1][2] + z * m[2][2] + m[3][2];
+  }
+}
+
+static inline void transform_directions_scalar(const float4x4 &matrix,
+                                               const float3 *src,
+                                               float3 *dst,
+                                               const int64_t size)
+{
+  const float(*m)[4] = matrix.values;
+  for (int64_t i = 0; i < size; i++) {
+    const float x = src[i].x, y = src[i].y, z = src[i].z;
+    dst[i].x = x * m[0][0] + y * m[1][0] + z * m[2][0];
+    dst[i].y = x * m[0][1] + y * m[1][1] + z * m[2][1];
+    dst[i].z = x * m[0][2] + y * m[1][2] + z * m[2][2];
+  }
+}
+
+static inline void normalize_scalar(float3 *vectors, const int64_t size)
+{
+  for (int64_t i = 0; i < size; i++) {
+    float3 &v = vectors[i];
+    const float length_squared = v.x * v.x + v.y * v.y + v.z * v.z;
+    /* Same threshold as #normalize_v3. */
+    const float factor = (length_squared > 1.0e-35f) ? 1.0f / sqrtf(length_squared) : 0.0f;
+    v.x *= factor;
+    v.y *= factor;
+    v.z *= factor;
+  }
+}
+
+static inline void dot_scalar(const float3 *a,
+                              const float3 *b,
+                              float *r_dots,
+                              const int64_t size)
+{
+  for (int64_t i = 0; i < size; i++) {
+    r_dots[i] = a[i].x * b[i].x + a[i].y * b[i].y + a[i].z * b[i].z;
+  }
+}
+
+static inline void cross_scalar(const float3 *a,
+                                const float3 *b,
+                                float3 *r_crosses,
+                                const int64_t size)
+{
+  for (int64_t i = 0; i < size; i++) {
+    const float x = a[i].y * b[i].z - a[i].z * b[i].y;
+    const float y = a[i].z * b[i].x - a[i].x * b[i].z;
+    const float z = a[i].x * b[i].y - a[i].y * b[i].x;
+    r_crosses[i].x = x;
+    r_crosses[i].y = y;
+    r_crosses[i].z = z;
+  }
+}
+
+static inline void multiply_matrices_scalar(const float4x4 &matrix,
+                                            const float4x4 *src,
+                                            float4x4 *dst,
+                                            const int64_t size)
+{
+  const float(*a)[4] = matrix.values;
+  for (int64_t i = 0; i < size; i++) {
+    float r[4][4];
+    for (int col = 0; col < 4; col++) {
+      const float *b = src[i].values[col];
+      for (int row = 0; row < 4; row++) {
+        r[col][row] = b[0] * a[0][row] + b[1] * a[1][row] + b[2] * a[2][row] + b[3] * a[3][row];
+      }
+    }
+    memcpy(dst[i].values, r, sizeof(r));
+  }
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name SIMD Kernels
+ * \{ */
+
+template<typename Simd>
+static void transform_points_simd(const float4x4 &matrix,
+                                  const float3 *src,
+                                  float3 *dst,
+                                  const int64_t size)
+{
+  using Vec = typename Simd::Vec;
+  Vec m[4][3];
+  for (int col = 0; col < 4; col++) {
+    for (int row = 0; row < 3; row++) {
+      m[col][row] = Simd::set1(matrix.values[col][row]);
+    }
+  }
+
+  int64_t i = 0;
+  for (; i + Simd::size <= size; i += Simd::size) {
+    Vec x, y, z;
+    Simd::load3(&src[i].x, x, y, z);
+    Vec r[3];
+    for (int row = 0; row < 3; row++) {
+      r[row] = Simd::madd(
+          x, m[0][row], Simd::madd(y, m[1][row], Simd::madd(z, m[2][row], m[3][row])));
+    }
+    Simd::store3(&dst[i].x, r[0], r[1], r[2]);
+  }
+  transform_points_scalar(matrix, src + i, dst + i, size - i);
+}
+
+template<typename Simd>
+static void transform_directions_simd(const float4x4 &matrix,
+                                      const float3 *src,
+                                      float3 *dst,
+                                      const int64_t size)
+{
+  using Vec = typename Simd::Vec;
+  Vec m[3][3];
+  for (int col = 0; col < 3; col++) {
+    for (int row = 0; row < 3; row++) {
+      m[col][row] = Simd::set1(matrix.values[col][row]);
+    }
+  }
+
+  int64_t i = 0;
+  for (; i + Simd::size <= size; i += Simd::size) {
+    Vec x, y, z;
+    Simd::load3(&src[i].x, x, y, z);
+    Vec r[3];
+    for (int row = 0; row < 3; row++) {
+      r[row] = Simd::madd(x, m[0][row], Simd::madd(y, m[1][row], Simd::mul(z, m[2][row])));
+    }
+    Simd::store3(&dst[i].x, r[0], r[1], r[2]);
+  }
+  transform_directions_scalar(matrix, src + i, dst + i, size - i);
+}
+
+template<typename Simd> static void normalize_simd(float3 *vectors, const int64_t size)
+{
+  using Vec = typename Simd::Vec;
+  /* Same threshold as #normalize_v3. */
+  const Vec min_length_squared = Simd::set1(1.0e-35f);
+  const Vec one = Simd::set1(1.0f);
+
+  int64_t i = 0;
+  for (; i + Simd::size <= size; i += Simd::size) {
+    Vec x, y, z;
+    Simd::load3(&vectors[i].x, x, y, z);
+    const Vec length_squared = Simd::madd(x, x, Simd::madd(y, y, Simd::mul(z, z)));
+    const Vec factor = Simd::select_greater(
+        length_squared, min_length_squared, Simd::div(one, Simd::sqrt(length_squared)));
+    Simd::store3(&vectors[i].x, Simd::mul(x, factor), Simd::mul(y, factor), Simd::mul(z, factor));
+  }
+  normalize_scalar(vectors + i, size - i);
+}
+
+template<typename Simd>
+static void dot_simd(const float3 *a, const float3 *b, float *r_dots, const int64_t size)
+{
+  using Vec = typename Simd::Vec;
+  int64_t i = 0;
+  for (; i + Simd::size <= size; i += Simd::size) {
+    Vec ax, ay, az, bx, by, bz;
+    Simd::load3(&a[i].x, ax, ay, az);
+    Simd::load3(&b[i].x, bx, by, bz);
+    Simd::store(r_dots + i, Simd::madd(ax, bx, Simd::madd(ay, by, Simd::mul(az, bz))));
+  }
+  dot_scalar(a + i, b + i, r_dots + i, size - i);
+}
+
+template<typename Simd>
+static void cross_simd(const float3 *a, const float3 *b, float3 *r_crosses, const int64_t size)
+{
+  using Vec = typename Simd::Vec;
+  int64_t i = 0;
+  for (; i + Simd::size <= size; i += Simd::size) {
+    Vec ax, ay, az, bx, by, bz;
+    Simd::load3(&a[i].x, ax, ay, az);
+    Simd::load3(&b[i].x, bx, by, bz);
+    const Vec rx = Simd::sub(Simd::mul(ay, bz), Simd::mul(az, by));
+    const Vec ry = Simd::sub(Simd::mul(az, bx), Simd::mul(ax, bz));
+    const Vec rz = Simd::sub(Simd::mul(ax, by), Simd::mul(ay, bx));
+    Simd::store3(&r_crosses[i].x, rx, ry, rz);
+  }
+  cross_scalar(a + i, b + i, r_crosses + i, size - i);
+}
+
+/** \} */
+
+}  // namespace blender::math_batch
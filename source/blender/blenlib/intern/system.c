@@ -111,26 +111,40 @@ void BLI_system_backtrace(FILE *fp)
 /* NOTE: The code for CPU brand string is adopted from Cycles. */
 
 #if !defined(_WIN32) || defined(FREE_WINDOWS)
-static void __cpuid(
+/* Same as the MSVC intrinsic, `subleaf` goes into ECX for the leaves that have sub-leaves. */
+static void __cpuidex(
     /* Cannot be const, because it is modified below.
      * NOLINTNEXTLINE: readability-non-const-parameter. */
     int data[4],
-    int selector)
+    int selector,
+    int subleaf)
 {
 #  if defined(__x86_64__)
-  asm("cpuid" : "=a"(data[0]), "=b"(data[1]), "=c"(data[2]), "=d"(data[3]) : "a"(selector));
+  asm("cpuid"
+      : "=a"(data[0]), "=b"(data[1]), "=c"(data[2]), "=d"(data[3])
+      : "a"(selector), "c"(subleaf));
 #  elif defined(__i386__)
   asm("pushl %%ebx    \n\t"
       "cpuid          \n\t"
       "movl %%ebx, %1 \n\t"
       "popl %%ebx     \n\t"
       : "=a"(data[0]), "=r"(data[1]), "=c"(data[2]), "=d"(data[3])
-      : "a"(selector)
+      : "a"(selector), "c"(subleaf)
       : "ebx");
 #  else
+  UNUSED_VARS(selector, subleaf);
   data[0] = data[1] = data[2] = data[3] = 0;
 #  endif
 }
+
+static void __cpuid(
+    /* Cannot be const, because it is modified below.
+     * NOLINTNEXTLINE: readability-non-const-parameter. */
+    int data[4],
+    int selector)
+{
+  __cpuidex(data, selector, 0);
+}
 #endif
 
 char *BLI_cpu_brand_string(void)
@@ -162,6 +176,45 @@ int BLI_cpu_support_sse41(void)
   return 0;
 }
 
+/* NOTE: The checks are adopted from Cycles. */
+int BLI_cpu_support_avx2(void)
+{
+  int result[4], num;
+  __cpuid(result, 0);
+  num = result[0];
+
+  if (num < 7) {
+    return 0;
+  }
+
+  __cpuid(result, 0x00000001);
+  const bool os_uses_xsave_xrestore = (result[2] & ((int)1 << 27)) != 0;
+  const bool cpu_avx_support = (result[2] & ((int)1 << 28)) != 0;
+  const bool cpu_fma_support = (result[2] & ((int)1 << 12)) != 0;
+  if (!(os_uses_xsave_xrestore && cpu_avx_support && cpu_fma_support)) {
+    return 0;
+  }
+
+  /* Check if the OS will save the YMM registers. */
+  uint32_t xcr_feature_mask;
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  int edx; /* not used */
+  /* actual opcode for xgetbv */
+  __asm__(".byte 0x0f, 0x01, 0xd0" : "=a"(xcr_feature_mask), "=d"(edx) : "c"(0));
+#elif defined(_MSC_VER) && defined(_XCR_XFEATURE_ENABLED_MASK)
+  xcr_feature_mask = (uint32_t)_xgetbv(_XCR_XFEATURE_ENABLED_MASK);
+#else
+  xcr_feature_mask = 0;
+#endif
+  if ((xcr_feature_mask & 0x6) != 0x6) {
+    return 0;
+  }
+
+  /* Leaf 7 has sub-leaves, the feature flags are in sub-leaf 0. */
+  __cpuidex(result, 0x00000007, 0);
+  return (result[1] & ((int)1 << 5)) != 0;
+}
+
 void BLI_hostname_get(char *buffer, size_t bufsize)
 {
 #ifndef WIN32
@@ -0,0 +1,58 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup bli
+ *
+ * Task scheduler internals shared between the task implementation files.
+ */
+
+#pragma once
+
+#ifdef WITH_TBB
+/* Quiet top level deprecation message, unrelated to API usage here. */
+#  define TBB_SUPPRESS_DEPRECATED_MESSAGES 1
+#  include <tbb/tbb.h>
+#endif
+
+/* Index of the calling thread below BLENDER_MAX_THREADS, unique among running threads and
+ * assigned on first use. -1 when more threads are running. */
+int task_scheduler_thread_index(void);
+
+/* Statistics
+ *
+ * Tasks call begin/end around their execution. Begin returns the time stamp to
+ * pass to end, or a negative value when statistics are disabled. */
+
+double task_scheduler_stats_task_begin(void);
+void task_scheduler_stats_task_end(double begin_time, int creator_thread_index);
+
+/* Parallel Range */
+
+/* Free the memory arenas kept for reuse by BLI_task_parallel_tls_memarena(). */
+void task_parallel_memarena_pool_free(void);
+
+/* NUMA Arenas */
+
+#ifdef WITH_TBB
+int task_scheduler_numa_arenas_num(void);
+tbb::task_arena &task_scheduler_numa_arena(int arena_index);
+/* Number of processors of the node, used to size the block of the arena. */
+int task_scheduler_numa_arena_concurrency(int arena_index);
+/* True when called from a task already running inside a NUMA arena, in which
+ * case nested parallel ranges stay in that arena. */
+bool task_scheduler_numa_thread_in_arena(void);
+#endif
@@ -33,6 +33,8 @@
 #include "BLI_task.h"
 #include "BLI_threads.h"
 
+#include "task_intern.hh"
+
 #ifdef WITH_TBB
 /* Quiet top level deprecation message, unrelated to API usage here. */
 #  define TBB_SUPPRESS_DEPRECATED_MESSAGES 1
@@ -50,13 +52,22 @@ class Task {
   void *taskdata;
   bool free_taskdata;
   TaskFreeFunction freedata;
+  /* Thread that pushed the task, for statistics. */
+  int creator_thread_index;
 
   Task(TaskPool *pool,
        TaskRunFunction run,
        void *taskdata,
        bool free_taskdata,
        TaskFreeFunction freedata)
-      : pool(pool), run(run), taskdata(taskdata), free_taskdata(free_taskdata), freedata(freedata)
+      : pool(pool),
+        run(run),
+        taskdata(taskdata),
+        free_taskdata(free_taskdata),
+        freedata(freedata),
+        creator_thread_index(BLI_task_scheduler_stats_is_enabled() ?
+                                 task_scheduler_thread_index() :
+                                 -1)
   {
   }
 
@@ -81,7 +92,8 @@ class Task {
         run(other.run),
         taskdata(other.taskdata),
         free_taskdata(other.free_taskdata),
-        freedata(other.freedata)
+        freedata(other.freedata),
+        creator_thread_index(other.creator_thread_index)
   {
     other.pool = NULL;
     other.run = NULL;
@@ -96,7 +108,8 @@ class Task {
         run(other.run),
         taskdata(other.taskdata),
         free_taskdata(other.free_taskdata),
-        freedata(other.freedata)
+        freedata(other.freedata),
+        creator_thread_index(other.creator_thread_index)
   {
     ((Task &)other).pool = NULL;
     ((Task &)other).run = NULL;
@@ -114,11 +127,13 @@ class Task {
   /* Execute task. */
   void operator()() const
   {
+    const double begin_time = task_scheduler_stats_task_begin();
 #ifdef WITH_TBB
     tbb::this_task_arena::isolate([this] { run(pool, taskdata); });
 #else
     run(pool, taskdata);
 #endif
+    task_scheduler_stats_task_end(begin_time, creator_thread_index);
   }
 };
 
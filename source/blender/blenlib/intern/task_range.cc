@@ -20,16 +20,20 @@
  * Task parallel range functions.
  */
 
+#include <atomic>
+#include <mutex>
 #include <stdlib.h>
+#include <thread>
 
 #include "MEM_guardedalloc.h"
 
 #include "DNA_listBase.h"
 
+#include "BLI_memarena.h"
 #include "BLI_task.h"
 #include "BLI_threads.h"
 
-#include "atomic_ops.h"
+#include "task_intern.hh"
 
 #ifdef WITH_TBB
 /* Quiet top level deprecation message, unrelated to API usage here. */
@@ -37,6 +41,118 @@
 #  include <tbb/tbb.h>
 #endif
 
+/* Per-Thread Memory Arenas
+ *
+ * Every thread that asks for an arena while running a parallel range gets its
+ * own one, found through a lock-free list that belongs to the range. When the
+ * range is done, all arenas are cleared and returned to a global pool, so that
+ * later ranges reuse their memory instead of allocating it again. */
+
+struct TaskParallelMemArenaLink {
+  TaskParallelMemArenaLink *next;
+  std::thread::id thread_id;
+  MemArena *memarena;
+};
+
+struct TaskParallelMemArenas {
+  std::atomic<TaskParallelMemArenaLink *> first;
+
+  TaskParallelMemArenas() : first(nullptr)
+  {
+  }
+
+  ~TaskParallelMemArenas();
+};
+
+static std::mutex task_memarena_pool_mutex;
+static TaskParallelMemArenaLink *task_memarena_pool = nullptr;
+
+static TaskParallelMemArenaLink *task_memarena_pool_pop()
+{
+  {
+    std::lock_guard<std::mutex> lock(task_memarena_pool_mutex);
+    TaskParallelMemArenaLink *link = task_memarena_pool;
+    if (link != nullptr) {
+      task_memarena_pool = link->next;
+      return link;
+    }
+  }
+
+  TaskParallelMemArenaLink *link = (TaskParallelMemArenaLink *)MEM_mallocN(sizeof(*link),
+                                                                           __func__);
+  link->memarena = BLI_memarena_new(BLI_MEMARENA_STD_BUFSIZE, "TaskParallelTLS memarena");
+  return link;
+}
+
+TaskParallelMemArenas::~TaskParallelMemArenas()
+{
+  TaskParallelMemArenaLink *link_first = first.load();
+  if (link_first == nullptr) {
+    return;
+  }
+
+  TaskParallelMemArenaLink *link_last = link_first;
+  while (true) {
+    BLI_memarena_clear(link_last->memarena);
+    if (link_last->next == nullptr) {
+      break;
+    }
+    link_last = link_last->next;
+  }
+
+  std::lock_guard<std::mutex> lock(task_memarena_pool_mutex);
+  link_last->next = task_memarena_pool;
+  task_memarena_pool = link_first;
+}
+
+void task_parallel_memarena_pool_free()
+{
+  std::lock_guard<std::mutex> lock(task_memarena_pool_mutex);
+  while (task_memarena_pool != nullptr) {
+    TaskParallelMemArenaLink *link_next = task_memarena_pool->next;
+    BLI_memarena_free(task_memarena_pool->memarena);
+    MEM_freeN(task_memarena_pool);
+    task_memarena_pool = link_next;
+  }
+}
+
+MemArena *BLI_task_parallel_tls_memarena(const TaskParallelTLS *tls)
+{
+  BLI_assert(tls->memarenas != NULL && "Only supported in BLI_task_parallel_range");
+  if (tls->memarena != NULL) {
+    return tls->memarena;
+  }
+
+  TaskParallelMemArenas *memarenas = tls->memarenas;
+  const std::thread::id thread_id = std::this_thread::get_id();
+  MemArena *memarena = nullptr;
+
+  /* Links are only ever prepended, so a concurrent insertion can't hide ours. */
+  for (TaskParallelMemArenaLink *link = memarenas->first.load(std::memory_order_acquire);
+       link != nullptr;
+       link = link->next) {
+    if (link->thread_id == thread_id) {
+      memarena = link->memarena;
+      break;
+    }
+  }
+
+  if (memarena == nullptr) {
+    TaskParallelMemArenaLink *link = task_memarena_pool_pop();
+    link->thread_id = thread_id;
+    link->next = memarenas->first.load(std::memory_order_relaxed);
+    while (!memarenas->first.compare_exchange_weak(
+        link->next, link, std::memory_order_release, std::memory_order_relaxed)) {
+      /* Retry with the updated first link. */
+    }
+    memarena = link->memarena;
+  }
+
+  /* Cache the arena, the TLS is private to the chunk being executed by this thread. */
+  const_cast<TaskParallelTLS *>(tls)->memarena = memarena;
+  return memarena;
+}
+
 #ifdef WITH_TBB
 
 /* Functor for running TBB parallel_for and parallel_reduce. */
@@ -47,23 +163,43 @@ struct RangeTask {
 
   void *userdata_chunk;
 
+  /* Thread that called BLI_task_parallel_range, for statistics. */
+  int creator_thread_index;
+
+  /* Memory arenas of the whole range, shared by all copies. */
+  TaskParallelMemArenas *memarenas;
+
   /* Root constructor. */
-  RangeTask(TaskParallelRangeFunc func, void *userdata, const TaskParallelSettings *settings)
-      : func(func), userdata(userdata), settings(settings)
+  RangeTask(TaskParallelRangeFunc func,
+            void *userdata,
+            const TaskParallelSettings *settings,
+            TaskParallelMemArenas *memarenas)
+      : func(func), userdata(userdata), settings(settings), memarenas(memarenas)
   {
     init_chunk(settings->userdata_chunk);
+    creator_thread_index = BLI_task_scheduler_stats_is_enabled() ?
+                               task_scheduler_thread_index() :
+                               -1;
   }
 
   /* Copy constructor. */
   RangeTask(const RangeTask &other)
-      : func(other.func), userdata(other.userdata), settings(other.settings)
+      : func(other.func),
+        userdata(other.userdata),
+        settings(other.settings),
+        creator_thread_index(other.creator_thread_index),
+        memarenas(other.memarenas)
   {
     init_chunk(settings->userdata_chunk);
   }
 
   /* Splitting constructor for parallel reduce. */
   RangeTask(RangeTask &other, tbb::split /* unused */)
-      : func(other.func), userdata(other.userdata), settings(other.settings)
+      : func(other.func),
+        userdata(other.userdata),
+        settings(other.settings),
+        creator_thread_index(other.creator_thread_index),
+        memarenas(other.memarenas)
   {
     init_chunk(settings->userdata_chunk);
   }
@@ -89,13 +225,17 @@ struct RangeTask {
 
   void operator()(const tbb::blocked_range<int> &r) const
   {
+    const double begin_time = task_scheduler_stats_task_begin();
     tbb::this_task_arena::isolate([this, r] {
       TaskParallelTLS tls;
       tls.userdata_chunk = userdata_chunk;
+      tls.memarena = nullptr;
+      tls.memarenas = memarenas;
       for (int i = r.begin(); i != r.end(); ++i) {
         func(userdata, i, &tls);
       }
     });
+    task_scheduler_stats_task_end(begin_time, creator_thread_index);
   }
 
   void join(const RangeTask &other)
@@ -104,6 +244,93 @@ struct RangeTask {
   }
 };
 
+/* Block of a range executed in the arena of a single NUMA node. */
+struct RangeTaskNumaBlock {
+  RangeTask task;
+  tbb::task_group group;
+  tbb::blocked_range<int> range;
+
+  RangeTaskNumaBlock(TaskParallelRangeFunc func,
+                     void *userdata,
+                     const TaskParallelSettings *settings,
+                     TaskParallelMemArenas *memarenas,
+                     const tbb::blocked_range<int> &range)
+      : task(func, userdata, settings, memarenas), range(range)
+  {
+  }
+};
+
+/* Split the range into one contiguous block per NUMA arena, sized by the
+ * number of processors of its node. The split only depends on the range, so
+ * memory first touched by a block stays local to the node in later ranges. */
+static void task_parallel_range_numa(const int start,
+                                     const int stop,
+                                     void *userdata,
+                                     TaskParallelRangeFunc func,
+                                     const TaskParallelSettings *settings,
+                                     TaskParallelMemArenas *memarenas,
+                                     const size_t grainsize)
+{
+  const int arenas_num = task_scheduler_numa_arenas_num();
+  int64_t concurrency_total = 0;
+  for (int i = 0; i < arenas_num; i++) {
+    concurrency_total += task_scheduler_numa_arena_concurrency(i);
+  }
+
+  RangeTaskNumaBlock **blocks = (RangeTaskNumaBlock **)MEM_mallocN(
+      sizeof(*blocks) * (size_t)arenas_num, __func__);
+  int64_t concurrency_accum = 0;
+  int block_start = start;
+  for (int i = 0; i < arenas_num; i++) {
+    concurrency_accum += task_scheduler_numa_arena_concurrency(i);
+    const int block_stop = start +
+                           (int)((int64_t)(stop - start) * concurrency_accum / concurrency_total);
+    blocks[i] = OBJECT_GUARDED_NEW(RangeTaskNumaBlock,
+                                   func,
+                                   userdata,
+                                   settings,
+                                   memarenas,
+                                   tbb::blocked_range<int>(block_start, block_stop, grainsize));
+    block_start = block_stop;
+  }
+
+  /* Start all blocks before waiting, the calling thread then helps out in the
+   * arenas one after the other. */
+  for (int i = 0; i < arenas_num; i++) {
+    RangeTaskNumaBlock *block = blocks[i];
+    task_scheduler_numa_arena(i).execute([block, settings] {
+      block->group.run([block, settings] {
+        if (settings->func_reduce) {
+          parallel_reduce(block->range, block->task);
+        }
+        else {
+          parallel_for(block->range, block->task);
+        }
+      });
+    });
+  }
+  for (int i = 0; i < arenas_num; i++) {
+    RangeTaskNumaBlock *block = blocks[i];
+    task_scheduler_numa_arena(i).execute([block] { block->group.wait(); });
+  }
+
+  if (settings->func_reduce) {
+    for (int i = 1; i < arenas_num; i++) {
+      blocks[0]->task.join(blocks[i]->task);
+    }
+    if (settings->userdata_chunk) {
+      memcpy(settings->userdata_chunk,
+             blocks[0]->task.userdata_chunk,
+             settings->userdata_chunk_size);
+    }
+  }
+
+  for (int i = 0; i < arenas_num; i++) {
+    OBJECT_GUARDED_DELETE(blocks[i], RangeTaskNumaBlock);
+  }
+  MEM_freeN(blocks);
+}
+
 #endif
 
 void BLI_task_parallel_range(const int start,
@@ -112,11 +339,24 @@ void BLI_task_parallel_range(const int start,
                              TaskParallelRangeFunc func,
                              const TaskParallelSettings *settings)
 {
+  /* Declared first, so arenas are released after all chunks have been freed. */
+  TaskParallelMemArenas memarenas;
+
 #ifdef WITH_TBB
   /* Multithreading. */
   if (settings->use_threading && BLI_task_scheduler_num_threads() > 1) {
-    RangeTask task(func, userdata, settings);
     const size_t grainsize = MAX2(settings->min_iter_per_thread, 1);
+
+    /* Nested ranges stay in the NUMA arena of the task that runs them.
+     * Checked before constructing the root task, each block has its own task and chunk. */
+    const int numa_arenas_num = task_scheduler_numa_arenas_num();
+    if (numa_arenas_num > 1 && !task_scheduler_numa_thread_in_arena() &&
+        (int64_t)(stop - start) >= (int64_t)grainsize * numa_arenas_num) {
+      task_parallel_range_numa(start, stop, userdata, func, settings, &memarenas, grainsize);
+      return;
+    }
+
+    RangeTask task(func, userdata, settings, &memarenas);
     const tbb::blocked_range<int> range(start, stop, grainsize);
 
     if (settings->func_reduce) {
@@ -134,11 +374,15 @@ void BLI_task_parallel_range(const int start,
 
   /* Single threaded. Nothing to reduce as everything is accumulated into the
    * main userdata chunk directly. */
+  const double begin_time = task_scheduler_stats_task_begin();
   TaskParallelTLS tls;
   tls.userdata_chunk = settings->userdata_chunk;
+  tls.memarena = nullptr;
+  tls.memarenas = &memarenas;
   for (int i = start; i < stop; i++) {
     func(userdata, i, &tls);
   }
+  task_scheduler_stats_task_end(begin_time, -1);
   if (settings->func_free != NULL) {
     settings->func_free(userdata, settings->userdata_chunk);
   }
@@ -149,17 +393,12 @@ int BLI_task_parallel_thread_id(const TaskParallelTLS *UNUSED(tls))
 #ifdef WITH_TBB
   /* Get a unique thread ID for texture nodes. In the future we should get rid
    * of the thread ID and change texture evaluation to not require per-thread
-   * storage that can't be efficiently allocated on the stack. */
-  static tbb::enumerable_thread_specific<int> tbb_thread_id(-1);
-  static int tbb_thread_id_counter = 0;
-
-  int &thread_id = tbb_thread_id.local();
+   * storage that can't be efficiently allocated on the stack.
+   * IDs of threads that exited are reused, so they don't alias while enough are available. */
+  const int thread_id = task_scheduler_thread_index();
   if (thread_id == -1) {
-    thread_id = atomic_fetch_and_add_int32(&tbb_thread_id_counter, 1);
-    if (thread_id >= BLENDER_MAX_THREADS) {
-      BLI_assert(!"Maximum number of threads exceeded for sculpting");
-      thread_id = thread_id % BLENDER_MAX_THREADS;
-    }
+    BLI_assert(!"Maximum number of threads exceeded for sculpting");
+    return 0;
   }
   return thread_id;
 #else
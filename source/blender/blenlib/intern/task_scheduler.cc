@@ -20,11 +20,28 @@
  * Task scheduler initialization.
  */
 
+#include <atomic>
+#include <stdio.h>
+
 #include "MEM_guardedalloc.h"
 
+#include "BLI_math_base.h"
 #include "BLI_task.h"
 #include "BLI_threads.h"
 
+#include "PIL_time.h"
+
+#include "numaapi.h"
+
+#include "task_intern.hh"
+
+#ifdef WIN32
+#  include <windows.h>
+#elif defined(__linux__)
+#  include <pthread.h>
+#  include <sched.h>
+#endif
+
 #ifdef WITH_TBB
 /* Quiet top level deprecation message, unrelated to API usage here. */
 #  define TBB_SUPPRESS_DEPRECATED_MESSAGES 1
@@ -36,6 +53,8 @@
 
 /* Task Scheduler */
 
+static void task_scheduler_observers_exit(void);
+
 static int task_scheduler_num_threads = 1;
 #ifdef WITH_TBB_GLOBAL_CONTROL
 static tbb::global_control *task_scheduler_global_control = nullptr;
@@ -67,6 +86,11 @@ void BLI_task_scheduler_init()
 
 void BLI_task_scheduler_exit()
 {
+  BLI_task_scheduler_numa_arenas_disable();
+  BLI_task_scheduler_stats_enable(false);
+  task_scheduler_observers_exit();
+  task_parallel_memarena_pool_free();
+
 #ifdef WITH_TBB_GLOBAL_CONTROL
   OBJECT_GUARDED_DELETE(task_scheduler_global_control, tbb::global_control);
 #endif
@@ -76,3 +100,455 @@ int BLI_task_scheduler_num_threads()
 {
   return task_scheduler_num_threads;
 }
+
+/* Task Scheduler Statistics
+ *
+ * Counters are indexed by the thread slot (see below), so each is written by a single thread at
+ * a time. Resetting writes them from other threads, so updates are atomic read-modify-writes.
+ * They are padded to avoid false sharing between workers. */
+
+struct alignas(64) TaskSchedulerWorkerCounters {
+  std::atomic<uint64_t> tasks_run;
+  std::atomic<uint64_t> tasks_stolen;
+  std::atomic<double> busy_time;
+  /* Time worker threads spent inside the scheduler, including busy time. */
+  std::atomic<double> scheduler_time;
+  /* Time the worker entered the scheduler, zero when outside of it. */
+  std::atomic<double> scheduler_enter_time;
+};
+
+static TaskSchedulerWorkerCounters task_scheduler_counters[BLENDER_MAX_THREADS];
+static std::atomic<bool> task_scheduler_stats_enabled(false);
+
+/* Nesting of tasks on this thread, only the outermost task counts busy time. */
+static thread_local int task_scheduler_thread_task_depth = 0;
+/* Nesting of scheduler entries, observers may report the same entry twice. */
+static thread_local int task_scheduler_thread_scheduler_depth = 0;
+
+static void task_scheduler_counter_add(std::atomic<uint64_t> &counter, const uint64_t value)
+{
+  counter.fetch_add(value, std::memory_order_relaxed);
+}
+
+static void task_scheduler_counter_add(std::atomic<double> &counter, const double value)
+{
+  double current = counter.load(std::memory_order_relaxed);
+  while (!counter.compare_exchange_weak(current, current + value, std::memory_order_relaxed)) {
+    /* Retry with the updated value. */
+  }
+}
+
+/* Thread Slots
+ *
+ * Each thread using the task scheduler gets an index below BLENDER_MAX_THREADS, unique among
+ * the running threads. Indices of threads that exited are reused, so threads that are created
+ * again (when TBB restarts its workers for example) don't run out of indices. */
+
+static ThreadMutex task_scheduler_thread_slots_mutex = BLI_MUTEX_INITIALIZER;
+static int task_scheduler_thread_slots_free[BLENDER_MAX_THREADS];
+static int task_scheduler_thread_slots_free_len = 0;
+/* Number of indices handed out so far, including the free ones. */
+static std::atomic<int> task_scheduler_thread_slots_num(0);
+
+struct TaskSchedulerThreadSlot {
+  int index = -1;
+
+  ~TaskSchedulerThreadSlot()
+  {
+    if (index == -1) {
+      return;
+    }
+    /* The thread may exit from inside the scheduler, don't count that time as idle. */
+    task_scheduler_counters[index].scheduler_enter_time.store(0.0, std::memory_order_relaxed);
+
+    BLI_mutex_lock(&task_scheduler_thread_slots_mutex);
+    task_scheduler_thread_slots_free[task_scheduler_thread_slots_free_len++] = index;
+    BLI_mutex_unlock(&task_scheduler_thread_slots_mutex);
+  }
+};
+
+static thread_local TaskSchedulerThreadSlot task_scheduler_thread_slot;
+
+int task_scheduler_thread_index()
+{
+  int &index = task_scheduler_thread_slot.index;
+  if (index == -1) {
+    BLI_mutex_lock(&task_scheduler_thread_slots_mutex);
+    if (task_scheduler_thread_slots_free_len > 0) {
+      index = task_scheduler_thread_slots_free[--task_scheduler_thread_slots_free_len];
+    }
+    else if (task_scheduler_thread_slots_num.load() < BLENDER_MAX_THREADS) {
+      index = task_scheduler_thread_slots_num.fetch_add(1);
+    }
+    BLI_mutex_unlock(&task_scheduler_thread_slots_mutex);
+  }
+  return index;
+}
+
+double task_scheduler_stats_task_begin()
+{
+  if (!task_scheduler_stats_enabled.load(std::memory_order_relaxed)) {
+    return -1.0;
+  }
+  if (task_scheduler_thread_task_depth++ > 0) {
+    return 0.0;
+  }
+  return PIL_check_seconds_timer();
+}
+
+void task_scheduler_stats_task_end(const double begin_time, const int creator_thread_index)
+{
+  if (begin_time < 0.0) {
+    return;
+  }
+  task_scheduler_thread_task_depth--;
+
+  const int index = task_scheduler_thread_index();
+  if (index == -1) {
+    return;
+  }
+  TaskSchedulerWorkerCounters &counters = task_scheduler_counters[index];
+  task_scheduler_counter_add(counters.tasks_run, 1);
+  if (creator_thread_index != -1 && creator_thread_index != index) {
+    task_scheduler_counter_add(counters.tasks_stolen, 1);
+  }
+  if (begin_time > 0.0) {
+    task_scheduler_counter_add(counters.busy_time, PIL_check_seconds_timer() - begin_time);
+  }
+}
+
+#ifdef WITH_TBB
+
+/* Node of the NUMA arena the thread is currently in, -1 when outside of them. */
+static thread_local int task_scheduler_thread_numa_arena_node = -1;
+
+/* Affinity of a worker from before it was pinned to the node of a NUMA arena,
+ * restored when it leaves the arena so it can run anywhere in other arenas. */
+struct TaskSchedulerThreadAffinity {
+#  ifdef WIN32
+  GROUP_AFFINITY affinity;
+#  elif defined(__linux__)
+  cpu_set_t affinity;
+#  endif
+  bool is_saved = false;
+};
+
+static thread_local TaskSchedulerThreadAffinity task_scheduler_thread_affinity;
+
+static void task_scheduler_thread_affinity_save()
+{
+  TaskSchedulerThreadAffinity &saved = task_scheduler_thread_affinity;
+#  ifdef WIN32
+  saved.is_saved = GetThreadGroupAffinity(GetCurrentThread(), &saved.affinity) != 0;
+#  elif defined(__linux__)
+  saved.is_saved = pthread_getaffinity_np(
+                       pthread_self(), sizeof(saved.affinity), &saved.affinity) == 0;
+#  endif
+}
+
+static void task_scheduler_thread_affinity_restore()
+{
+  TaskSchedulerThreadAffinity &saved = task_scheduler_thread_affinity;
+  if (!saved.is_saved) {
+    return;
+  }
+#  ifdef WIN32
+  SetThreadGroupAffinity(GetCurrentThread(), &saved.affinity, nullptr);
+#  elif defined(__linux__)
+  pthread_setaffinity_np(pthread_self(), sizeof(saved.affinity), &saved.affinity);
+#  endif
+  saved.is_saved = false;
+}
+
+/* Observes threads entering and leaving an arena, to measure the time workers
+ * spend in the scheduler and to pin workers of NUMA arenas to their node.
+ * Workers are unpinned when they leave a NUMA arena, or when they enter another arena
+ * (for workers still in a NUMA arena when its observer was removed). */
+class TaskSchedulerObserver : public tbb::task_scheduler_observer {
+  int numa_node_;
+
+ public:
+  TaskSchedulerObserver() : numa_node_(-1)
+  {
+    observe(true);
+  }
+
+  TaskSchedulerObserver(tbb::task_arena &arena, int numa_node)
+      : tbb::task_scheduler_observer(arena), numa_node_(numa_node)
+  {
+    observe(true);
+  }
+
+  ~TaskSchedulerObserver()
+  {
+    observe(false);
+  }
+
+  void on_scheduler_entry(bool is_worker) override
+  {
+    if (numa_node_ == -1) {
+      if (is_worker) {
+        task_scheduler_thread_affinity_restore();
+      }
+    }
+    else {
+      task_scheduler_thread_numa_arena_node = numa_node_;
+      /* Only workers are pinned, the thread waiting for a parallel range
+       * helps out in every arena and keeps its own affinity. */
+      if (is_worker) {
+        if (!task_scheduler_thread_affinity.is_saved) {
+          task_scheduler_thread_affinity_save();
+        }
+        numaAPI_RunThreadOnNode(numa_node_);
+      }
+    }
+
+    if (is_worker && task_scheduler_thread_scheduler_depth++ == 0 &&
+        task_scheduler_stats_enabled.load(std::memory_order_relaxed)) {
+      const int index = task_scheduler_thread_index();
+      if (index != -1) {
+        task_scheduler_counters[index].scheduler_enter_time.store(PIL_check_seconds_timer(),
+                                                                  std::memory_order_relaxed);
+      }
+    }
+  }
+
+  void on_scheduler_exit(bool is_worker) override
+  {
+    if (numa_node_ != -1) {
+      task_scheduler_thread_numa_arena_node = -1;
+      if (is_worker) {
+        task_scheduler_thread_affinity_restore();
+      }
+    }
+
+    if (is_worker && --task_scheduler_thread_scheduler_depth == 0) {
+      const int index = task_scheduler_thread_index();
+      if (index == -1) {
+        return;
+      }
+      TaskSchedulerWorkerCounters &counters = task_scheduler_counters[index];
+      const double enter_time = counters.scheduler_enter_time.load(std::memory_order_relaxed);
+      if (enter_time != 0.0) {
+        task_scheduler_counter_add(counters.scheduler_time,
+                                   PIL_check_seconds_timer() - enter_time);
+        counters.scheduler_enter_time.store(0.0, std::memory_order_relaxed);
+      }
+    }
+  }
+};
+
+/* Observer of the arenas other than the NUMA arenas,
+ * used for statistics and once NUMA arenas were used. */
+static TaskSchedulerObserver *task_scheduler_global_observer = nullptr;
+static bool task_scheduler_numa_arenas_used = false;
+
+static void task_scheduler_global_observer_update()
+{
+  const bool use_observer = task_scheduler_stats_enabled.load() ||
+                            task_scheduler_numa_arenas_used;
+  if (use_observer && task_scheduler_global_observer == nullptr) {
+    task_scheduler_global_observer = OBJECT_GUARDED_NEW(TaskSchedulerObserver);
+  }
+  else if (!use_observer && task_scheduler_global_observer != nullptr) {
+    OBJECT_GUARDED_DELETE(task_scheduler_global_observer, TaskSchedulerObserver);
+    task_scheduler_global_observer = nullptr;
+  }
+}
+
+#endif
+
+static void task_scheduler_observers_exit()
+{
+#ifdef WITH_TBB
+  task_scheduler_numa_arenas_used = false;
+  task_scheduler_global_observer_update();
+#endif
+}
+
+void BLI_task_scheduler_stats_enable(bool enable)
+{
+  if (enable == task_scheduler_stats_enabled.load()) {
+    return;
+  }
+  task_scheduler_stats_enabled.store(enable);
+#ifdef WITH_TBB
+  task_scheduler_global_observer_update();
+#endif
+}
+
+bool BLI_task_scheduler_stats_is_enabled()
+{
+  return task_scheduler_stats_enabled.load();
+}
+
+void BLI_task_scheduler_stats_reset()
+{
+  const int counters_num = task_scheduler_thread_slots_num.load();
+  const double time = PIL_check_seconds_timer();
+  for (int i = 0; i < counters_num; i++) {
+    TaskSchedulerWorkerCounters &counters = task_scheduler_counters[i];
+    counters.tasks_run.store(0, std::memory_order_relaxed);
+    counters.tasks_stolen.store(0, std::memory_order_relaxed);
+    counters.busy_time.store(0.0, std::memory_order_relaxed);
+    counters.scheduler_time.store(0.0, std::memory_order_relaxed);
+    if (counters.scheduler_enter_time.load(std::memory_order_relaxed) != 0.0) {
+      counters.scheduler_enter_time.store(time, std::memory_order_relaxed);
+    }
+  }
+}
+
+int BLI_task_scheduler_stats_get(TaskSchedulerWorkerStats *r_stats, int stats_len)
+{
+  const int counters_num = task_scheduler_thread_slots_num.load();
+  const double time = PIL_check_seconds_timer();
+  for (int i = 0; i < min_ii(counters_num, stats_len); i++) {
+    const TaskSchedulerWorkerCounters &counters = task_scheduler_counters[i];
+    TaskSchedulerWorkerStats &stats = r_stats[i];
+    stats.tasks_run = counters.tasks_run.load(std::memory_order_relaxed);
+    stats.tasks_stolen = counters.tasks_stolen.load(std::memory_order_relaxed);
+    stats.busy_time = counters.busy_time.load(std::memory_order_relaxed);
+
+    /* Include the time of workers that are currently in the scheduler. */
+    double scheduler_time = counters.scheduler_time.load(std::memory_order_relaxed);
+    const double enter_time = counters.scheduler_enter_time.load(std::memory_order_relaxed);
+    if (enter_time != 0.0) {
+      scheduler_time += time - enter_time;
+    }
+    stats.idle_time = (scheduler_time > stats.busy_time) ? scheduler_time - stats.busy_time : 0.0;
+  }
+  return counters_num;
+}
+
+void BLI_task_scheduler_stats_print()
+{
+  const int counters_num = BLI_task_scheduler_stats_get(nullptr, 0);
+  TaskSchedulerWorkerStats *stats = (TaskSchedulerWorkerStats *)MEM_mallocN(
+      sizeof(*stats) * (size_t)max_ii(counters_num, 1), __func__);
+  BLI_task_scheduler_stats_get(stats, counters_num);
+
+  printf("Task scheduler statistics:\n");
+  printf("  %6s %10s %10s %10s %10s\n", "Worker", "Tasks", "Stolen", "Busy (s)", "Idle (s)");
+  for (int i = 0; i < counters_num; i++) {
+    printf("  %6d %10llu %10llu %10.4f %10.4f\n",
+           i,
+           (unsigned long long)stats[i].tasks_run,
+           (unsigned long long)stats[i].tasks_stolen,
+           stats[i].busy_time,
+           stats[i].idle_time);
+  }
+
+  MEM_freeN(stats);
+}
+
+/* NUMA Arenas */
+
+#ifdef WITH_TBB
+
+struct TaskSchedulerNumaArena {
+  tbb::task_arena arena;
+  TaskSchedulerObserver *observer;
+  int concurrency;
+
+  TaskSchedulerNumaArena(int node, int concurrency)
+      : arena(concurrency), observer(nullptr), concurrency(concurrency)
+  {
+    /* The arena must exist before an observer can be attached to it. */
+    arena.initialize();
+    observer = OBJECT_GUARDED_NEW(TaskSchedulerObserver, arena, node);
+  }
+
+  ~TaskSchedulerNumaArena()
+  {
+    OBJECT_GUARDED_DELETE(observer, TaskSchedulerObserver);
+  }
+};
+
+static TaskSchedulerNumaArena **task_scheduler_numa_arenas = nullptr;
+static int task_scheduler_numa_arenas_len = 0;
+
+int task_scheduler_numa_arenas_num()
+{
+  return task_scheduler_numa_arenas_len;
+}
+
+tbb::task_arena &task_scheduler_numa_arena(int arena_index)
+{
+  BLI_assert(arena_index < task_scheduler_numa_arenas_len);
+  return task_scheduler_numa_arenas[arena_index]->arena;
+}
+
+int task_scheduler_numa_arena_concurrency(int arena_index)
+{
+  BLI_assert(arena_index < task_scheduler_numa_arenas_len);
+  return task_scheduler_numa_arenas[arena_index]->concurrency;
+}
+
+bool task_scheduler_numa_thread_in_arena()
+{
+  return task_scheduler_thread_numa_arena_node != -1;
+}
+
+#endif
+
+bool BLI_task_scheduler_numa_arenas_enable()
+{
+#ifdef WITH_TBB
+  if (task_scheduler_numa_arenas_len > 0) {
+    return true;
+  }
+  if (task_scheduler_num_threads <= 1 || numaAPI_Initialize() != NUMAAPI_SUCCESS) {
+    return false;
+  }
+
+  /* Node indices are not guaranteed to be contiguous, only use nodes that
+   * are available and have processors. */
+  const int num_nodes = numaAPI_GetNumNodes();
+  int *nodes = (int *)MEM_mallocN(sizeof(int) * (size_t)max_ii(num_nodes, 1), __func__);
+  int nodes_len = 0;
+  for (int node = 0; node < num_nodes; node++) {
+    if (numaAPI_IsNodeAvailable(node) && numaAPI_GetNumNodeProcessors(node) > 0) {
+      nodes[nodes_len++] = node;
+    }
+  }
+
+  if (nodes_len > 1) {
+    task_scheduler_numa_arenas = (TaskSchedulerNumaArena **)MEM_mallocN(
+        sizeof(*task_scheduler_numa_arenas) * (size_t)nodes_len, __func__);
+    for (int i = 0; i < nodes_len; i++) {
+      task_scheduler_numa_arenas[i] = OBJECT_GUARDED_NEW(
+          TaskSchedulerNumaArena, nodes[i], numaAPI_GetNumNodeProcessors(nodes[i]));
+    }
+    task_scheduler_numa_arenas_len = nodes_len;
+
+    /* Kept until exit, workers may still be pinned after disabling the arenas. */
+    task_scheduler_numa_arenas_used = true;
+    task_scheduler_global_observer_update();
+  }
+
+  MEM_freeN(nodes);
+  return task_scheduler_numa_arenas_len > 0;
+#else
+  return false;
+#endif
+}
+
+void BLI_task_scheduler_numa_arenas_disable()
+{
+#ifdef WITH_TBB
+  for (int i = 0; i < task_scheduler_numa_arenas_len; i++) {
+    OBJECT_GUARDED_DELETE(task_scheduler_numa_arenas[i], TaskSchedulerNumaArena);
+  }
+  MEM_SAFE_FREE(task_scheduler_numa_arenas);
+  task_scheduler_numa_arenas_len = 0;
+#endif
+}
+
+int BLI_task_scheduler_numa_arenas_num()
+{
+#ifdef WITH_TBB
+  return task_scheduler_numa_arenas_len;
+#else
+  return 0;
+#endif
+}
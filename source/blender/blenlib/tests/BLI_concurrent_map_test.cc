@@ -0,0 +1,191 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <atomic>
+
+#include "BLI_concurrent_map.hh"
+#include "BLI_rand.h"
+#include "BLI_strict_flags.h"
+#include "BLI_string_ref.hh"
+#include "BLI_task.h"
+#include "BLI_vector.hh"
+
+namespace blender::tests {
+
+TEST(concurrent_map, DefaultConstructor)
+{
+  ConcurrentMap<int, float> map;
+  EXPECT_EQ(map.size(), 0);
+  EXPECT_TRUE(map.is_empty());
+  EXPECT_FALSE(map.contains(3));
+  EXPECT_EQ(map.lookup_ptr(3), nullptr);
+}
+
+TEST(concurrent_map, AddAndLookup)
+{
+  ConcurrentMap<int, float> map(10);
+  EXPECT_TRUE(map.add(2, 5.0f));
+  EXPECT_TRUE(map.add(6, 2.0f));
+  EXPECT_EQ(map.size(), 2);
+  EXPECT_TRUE(map.contains(2));
+  EXPECT_TRUE(map.contains(6));
+  EXPECT_FALSE(map.contains(4));
+  EXPECT_EQ(map.lookup(2), 5.0f);
+  EXPECT_EQ(*map.lookup_ptr(6), 2.0f);
+  EXPECT_EQ(map.lookup_default(4, 1.0f), 1.0f);
+}
+
+TEST(concurrent_map, AddExistingKeepsFirstValue)
+{
+  ConcurrentMap<int, float> map(10);
+  EXPECT_TRUE(map.add(3, 1.0f));
+  EXPECT_FALSE(map.add(3, 2.0f));
+  EXPECT_EQ(map.size(), 1);
+  EXPECT_EQ(map.lookup(3), 1.0f);
+  EXPECT_EQ(map.lookup_or_add(3, 4.0f), 1.0f);
+  EXPECT_EQ(map.lookup_or_add(4, 4.0f), 4.0f);
+  EXPECT_EQ(map.size(), 2);
+}
+
+TEST(concurrent_map, LookupOrAddCB)
+{
+  ConcurrentMap<int, float> map(10);
+  int calls = 0;
+  auto create_value = [&]() {
+    calls++;
+    return 11.0f;
+  };
+  EXPECT_EQ(map.lookup_or_add_cb(0, create_value), 11.0f);
+  EXPECT_EQ(map.lookup_or_add_cb(0, create_value), 11.0f);
+  EXPECT_EQ(calls, 1);
+  map.lookup_or_add_cb(0, create_value) = 2.0f;
+  EXPECT_EQ(map.lookup(0), 2.0f);
+}
+
+TEST(concurrent_map, ReserveKeepsItems)
+{
+  ConcurrentMap<int, int> map;
+  for (int i = 0; i < 100; i++) {
+    map.reserve(i + 1);
+    EXPECT_GE(map.usable_capacity(), i + 1);
+    map.add(i, i * 3);
+  }
+  EXPECT_EQ(map.size(), 100);
+  for (int i = 0; i < 100; i++) {
+    EXPECT_EQ(map.lookup(i), i * 3);
+  }
+}
+
+TEST(concurrent_map, Clear)
+{
+  ConcurrentMap<int, int> map(10);
+  map.add(1, 1);
+  map.add(2, 2);
+  const int64_t capacity = map.capacity();
+  map.clear();
+  EXPECT_EQ(map.size(), 0);
+  EXPECT_FALSE(map.contains(1));
+  EXPECT_EQ(map.capacity(), capacity);
+  map.add(1, 5);
+  EXPECT_EQ(map.lookup(1), 5);
+}
+
+TEST(concurrent_map, StringKeys)
+{
+  ConcurrentMap<std::string, int> map(10);
+  map.add("hello", 1);
+  map.add_as(StringRef("world"), 2);
+  EXPECT_EQ(map.lookup_as(StringRef("hello")), 1);
+  EXPECT_EQ(map.lookup("world"), 2);
+  EXPECT_FALSE(map.contains_as(StringRef("test")));
+}
+
+TEST(concurrent_map, ForeachItem)
+{
+  ConcurrentMap<int, int> map(10);
+  map.add(3, 4);
+  map.add(1, 8);
+
+  Vector<int> keys;
+  Vector<int> values;
+  map.foreach_item([&](int key, int value) {
+    keys.append(key);
+    values.append(value);
+  });
+
+  EXPECT_EQ(keys.size(), 2);
+  EXPECT_EQ(values.size(), 2);
+  EXPECT_EQ(keys.first_index_of(3), values.first_index_of(4));
+  EXPECT_EQ(keys.first_index_of(1), values.first_index_of(8));
+}
+
+struct ConcurrentMapTestData {
+  ConcurrentMap<int, int> *map;
+  const int *keys;
+  std::atomic<int> added;
+  std::atomic<int> created;
+};
+
+static void concurrent_map_add_task(void *__restrict userdata,
+                                    const int index,
+                                    const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  ConcurrentMapTestData *data = static_cast<ConcurrentMapTestData *>(userdata);
+  const int key = data->keys[index];
+  if (data->map->add(key, key * 2)) {
+    data->added++;
+  }
+  /* Every key is added before, so the callback must never be called. */
+  data->map->lookup_or_add_cb(key, [&]() {
+    data->created++;
+    return 0;
+  });
+  EXPECT_EQ(data->map->lookup(key), key * 2);
+}
+
+TEST(concurrent_map, ParallelAdd)
+{
+  const int keys_num = 100000;
+  const int unique_keys_num = 10000;
+
+  /* Every key is added about ten times, from different threads. */
+  Vector<int> keys(keys_num);
+  RNG *rng = BLI_rng_new(0);
+  for (int i = 0; i < keys_num; i++) {
+    keys[i] = static_cast<int>(BLI_rng_get_uint(rng) % unique_keys_num);
+  }
+  BLI_rng_free(rng);
+
+  BLI_threadapi_init();
+  BLI_task_scheduler_init();
+
+  ConcurrentMap<int, int> map(unique_keys_num);
+  ConcurrentMapTestData data;
+  data.map = &map;
+  data.keys = keys.data();
+  data.added = 0;
+  data.created = 0;
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 64;
+  BLI_task_parallel_range(0, keys_num, &data, concurrent_map_add_task, &settings);
+
+  EXPECT_EQ(data.added, map.size());
+  EXPECT_EQ(data.created, 0);
+  for (const int key : keys) {
+    EXPECT_EQ(map.lookup(key), key * 2);
+  }
+  int64_t items_num = 0;
+  map.foreach_item([&](int key, int value) {
+    EXPECT_EQ(value, key * 2);
+    items_num++;
+  });
+  EXPECT_EQ(items_num, map.size());
+
+  BLI_task_scheduler_exit();
+  BLI_threadapi_exit();
+}
+
+}  // namespace blender::tests
@@ -6,6 +6,8 @@
 
 #include "BLI_math.h"
 #include "BLI_rand.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
 #include "PIL_time.h"
 
 #include "BLI_delaunay_2d.h"
@@ -30,6 +32,7 @@ static void fill_input_verts(CDT_input *r_input, float (*vcos)[2], int nverts)
   r_input->faces_len_table = NULL;
   r_input->epsilon = 1e-5f;
   r_input->skip_input_modify = false;
+  r_input->use_threading = false;
 }
 
 static void add_input_edges(CDT_input *r_input, int (*edges)[2], int nedges)
@@ -1425,6 +1428,102 @@ TEST(delaunay, ChainNearIntersects)
   free_spec_arrays(&in);
   BLI_delaunay_2d_cdt_free(out);
 }
+
+static int orig_table_len(const int *start_table, const int *len_table, int len)
+{
+  return len == 0 ? 0 : start_table[len - 1] + len_table[len - 1];
+}
+
+template<typename T> static void expect_arrays_eq(const T *a, const T *b, int len)
+{
+  if (len > 0) {
+    EXPECT_EQ(memcmp(a, b, sizeof(T) * len), 0);
+  }
+}
+
+static void expect_results_eq(const CDT_result *a, const CDT_result *b)
+{
+  EXPECT_EQ(a->verts_len, b->verts_len);
+  EXPECT_EQ(a->edges_len, b->edges_len);
+  EXPECT_EQ(a->faces_len, b->faces_len);
+  if (a->verts_len != b->verts_len || a->edges_len != b->edges_len ||
+      a->faces_len != b->faces_len) {
+    return;
+  }
+  expect_arrays_eq(a->vert_coords, b->vert_coords, a->verts_len);
+  expect_arrays_eq(a->edges, b->edges, a->edges_len);
+  expect_arrays_eq(a->faces_start_table, b->faces_start_table, a->faces_len);
+  expect_arrays_eq(a->faces_len_table, b->faces_len_table, a->faces_len);
+  expect_arrays_eq(
+      a->faces, b->faces, orig_table_len(a->faces_start_table, a->faces_len_table, a->faces_len));
+  expect_arrays_eq(a->verts_orig_len_table, b->verts_orig_len_table, a->verts_len);
+  expect_arrays_eq(a->edges_orig_len_table, b->edges_orig_len_table, a->edges_len);
+  expect_arrays_eq(a->faces_orig_len_table, b->faces_orig_len_table, a->faces_len);
+  expect_arrays_eq(
+      a->verts_orig,
+      b->verts_orig,
+      orig_table_len(a->verts_orig_start_table, a->verts_orig_len_table, a->verts_len));
+  expect_arrays_eq(
+      a->edges_orig,
+      b->edges_orig,
+      orig_table_len(a->edges_orig_start_table, a->edges_orig_len_table, a->edges_len));
+  expect_arrays_eq(
+      a->faces_orig,
+      b->faces_orig,
+      orig_table_len(a->faces_orig_start_table, a->faces_orig_len_table, a->faces_len));
+}
+
+/* Enough points for several levels of tasks in the threaded initial triangulation,
+ * with a circle face and some duplicate points. */
+TEST(delaunay, Threaded)
+{
+  const int npts = 100000;
+  const int ncircle = 64;
+  CDT_input in;
+  CDT_result *out, *out_threaded;
+  float(*p)[2] = (float(*)[2])MEM_malloc_arrayN(npts, sizeof(float[2]), __func__);
+  int *faces = (int *)MEM_malloc_arrayN(ncircle, sizeof(int), __func__);
+  int faces_start_table[1] = {0};
+  int faces_len_table[1] = {ncircle};
+  RNG *rng = BLI_rng_new(0);
+  int i;
+
+  BLI_threadapi_init();
+  BLI_task_scheduler_init();
+
+  for (i = 0; i < ncircle; i++) {
+    const double angle = 2.0 * M_PI * i / ncircle;
+    p[i][0] = (float)(0.5 + 0.4 * cos(angle));
+    p[i][1] = (float)(0.5 + 0.4 * sin(angle));
+    faces[i] = i;
+  }
+  for (; i < npts; i++) {
+    if (i % 100 == 0) {
+      copy_v2_v2(p[i], p[i - 1]);
+      continue;
+    }
+    p[i][0] = (float)BLI_rng_get_double(rng);
+    p[i][1] = (float)BLI_rng_get_double(rng);
+  }
+  fill_input_verts(&in, p, npts);
+  add_input_faces(&in, faces, faces_start_table, faces_len_table, 1);
+
+  for (CDT_output_type otype : {CDT_FULL, CDT_INSIDE}) {
+    in.use_threading = false;
+    out = BLI_delaunay_2d_cdt_calc(&in, otype);
+    in.use_threading = true;
+    out_threaded = BLI_delaunay_2d_cdt_calc(&in, otype);
+    expect_results_eq(out, out_threaded);
+    BLI_delaunay_2d_cdt_free(out);
+    BLI_delaunay_2d_cdt_free(out_threaded);
+  }
+
+  BLI_rng_free(rng);
+  MEM_freeN(p);
+  MEM_freeN(faces);
+  BLI_task_scheduler_exit();
+  BLI_threadapi_exit();
+}
 #endif
 
 #if DO_RANDOM_TESTS
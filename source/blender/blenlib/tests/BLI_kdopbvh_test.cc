@@ -2,7 +2,10 @@
 
 #include "testing/testing.h"
 
-/* TODO: ray intersection, overlap ... etc.*/
+/* TODO: overlap ... etc.*/
+
+#include <algorithm>
+#include <vector>
 
 #include "MEM_guardedalloc.h"
 
@@ -120,6 +123,12 @@ TEST(kdopbvh, FindNearest_500)
   find_nearest_points_test(500, 1.0, 1000, 12);
 }
 
+/* Large enough for branches to be split using multiple threads. */
+TEST(kdopbvh, FindNearest_100000)
+{
+  find_nearest_points_test(100000, 1.0, 1000000, 12);
+}
+
 TEST(kdopbvh, OptimalFindNearest_1)
 {
   find_nearest_points_test(1, 1.0, 1000, 1234, true);
@@ -132,3 +141,379 @@ TEST(kdopbvh, OptimalFindNearest_500)
 {
   find_nearest_points_test(500, 1.0, 1000, 12, true);
 }
+
+/**
+ * Build a tree, move all points and update it.
+ */
+static void update_tree_test(int points_len, int random_seed)
+{
+  struct RNG *rng = BLI_rng_new(random_seed);
+  BVHTree *tree = BLI_bvhtree_new(points_len, 0.0, 4, 6);
+
+  float(*points)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * points_len, __func__);
+  for (int i = 0; i < points_len; i++) {
+    rng_v3_round(points[i], 3, rng, 1000000, 1.0f);
+    BLI_bvhtree_insert(tree, i, points[i], 1);
+  }
+  BLI_bvhtree_balance(tree);
+
+  for (int i = 0; i < points_len; i++) {
+    float offset[3];
+    rng_v3_round(offset, 3, rng, 1000000, 0.1f);
+    add_v3_v3(points[i], offset);
+    BLI_bvhtree_update_node(tree, i, points[i], NULL, 1);
+  }
+  BLI_bvhtree_update_tree(tree);
+
+  for (int i = 0; i < points_len; i++) {
+    const int j = BLI_bvhtree_find_nearest(tree, points[i], NULL, NULL, NULL);
+    if (j != i) {
+      EXPECT_EQ_ARRAY(points[i], points[j], 3);
+    }
+  }
+
+  BLI_bvhtree_free(tree);
+  BLI_rng_free(rng);
+  MEM_freeN(points);
+}
+
+TEST(kdopbvh, UpdateTree_500)
+{
+  update_tree_test(500, 12);
+}
+TEST(kdopbvh, UpdateTree_100000)
+{
+  update_tree_test(100000, 1234);
+}
+
+/* Hit points within a distance of 0.05 from the ray (at the closest point along the ray). */
+static void ray_cast_point_callback(void *userdata,
+                                    int index,
+                                    const BVHTreeRay *ray,
+                                    BVHTreeRayHit *hit)
+{
+  const float(*points)[3] = (const float(*)[3])userdata;
+  float co[3], offset[3];
+  sub_v3_v3v3(offset, points[index], ray->origin);
+  const float dist = dot_v3v3(offset, ray->direction);
+  madd_v3_v3v3fl(co, ray->origin, ray->direction, dist);
+  if (dist >= 0.0f && dist < hit->dist && len_squared_v3v3(co, points[index]) < 0.05f * 0.05f) {
+    hit->index = index;
+    hit->dist = dist;
+    copy_v3_v3(hit->co, co);
+  }
+}
+
+/**
+ * Rays from a grid of origins (neighboring rays are similar, as #BLI_bvhtree_ray_cast_batch
+ * expects), with some axis aligned rays to check those are handled the same way.
+ */
+static void rays_grid_create(float (*co)[3], float (*dir)[3], int rays_len, struct RNG *rng)
+{
+  for (int i = 0; i < rays_len; i++) {
+    co[i][0] = (float)(i % 32 - 16) / 32.0f;
+    co[i][1] = (float)(i / 32 - 16) / 32.0f;
+    co[i][2] = -2.0f;
+    if (i % 7 == 0) {
+      copy_v3_fl3(dir[i], 0.0f, 0.0f, 1.0f);
+    }
+    else {
+      rng_v3_round(dir[i], 2, rng, 1000, 0.2f);
+      dir[i][2] = 1.0f;
+      normalize_v3(dir[i]);
+    }
+  }
+}
+
+static void ray_cast_batch_test(int points_len, int rays_len, int random_seed, bool use_callback)
+{
+  struct RNG *rng = BLI_rng_new(random_seed);
+  BVHTree *tree = BLI_bvhtree_new(points_len, 0.05f, 4, 6);
+
+  float(*points)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * points_len, __func__);
+  for (int i = 0; i < points_len; i++) {
+    rng_v3_round(points[i], 3, rng, 1000, 1.0f);
+    BLI_bvhtree_insert(tree, i, points[i], 1);
+  }
+  BLI_bvhtree_balance(tree);
+
+  float(*co)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * rays_len, __func__);
+  float(*dir)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * rays_len, __func__);
+  BVHTreeRayHit *hits = (BVHTreeRayHit *)MEM_mallocN(sizeof(*hits) * rays_len, __func__);
+  rays_grid_create(co, dir, rays_len, rng);
+
+  for (int i = 0; i < rays_len; i++) {
+    hits[i].index = -1;
+    hits[i].dist = BVH_RAYCAST_DIST_MAX;
+  }
+
+  BVHTree_RayCastCallback callback = use_callback ? ray_cast_point_callback : NULL;
+  BLI_bvhtree_ray_cast_batch(
+      tree, co, dir, rays_len, 0.0f, hits, callback, points, BVH_RAYCAST_DEFAULT);
+
+  int hits_num = 0;
+  for (int i = 0; i < rays_len; i++) {
+    BVHTreeRayHit hit_single;
+    hit_single.index = -1;
+    hit_single.dist = BVH_RAYCAST_DIST_MAX;
+    BLI_bvhtree_ray_cast_ex(
+        tree, co[i], dir[i], 0.0f, &hit_single, callback, points, BVH_RAYCAST_DEFAULT);
+
+    EXPECT_EQ(hit_single.index, hits[i].index);
+    EXPECT_EQ(hit_single.dist, hits[i].dist);
+    if (hits[i].index != -1) {
+      hits_num++;
+    }
+  }
+  /* Ensure the test isn't only checking rays that miss. */
+  EXPECT_GT(hits_num, 0);
+
+  BLI_bvhtree_free(tree);
+  BLI_rng_free(rng);
+  MEM_freeN(points);
+  MEM_freeN(co);
+  MEM_freeN(dir);
+  MEM_freeN(hits);
+}
+
+TEST(kdopbvh, RayCastBatch_5)
+{
+  ray_cast_batch_test(500, 5, 12, false);
+}
+TEST(kdopbvh, RayCastBatch_1023)
+{
+  ray_cast_batch_test(500, 1023, 12, false);
+}
+TEST(kdopbvh, RayCastBatchCallback_1023)
+{
+  ray_cast_batch_test(500, 1023, 1234, true);
+}
+
+/**
+ * Every point is inserted twice, so rays hit two points at exactly the same distance. The
+ * callback keeps the first, so the hits are only the same when each ray of a packet visits the
+ * nodes in its own order. Neighboring rays go in opposite directions along the points.
+ */
+static void ray_cast_batch_ties_test(int points_len, int random_seed)
+{
+  struct RNG *rng = BLI_rng_new(random_seed);
+  BVHTree *tree = BLI_bvhtree_new(points_len * 2, 0.05f, 4, 6);
+
+  float(*points)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * points_len * 2, __func__);
+  for (int i = 0; i < points_len; i++) {
+    rng_v3_round(points[i], 2, rng, 1000, 0.2f);
+    points[i][2] = BLI_rng_get_float(rng) * 2.0f - 1.0f;
+    copy_v3_v3(points[points_len + i], points[i]);
+  }
+  for (int i = 0; i < points_len * 2; i++) {
+    BLI_bvhtree_insert(tree, i, points[i], 1);
+  }
+  BLI_bvhtree_balance(tree);
+
+  const int rays_len = points_len;
+  float(*co)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * rays_len, __func__);
+  float(*dir)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * rays_len, __func__);
+  BVHTreeRayHit *hits = (BVHTreeRayHit *)MEM_mallocN(sizeof(*hits) * rays_len, __func__);
+  for (int i = 0; i < rays_len; i++) {
+    copy_v3_fl3(dir[i], 0.0f, 0.0f, (i % 2) ? -1.0f : 1.0f);
+    madd_v3_v3v3fl(co[i], points[i], dir[i], -2.0f);
+    hits[i].index = -1;
+    hits[i].dist = BVH_RAYCAST_DIST_MAX;
+  }
+
+  BLI_bvhtree_ray_cast_batch(tree,
+                             co,
+                             dir,
+                             rays_len,
+                             0.0f,
+                             hits,
+                             ray_cast_point_callback,
+                             points,
+                             BVH_RAYCAST_DEFAULT);
+
+  for (int i = 0; i < rays_len; i++) {
+    BVHTreeRayHit hit_single;
+    hit_single.index = -1;
+    hit_single.dist = BVH_RAYCAST_DIST_MAX;
+    BLI_bvhtree_ray_cast_ex(tree,
+                            co[i],
+                            dir[i],
+                            0.0f,
+                            &hit_single,
+                            ray_cast_point_callback,
+                            points,
+                            BVH_RAYCAST_DEFAULT);
+
+    EXPECT_NE(hits[i].index, -1);
+    EXPECT_EQ(hit_single.index, hits[i].index);
+    EXPECT_EQ(hit_single.dist, hits[i].dist);
+  }
+
+  BLI_bvhtree_free(tree);
+  BLI_rng_free(rng);
+  MEM_freeN(points);
+  MEM_freeN(co);
+  MEM_freeN(dir);
+  MEM_freeN(hits);
+}
+
+TEST(kdopbvh, RayCastBatchTies_500)
+{
+  ray_cast_batch_ties_test(500, 12);
+}
+
+static void overlap_pairs_sort(BVHTreeOverlap *overlap, uint overlap_len)
+{
+  std::sort(overlap, overlap + overlap_len, [](const BVHTreeOverlap &a, const BVHTreeOverlap &b) {
+    return (a.indexA != b.indexA) ? (a.indexA < b.indexA) : (a.indexB < b.indexB);
+  });
+}
+
+/**
+ * Check queries using the compact layout give the same results as the regular tree,
+ * before and after updating the tree.
+ */
+static void compact_layout_test(int points_len, int random_seed)
+{
+  struct RNG *rng = BLI_rng_new(random_seed);
+  BVHTree *tree = BLI_bvhtree_new(points_len, 0.02f, 4, 6);
+  BVHTree *tree_compact = BLI_bvhtree_new(points_len, 0.02f, 4, 6);
+
+  float(*points)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * points_len, __func__);
+  for (int i = 0; i < points_len; i++) {
+    rng_v3_round(points[i], 3, rng, 1000000, 1.0f);
+    BLI_bvhtree_insert(tree, i, points[i], 1);
+    BLI_bvhtree_insert(tree_compact, i, points[i], 1);
+  }
+  BLI_bvhtree_balance(tree);
+  BLI_bvhtree_balance(tree_compact);
+  EXPECT_TRUE(BLI_bvhtree_compact_layout_build(tree_compact));
+  EXPECT_TRUE(BLI_bvhtree_has_compact_layout(tree_compact));
+
+  for (int update = 0; update < 2; update++) {
+    if (update) {
+      for (int i = 0; i < points_len; i++) {
+        float offset[3];
+        rng_v3_round(offset, 3, rng, 1000000, 0.5f);
+        add_v3_v3(points[i], offset);
+        BLI_bvhtree_update_node(tree, i, points[i], NULL, 1);
+        BLI_bvhtree_update_node(tree_compact, i, points[i], NULL, 1);
+      }
+      BLI_bvhtree_update_tree(tree);
+      BLI_bvhtree_update_tree(tree_compact);
+    }
+
+    for (int i = 0; i < points_len; i++) {
+      float co[3];
+      rng_v3_round(co, 3, rng, 1000000, 1.5f);
+      BVHTreeNearest nearest, nearest_compact;
+      nearest.index = nearest_compact.index = -1;
+      nearest.dist_sq = nearest_compact.dist_sq = FLT_MAX;
+      BLI_bvhtree_find_nearest(tree, co, &nearest, NULL, NULL);
+      BLI_bvhtree_find_nearest(tree_compact, co, &nearest_compact, NULL, NULL);
+      EXPECT_EQ(nearest.dist_sq, nearest_compact.dist_sq);
+    }
+
+    uint overlap_len, overlap_compact_len;
+    BVHTreeOverlap *overlap = BLI_bvhtree_overlap(tree, tree, &overlap_len, NULL, NULL);
+    BVHTreeOverlap *overlap_compact = BLI_bvhtree_overlap(
+        tree_compact, tree_compact, &overlap_compact_len, NULL, NULL);
+    if (points_len > 1000) {
+      /* Ensure the test isn't only checking trees without any overlap. */
+      EXPECT_GT(overlap_len, 0);
+    }
+    ASSERT_EQ(overlap_len, overlap_compact_len);
+    overlap_pairs_sort(overlap, overlap_len);
+    overlap_pairs_sort(overlap_compact, overlap_compact_len);
+    for (uint i = 0; i < overlap_len; i++) {
+      EXPECT_EQ(overlap[i].indexA, overlap_compact[i].indexA);
+      EXPECT_EQ(overlap[i].indexB, overlap_compact[i].indexB);
+    }
+    MEM_freeN(overlap);
+    MEM_freeN(overlap_compact);
+  }
+
+  BLI_bvhtree_free(tree);
+  BLI_bvhtree_free(tree_compact);
+  BLI_rng_free(rng);
+  MEM_freeN(points);
+}
+
+TEST(kdopbvh, CompactLayout_3)
+{
+  compact_layout_test(3, 12);
+}
+TEST(kdopbvh, CompactLayout_10000)
+{
+  compact_layout_test(10000, 1234);
+}
+struct NearestOrderData {
+  const float (*points)[3];
+  std::vector<int> indices;
+};
+
+static void nearest_order_callback(void *userdata,
+                                   int index,
+                                   const float co[3],
+                                   BVHTreeNearest *nearest)
+{
+  NearestOrderData *data = (NearestOrderData *)userdata;
+  data->indices.push_back(index);
+
+  const float dist_sq = len_squared_v3v3(co, data->points[index]);
+  if (dist_sq < nearest->dist_sq) {
+    nearest->index = index;
+    nearest->dist_sq = dist_sq;
+  }
+}
+
+/**
+ * The compact layout visits children nearest first, the result is the same
+ * but the callback is called for other leafs (and in another order) than with the regular tree.
+ */
+TEST(kdopbvh, CompactLayoutFindNearestOrder)
+{
+  const float points[4][3] = {{0.0f, 0.0f, 0.0f},
+                              {1.0f, 0.0f, 0.0f},
+                              {2.0f, 0.0f, 0.0f},
+                              {3.0f, 0.0f, 0.0f}};
+  const float co[3] = {1.9f, 0.0f, 0.0f};
+
+  BVHTree *tree = BLI_bvhtree_new(4, 0.0f, 4, 6);
+  for (int i = 0; i < 4; i++) {
+    BLI_bvhtree_insert(tree, i, points[i], 1);
+  }
+  BLI_bvhtree_balance(tree);
+
+  for (int use_compact = 0; use_compact < 2; use_compact++) {
+    if (use_compact) {
+      EXPECT_TRUE(BLI_bvhtree_compact_layout_build(tree));
+    }
+    NearestOrderData data = {points};
+    BVHTreeNearest nearest;
+    nearest.index = -1;
+    nearest.dist_sq = FLT_MAX;
+    BLI_bvhtree_find_nearest(tree, co, &nearest, nearest_order_callback, &data);
+    EXPECT_EQ(nearest.index, 2);
+    if (use_compact) {
+      EXPECT_EQ(data.indices, std::vector<int>({2}));
+    }
+    else {
+      /* The query is past the first child along the main axis, children are visited last first. */
+      EXPECT_EQ(data.indices, std::vector<int>({3, 2}));
+    }
+  }
+
+  BLI_bvhtree_free(tree);
+}
+
+TEST(kdopbvh, CompactLayoutUnsupported)
+{
+  BVHTree *tree = BLI_bvhtree_new(1, 0.0, 8, 8);
+  float co[3] = {0};
+  BLI_bvhtree_insert(tree, 0, co, 1);
+  BLI_bvhtree_balance(tree);
+  EXPECT_FALSE(BLI_bvhtree_compact_layout_build(tree));
+  EXPECT_FALSE(BLI_bvhtree_has_compact_layout(tree));
+  BLI_bvhtree_free(tree);
+}
@@ -0,0 +1,222 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_kdtree.h"
+#include "BLI_math_vector.h"
+#include "BLI_rand.h"
+#include "BLI_utildefines.h"
+
+/* -------------------------------------------------------------------- */
+/* Helper Functions */
+
+static void rng_get_float_v3(struct RNG *rng, float r_co[3])
+{
+  for (int j = 0; j < 3; j++) {
+    r_co[j] = BLI_rng_get_float(rng);
+  }
+}
+
+static KDTree_3d *kdtree_random_create(float (*points)[3], int points_len, struct RNG *rng)
+{
+  KDTree_3d *tree = BLI_kdtree_3d_new(points_len);
+  for (int i = 0; i < points_len; i++) {
+    rng_get_float_v3(rng, points[i]);
+    BLI_kdtree_3d_insert(tree, i, points[i]);
+  }
+  BLI_kdtree_3d_balance(tree);
+  return tree;
+}
+
+/* -------------------------------------------------------------------- */
+/* Tests */
+
+static void find_nearest_n_batch_test(int points_len, int co_len, uint nearest_len_capacity)
+{
+  struct RNG *rng = BLI_rng_new(1234);
+  float(*points)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * points_len, __func__);
+  KDTree_3d *tree = kdtree_random_create(points, points_len, rng);
+
+  float(*co)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * co_len, __func__);
+  for (int i = 0; i < co_len; i++) {
+    BLI_rng_get_float_unit_v3(rng, co[i]);
+  }
+
+  KDTreeNearest_3d *nearest_batch = (KDTreeNearest_3d *)MEM_mallocN(
+      sizeof(*nearest_batch) * co_len * nearest_len_capacity, __func__);
+  KDTreeNearest_3d *nearest = (KDTreeNearest_3d *)MEM_mallocN(
+      sizeof(*nearest) * nearest_len_capacity, __func__);
+  int *nearest_batch_len = (int *)MEM_mallocN(sizeof(int) * co_len, __func__);
+
+  BLI_kdtree_3d_find_nearest_n_batch(
+      tree, co, co_len, nearest_batch, nearest_len_capacity, nearest_batch_len);
+
+  for (int i = 0; i < co_len; i++) {
+    const int nearest_len = BLI_kdtree_3d_find_nearest_n(
+        tree, co[i], nearest, nearest_len_capacity);
+    ASSERT_EQ(nearest_len, nearest_batch_len[i]);
+    for (int j = 0; j < nearest_len; j++) {
+      const KDTreeNearest_3d *n = &nearest_batch[i * nearest_len_capacity + j];
+      EXPECT_EQ(nearest[j].index, n->index);
+      EXPECT_EQ(nearest[j].dist, n->dist);
+    }
+  }
+
+  BLI_kdtree_3d_free(tree);
+  BLI_rng_free(rng);
+  MEM_freeN(points);
+  MEM_freeN(co);
+  MEM_freeN(nearest);
+  MEM_freeN(nearest_batch);
+  MEM_freeN(nearest_batch_len);
+}
+
+TEST(kdtree, FindNearestNBatch_10)
+{
+  find_nearest_n_batch_test(100, 10, 4);
+}
+TEST(kdtree, FindNearestNBatch_10000)
+{
+  find_nearest_n_batch_test(10000, 10000, 8);
+}
+TEST(kdtree, FindNearestNBatchFewPoints)
+{
+  /* Less points than requested. */
+  find_nearest_n_batch_test(3, 2000, 8);
+}
+
+struct RangeSearchBatchData {
+  int *found_len;
+  float (*points)[3];
+  float (*co)[3];
+  float range;
+};
+
+static bool range_search_batch_cb(
+    void *user_data, int co_index, int index, const float co[3], float dist_sq)
+{
+  RangeSearchBatchData *data = (RangeSearchBatchData *)user_data;
+  /* Each query is only run on one thread, no need to lock. */
+  data->found_len[co_index]++;
+  EXPECT_EQ_ARRAY(co, data->points[index], 3);
+  EXPECT_LE(dist_sq, data->range * data->range);
+  EXPECT_EQ(dist_sq, len_squared_v3v3(data->points[index], data->co[co_index]));
+  return true;
+}
+
+TEST(kdtree, RangeSearchCbBatch)
+{
+  const int points_len = 10000, co_len = 5000;
+  struct RNG *rng = BLI_rng_new(123);
+  float(*points)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * points_len, __func__);
+  KDTree_3d *tree = kdtree_random_create(points, points_len, rng);
+
+  float(*co)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * co_len, __func__);
+  for (int i = 0; i < co_len; i++) {
+    BLI_rng_get_float_unit_v3(rng, co[i]);
+  }
+
+  RangeSearchBatchData data;
+  data.found_len = (int *)MEM_callocN(sizeof(int) * co_len, __func__);
+  data.points = points;
+  data.co = co;
+  data.range = 0.05f;
+  BLI_kdtree_3d_range_search_cb_batch(tree, co, co_len, data.range, range_search_batch_cb, &data);
+
+  int found_total = 0;
+  for (int i = 0; i < co_len; i++) {
+    KDTreeNearest_3d *nearest = NULL;
+    const int nearest_len = BLI_kdtree_3d_range_search(tree, co[i], &nearest, data.range);
+    EXPECT_EQ(nearest_len, data.found_len[i]);
+    found_total += nearest_len;
+    MEM_SAFE_FREE(nearest);
+  }
+  /* Ensure the test isn't only checking empty results. */
+  EXPECT_GT(found_total, 0);
+
+  BLI_kdtree_3d_free(tree);
+  BLI_rng_free(rng);
+  MEM_freeN(points);
+  MEM_freeN(co);
+  MEM_freeN(data.found_len);
+}
+
+/**
+ * Compare #BLI_kdtree_3d_calc_duplicates_fast with checking all pairs
+ * (large inputs use a grid instead of the tree).
+ */
+static void calc_duplicates_fast_test(int points_len, float range)
+{
+  struct RNG *rng = BLI_rng_new(12);
+  float(*points)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * points_len, __func__);
+  KDTree_3d *tree = BLI_kdtree_3d_new(points_len);
+  for (int i = 0; i < points_len; i++) {
+    if (i % 10 == 9) {
+      /* Ensure there are duplicates, even for small ranges. */
+      copy_v3_v3(points[i], points[i - 1]);
+    }
+    else {
+      rng_get_float_v3(rng, points[i]);
+    }
+    BLI_kdtree_3d_insert(tree, i, points[i]);
+  }
+  BLI_kdtree_3d_balance(tree);
+
+  int *duplicates = (int *)MEM_mallocN(sizeof(int) * points_len, __func__);
+  int *duplicates_expect = (int *)MEM_mallocN(sizeof(int) * points_len, __func__);
+  for (int i = 0; i < points_len; i++) {
+    /* Some points are kept as they are (only used as targets). */
+    duplicates[i] = duplicates_expect[i] = (i % 7 == 0) ? i : -1;
+  }
+
+  const int found = BLI_kdtree_3d_calc_duplicates_fast(tree, range, true, duplicates);
+
+  int found_expect = 0;
+  for (int search = 0; search < points_len; search++) {
+    if (!ELEM(duplicates_expect[search], -1, search)) {
+      continue;
+    }
+    const int found_prev = found_expect;
+    for (int j = 0; j < points_len; j++) {
+      if (j != search && duplicates_expect[j] == -1 &&
+          len_squared_v3v3(points[j], points[search]) <= range * range) {
+        duplicates_expect[j] = search;
+        found_expect++;
+      }
+    }
+    if (found_expect != found_prev) {
+      duplicates_expect[search] = search;
+    }
+  }
+
+  EXPECT_GT(found, 0);
+  EXPECT_EQ(found_expect, found);
+  EXPECT_EQ_ARRAY(duplicates_expect, duplicates, points_len);
+
+  BLI_kdtree_3d_free(tree);
+  BLI_rng_free(rng);
+  MEM_freeN(points);
+  MEM_freeN(duplicates);
+  MEM_freeN(duplicates_expect);
+}
+
+TEST(kdtree, CalcDuplicatesFast_100)
+{
+  calc_duplicates_fast_test(100, 0.1f);
+}
+TEST(kdtree, CalcDuplicatesFast_5000)
+{
+  calc_duplicates_fast_test(5000, 0.1f);
+}
+TEST(kdtree, CalcDuplicatesFastLargeRange_5000)
+{
+  /* A single grid cell. */
+  calc_duplicates_fast_test(5000, 2.0f);
+}
+TEST(kdtree, CalcDuplicatesFastSmallRange_5000)
+{
+  /* Too many grid cells, the tree is used. */
+  calc_duplicates_fast_test(5000, 0.0001f);
+}
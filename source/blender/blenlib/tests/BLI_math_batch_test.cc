@@ -0,0 +1,153 @@
+/* Apache License, Version 2.0 */
+
+#include "BLI_array.hh"
+#include "BLI_math_batch.h"
+#include "BLI_math_batch.hh"
+#include "BLI_rand.hh"
+#include "testing/testing.h"
+
+namespace blender::tests {
+
+/* Sizes around multiples of the SIMD register widths, to test the remainders. */
+static const int test_sizes[] = {0, 1, 3, 4, 7, 8, 9, 15, 16, 17, 33, 100};
+
+static Array<float3> random_vectors(const int size, const uint32_t seed)
+{
+  RandomNumberGenerator rng(seed);
+  Array<float3> vectors(size);
+  for (float3 &vector : vectors) {
+    vector = float3(rng.get_float(), rng.get_float(), rng.get_float()) * 20.0f - float3(10.0f);
+  }
+  return vectors;
+}
+
+static float4x4 test_matrix()
+{
+  float4x4 matrix;
+  loc_eul_size_to_mat4(matrix.values,
+                       float3(1.0f, -2.0f, 3.0f),
+                       float3(0.3f, 1.2f, -0.7f),
+                       float3(2.0f, 0.5f, 1.5f));
+  return matrix;
+}
+
+static void expect_vectors_near(Span<float3> a, Span<float3> b, const float eps)
+{
+  ASSERT_EQ(a.size(), b.size());
+  for (const int64_t i : a.index_range()) {
+    EXPECT_V3_NEAR(a[i], b[i], eps);
+  }
+}
+
+TEST(math_batch, TransformPoints)
+{
+  const float4x4 matrix = test_matrix();
+  for (const int size : test_sizes) {
+    const Array<float3> src = random_vectors(size, 0);
+    Array<float3> expected(size);
+    for (const int64_t i : src.index_range()) {
+      expected[i] = matrix * src[i];
+    }
+
+    Array<float3> dst(size);
+    transform_points(matrix, src, dst);
+    expect_vectors_near(dst, expected, 1e-4f);
+
+    Array<float3> points = src;
+    transform_points(matrix, points);
+    expect_vectors_near(points, expected, 1e-4f);
+  }
+}
+
+TEST(math_batch, TransformPointsC)
+{
+  const float4x4 matrix = test_matrix();
+  for (const int size : test_sizes) {
+    Array<float3> points = random_vectors(size, 0);
+    Array<float3> expected = points;
+    for (float3 &point : expected) {
+      mul_m4_v3(matrix.values, point);
+    }
+
+    BLI_math_batch_transform_points(
+        matrix.values, reinterpret_cast<float(*)[3]>(points.data()), size);
+    expect_vectors_near(points, expected, 1e-4f);
+  }
+}
+
+TEST(math_batch, TransformDirections)
+{
+  const float4x4 matrix = test_matrix();
+  for (const int size : test_sizes) {
+    Array<float3> directions = random_vectors(size, 1);
+    Array<float3> expected(size);
+    for (const int64_t i : directions.index_range()) {
+      expected[i] = matrix.ref_3x3() * directions[i];
+    }
+    transform_directions(matrix, directions);
+    expect_vectors_near(directions, expected, 1e-4f);
+  }
+}
+
+TEST(math_batch, Normalize)
+{
+  for (const int size : test_sizes) {
+    Array<float3> vectors = random_vectors(size, 2);
+    if (size > 5) {
+      /* Too short to normalize. */
+      vectors[5] = float3(0.0f);
+      vectors[size - 1] = float3(1e-20f, 0.0f, 0.0f);
+    }
+    Array<float3> expected(size);
+    for (const int64_t i : vectors.index_range()) {
+      expected[i] = vectors[i].normalized();
+    }
+    normalize_vectors(vectors);
+    expect_vectors_near(vectors, expected, 1e-6f);
+  }
+}
+
+TEST(math_batch, DotCross)
+{
+  for (const int size : test_sizes) {
+    const Array<float3> a = random_vectors(size, 3);
+    Array<float3> b = random_vectors(size, 4);
+
+    Array<float> dots(size);
+    dot_products(a, b, dots);
+    Array<float3> crosses(size);
+    cross_products(a, b, crosses);
+    for (const int64_t i : a.index_range()) {
+      EXPECT_NEAR(dots[i], float3::dot(a[i], b[i]), 1e-4f);
+      EXPECT_V3_NEAR(crosses[i], float3::cross_high_precision(a[i], b[i]), 1e-4f);
+    }
+
+    /* In place. */
+    cross_products(a, b, b);
+    expect_vectors_near(b, crosses, 0.0f);
+  }
+}
+
+TEST(math_batch, MultiplyMatrices)
+{
+  const float4x4 matrix = test_matrix();
+  RandomNumberGenerator rng(5);
+  for (const int size : test_sizes) {
+    Array<float4x4> matrices(size);
+    for (float4x4 &m : matrices) {
+      for (int i = 0; i < 16; i++) {
+        m.values[i / 4][i % 4] = rng.get_float();
+      }
+    }
+    Array<float4x4> expected(size);
+    for (const int64_t i : matrices.index_range()) {
+      expected[i] = matrix * matrices[i];
+    }
+    multiply_matrices(matrix, matrices, matrices);
+    for (const int64_t i : matrices.index_range()) {
+      EXPECT_M4_NEAR(matrices[i].values, expected[i].values, 1e-5f);
+    }
+  }
+}
+
+}  // namespace blender::tests
@@ -0,0 +1,70 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "BLI_array.hh"
+#include "BLI_parallel_scan.hh"
+#include "BLI_strict_flags.h"
+#include "BLI_task.h"
+
+namespace blender::tests {
+
+TEST(parallel_scan, Empty)
+{
+  Array<int> values;
+  EXPECT_EQ(parallel_exclusive_scan(values.as_mutable_span()), 0);
+  EXPECT_EQ(parallel_exclusive_scan(values.as_mutable_span(), 5), 5);
+}
+
+TEST(parallel_scan, Small)
+{
+  Array<int> counts = {3, 0, 2, 5};
+  Array<int> offsets(4);
+  EXPECT_EQ(parallel_exclusive_scan(counts.as_span(), offsets.as_mutable_span()), 10);
+  Array<int> expected = {0, 3, 3, 5};
+  EXPECT_EQ_ARRAY(offsets.data(), expected.data(), 4);
+}
+
+TEST(parallel_scan, InPlaceWithInit)
+{
+  Array<int> values = {1, 2, 3};
+  EXPECT_EQ(parallel_exclusive_scan(values.as_mutable_span(), 10), 16);
+  Array<int> expected = {10, 11, 13};
+  EXPECT_EQ_ARRAY(values.data(), expected.data(), 3);
+}
+
+static void test_large_scan(const int64_t size)
+{
+  Array<int64_t> counts(size);
+  for (const int64_t i : counts.index_range()) {
+    counts[i] = i % 7;
+  }
+
+  Array<int64_t> offsets(size);
+  const int64_t total = parallel_exclusive_scan(counts.as_span(), offsets.as_mutable_span());
+
+  int64_t expected = 0;
+  for (const int64_t i : counts.index_range()) {
+    EXPECT_EQ(offsets[i], expected);
+    expected += counts[i];
+  }
+  EXPECT_EQ(total, expected);
+
+  /* In place gives the same result. */
+  EXPECT_EQ(parallel_exclusive_scan(counts.as_mutable_span()), total);
+  EXPECT_EQ_ARRAY(counts.data(), offsets.data(), (size_t)size);
+}
+
+TEST(parallel_scan, Large)
+{
+  test_large_scan(parallel_scan_block_size * 3 + 5);
+
+  BLI_threadapi_init();
+  BLI_task_scheduler_init();
+  test_large_scan(parallel_scan_block_size * 3 + 5);
+  test_large_scan(1000000);
+  BLI_task_scheduler_exit();
+  BLI_threadapi_exit();
+}
+
+}  // namespace blender::tests
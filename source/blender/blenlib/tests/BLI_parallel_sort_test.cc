@@ -0,0 +1,125 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <algorithm>
+
+#include "BLI_array.hh"
+#include "BLI_parallel_sort.hh"
+#include "BLI_rand.hh"
+#include "BLI_strict_flags.h"
+#include "BLI_task.h"
+
+namespace blender::tests {
+
+struct SortItem {
+  uint32_t key;
+  int index;
+};
+
+static Array<SortItem> random_sort_items(const int64_t size, const uint32_t max_key)
+{
+  RandomNumberGenerator rng(0);
+  Array<SortItem> items(size);
+  for (const int64_t i : items.index_range()) {
+    items[i].key = rng.get_uint32() % max_key;
+    items[i].index = static_cast<int>(i);
+  }
+  return items;
+}
+
+static void expect_stable_sorted(Span<SortItem> items)
+{
+  for (int64_t i = 1; i < items.size(); i++) {
+    EXPECT_LE(items[i - 1].key, items[i].key);
+    if (items[i - 1].key == items[i].key) {
+      EXPECT_LT(items[i - 1].index, items[i].index);
+    }
+  }
+}
+
+TEST(parallel_sort, Empty)
+{
+  Array<int> values;
+  parallel_sort(values.as_mutable_span());
+  parallel_radix_sort(values.as_mutable_span());
+  EXPECT_EQ(values.size(), 0);
+}
+
+TEST(parallel_sort, SmallMergeSort)
+{
+  Array<int> values = {5, 3, 8, 1, 3, 0};
+  parallel_sort(values.as_mutable_span());
+  EXPECT_EQ_ARRAY(values.data(), Span<int>({0, 1, 3, 3, 5, 8}).data(), 6);
+}
+
+TEST(parallel_sort, SmallRadixSortSigned)
+{
+  Array<int> values = {5, -3, 8, INT32_MIN, -1, 0, INT32_MAX};
+  parallel_radix_sort(values.as_mutable_span());
+  Array<int> expected = {INT32_MIN, -3, -1, 0, 5, 8, INT32_MAX};
+  EXPECT_EQ_ARRAY(values.data(), expected.data(), 7);
+}
+
+TEST(parallel_sort, RadixSortSingleDigit)
+{
+  /* All passes but the first are skipped. */
+  Array<uint32_t> values = {3, 1, 2, 200, 0};
+  parallel_radix_sort(values.as_mutable_span());
+  Array<uint32_t> expected = {0, 1, 2, 3, 200};
+  EXPECT_EQ_ARRAY(values.data(), expected.data(), 5);
+}
+
+TEST(parallel_sort, MergeSortCompare)
+{
+  Array<float> values = {1.0f, 4.0f, -2.0f, 0.5f};
+  parallel_sort(values.as_mutable_span(), [](float a, float b) { return a > b; });
+  Array<float> expected = {4.0f, 1.0f, 0.5f, -2.0f};
+  EXPECT_EQ_ARRAY(values.data(), expected.data(), 4);
+}
+
+/* Larger sizes than a single block, with and without threads. */
+static void test_large_sorts(const int64_t size)
+{
+  for (const uint32_t max_key : {10u, 100000u, UINT32_MAX}) {
+    Array<SortItem> items = random_sort_items(size, max_key);
+    parallel_sort(items.as_mutable_span(),
+                  [](const SortItem &a, const SortItem &b) { return a.key < b.key; });
+    expect_stable_sorted(items);
+
+    items = random_sort_items(size, max_key);
+    parallel_radix_sort(items.as_mutable_span(), [](const SortItem &item) { return item.key; });
+    expect_stable_sorted(items);
+  }
+}
+
+TEST(parallel_sort, LargeSingleThreaded)
+{
+  test_large_sorts(100000);
+  test_large_sorts(parallel_sort_block_size * 5 + 3);
+}
+
+TEST(parallel_sort, LargeMultiThreaded)
+{
+  BLI_threadapi_init();
+  BLI_task_scheduler_init();
+
+  test_large_sorts(100000);
+  test_large_sorts(parallel_sort_block_size * 5 + 3);
+
+  Array<int64_t> values(300000);
+  RandomNumberGenerator rng(1);
+  for (int64_t &value : values) {
+    value = static_cast<int64_t>((static_cast<uint64_t>(rng.get_uint32()) << 32) ^
+                                 rng.get_uint32());
+  }
+  Array<int64_t> expected = values;
+  std::sort(expected.begin(), expected.end());
+  parallel_radix_sort(values.as_mutable_span());
+  EXPECT_EQ_ARRAY(values.data(), expected.data(), (size_t)values.size());
+
+  BLI_task_scheduler_exit();
+  BLI_threadapi_exit();
+}
+
+}  // namespace blender::tests
@@ -1,7 +1,9 @@
 /* Apache License, Version 2.0 */
 
 #include "testing/testing.h"
+#include <atomic>
 #include <string.h>
+#include <thread>
 
 #include "atomic_ops.h"
 
@@ -10,8 +12,10 @@
 #include "BLI_utildefines.h"
 
 #include "BLI_listbase.h"
+#include "BLI_memarena.h"
 #include "BLI_mempool.h"
 #include "BLI_task.h"
+#include "BLI_task.hh"
 
 #define NUM_ITEMS 10000
 
@@ -65,6 +69,201 @@ TEST(task, RangeIter)
   BLI_threadapi_exit();
 }
 
+TEST(task, RangeIterNumaArenas)
+{
+  int data[NUM_ITEMS] = {0};
+  int sum = 0;
+
+  BLI_threadapi_init();
+  BLI_task_scheduler_init();
+
+  /* Machines with a single node fall back to the regular scheduler, the result
+   * must be the same either way. */
+  const bool use_numa = BLI_task_scheduler_numa_arenas_enable();
+  EXPECT_EQ(BLI_task_scheduler_numa_arenas_num() > 1, use_numa);
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1;
+
+  settings.userdata_chunk = &sum;
+  settings.userdata_chunk_size = sizeof(sum);
+  settings.func_reduce = task_range_iter_reduce_func;
+
+  BLI_task_parallel_range(0, NUM_ITEMS, data, task_range_iter_func, &settings);
+
+  int expected_sum = 0;
+  for (int i = 0; i < NUM_ITEMS; i++) {
+    EXPECT_EQ(data[i], i);
+    expected_sum += i;
+  }
+  EXPECT_EQ(sum, expected_sum);
+
+  BLI_task_scheduler_numa_arenas_disable();
+  EXPECT_EQ(BLI_task_scheduler_numa_arenas_num(), 0);
+
+  BLI_task_scheduler_exit();
+  BLI_threadapi_exit();
+}
+
+/* *** Parallel iterations allocating from the per-thread memory arenas. *** */
+
+typedef struct TaskMemArenaItem {
+  struct TaskMemArenaItem *next;
+  int index;
+} TaskMemArenaItem;
+
+static void task_range_memarena_func(void *userdata,
+                                     int index,
+                                     const TaskParallelTLS *__restrict tls)
+{
+  int *data = (int *)userdata;
+  MemArena *memarena = BLI_task_parallel_tls_memarena(tls);
+  /* The same arena is returned for all iterations of a chunk. */
+  EXPECT_EQ(memarena, BLI_task_parallel_tls_memarena(tls));
+
+  TaskMemArenaItem **items = (TaskMemArenaItem **)tls->userdata_chunk;
+  TaskMemArenaItem *item = (TaskMemArenaItem *)BLI_memarena_alloc(memarena, sizeof(*item));
+  item->index = index;
+  item->next = *items;
+  *items = item;
+  data[index] = index;
+}
+
+static void task_range_memarena_free_func(const void *__restrict userdata,
+                                          void *__restrict userdata_chunk)
+{
+  /* Arena memory is still valid when freeing the chunks. */
+  int *data = (int *)userdata;
+  for (TaskMemArenaItem *item = *(TaskMemArenaItem **)userdata_chunk; item; item = item->next) {
+    data[item->index] += NUM_ITEMS;
+  }
+}
+
+TEST(task, RangeIterMemArena)
+{
+  int data[NUM_ITEMS] = {0};
+  TaskMemArenaItem *items = NULL;
+
+  BLI_threadapi_init();
+  BLI_task_scheduler_init();
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1;
+
+  settings.userdata_chunk = &items;
+  settings.userdata_chunk_size = sizeof(items);
+  settings.func_free = task_range_memarena_free_func;
+
+  /* Run twice, the second time reuses the arenas of the first. */
+  for (int pass = 0; pass < 2; pass++) {
+    memset(data, 0, sizeof(data));
+    items = NULL;
+    BLI_task_parallel_range(0, NUM_ITEMS, data, task_range_memarena_func, &settings);
+
+    for (int i = 0; i < NUM_ITEMS; i++) {
+      EXPECT_EQ(data[i], i + NUM_ITEMS);
+    }
+  }
+
+  BLI_task_scheduler_exit();
+  BLI_threadapi_exit();
+}
+
+/* *** Task scheduler statistics. *** */
+
+static void task_stats_pool_func(TaskPool *__restrict pool, void *taskdata)
+{
+  int *count = (int *)BLI_task_pool_user_data(pool);
+  atomic_add_and_fetch_uint32((uint32_t *)count, POINTER_AS_INT(taskdata));
+}
+
+TEST(task, SchedulerStats)
+{
+  int data[NUM_ITEMS] = {0};
+  int count = 0;
+
+  BLI_threadapi_init();
+  BLI_task_scheduler_init();
+  BLI_task_scheduler_stats_enable(true);
+  BLI_task_scheduler_stats_reset();
+  EXPECT_TRUE(BLI_task_scheduler_stats_is_enabled());
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1;
+  settings.userdata_chunk = &count;
+  settings.userdata_chunk_size = sizeof(count);
+  settings.func_reduce = task_range_iter_reduce_func;
+  BLI_task_parallel_range(0, NUM_ITEMS, data, task_range_iter_func, &settings);
+
+  count = 0;
+  TaskPool *pool = BLI_task_pool_create(&count, TASK_PRIORITY_HIGH);
+  for (int i = 0; i < 100; i++) {
+    BLI_task_pool_push(pool, task_stats_pool_func, POINTER_FROM_INT(1), false, NULL);
+  }
+  BLI_task_pool_work_and_wait(pool);
+  BLI_task_pool_free(pool);
+  EXPECT_EQ(count, 100);
+
+  const int workers_num = BLI_task_scheduler_stats_get(NULL, 0);
+  EXPECT_GE(workers_num, 1);
+  TaskSchedulerWorkerStats *stats = (TaskSchedulerWorkerStats *)MEM_calloc_arrayN(
+      workers_num, sizeof(*stats), __func__);
+  EXPECT_EQ(BLI_task_scheduler_stats_get(stats, workers_num), workers_num);
+
+  /* Every pool task is counted, parallel range chunks at least once. */
+  uint64_t tasks_run = 0;
+  for (int i = 0; i < workers_num; i++) {
+    EXPECT_LE(stats[i].tasks_stolen, stats[i].tasks_run);
+    EXPECT_GE(stats[i].busy_time, 0.0);
+    EXPECT_GE(stats[i].idle_time, 0.0);
+    tasks_run += stats[i].tasks_run;
+  }
+  EXPECT_GE(tasks_run, 101u);
+
+  /* Reset clears the counters, disabling stops collecting new ones. */
+  BLI_task_scheduler_stats_reset();
+  BLI_task_scheduler_stats_enable(false);
+  BLI_task_parallel_range(0, NUM_ITEMS, data, task_range_iter_func, &settings);
+  BLI_task_scheduler_stats_get(stats, workers_num);
+  for (int i = 0; i < workers_num; i++) {
+    EXPECT_EQ(stats[i].tasks_run, 0u);
+    EXPECT_EQ(stats[i].busy_time, 0.0);
+  }
+
+  MEM_freeN(stats);
+  BLI_task_scheduler_exit();
+  BLI_threadapi_exit();
+}
+
+/* Threads that exited pass their ID on to threads created later, so more threads than
+ * BLENDER_MAX_THREADS can be created over time without IDs being shared. */
+TEST(task, ParallelThreadIdReuse)
+{
+  BLI_threadapi_init();
+  BLI_task_scheduler_init();
+
+  int first_thread_id = -1;
+  for (int i = 0; i < BLENDER_MAX_THREADS * 2; i++) {
+    int thread_id = -1;
+    std::thread thread([&thread_id]() { thread_id = BLI_task_parallel_thread_id(NULL); });
+    thread.join();
+
+    EXPECT_GE(thread_id, 0);
+    EXPECT_LT(thread_id, BLENDER_MAX_THREADS);
+    if (i == 0) {
+      first_thread_id = thread_id;
+    }
+    /* Only one of these threads runs at a time, so they all get the same ID. */
+    EXPECT_EQ(thread_id, first_thread_id);
+  }
+
+  BLI_task_scheduler_exit();
+  BLI_threadapi_exit();
+}
+
 /* *** Parallel iterations over mempool items. *** */
 
 static void task_mempool_iter_func(void *userdata, MempoolIterData *item)
@@ -181,3 +380,31 @@ TEST(task, ListBaseIter)
   MEM_freeN(items_buffer);
   BLI_threadapi_exit();
 }
+
+/* *** C++ parallel for over chunks of an index range. *** */
+
+TEST(task, ParallelFor)
+{
+  int data[NUM_ITEMS] = {0};
+
+  BLI_threadapi_init();
+  BLI_task_scheduler_init();
+
+  std::atomic<int> chunks_num = 0;
+  const blender::IndexRange items_range(10, NUM_ITEMS - 10);
+  blender::parallel_for(items_range, 100, [&](blender::IndexRange range) {
+    EXPECT_LE(range.size(), 100);
+    for (const int64_t i : range) {
+      data[i] += (int)i;
+    }
+    chunks_num++;
+  });
+
+  EXPECT_EQ(chunks_num, (NUM_ITEMS - 10 + 99) / 100);
+  for (int i = 0; i < NUM_ITEMS; i++) {
+    EXPECT_EQ(data[i], i < 10 ? 0 : i);
+  }
+
+  BLI_task_scheduler_exit();
+  BLI_threadapi_exit();
+}
@@ -0,0 +1,177 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <mutex>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_concurrent_map.hh"
+#include "BLI_ghash.h"
+#include "BLI_map.hh"
+#include "BLI_math_base.h"
+#include "BLI_rand.h"
+#include "BLI_task.h"
+#include "BLI_utildefines.h"
+#include "PIL_time_utildefines.h"
+
+/* Compares adding and looking up integer keys from a parallel range, using a ConcurrentMap against
+ * the alternatives that parallel code uses today: a Map or a GHash behind a mutex. Every key is
+ * added about twice, so threads also race on adding the same keys. */
+
+#define MAP_MIN_ITER_PER_THREAD 1024
+
+using blender::ConcurrentMap;
+using blender::Map;
+
+struct MapTestData {
+  const int *keys;
+  ConcurrentMap<int, int> *concurrent_map;
+  Map<int, int> *map;
+  GHash *ghash;
+  std::mutex *mutex;
+};
+
+static void concurrent_map_add_cb(void *__restrict userdata,
+                                  const int index,
+                                  const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  MapTestData *data = (MapTestData *)userdata;
+  const int key = data->keys[index];
+  data->concurrent_map->add(key, index);
+}
+
+static void concurrent_map_lookup_cb(void *__restrict userdata,
+                                     const int index,
+                                     const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  MapTestData *data = (MapTestData *)userdata;
+  const int key = data->keys[index];
+  EXPECT_NE(data->concurrent_map->lookup_ptr(key), nullptr);
+}
+
+static void map_mutex_add_cb(void *__restrict userdata,
+                             const int index,
+                             const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  MapTestData *data = (MapTestData *)userdata;
+  const int key = data->keys[index];
+  std::lock_guard<std::mutex> lock(*data->mutex);
+  data->map->add(key, index);
+}
+
+static void map_mutex_lookup_cb(void *__restrict userdata,
+                                const int index,
+                                const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  MapTestData *data = (MapTestData *)userdata;
+  const int key = data->keys[index];
+  /* Lookups are safe without the mutex once all keys have been added. */
+  EXPECT_NE(data->map->lookup_ptr(key), nullptr);
+}
+
+static void ghash_mutex_add_cb(void *__restrict userdata,
+                               const int index,
+                               const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  MapTestData *data = (MapTestData *)userdata;
+  const int key = data->keys[index];
+  void **value_p;
+  std::lock_guard<std::mutex> lock(*data->mutex);
+  if (!BLI_ghash_ensure_p(data->ghash, POINTER_FROM_INT(key), &value_p)) {
+    *value_p = POINTER_FROM_INT(index);
+  }
+}
+
+static void ghash_mutex_lookup_cb(void *__restrict userdata,
+                                  const int index,
+                                  const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  MapTestData *data = (MapTestData *)userdata;
+  const int key = data->keys[index];
+  EXPECT_TRUE(BLI_ghash_haskey(data->ghash, POINTER_FROM_INT(key)));
+}
+
+static void concurrent_map_tests(const int keys_num, const char *id)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  BLI_threadapi_init();
+  BLI_task_scheduler_init();
+
+  const int unique_keys_num = max_ii(keys_num / 2, 1);
+  int *keys = (int *)MEM_mallocN(sizeof(*keys) * (size_t)keys_num, __func__);
+  RNG *rng = BLI_rng_new(0);
+  for (int i = 0; i < keys_num; i++) {
+    /* Zero is avoided because GHash can't distinguish it from NULL in all cases. */
+    keys[i] = 1 + (int)(BLI_rng_get_uint(rng) % (uint)unique_keys_num);
+  }
+  BLI_rng_free(rng);
+
+  std::mutex mutex;
+  MapTestData data = {keys, nullptr, nullptr, nullptr, &mutex};
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = MAP_MIN_ITER_PER_THREAD;
+
+  {
+    ConcurrentMap<int, int> concurrent_map(unique_keys_num);
+    data.concurrent_map = &concurrent_map;
+
+    TIMEIT_START(concurrent_map_add);
+    BLI_task_parallel_range(0, keys_num, &data, concurrent_map_add_cb, &settings);
+    TIMEIT_END(concurrent_map_add);
+
+    TIMEIT_START(concurrent_map_lookup);
+    BLI_task_parallel_range(0, keys_num, &data, concurrent_map_lookup_cb, &settings);
+    TIMEIT_END(concurrent_map_lookup);
+
+    printf("%d unique keys\n", (int)concurrent_map.size());
+  }
+
+  {
+    Map<int, int> map;
+    map.reserve(unique_keys_num);
+    data.map = &map;
+
+    TIMEIT_START(map_mutex_add);
+    BLI_task_parallel_range(0, keys_num, &data, map_mutex_add_cb, &settings);
+    TIMEIT_END(map_mutex_add);
+
+    TIMEIT_START(map_lookup);
+    BLI_task_parallel_range(0, keys_num, &data, map_mutex_lookup_cb, &settings);
+    TIMEIT_END(map_lookup);
+  }
+
+  {
+    data.ghash = BLI_ghash_int_new_ex(__func__, (uint)unique_keys_num);
+
+    TIMEIT_START(ghash_mutex_add);
+    BLI_task_parallel_range(0, keys_num, &data, ghash_mutex_add_cb, &settings);
+    TIMEIT_END(ghash_mutex_add);
+
+    TIMEIT_START(ghash_lookup);
+    BLI_task_parallel_range(0, keys_num, &data, ghash_mutex_lookup_cb, &settings);
+    TIMEIT_END(ghash_lookup);
+
+    BLI_ghash_free(data.ghash, NULL, NULL);
+  }
+
+  MEM_freeN(keys);
+
+  BLI_task_scheduler_exit();
+  BLI_threadapi_exit();
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(concurrent_map, IntAddLookup100k)
+{
+  concurrent_map_tests(100000, "ConcurrentMap - 100000 integer keys");
+}
+
+TEST(concurrent_map, IntAddLookup10M)
+{
+  concurrent_map_tests(10000000, "ConcurrentMap - 10000000 integer keys");
+}
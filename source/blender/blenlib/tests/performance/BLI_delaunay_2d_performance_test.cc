@@ -0,0 +1,132 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_delaunay_2d.h"
+#include "BLI_math.h"
+#include "BLI_rand.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
+#include "BLI_utildefines.h"
+#include "PIL_time_utildefines.h"
+
+/* Large versions of the random inputs of BLI_delaunay_2d_test, triangulated with and without
+ * threading. */
+
+enum {
+  RANDOM_PTS,
+  RANDOM_TILTED_GRID,
+  RANDOM_CIRCLE,
+};
+
+static void delaunay_2d_test(int test_kind, int size, const char *id)
+{
+  CDT_input in = {0};
+  CDT_result *out;
+  float(*p)[2];
+  int(*e)[2] = NULL;
+  int *faces = NULL;
+  int faces_start_table[1] = {0};
+  int faces_len_table[1] = {size};
+  int npts = size;
+  RNG *rng = BLI_rng_new(0);
+  int i, j;
+
+  printf("\n========== STARTING %s ==========\n", id);
+
+  BLI_threadapi_init();
+  BLI_task_scheduler_init();
+
+  if (test_kind == RANDOM_TILTED_GRID) {
+    npts = size * size;
+  }
+  p = (float(*)[2])MEM_malloc_arrayN(npts, sizeof(*p), __func__);
+
+  switch (test_kind) {
+    case RANDOM_PTS:
+      for (i = 0; i < size; i++) {
+        p[i][0] = (float)BLI_rng_get_double(rng);
+        p[i][1] = (float)BLI_rng_get_double(rng);
+      }
+      break;
+
+    case RANDOM_TILTED_GRID:
+      /* Edges from the left to the right ends and from the tops to the bottoms. */
+      e = (int(*)[2])MEM_malloc_arrayN(2 * size, sizeof(*e), __func__);
+      for (i = 0; i < size; i++) {
+        for (j = 0; j < size; j++) {
+          p[i * size + j][0] = i * 0.01f + j;
+          p[i * size + j][1] = i;
+        }
+        e[i][0] = i * size;
+        e[i][1] = i * size + size - 1;
+        e[size + i][0] = i;
+        e[size + i][1] = (size - 1) * size + i;
+      }
+      in.edges_len = 2 * size;
+      in.edges = e;
+      break;
+
+    case RANDOM_CIRCLE:
+      /* One face with all points. */
+      faces = (int *)MEM_malloc_arrayN(size, sizeof(int), __func__);
+      for (i = 0; i < size; i++) {
+        const double angle = 2.0 * M_PI * i / size;
+        p[i][0] = (float)cos(angle);
+        p[i][1] = (float)sin(angle);
+        faces[i] = i;
+      }
+      in.faces_len = 1;
+      in.faces = faces;
+      in.faces_start_table = faces_start_table;
+      in.faces_len_table = faces_len_table;
+      break;
+  }
+  in.verts_len = npts;
+  in.vert_coords = p;
+  in.epsilon = 1e-5f;
+
+  in.use_threading = false;
+  TIMEIT_START(cdt_calc);
+  out = BLI_delaunay_2d_cdt_calc(&in, CDT_FULL);
+  TIMEIT_END(cdt_calc);
+  BLI_delaunay_2d_cdt_free(out);
+
+  in.use_threading = true;
+  TIMEIT_START(cdt_calc_threaded);
+  out = BLI_delaunay_2d_cdt_calc(&in, CDT_FULL);
+  TIMEIT_END(cdt_calc_threaded);
+  BLI_delaunay_2d_cdt_free(out);
+
+  MEM_freeN(p);
+  MEM_SAFE_FREE(e);
+  MEM_SAFE_FREE(faces);
+  BLI_rng_free(rng);
+
+  BLI_task_scheduler_exit();
+  BLI_threadapi_exit();
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(delaunay_2d, RandomPoints100K)
+{
+  delaunay_2d_test(RANDOM_PTS, 100000, "Delaunay 2D - 100000 random points");
+}
+
+TEST(delaunay_2d, RandomPoints1M)
+{
+  delaunay_2d_test(RANDOM_PTS, 1000000, "Delaunay 2D - 1000000 random points");
+}
+
+TEST(delaunay_2d, TiltedGrid512)
+{
+  delaunay_2d_test(RANDOM_TILTED_GRID, 512, "Delaunay 2D - 512x512 tilted grid");
+}
+
+TEST(delaunay_2d, Circle100K)
+{
+  delaunay_2d_test(RANDOM_CIRCLE, 100000, "Delaunay 2D - 100000 points circle face");
+}
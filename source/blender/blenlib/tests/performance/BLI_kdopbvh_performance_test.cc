@@ -0,0 +1,233 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_kdopbvh.h"
+#include "BLI_math_geom.h"
+#include "BLI_math_vector.h"
+#include "BLI_rand.h"
+#include "BLI_utildefines.h"
+
+#include "PIL_time.h"
+
+#define NUM_RUN_AVERAGED 10
+
+/* Grid of 1024x1024 rays, similar to casting from the pixels of an image. */
+#define RAYS_GRID_SIZE 1024
+#define RAYS_NUM (RAYS_GRID_SIZE * RAYS_GRID_SIZE)
+
+/* *** Ray casting, one at a time compared to batches. *** */
+
+static void ray_cast_tri_callback(void *userdata,
+                                  int index,
+                                  const BVHTreeRay *ray,
+                                  BVHTreeRayHit *hit)
+{
+  const float(*tri)[3] = ((const float(*)[3][3])userdata)[index];
+  float dist;
+  if (isect_ray_tri_v3(ray->origin, ray->direction, tri[0], tri[1], tri[2], &dist, NULL) &&
+      dist < hit->dist) {
+    hit->index = index;
+    hit->dist = dist;
+    madd_v3_v3v3fl(hit->co, ray->origin, ray->direction, dist);
+  }
+}
+
+static void ray_hits_init(BVHTreeRayHit *hits)
+{
+  for (int i = 0; i < RAYS_NUM; i++) {
+    hits[i].index = -1;
+    hits[i].dist = BVH_RAYCAST_DIST_MAX;
+  }
+}
+
+static void ray_cast_test(const char *id,
+                          const int tris_num,
+                          const char tree_type,
+                          const char axis,
+                          const bool use_callback)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  /* Random small triangles in a 10x10x10 cube. */
+  RNG *rng = BLI_rng_new(0);
+  float(*tris)[3][3] = (float(*)[3][3])MEM_mallocN(sizeof(*tris) * tris_num, __func__);
+  BVHTree *tree = BLI_bvhtree_new(tris_num, 0.0f, tree_type, axis);
+  for (int i = 0; i < tris_num; i++) {
+    float center[3];
+    BLI_rng_get_float_unit_v3(rng, center);
+    mul_v3_fl(center, BLI_rng_get_float(rng) * 5.0f);
+    for (int j = 0; j < 3; j++) {
+      BLI_rng_get_float_unit_v3(rng, tris[i][j]);
+      madd_v3_v3v3fl(tris[i][j], center, tris[i][j], 0.1f);
+    }
+    BLI_bvhtree_insert(tree, i, &tris[i][0][0], 3);
+  }
+  BLI_bvhtree_balance(tree);
+
+  /* Rays from a point outside the cube, through a grid covering it. */
+  float(*co)[3] = (float(*)[3])MEM_mallocN(sizeof(*co) * RAYS_NUM, __func__);
+  float(*dir)[3] = (float(*)[3])MEM_mallocN(sizeof(*dir) * RAYS_NUM, __func__);
+  for (int i = 0; i < RAYS_NUM; i++) {
+    copy_v3_fl3(co[i], -10.0f, 0.0f, 0.0f);
+    const float x = (float)(i % RAYS_GRID_SIZE) / (float)RAYS_GRID_SIZE - 0.5f;
+    const float y = (float)(i / RAYS_GRID_SIZE) / (float)RAYS_GRID_SIZE - 0.5f;
+    copy_v3_fl3(dir[i], 1.0f, x, y);
+    normalize_v3(dir[i]);
+  }
+
+  BVHTree_RayCastCallback callback = use_callback ? ray_cast_tri_callback : NULL;
+  BVHTreeRayHit *hits = (BVHTreeRayHit *)MEM_mallocN(sizeof(*hits) * RAYS_NUM, __func__);
+  BVHTreeRayHit *hits_batch = (BVHTreeRayHit *)MEM_mallocN(sizeof(*hits) * RAYS_NUM, __func__);
+
+  double time_single = 0.0, time_batch = 0.0;
+  for (int run = 0; run < NUM_RUN_AVERAGED; run++) {
+    ray_hits_init(hits);
+    double time_start = PIL_check_seconds_timer();
+    for (int i = 0; i < RAYS_NUM; i++) {
+      BLI_bvhtree_ray_cast_ex(
+          tree, co[i], dir[i], 0.0f, &hits[i], callback, tris, BVH_RAYCAST_DEFAULT);
+    }
+    time_single += PIL_check_seconds_timer() - time_start;
+
+    ray_hits_init(hits_batch);
+    time_start = PIL_check_seconds_timer();
+    BLI_bvhtree_ray_cast_batch(
+        tree, co, dir, RAYS_NUM, 0.0f, hits_batch, callback, tris, BVH_RAYCAST_DEFAULT);
+    time_batch += PIL_check_seconds_timer() - time_start;
+  }
+
+  int hits_num = 0;
+  for (int i = 0; i < RAYS_NUM; i++) {
+    EXPECT_EQ(hits[i].index, hits_batch[i].index);
+    hits_num += (hits[i].index != -1) ? 1 : 0;
+  }
+
+  printf("\t%d rays (%d hits): single %fs, batch %fs on average over %d runs\n",
+         RAYS_NUM,
+         hits_num,
+         time_single / NUM_RUN_AVERAGED,
+         time_batch / NUM_RUN_AVERAGED,
+         NUM_RUN_AVERAGED);
+
+  BLI_bvhtree_free(tree);
+  BLI_rng_free(rng);
+  MEM_freeN(tris);
+  MEM_freeN(co);
+  MEM_freeN(dir);
+  MEM_freeN(hits);
+  MEM_freeN(hits_batch);
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(kdopbvh, RayCastBinary100k)
+{
+  ray_cast_test("Ray cast - Binary tree - 100000 triangles", 100000, 2, 6, false);
+}
+
+TEST(kdopbvh, RayCastQuad100k)
+{
+  ray_cast_test("Ray cast - Quad tree - 100000 triangles", 100000, 4, 6, false);
+}
+
+TEST(kdopbvh, RayCastCallbackQuad100k)
+{
+  ray_cast_test("Ray cast with callback - Quad tree - 100000 triangles", 100000, 4, 6, true);
+}
+
+TEST(kdopbvh, RayCastCallbackQuad1M)
+{
+  ray_cast_test("Ray cast with callback - Quad tree - 1000000 triangles", 1000000, 4, 6, true);
+}
+
+/* *** Find nearest & overlap, regular nodes compared to the compact layout. *** */
+
+#define QUERIES_NUM 100000
+
+static void random_in_cube_v3(RNG *rng, float r_co[3])
+{
+  for (int i = 0; i < 3; i++) {
+    r_co[i] = BLI_rng_get_float(rng) * 10.0f - 5.0f;
+  }
+}
+
+static void compact_layout_test(const char *id, const int points_num)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  /* Random points in a 10x10x10 cube, queried from other random points. */
+  RNG *rng = BLI_rng_new(0);
+  float(*points)[3] = (float(*)[3])MEM_mallocN(sizeof(*points) * points_num, __func__);
+  float(*co)[3] = (float(*)[3])MEM_mallocN(sizeof(*co) * QUERIES_NUM, __func__);
+  BVHTree *tree = BLI_bvhtree_new(points_num, 0.01f, 4, 6);
+  BVHTree *tree_compact = BLI_bvhtree_new(points_num, 0.01f, 4, 6);
+  for (int i = 0; i < points_num; i++) {
+    random_in_cube_v3(rng, points[i]);
+    BLI_bvhtree_insert(tree, i, points[i], 1);
+    BLI_bvhtree_insert(tree_compact, i, points[i], 1);
+  }
+  for (int i = 0; i < QUERIES_NUM; i++) {
+    random_in_cube_v3(rng, co[i]);
+  }
+  BLI_bvhtree_balance(tree);
+  BLI_bvhtree_balance(tree_compact);
+  BLI_bvhtree_compact_layout_build(tree_compact);
+
+  double time_nearest = 0.0, time_nearest_compact = 0.0;
+  double time_overlap = 0.0, time_overlap_compact = 0.0;
+  uint overlap_len = 0, overlap_compact_len = 0;
+  for (int run = 0; run < NUM_RUN_AVERAGED; run++) {
+    double time_start = PIL_check_seconds_timer();
+    for (int i = 0; i < QUERIES_NUM; i++) {
+      BLI_bvhtree_find_nearest(tree, co[i], NULL, NULL, NULL);
+    }
+    time_nearest += PIL_check_seconds_timer() - time_start;
+
+    time_start = PIL_check_seconds_timer();
+    for (int i = 0; i < QUERIES_NUM; i++) {
+      BLI_bvhtree_find_nearest(tree_compact, co[i], NULL, NULL, NULL);
+    }
+    time_nearest_compact += PIL_check_seconds_timer() - time_start;
+
+    time_start = PIL_check_seconds_timer();
+    MEM_freeN(BLI_bvhtree_overlap(tree, tree, &overlap_len, NULL, NULL));
+    time_overlap += PIL_check_seconds_timer() - time_start;
+
+    time_start = PIL_check_seconds_timer();
+    MEM_freeN(BLI_bvhtree_overlap(tree_compact, tree_compact, &overlap_compact_len, NULL, NULL));
+    time_overlap_compact += PIL_check_seconds_timer() - time_start;
+  }
+  EXPECT_EQ(overlap_len, overlap_compact_len);
+
+  printf("\t%d find nearest: regular %fs, compact %fs on average over %d runs\n",
+         QUERIES_NUM,
+         time_nearest / NUM_RUN_AVERAGED,
+         time_nearest_compact / NUM_RUN_AVERAGED,
+         NUM_RUN_AVERAGED);
+  printf("\tself overlap (%u pairs): regular %fs, compact %fs on average over %d runs\n",
+         overlap_len,
+         time_overlap / NUM_RUN_AVERAGED,
+         time_overlap_compact / NUM_RUN_AVERAGED,
+         NUM_RUN_AVERAGED);
+
+  BLI_bvhtree_free(tree);
+  BLI_bvhtree_free(tree_compact);
+  BLI_rng_free(rng);
+  MEM_freeN(points);
+  MEM_freeN(co);
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(kdopbvh, CompactLayout100k)
+{
+  compact_layout_test("Compact layout - Quad tree - 100000 points", 100000);
+}
+
+TEST(kdopbvh, CompactLayout1M)
+{
+  compact_layout_test("Compact layout - Quad tree - 1000000 points", 1000000);
+}
@@ -0,0 +1,117 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "BLI_array.hh"
+#include "BLI_math_batch.hh"
+#include "BLI_rand.hh"
+#include "BLI_utildefines.h"
+#include "PIL_time_utildefines.h"
+
+/* Compares the batch math functions against loops over the single element operators of float3
+ * and float4x4, as used by deform modifiers today. */
+
+using namespace blender;
+
+static Array<float3> random_vectors(const int size)
+{
+  RandomNumberGenerator rng(0);
+  Array<float3> vectors(size);
+  for (float3 &vector : vectors) {
+    vector = float3(rng.get_float(), rng.get_float(), rng.get_float());
+  }
+  return vectors;
+}
+
+static void math_batch_tests(const int size, const char *id)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  float4x4 matrix;
+  loc_eul_size_to_mat4(matrix.values,
+                       float3(1.0f, -2.0f, 3.0f),
+                       float3(0.3f, 1.2f, -0.7f),
+                       float3(2.0f, 0.5f, 1.5f));
+
+  const Array<float3> a = random_vectors(size);
+  const Array<float3> b = random_vectors(size);
+  Array<float3> vectors(size);
+  Array<float> dots(size);
+
+  TIMEIT_START(transform_points_loop);
+  for (const int i : a.index_range()) {
+    vectors[i] = matrix * a[i];
+  }
+  TIMEIT_END(transform_points_loop);
+
+  TIMEIT_START(transform_points_batch);
+  transform_points(matrix, a, vectors);
+  TIMEIT_END(transform_points_batch);
+
+  TIMEIT_START(transform_directions_loop);
+  for (const int i : a.index_range()) {
+    vectors[i] = matrix.ref_3x3() * a[i];
+  }
+  TIMEIT_END(transform_directions_loop);
+
+  TIMEIT_START(transform_directions_batch);
+  transform_directions(matrix, a, vectors);
+  TIMEIT_END(transform_directions_batch);
+
+  vectors = a;
+  TIMEIT_START(normalize_loop);
+  for (float3 &vector : vectors) {
+    vector.normalize();
+  }
+  TIMEIT_END(normalize_loop);
+
+  vectors = a;
+  TIMEIT_START(normalize_batch);
+  normalize_vectors(vectors);
+  TIMEIT_END(normalize_batch);
+
+  TIMEIT_START(dot_loop);
+  for (const int i : a.index_range()) {
+    dots[i] = float3::dot(a[i], b[i]);
+  }
+  TIMEIT_END(dot_loop);
+
+  TIMEIT_START(dot_batch);
+  dot_products(a, b, dots);
+  TIMEIT_END(dot_batch);
+
+  TIMEIT_START(cross_loop);
+  for (const int i : a.index_range()) {
+    vectors[i] = float3::cross_high_precision(a[i], b[i]);
+  }
+  TIMEIT_END(cross_loop);
+
+  TIMEIT_START(cross_batch);
+  cross_products(a, b, vectors);
+  TIMEIT_END(cross_batch);
+
+  Array<float4x4> matrices(size / 4, matrix);
+  Array<float4x4> r_matrices(matrices.size());
+
+  TIMEIT_START(multiply_matrices_loop);
+  for (const int i : matrices.index_range()) {
+    r_matrices[i] = matrix * matrices[i];
+  }
+  TIMEIT_END(multiply_matrices_loop);
+
+  TIMEIT_START(multiply_matrices_batch);
+  multiply_matrices(matrix, matrices, r_matrices);
+  TIMEIT_END(multiply_matrices_batch);
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(math_batch, Vectors1M)
+{
+  math_batch_tests(1000000, "Math Batch - 1000000 vectors");
+}
+
+TEST(math_batch, Vectors10M)
+{
+  math_batch_tests(10000000, "Math Batch - 10000000 vectors");
+}
@@ -0,0 +1,141 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <algorithm>
+
+#include "BLI_array.hh"
+#include "BLI_parallel_scan.hh"
+#include "BLI_parallel_sort.hh"
+#include "BLI_rand.hh"
+#include "BLI_sort_utils.h"
+#include "BLI_task.h"
+#include "BLI_utildefines.h"
+#include "PIL_time_utildefines.h"
+
+/* Compares the parallel sorts against std::sort, std::stable_sort and qsort, and the parallel
+ * exclusive scan against the serial loop used by mesh mapping code today. Items are pairs of an
+ * index and its key, like when building vertex to face maps. */
+
+using blender::Array;
+using blender::IndexRange;
+using blender::RandomNumberGenerator;
+
+static Array<SortIntByInt> random_items(const int items_num, const int max_key)
+{
+  RandomNumberGenerator rng(0);
+  Array<SortIntByInt> items(items_num);
+  for (const int i : IndexRange(items_num)) {
+    items[i].sort_value = rng.get_int32(max_key);
+    items[i].data = i;
+  }
+  return items;
+}
+
+static bool items_key_less(const SortIntByInt &a, const SortIntByInt &b)
+{
+  return a.sort_value < b.sort_value;
+}
+
+static void parallel_sort_tests(const int items_num, const int max_key, const char *id)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  BLI_threadapi_init();
+  BLI_task_scheduler_init();
+
+  Array<SortIntByInt> items;
+
+  items = random_items(items_num, max_key);
+  TIMEIT_START(qsort);
+  qsort(items.data(), (size_t)items_num, sizeof(SortIntByInt), BLI_sortutil_cmp_int);
+  TIMEIT_END(qsort);
+
+  items = random_items(items_num, max_key);
+  TIMEIT_START(std_sort);
+  std::sort(items.begin(), items.end(), items_key_less);
+  TIMEIT_END(std_sort);
+
+  items = random_items(items_num, max_key);
+  TIMEIT_START(std_stable_sort);
+  std::stable_sort(items.begin(), items.end(), items_key_less);
+  TIMEIT_END(std_stable_sort);
+
+  items = random_items(items_num, max_key);
+  TIMEIT_START(parallel_sort);
+  blender::parallel_sort(items.as_mutable_span(), items_key_less);
+  TIMEIT_END(parallel_sort);
+  EXPECT_TRUE(std::is_sorted(items.begin(), items.end(), items_key_less));
+
+  items = random_items(items_num, max_key);
+  TIMEIT_START(parallel_radix_sort);
+  blender::parallel_radix_sort(items.as_mutable_span(), [](const SortIntByInt &item) {
+    return (uint)item.sort_value;
+  });
+  TIMEIT_END(parallel_radix_sort);
+  EXPECT_TRUE(std::is_sorted(items.begin(), items.end(), items_key_less));
+
+  BLI_task_scheduler_exit();
+  BLI_threadapi_exit();
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+static void parallel_scan_tests(const int values_num, const char *id)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  BLI_threadapi_init();
+  BLI_task_scheduler_init();
+
+  Array<int> counts(values_num);
+  RandomNumberGenerator rng(0);
+  for (int &count : counts) {
+    count = rng.get_int32(8);
+  }
+  Array<int> offsets(values_num);
+
+  int serial_total = 0;
+  TIMEIT_START(serial_scan);
+  for (const int i : IndexRange(values_num)) {
+    offsets[i] = serial_total;
+    serial_total += counts[i];
+  }
+  TIMEIT_END(serial_scan);
+
+  int parallel_total = 0;
+  TIMEIT_START(parallel_exclusive_scan);
+  parallel_total = blender::parallel_exclusive_scan(counts.as_span(), offsets.as_mutable_span());
+  TIMEIT_END(parallel_exclusive_scan);
+  EXPECT_EQ(serial_total, parallel_total);
+
+  BLI_task_scheduler_exit();
+  BLI_threadapi_exit();
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(parallel_sort, Sort1M)
+{
+  parallel_sort_tests(1000000, 1000000, "Parallel Sort - 1000000 items, 1000000 keys");
+}
+
+TEST(parallel_sort, Sort1MFewKeys)
+{
+  parallel_sort_tests(1000000, 100, "Parallel Sort - 1000000 items, 100 keys");
+}
+
+TEST(parallel_sort, Sort10M)
+{
+  parallel_sort_tests(10000000, 10000000, "Parallel Sort - 10000000 items, 10000000 keys");
+}
+
+TEST(parallel_sort, Scan10M)
+{
+  parallel_scan_tests(10000000, "Parallel Exclusive Scan - 10000000 values");
+}
+
+TEST(parallel_sort, Scan100M)
+{
+  parallel_scan_tests(100000000, "Parallel Exclusive Scan - 100000000 values");
+}
@@ -46,6 +46,7 @@ struct bScreen;
 struct wmWindowManager;
 
 typedef struct BlendHandle BlendHandle;
+typedef struct BlendFileStream BlendFileStream;
 
 typedef struct WorkspaceConfigFileData {
   struct Main *main; /* has to be freed when done reading file data */
@@ -113,6 +114,8 @@ BlendFileData *BLO_read_from_memfile(struct Main *oldmain,
 
 void BLO_blendfiledata_free(BlendFileData *bfd);
 
+void BLO_read_profile_json_filepath_set(const char *filepath);
+
 /** \} */
 
 /* -------------------------------------------------------------------- */
@@ -120,6 +123,8 @@ void BLO_blendfiledata_free(BlendFileData *bfd);
  * \{ */
 
 BlendHandle *BLO_blendhandle_from_file(const char *filepath, struct ReportList *reports);
+BlendHandle *BLO_blendhandle_from_file_for_link(const char *filepath,
+                                               struct ReportList *reports);
 BlendHandle *BLO_blendhandle_from_memory(const void *mem, int memsize);
 
 struct LinkNode *BLO_blendhandle_get_datablock_names(BlendHandle *bh,
@@ -132,6 +137,32 @@ void BLO_blendhandle_close(BlendHandle *bh);
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name BLO Blend File Stream API
+ *
+ * Visit the blocks of a file in order without reading the file into memory,
+ * for quickly inspecting many files (an asset index for example).
+ * \{ */
+
+BlendFileStream *BLO_blendfile_stream_open(const char *filepath, struct ReportList *reports);
+void BLO_blendfile_stream_close(BlendFileStream *stream);
+
+const struct BHead *BLO_blendfile_stream_next(BlendFileStream *stream);
+const void *BLO_blendfile_stream_data(BlendFileStream *stream, int len);
+const char *BLO_blendfile_stream_id_name(BlendFileStream *stream);
+
+int BLO_blendfile_stream_struct_index(BlendFileStream *stream, const char *stype);
+int BLO_blendfile_stream_member_offset(BlendFileStream *stream,
+                                       const char *stype,
+                                       const char *vartype,
+                                       const char *name);
+bool BLO_blendfile_stream_member_get(BlendFileStream *stream,
+                                     int offset,
+                                     int size,
+                                     void *r_value);
+
+/** \} */
+
 #define BLO_GROUP_MAX 32
 #define BLO_EMBEDDED_STARTUP_BLEND "<startup.blend>"
 
@@ -24,15 +24,26 @@
  * \ingroup blenloader
  */
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 struct Scene;
 struct GHash;
 
+/** Reference counted chunk contents, shared between all chunks with the same data. */
+typedef struct MemFileSharedBuffer MemFileSharedBuffer;
+
 typedef struct {
   void *next, *prev;
+  /** Contents of #MemFileChunk.shared, NULL while compressed (see #BLO_memfile_compress). */
   const char *buf;
   /** Size in bytes. */
   unsigned int size;
-  /** When true, this chunk doesn't own the memory, it's shared with a previous #MemFileChunk */
+  /** Owns a user of the shared buffer. */
+  MemFileSharedBuffer *shared;
+  /** When true, this chunk is identical to the chunk written at this position in the
+   * previous step (used by undo code to detect unchanged IDs). */
   bool is_identical;
   /** When true, this chunk is also identical to the one in the next step (used by undo code to
    * detect unchanged IDs).
@@ -78,9 +89,15 @@ void BLO_memfile_chunk_add(MemFileWriteData *mem_data, const char *buf, unsigned
 extern void BLO_memfile_free(MemFile *memfile);
 extern void BLO_memfile_merge(MemFile *first, MemFile *second);
 extern void BLO_memfile_clear_future(MemFile *memfile);
+extern void BLO_memfile_compress(MemFile *memfile);
+extern void BLO_memfile_uncompress(MemFile *memfile);
 
 /* utilities */
 extern struct Main *BLO_memfile_main_get(struct MemFile *memfile,
                                          struct Main *bmain,
                                          struct Scene **r_scene);
 extern bool BLO_memfile_write_file(struct MemFile *memfile, const char *filename);
+
+#ifdef __cplusplus
+}
+#endif
@@ -72,3 +72,27 @@ extern bool BLO_write_file_mem(struct Main *mainvar,
                                int write_flags);
 
 /** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name BLO Write File Snapshot API
+ *
+ * Saving split into two steps, so only storing the file in memory blocks the user,
+ * compression and disk access can run in a thread.
+ * \{ */
+
+typedef struct BlendFileWriteSnapshot BlendFileWriteSnapshot;
+
+extern BlendFileWriteSnapshot *BLO_write_file_snapshot(struct Main *mainvar,
+                                                       const char *filepath,
+                                                       const int write_flags,
+                                                       const struct BlendFileWriteParams *params,
+                                                       struct ReportList *reports);
+extern BlendFileWriteSnapshot *BLO_write_file_snapshot_from_memfile(struct MemFile *memfile,
+                                                                    const char *filepath);
+extern bool BLO_write_file_snapshot_write(BlendFileWriteSnapshot *snapshot,
+                                          const short *stop,
+                                          float *r_progress,
+                                          struct ReportList *reports);
+extern void BLO_write_file_snapshot_free(BlendFileWriteSnapshot *snapshot);
+
+/** \} */
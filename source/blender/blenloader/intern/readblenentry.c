@@ -31,6 +31,8 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "BLI_endian_switch.h"
+#include "BLI_fileops.h"
 #include "BLI_ghash.h"
 #include "BLI_linklist.h"
 #include "BLI_listbase.h"
@@ -40,6 +42,7 @@
 #include "DNA_genfile.h"
 #include "DNA_sdna_types.h"
 
+#include "BKE_global.h"
 #include "BKE_idtype.h"
 #include "BKE_main.h"
 
@@ -76,6 +79,26 @@ BlendHandle *BLO_blendhandle_from_file(const char *filepath, ReportList *reports
   return bh;
 }
 
+/**
+ * Open a blendhandle from a file path, for linking data-blocks from the file.
+ *
+ * When the file contains an ID index, only the blocks of the data-blocks
+ * that are linked are read (along with the data-blocks they use).
+ * This handle can't be used to list the contents of the file.
+ *
+ * \param filepath: The file path to open.
+ * \param reports: Report errors in opening the file (can be NULL).
+ * \return A handle on success, or NULL on failure.
+ */
+BlendHandle *BLO_blendhandle_from_file_for_link(const char *filepath, ReportList *reports)
+{
+  BlendHandle *bh;
+
+  bh = (BlendHandle *)blo_filedata_from_file_for_link(filepath, reports);
+
+  return bh;
+}
+
 /**
  * Open a blendhandle from memory.
  *
@@ -295,6 +318,142 @@ void BLO_blendhandle_close(BlendHandle *bh)
   blo_filedata_free(fd);
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Blend File Stream
+ * \{ */
+
+/**
+ * Open a file for visiting its blocks in order, the file is never read into memory as a whole.
+ *
+ * \param filepath: The file path to open.
+ * \param reports: Report errors in opening the file (can be NULL).
+ * \return A stream on success, or NULL on failure.
+ */
+BlendFileStream *BLO_blendfile_stream_open(const char *filepath, ReportList *reports)
+{
+  return (BlendFileStream *)blo_filedata_from_file_for_stream(filepath, reports);
+}
+
+void BLO_blendfile_stream_close(BlendFileStream *stream)
+{
+  blo_filedata_free((FileData *)stream);
+}
+
+/**
+ * Advance to the next block.
+ *
+ * \return The block header, NULL when there are no more blocks.
+ * The header (and its data) is only valid until the next call.
+ */
+const BHead *BLO_blendfile_stream_next(BlendFileStream *stream)
+{
+  return blo_bhead_stream_next((FileData *)stream);
+}
+
+/**
+ * Access the data of the current block as stored in the file (no endian switching or
+ * DNA conversion). Only the first \a len bytes are read when the block isn't already
+ * in memory, the remaining data is skipped.
+ *
+ * \return The data or NULL on failure, valid until the next call to
+ * #BLO_blendfile_stream_next.
+ */
+const void *BLO_blendfile_stream_data(BlendFileStream *stream, int len)
+{
+  return blo_bhead_stream_data((FileData *)stream, len);
+}
+
+/**
+ * \return The name of the data-block of the current block (including the ID code),
+ * NULL when the block isn't a data-block.
+ */
+const char *BLO_blendfile_stream_id_name(BlendFileStream *stream)
+{
+  FileData *fd = (FileData *)stream;
+  const BHead *bhead = fd->stream_bhead;
+  if (bhead == NULL || !BKE_idtype_idcode_is_valid(bhead->code)) {
+    return NULL;
+  }
+  const int len = fd->id_name_offs + MAX_ID_NAME;
+  if (bhead->len < len) {
+    return NULL;
+  }
+  const char *data = blo_bhead_stream_data(fd, len);
+  if (data == NULL) {
+    return NULL;
+  }
+  return data + fd->id_name_offs;
+}
+
+/**
+ * \return The index of the struct \a stype in the DNA of the file, to compare with
+ * #BHead.SDNAnr, -1 when not found.
+ */
+int BLO_blendfile_stream_struct_index(BlendFileStream *stream, const char *stype)
+{
+  FileData *fd = (FileData *)stream;
+  return DNA_struct_find_nr(fd->filesdna, stype);
+}
+
+/**
+ * \return The offset of a struct member in the file, -1 when the file doesn't have it.
+ * Arguments are as for #DNA_elem_offset, e.g. `("ID", "char", "name[]")`.
+ */
+int BLO_blendfile_stream_member_offset(BlendFileStream *stream,
+                                       const char *stype,
+                                       const char *vartype,
+                                       const char *name)
+{
+  FileData *fd = (FileData *)stream;
+  if (!DNA_struct_elem_find(fd->filesdna, stype, vartype, name)) {
+    return -1;
+  }
+  return DNA_elem_offset(fd->filesdna, stype, vartype, name);
+}
+
+/**
+ * Copy a value from the data of the current block, converting it to the endianness in use.
+ * Only the data up to the value is read.
+ *
+ * \param offset: The offset in the block, see #BLO_blendfile_stream_member_offset.
+ * \param size: The size of the value in the file (pointers in files written
+ * on 32 bit systems are 4 bytes).
+ * \return False when the value is outside of the block or reading fails.
+ */
+bool BLO_blendfile_stream_member_get(BlendFileStream *stream,
+                                     int offset,
+                                     int size,
+                                     void *r_value)
+{
+  FileData *fd = (FileData *)stream;
+  const BHead *bhead = fd->stream_bhead;
+  if (bhead == NULL || offset < 0 || size <= 0 || offset + size > bhead->len) {
+    return false;
+  }
+  const char *data = blo_bhead_stream_data(fd, offset + size);
+  if (data == NULL) {
+    return false;
+  }
+  memcpy(r_value, data + offset, (size_t)size);
+
+  if (fd->flags & FD_FLAGS_SWITCH_ENDIAN) {
+    switch (size) {
+      case 2:
+        BLI_endian_switch_int16(r_value);
+        break;
+      case 4:
+        BLI_endian_switch_int32(r_value);
+        break;
+      case 8:
+        BLI_endian_switch_int64(r_value);
+        break;
+    }
+  }
+  return true;
+}
+
+/** \} */
+
 /**********/
 
 /**
@@ -312,14 +471,26 @@ BlendFileData *BLO_read_from_file(const char *filepath,
   BlendFileData *bfd = NULL;
   FileData *fd;
 
+  struct BlendFileReadProfile *profile = NULL;
+  if (G.debug & G_DEBUG_IO_TIMING) {
+    profile = blo_read_profile_new(filepath);
+  }
+
   fd = blo_filedata_from_file(filepath, reports);
   if (fd) {
     fd->reports = reports;
     fd->skip_flags = skip_flags;
+    fd->profile = profile;
+    blo_read_profile_bytes_add(fd, BLI_file_size(filepath));
     bfd = blo_read_file_internal(fd, filepath);
     blo_filedata_free(fd);
   }
 
+  if (profile != NULL) {
+    blo_read_profile_report(profile);
+    blo_read_profile_free(profile);
+  }
+
   return bfd;
 }
 
@@ -23,6 +23,10 @@
 
 #include "zlib.h"
 
+#ifdef WITH_ZSTD
+#  include <zstd.h>
+#endif
+
 #include <ctype.h> /* for isdigit. */
 #include <fcntl.h> /* for open flags (O_BINARY, O_RDONLY). */
 #include <limits.h>
@@ -100,6 +104,7 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "BLI_bitmap.h"
 #include "BLI_blenlib.h"
 #include "BLI_endian_switch.h"
 #include "BLI_ghash.h"
@@ -107,6 +112,8 @@
 #include "BLI_math.h"
 #include "BLI_memarena.h"
 #include "BLI_mempool.h"
+#include "BLI_mmap.h"
+#include "BLI_task.h"
 #include "BLI_threads.h"
 
 #include "BLT_translation.h"
@@ -235,8 +242,9 @@
  * Delay reading blocks we might not use (especially applies to library linking).
  * which keeps large arrays in memory from data-blocks we may not even use.
  *
- * \note This is disabled when using compression,
+ * \note This is disabled when using gzip compression,
  * while zlib supports seek it's unusably slow, see: T61880.
+ * Zstd compressed files use a seek table, so this is supported for them.
  */
 #define USE_BHEAD_READ_ON_DEMAND
 
@@ -246,6 +254,12 @@
 /* Use GHash for restoring pointers by name */
 #define USE_GHASH_RESTORE_POINTER
 
+/**
+ * Reconstruct the structs of data-blocks in parallel before they are linked,
+ * see #read_file_preread_structs.
+ */
+#define USE_PARALLEL_STRUCT_READ
+
 /* Define this to have verbose debug prints. */
 //#define USE_DEBUG_PRINT
 
@@ -800,77 +814,87 @@ static void bh8_from_bh4(BHead *bhead, BHead4 *bhead4)
   }
 }
 
-static BHeadN *get_bhead(FileData *fd)
+/**
+ * Read the next block header, converted to the #BHead used in memory.
+ * Sets #FileData.is_eof at the end of the file (or for invalid headers).
+ */
+static void bhead_read_header(FileData *fd, BHead *r_bhead)
 {
-  BHeadN *new_bhead = NULL;
+  /* initializing to zero isn't strictly needed but shuts valgrind up
+   * since uninitialized memory gets compared */
+  BHead8 bhead8 = {0};
+  BHead4 bhead4 = {0};
   int readsize;
 
-  if (fd) {
-    if (!fd->is_eof) {
-      /* initializing to zero isn't strictly needed but shuts valgrind up
-       * since uninitialized memory gets compared */
-      BHead8 bhead8 = {0};
-      BHead4 bhead4 = {0};
-      BHead bhead = {0};
-
-      /* First read the bhead structure.
-       * Depending on the platform the file was written on this can
-       * be a big or little endian BHead4 or BHead8 structure.
-       *
-       * As usual 'ENDB' (the last *partial* bhead of the file)
-       * needs some special handling. We don't want to EOF just yet.
-       */
-      if (fd->flags & FD_FLAGS_FILE_POINTSIZE_IS_4) {
-        bhead4.code = DATA;
-        readsize = fd->read(fd, &bhead4, sizeof(bhead4), NULL);
+  /* First read the bhead structure.
+   * Depending on the platform the file was written on this can
+   * be a big or little endian BHead4 or BHead8 structure.
+   *
+   * As usual 'ENDB' (the last *partial* bhead of the file)
+   * needs some special handling. We don't want to EOF just yet.
+   */
+  if (fd->flags & FD_FLAGS_FILE_POINTSIZE_IS_4) {
+    bhead4.code = DATA;
+    readsize = fd->read(fd, &bhead4, sizeof(bhead4), NULL);
 
-        if (readsize == sizeof(bhead4) || bhead4.code == ENDB) {
-          if (fd->flags & FD_FLAGS_SWITCH_ENDIAN) {
-            switch_endian_bh4(&bhead4);
-          }
+    if (readsize == sizeof(bhead4) || bhead4.code == ENDB) {
+      if (fd->flags & FD_FLAGS_SWITCH_ENDIAN) {
+        switch_endian_bh4(&bhead4);
+      }
 
-          if (fd->flags & FD_FLAGS_POINTSIZE_DIFFERS) {
-            bh8_from_bh4(&bhead, &bhead4);
-          }
-          else {
-            /* MIN2 is only to quiet '-Warray-bounds' compiler warning. */
-            BLI_assert(sizeof(bhead) == sizeof(bhead4));
-            memcpy(&bhead, &bhead4, MIN2(sizeof(bhead), sizeof(bhead4)));
-          }
-        }
-        else {
-          fd->is_eof = true;
-          bhead.len = 0;
-        }
+      if (fd->flags & FD_FLAGS_POINTSIZE_DIFFERS) {
+        bh8_from_bh4(r_bhead, &bhead4);
       }
       else {
-        bhead8.code = DATA;
-        readsize = fd->read(fd, &bhead8, sizeof(bhead8), NULL);
-
-        if (readsize == sizeof(bhead8) || bhead8.code == ENDB) {
-          if (fd->flags & FD_FLAGS_SWITCH_ENDIAN) {
-            switch_endian_bh8(&bhead8);
-          }
+        /* MIN2 is only to quiet '-Warray-bounds' compiler warning. */
+        BLI_assert(sizeof(*r_bhead) == sizeof(bhead4));
+        memcpy(r_bhead, &bhead4, MIN2(sizeof(*r_bhead), sizeof(bhead4)));
+      }
+    }
+    else {
+      fd->is_eof = true;
+      r_bhead->len = 0;
+    }
+  }
+  else {
+    bhead8.code = DATA;
+    readsize = fd->read(fd, &bhead8, sizeof(bhead8), NULL);
 
-          if (fd->flags & FD_FLAGS_POINTSIZE_DIFFERS) {
-            bh4_from_bh8(&bhead, &bhead8, (fd->flags & FD_FLAGS_SWITCH_ENDIAN));
-          }
-          else {
-            /* MIN2 is only to quiet '-Warray-bounds' compiler warning. */
-            BLI_assert(sizeof(bhead) == sizeof(bhead8));
-            memcpy(&bhead, &bhead8, MIN2(sizeof(bhead), sizeof(bhead8)));
-          }
-        }
-        else {
-          fd->is_eof = true;
-          bhead.len = 0;
-        }
+    if (readsize == sizeof(bhead8) || bhead8.code == ENDB) {
+      if (fd->flags & FD_FLAGS_SWITCH_ENDIAN) {
+        switch_endian_bh8(&bhead8);
       }
 
-      /* make sure people are not trying to pass bad blend files */
-      if (bhead.len < 0) {
-        fd->is_eof = true;
+      if (fd->flags & FD_FLAGS_POINTSIZE_DIFFERS) {
+        bh4_from_bh8(r_bhead, &bhead8, (fd->flags & FD_FLAGS_SWITCH_ENDIAN));
+      }
+      else {
+        /* MIN2 is only to quiet '-Warray-bounds' compiler warning. */
+        BLI_assert(sizeof(*r_bhead) == sizeof(bhead8));
+        memcpy(r_bhead, &bhead8, MIN2(sizeof(*r_bhead), sizeof(bhead8)));
       }
+    }
+    else {
+      fd->is_eof = true;
+      r_bhead->len = 0;
+    }
+  }
+
+  /* make sure people are not trying to pass bad blend files */
+  if (r_bhead->len < 0) {
+    fd->is_eof = true;
+  }
+}
+
+static BHeadN *get_bhead(FileData *fd)
+{
+  BHeadN *new_bhead = NULL;
+  int readsize;
+
+  if (fd) {
+    if (!fd->is_eof) {
+      BHead bhead = {0};
+      bhead_read_header(fd, &bhead);
 
       /* bhead now contains the (converted) bhead structure. Now read
        * the associated data and put everything in a BHeadN (creative naming !)
@@ -937,11 +961,140 @@ static BHeadN *get_bhead(FileData *fd)
   return new_bhead;
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Memory Mapped BHead Access
+ *
+ * When the file is memory mapped and stored with the same pointer size and endianness
+ * as used in memory, the #BHead's and their data are used from the mapping directly,
+ * instead of being copied into #BHeadN's. Data is only copied when it's needed in memory
+ * (see #read_struct), which avoids reading (and keeping) data that isn't used at all.
+ *
+ * \note Blocks are only 4 byte aligned in the file, so pointers in #BHead may be unaligned,
+ * this is fine for all supported architectures.
+ * \{ */
+
+static bool blo_bhead_use_mmap(const FileData *fd)
+{
+#ifdef BLI_MMAP_DIRECT_ACCESS_SAFE
+  return (fd->mmap_file != NULL) &&
+         ((fd->flags & (FD_FLAGS_SWITCH_ENDIAN | FD_FLAGS_POINTSIZE_DIFFERS)) == 0);
+#else
+  /* IO errors can't be recovered from when accessing the mapping directly. */
+  UNUSED_VARS(fd);
+  return false;
+#endif
+}
+
+static BHead *bhead_from_mmap(FileData *fd, size_t offset)
+{
+  BLI_mmap_file *mmap_file = fd->mmap_file;
+  const size_t length = BLI_mmap_get_length(mmap_file);
+
+  if (fd->is_eof) {
+    return NULL;
+  }
+
+  /* Old files may end with a partial ENDB, which is treated the same as the end of the file. */
+  if (offset > length || (length - offset) < sizeof(BHead)) {
+    fd->is_eof = true;
+    return NULL;
+  }
+
+  BHead *bhead = POINTER_OFFSET(BLI_mmap_get_pointer(mmap_file), offset);
+
+  /* Make sure people are not trying to pass bad blend files. */
+  if ((bhead->len < 0) || ((size_t)bhead->len > (length - offset - sizeof(BHead))) ||
+      BLI_mmap_has_io_error(mmap_file)) {
+    fd->is_eof = true;
+    return NULL;
+  }
+
+  return bhead;
+}
+
+/**
+ * Blocks accessed directly in the memory mapping are filled with zeros when reading the file
+ * fails, check this after copying them. Reading with #BLI_mmap_read reports errors itself.
+ */
+static bool bhead_mmap_has_io_error(const FileData *fd)
+{
+  return (fd->flags & FD_FLAGS_BHEAD_FROM_MMAP) && BLI_mmap_has_io_error(fd->mmap_file);
+}
+
+static size_t bhead_mmap_offset(FileData *fd, const BHead *bhead)
+{
+  return (size_t)((const char *)bhead - (const char *)BLI_mmap_get_pointer(fd->mmap_file));
+}
+
+static BHead *bhead_next_from_mmap(FileData *fd, BHead *thisblock)
+{
+  if (thisblock->code == ENDB) {
+    return NULL;
+  }
+  return bhead_from_mmap(fd, bhead_mmap_offset(fd, thisblock) + sizeof(BHead) + thisblock->len);
+}
+
+static BHead *bhead_prev_from_mmap(FileData *fd, BHead *thisblock)
+{
+  /* Only needed for library linking, so build the array of all blocks on demand. */
+  if (fd->mmap_bheads == NULL) {
+    int bheads_alloc = 1024;
+    fd->mmap_bheads = MEM_mallocN(sizeof(*fd->mmap_bheads) * bheads_alloc, __func__);
+    for (BHead *bhead = bhead_from_mmap(fd, SIZEOFBLENDERHEADER); bhead;
+         bhead = bhead_next_from_mmap(fd, bhead)) {
+      if (fd->mmap_bheads_len == bheads_alloc) {
+        bheads_alloc *= 2;
+        fd->mmap_bheads = MEM_reallocN(fd->mmap_bheads,
+                                       sizeof(*fd->mmap_bheads) * bheads_alloc);
+      }
+      fd->mmap_bheads[fd->mmap_bheads_len++] = bhead;
+    }
+    /* The loop above reached the end of the file,
+     * this doesn't mean all blocks have been read by the caller. */
+    fd->is_eof = false;
+  }
+
+  /* The blocks are sorted by their address. */
+  int low = 0, high = fd->mmap_bheads_len;
+  while (low < high) {
+    const int mid = (low + high) / 2;
+    if (fd->mmap_bheads[mid] < thisblock) {
+      low = mid + 1;
+    }
+    else {
+      high = mid;
+    }
+  }
+  BLI_assert(low < fd->mmap_bheads_len && fd->mmap_bheads[low] == thisblock);
+  return (low > 0) ? fd->mmap_bheads[low - 1] : NULL;
+}
+
+/** \} */
+
+/* Whether the data of this block has been read. */
+static bool blo_bhead_has_data(const FileData *fd, BHead *bhead)
+{
+  if (fd->flags & FD_FLAGS_BHEAD_FROM_MMAP) {
+    return true;
+  }
+#ifdef USE_BHEAD_READ_ON_DEMAND
+  return BHEADN_FROM_BHEAD(bhead)->has_data;
+#else
+  UNUSED_VARS(bhead);
+  return true;
+#endif
+}
+
 BHead *blo_bhead_first(FileData *fd)
 {
   BHeadN *new_bhead;
   BHead *bhead = NULL;
 
+  if (fd->flags & FD_FLAGS_BHEAD_FROM_MMAP) {
+    fd->is_eof = false;
+    return bhead_from_mmap(fd, SIZEOFBLENDERHEADER);
+  }
+
   /* Rewind the file
    * Read in a new block if necessary
    */
@@ -957,8 +1110,12 @@ BHead *blo_bhead_first(FileData *fd)
   return bhead;
 }
 
-BHead *blo_bhead_prev(FileData *UNUSED(fd), BHead *thisblock)
+BHead *blo_bhead_prev(FileData *fd, BHead *thisblock)
 {
+  if (fd->flags & FD_FLAGS_BHEAD_FROM_MMAP) {
+    return bhead_prev_from_mmap(fd, thisblock);
+  }
+
   BHeadN *bheadn = BHEADN_FROM_BHEAD(thisblock);
   BHeadN *prev = bheadn->prev;
 
@@ -970,6 +1127,10 @@ BHead *blo_bhead_next(FileData *fd, BHead *thisblock)
   BHeadN *new_bhead = NULL;
   BHead *bhead = NULL;
 
+  if (thisblock && (fd->flags & FD_FLAGS_BHEAD_FROM_MMAP)) {
+    return bhead_next_from_mmap(fd, thisblock);
+  }
+
   if (thisblock) {
     /* bhead is actually a sub part of BHeadN
      * We calculate the BHeadN pointer from the BHead pointer below */
@@ -1035,6 +1196,326 @@ const char *blo_bhead_id_name(const FileData *fd, const BHead *bhead)
   return (const char *)POINTER_OFFSET(bhead, sizeof(*bhead) + fd->id_name_offs);
 }
 
+/* -------------------------------------------------------------------- */
+/** \name ID Index
+ *
+ * Files opened for linking that contain an ID index (see #BlendIDIndexHeader) only read
+ * the #GLOB and #DNA1 blocks up-front. Other blocks are read when their ID is looked up
+ * by name (#find_bhead_from_code_name), along with the blocks of all IDs it uses.
+ * IDs used but missing from the index dependencies are read when looked up
+ * by address (#find_bhead).
+ *
+ * #FileData.bhead_list only contains the blocks read so far, sorted by file offset.
+ * \{ */
+
+typedef struct IDIndex {
+  /** The index as stored in the file. */
+  char *buf;
+  const BlendIDIndexHeader *header;
+  const BlendIDIndexEntry *entries;
+  const uint32_t *deps;
+
+  /** Last block read for each entry, NULL when the entry hasn't been read yet. */
+  BHeadN **entries_bhead_last;
+  /** The #GLOB block, the first block in #FileData.bhead_list. */
+  BHeadN *bhead_glob;
+
+  /** Entry index from the name of linkable IDs. */
+  GHash *entry_from_name;
+  /** Entry index from #BlendIDIndexEntry.old. */
+  GHash *entry_from_old;
+} IDIndex;
+
+static void id_index_free(IDIndex *index)
+{
+  MEM_freeN(index->buf);
+  MEM_SAFE_FREE(index->entries_bhead_last);
+  if (index->entry_from_name) {
+    BLI_ghash_free(index->entry_from_name, NULL, NULL);
+  }
+  if (index->entry_from_old) {
+    BLI_ghash_free(index->entry_from_old, NULL, NULL);
+  }
+  MEM_freeN(index);
+}
+
+static bool id_index_is_valid(const IDIndex *index, const uint64_t index_len)
+{
+  const BlendIDIndexHeader *header = index->header;
+  if (!STREQLEN(header->magic, BLEND_ID_INDEX_MAGIC, sizeof(header->magic)) ||
+      (header->version != BLEND_ID_INDEX_VERSION)) {
+    return false;
+  }
+  const uint64_t index_len_expect = (uint64_t)sizeof(BlendIDIndexHeader) +
+                                    (uint64_t)header->entries_len * sizeof(BlendIDIndexEntry) +
+                                    (uint64_t)header->deps_len * sizeof(uint32_t) +
+                                    sizeof(BlendIDIndexFooter);
+  if (index_len_expect != index_len) {
+    return false;
+  }
+
+  /* Entries must be sorted and between the #GLOB and #DNA1 blocks. */
+  uint64_t offset_min = header->glob_offset + sizeof(BHead);
+  for (uint i = 0; i < header->entries_len; i++) {
+    const BlendIDIndexEntry *entry = &index->entries[i];
+    if ((entry->offset < offset_min) || (entry->offset >= header->dna_offset) ||
+        (entry->len < sizeof(BHead)) || (entry->len > header->dna_offset - entry->offset) ||
+        ((uint64_t)entry->deps_start + entry->deps_len > header->deps_len) ||
+        (memchr(entry->name, '\0', sizeof(entry->name)) == NULL)) {
+      return false;
+    }
+    offset_min = entry->offset + entry->len;
+  }
+  for (uint i = 0; i < header->deps_len; i++) {
+    if (index->deps[i] >= header->entries_len) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Read the blocks in the given range of the file into #FileData.bhead_list,
+ * inserting them after \a bhead_prev (at the start of the list when NULL).
+ *
+ * \return the last block read or NULL on failure.
+ */
+static BHeadN *id_index_read_blocks(FileData *fd,
+                                    const uint64_t offset,
+                                    const uint64_t len,
+                                    BHeadN *bhead_prev,
+                                    BHeadN **r_bhead_first)
+{
+  BHeadN *bhead_first = NULL;
+  BHeadN *bhead_last = NULL;
+
+  if (fd->seek(fd, (off64_t)offset, SEEK_SET) != -1) {
+    fd->is_eof = false;
+    while ((uint64_t)fd->file_offset < offset + len) {
+      BHeadN *new_bhead = get_bhead(fd);
+      if (new_bhead == NULL) {
+        break;
+      }
+      /* #get_bhead adds to the end of the list, keep the list sorted by file offset. */
+      BLI_remlink(&fd->bhead_list, new_bhead);
+      BLI_insertlinkafter(&fd->bhead_list, bhead_prev, new_bhead);
+      bhead_prev = new_bhead;
+
+      if (bhead_first == NULL) {
+        bhead_first = new_bhead;
+      }
+      bhead_last = new_bhead;
+    }
+    /* Never read past the blocks that are requested when walking over the list. */
+    fd->is_eof = true;
+  }
+
+  if (r_bhead_first) {
+    *r_bhead_first = bhead_first;
+  }
+  return bhead_last;
+}
+
+/**
+ * Open the ID index of the file and read the #GLOB and #DNA1 blocks.
+ *
+ * \return NULL when the file has no (valid) index,
+ * the file can then be read as usual.
+ */
+static IDIndex *id_index_read(FileData *fd)
+{
+  /* The index is stored with the pointer size and endianness of the file. */
+  if ((fd->seek == NULL) || (fd->flags & (FD_FLAGS_SWITCH_ENDIAN | FD_FLAGS_POINTSIZE_DIFFERS))) {
+    return NULL;
+  }
+  BLI_assert(BLI_listbase_is_empty(&fd->bhead_list));
+
+  /* The index is stored in the last block before #ENDB. */
+  const off64_t file_len = fd->seek(fd, 0, SEEK_END);
+  const off64_t footer_offset = file_len - (off64_t)(sizeof(BHead) + sizeof(BlendIDIndexFooter));
+  const off64_t index_end = footer_offset + (off64_t)sizeof(BlendIDIndexFooter);
+  BlendIDIndexFooter footer;
+
+  IDIndex *index = NULL;
+
+  if ((file_len == -1) || (footer_offset < SIZEOFBLENDERHEADER + (off64_t)sizeof(BHead)) ||
+      (fd->seek(fd, footer_offset, SEEK_SET) == -1) ||
+      (fd->read(fd, &footer, sizeof(footer), NULL) != sizeof(footer)) ||
+      !STREQLEN(footer.magic, BLEND_ID_INDEX_MAGIC, sizeof(footer.magic)) ||
+      (footer.len < sizeof(BlendIDIndexHeader) + sizeof(BlendIDIndexFooter)) ||
+      (footer.len > INT_MAX) ||
+      ((off64_t)footer.len > index_end - (SIZEOFBLENDERHEADER + (off64_t)sizeof(BHead)))) {
+    goto fail;
+  }
+
+  index = MEM_callocN(sizeof(*index), __func__);
+  index->buf = MEM_mallocN((size_t)footer.len, __func__);
+  if ((fd->seek(fd, index_end - (off64_t)footer.len, SEEK_SET) == -1) ||
+      (fd->read(fd, index->buf, (uint)footer.len, NULL) != (int)footer.len)) {
+    goto fail;
+  }
+
+  index->header = (const BlendIDIndexHeader *)index->buf;
+  index->entries = (const BlendIDIndexEntry *)(index->header + 1);
+  index->deps = (const uint32_t *)(index->entries + index->header->entries_len);
+  if (!id_index_is_valid(index, footer.len) ||
+      (index->header->dna_offset >= (uint64_t)(index_end - (off64_t)footer.len))) {
+    goto fail;
+  }
+
+  const uint entries_len = index->header->entries_len;
+  index->entries_bhead_last = MEM_calloc_arrayN(
+      entries_len, sizeof(*index->entries_bhead_last), __func__);
+  index->entry_from_name = BLI_ghash_str_new_ex(__func__, entries_len);
+  index->entry_from_old = BLI_ghash_ptr_new_ex(__func__, entries_len);
+  for (uint i = 0; i < entries_len; i++) {
+    const BlendIDIndexEntry *entry = &index->entries[i];
+    const int code = entry->code;
+    if (BKE_idtype_idcode_is_valid(code) && BKE_idtype_idcode_is_linkable(code)) {
+      BLI_ghash_reinsert(
+          index->entry_from_name, (void *)entry->name, POINTER_FROM_UINT(i), NULL, NULL);
+    }
+    BLI_ghash_reinsert(
+        index->entry_from_old, (void *)(uintptr_t)entry->old, POINTER_FROM_UINT(i), NULL, NULL);
+  }
+
+  /* Only a single block is read for these. */
+  index->bhead_glob = id_index_read_blocks(fd, index->header->glob_offset, 1, NULL, NULL);
+  if ((index->bhead_glob == NULL) || (index->bhead_glob->bhead.code != GLOB) ||
+      (id_index_read_blocks(fd, index->header->dna_offset, 1, index->bhead_glob, NULL) == NULL) ||
+      (((BHeadN *)fd->bhead_list.last)->bhead.code != DNA1)) {
+    goto fail;
+  }
+
+  /* The blocks are read from the list, without the mapping. */
+  fd->flags &= ~FD_FLAGS_BHEAD_FROM_MMAP;
+  return index;
+
+fail:
+  /* Read the file as usual. */
+  BLI_freelistN(&fd->bhead_list);
+  fd->is_eof = false;
+  fd->seek(fd, SIZEOFBLENDERHEADER, SEEK_SET);
+  if (index != NULL) {
+    id_index_free(index);
+  }
+  return NULL;
+}
+
+static int id_index_cmp_uint(const void *a, const void *b)
+{
+  const uint ua = *(const uint *)a, ub = *(const uint *)b;
+  return (ua > ub) - (ua < ub);
+}
+
+/**
+ * Read the blocks of the entry and all entries it uses (directly or indirectly).
+ *
+ * \return true when any blocks were read.
+ */
+static bool id_index_read_entry_with_deps(FileData *fd, const uint entry_index)
+{
+  IDIndex *index = fd->id_index;
+  const uint entries_len = index->header->entries_len;
+
+  /* The dependencies of entries that have been read have been read too. */
+  if (index->entries_bhead_last[entry_index] != NULL) {
+    return false;
+  }
+
+  BLI_bitmap *entries_visit = BLI_BITMAP_NEW(entries_len, __func__);
+  uint *entries_read = MEM_malloc_arrayN(entries_len, sizeof(*entries_read), __func__);
+  uint *stack = MEM_malloc_arrayN(entries_len, sizeof(*stack), __func__);
+  uint entries_read_len = 0, stack_len = 0;
+
+  BLI_BITMAP_ENABLE(entries_visit, entry_index);
+  stack[stack_len++] = entry_index;
+  while (stack_len != 0) {
+    const uint i = stack[--stack_len];
+    const BlendIDIndexEntry *entry = &index->entries[i];
+    entries_read[entries_read_len++] = i;
+    for (uint j = 0; j < entry->deps_len; j++) {
+      const uint dep = index->deps[entry->deps_start + j];
+      if (!BLI_BITMAP_TEST(entries_visit, dep) && (index->entries_bhead_last[dep] == NULL)) {
+        BLI_BITMAP_ENABLE(entries_visit, dep);
+        stack[stack_len++] = dep;
+      }
+    }
+  }
+  MEM_freeN(stack);
+  MEM_freeN(entries_visit);
+
+  /* Read in file order, which is also the order of the blocks in the list. */
+  qsort(entries_read, entries_read_len, sizeof(*entries_read), id_index_cmp_uint);
+
+  bool changed = false;
+  BHeadN *bhead_prev = index->bhead_glob;
+  uint i_prev = 0;
+  for (uint k = 0; k < entries_read_len; k++) {
+    const uint i = entries_read[k];
+    for (; i_prev < i; i_prev++) {
+      if (index->entries_bhead_last[i_prev] != NULL) {
+        bhead_prev = index->entries_bhead_last[i_prev];
+      }
+    }
+
+    const BlendIDIndexEntry *entry = &index->entries[i];
+    BHeadN *bhead_first;
+    BHeadN *bhead_last = id_index_read_blocks(
+        fd, entry->offset, entry->len, bhead_prev, &bhead_first);
+    if (bhead_last == NULL) {
+      continue;
+    }
+    index->entries_bhead_last[i] = bhead_prev = bhead_last;
+    i_prev = i + 1;
+    changed = true;
+
+#ifdef USE_GHASH_BHEAD
+    if ((fd->bhead_idname_hash != NULL) && BLI_ghash_haskey(index->entry_from_name, entry->name)) {
+      void **val_p;
+      if (!BLI_ghash_ensure_p(fd->bhead_idname_hash,
+                              (void *)blo_bhead_id_name(fd, &bhead_first->bhead),
+                              &val_p)) {
+        *val_p = &bhead_first->bhead;
+      }
+    }
+#endif
+  }
+  MEM_freeN(entries_read);
+
+  if (changed) {
+    /* Created again when needed, see #find_bhead. */
+    MEM_SAFE_FREE(fd->bheadmap);
+    fd->tot_bheadmap = 0;
+  }
+  return changed;
+}
+
+/** Read the blocks of a linkable ID by name (including the 2 character ID code). */
+static void id_index_ensure_from_idname(FileData *fd, const char *idname)
+{
+  void **entry_p = BLI_ghash_lookup_p(fd->id_index->entry_from_name, idname);
+  if (entry_p != NULL) {
+    id_index_read_entry_with_deps(fd, POINTER_AS_UINT(*entry_p));
+  }
+}
+
+/**
+ * Read the blocks of an ID by the address it was written with.
+ *
+ * \return true when any blocks were read.
+ */
+static bool id_index_ensure_from_old(FileData *fd, const void *old)
+{
+  void **entry_p = BLI_ghash_lookup_p(fd->id_index->entry_from_old, old);
+  if (entry_p != NULL) {
+    return id_index_read_entry_with_deps(fd, POINTER_AS_UINT(*entry_p));
+  }
+  return false;
+}
+
+/** \} */
+
 static void decode_blender_header(FileData *fd)
 {
   char header[SIZEOFBLENDERHEADER], num[4];
@@ -1072,9 +1553,45 @@ static void decode_blender_header(FileData *fd)
     memcpy(num, header + 9, 3);
     num[3] = 0;
     fd->fileversion = atoi(num);
+
+    if (blo_bhead_use_mmap(fd)) {
+      fd->flags |= FD_FLAGS_BHEAD_FROM_MMAP;
+    }
   }
 }
 
+static int read_file_subversion(const FileGlobal *fg)
+{
+  /* We can't use read_global because this needs 'DNA1' to be decoded,
+   * however the first 4 chars are _always_ the subversion. */
+  BLI_STATIC_ASSERT(offsetof(FileGlobal, subvstr) == 0, "Must be first: subvstr")
+  char num[5];
+  memcpy(num, fg->subvstr, 4);
+  num[4] = 0;
+  return atoi(num);
+}
+
+static bool read_file_dna_decode(FileData *fd,
+                                 const void *data,
+                                 const int data_len,
+                                 const int subversion,
+                                 const char **r_error_message)
+{
+  const bool do_endian_swap = (fd->flags & FD_FLAGS_SWITCH_ENDIAN) != 0;
+
+  fd->filesdna = DNA_sdna_from_data(data, data_len, do_endian_swap, true, r_error_message);
+  if (fd->filesdna) {
+    blo_do_versions_dna(fd->filesdna, fd->fileversion, subversion);
+    fd->compflags = DNA_struct_get_compareflags(fd->filesdna, fd->memsdna);
+    /* used to retrieve ID names from (bhead+1) */
+    fd->id_name_offs = DNA_elem_offset(fd->filesdna, "ID", "char", "name[]");
+
+    return true;
+  }
+
+  return false;
+}
+
 /**
  * \return Success if the file is read correctly, else set \a r_error_message.
  */
@@ -1090,30 +1607,10 @@ static bool read_file_dna(FileData *fd, const char **r_error_message)
       if (fd->fileversion <= 242) {
         continue;
       }
-      /* We can't use read_global because this needs 'DNA1' to be decoded,
-       * however the first 4 chars are _always_ the subversion. */
-      FileGlobal *fg = (void *)&bhead[1];
-      BLI_STATIC_ASSERT(offsetof(FileGlobal, subvstr) == 0, "Must be first: subvstr")
-      char num[5];
-      memcpy(num, fg->subvstr, 4);
-      num[4] = 0;
-      subversion = atoi(num);
+      subversion = read_file_subversion((const FileGlobal *)&bhead[1]);
     }
     else if (bhead->code == DNA1) {
-      const bool do_endian_swap = (fd->flags & FD_FLAGS_SWITCH_ENDIAN) != 0;
-
-      fd->filesdna = DNA_sdna_from_data(
-          &bhead[1], bhead->len, do_endian_swap, true, r_error_message);
-      if (fd->filesdna) {
-        blo_do_versions_dna(fd->filesdna, fd->fileversion, subversion);
-        fd->compflags = DNA_struct_get_compareflags(fd->filesdna, fd->memsdna);
-        /* used to retrieve ID names from (bhead+1) */
-        fd->id_name_offs = DNA_elem_offset(fd->filesdna, "ID", "char", "name[]");
-
-        return true;
-      }
-
-      return false;
+      return read_file_dna_decode(fd, &bhead[1], bhead->len, subversion, r_error_message);
     }
     else if (bhead->code == ENDB) {
       break;
@@ -1195,6 +1692,52 @@ static off64_t fd_seek_data_from_file(FileData *filedata, off64_t offset, int wh
   return filedata->file_offset;
 }
 
+/* Memory mapped file reading. */
+
+static int fd_read_from_mmap(FileData *filedata,
+                             void *buffer,
+                             uint size,
+                             bool *UNUSED(r_is_memchunck_identical))
+{
+  /* don't read more bytes then there are available in the file */
+  const size_t length = BLI_mmap_get_length(filedata->mmap_file);
+  const size_t offset = (size_t)filedata->file_offset;
+  const size_t readsize = (offset < length) ? MIN2(size, length - offset) : 0;
+
+  if (!BLI_mmap_read(filedata->mmap_file, buffer, offset, readsize)) {
+    return EOF;
+  }
+
+  filedata->file_offset += readsize;
+  return (int)readsize;
+}
+
+static off64_t fd_seek_from_mmap(FileData *filedata, off64_t offset, int whence)
+{
+  const off64_t length = (off64_t)BLI_mmap_get_length(filedata->mmap_file);
+  off64_t offset_new;
+
+  switch (whence) {
+    case SEEK_SET:
+      offset_new = offset;
+      break;
+    case SEEK_CUR:
+      offset_new = filedata->file_offset + offset;
+      break;
+    case SEEK_END:
+      offset_new = length + offset;
+      break;
+    default:
+      return -1;
+  }
+
+  if (offset_new < 0 || offset_new > length) {
+    return -1;
+  }
+  filedata->file_offset = offset_new;
+  return offset_new;
+}
+
 /* GZip file reading. */
 
 static int fd_read_gzip_from_file(FileData *filedata,
@@ -1214,6 +1757,374 @@ static int fd_read_gzip_from_file(FileData *filedata,
   return readsize;
 }
 
+#ifdef WITH_ZSTD
+/* Zstd file reading.
+ *
+ * Files written by Blender contain a seek table (see #SEEKABLE_ZSTD_MAGIC_SKIPPABLE),
+ * which is used to only decompress the frames being read and to decompress frames ahead
+ * in parallel while reading sequentially.
+ * Other zstd files (without a seek table) are decompressed as a stream, without seeking. */
+
+typedef struct ZstdReadFrame {
+  /** Index of the frame, -1 when unused. */
+  int frame;
+  /** Decompressed data, allocated to hold the largest frame. */
+  char *buf;
+  /** Compressed data, points into #ZstdReadState.in_buf. */
+  const char *in_buf;
+  size_t in_len;
+  /** Expected size of the decompressed data. */
+  size_t out_len;
+  bool error;
+} ZstdReadFrame;
+
+typedef struct ZstdReadState {
+  /** Offset of each frame (and the end of the last frame) from the seek table. */
+  size_t *compressed_ofs;
+  size_t *uncompressed_ofs;
+  int frames_len;
+  size_t frame_len_max;
+
+  /**
+   * Frames decompressed ahead of reading sequentially,
+   * with one extra frame at the end for other (random access) reads.
+   */
+  ZstdReadFrame *frame_cache;
+  int frame_cache_len;
+  /** The first frame of the last batch decompressed ahead (-1 when unset). */
+  int frame_ahead_first;
+
+  /** Compressed data of the frames being decompressed. */
+  char *in_buf;
+  size_t in_buf_len;
+
+  /** Stream decompression, when there is no seek table. */
+  ZSTD_DStream *stream;
+  ZSTD_inBuffer stream_in;
+} ZstdReadState;
+
+static uint32_t fd_zstd_uint32_unpack(const uchar *src)
+{
+  /* The seekable format is always little endian. */
+  return (uint32_t)src[0] | ((uint32_t)src[1] << 8) | ((uint32_t)src[2] << 16) |
+         ((uint32_t)src[3] << 24);
+}
+
+static bool fd_zstd_read_exact(int file, off64_t offset, void *buf, size_t len)
+{
+  if (BLI_lseek(file, offset, SEEK_SET) == -1) {
+    return false;
+  }
+  char *buf_step = buf;
+  while (len != 0) {
+    const int readsize = read(file, buf_step, (uint)MIN2(len, INT_MAX));
+    if (readsize <= 0) {
+      return false;
+    }
+    buf_step += readsize;
+    len -= (size_t)readsize;
+  }
+  return true;
+}
+
+static void fd_zstd_state_free(ZstdReadState *zstd)
+{
+  if (zstd->frame_cache) {
+    for (int i = 0; i < zstd->frame_cache_len + 1; i++) {
+      MEM_SAFE_FREE(zstd->frame_cache[i].buf);
+    }
+    MEM_freeN(zstd->frame_cache);
+  }
+  MEM_SAFE_FREE(zstd->compressed_ofs);
+  MEM_SAFE_FREE(zstd->uncompressed_ofs);
+  MEM_SAFE_FREE(zstd->in_buf);
+  if (zstd->stream) {
+    ZSTD_freeDStream(zstd->stream);
+  }
+  MEM_freeN(zstd);
+}
+
+/**
+ * Read the seek table from the end of the file.
+ * \return The state for seekable reading or NULL when the file has no (valid) seek table.
+ */
+static ZstdReadState *fd_zstd_state_from_seek_table(int file)
+{
+  uchar footer[SEEKABLE_ZSTD_FOOTER_SIZE];
+  uchar header[8];
+
+  const off64_t file_len = BLI_lseek(file, 0, SEEK_END);
+  if (file_len < (off64_t)(sizeof(header) + sizeof(footer)) ||
+      !fd_zstd_read_exact(file, file_len - (off64_t)sizeof(footer), footer, sizeof(footer))) {
+    return NULL;
+  }
+
+  const uint32_t frames_len = fd_zstd_uint32_unpack(footer);
+  const uchar descriptor = footer[4];
+  if (fd_zstd_uint32_unpack(footer + 5) != SEEKABLE_ZSTD_MAGIC_FOOTER ||
+      /* Reserved bits must be zero. */
+      (descriptor & 0x7C) != 0 || frames_len == 0) {
+    return NULL;
+  }
+
+  /* Entries optionally contain a checksum, which isn't used here. */
+  const size_t entry_len = (descriptor & 0x80) ? 12 : 8;
+  const size_t table_len = (size_t)frames_len * entry_len;
+  const off64_t table_frame_ofs = file_len - (off64_t)(table_len + sizeof(footer) +
+                                                       sizeof(header));
+  if (table_frame_ofs < 0 || !fd_zstd_read_exact(file, table_frame_ofs, header, sizeof(header)) ||
+      fd_zstd_uint32_unpack(header) != SEEKABLE_ZSTD_MAGIC_SKIPPABLE ||
+      fd_zstd_uint32_unpack(header + 4) != table_len + sizeof(footer)) {
+    return NULL;
+  }
+
+  uchar *table = MEM_mallocN(table_len, __func__);
+  if (!fd_zstd_read_exact(file, table_frame_ofs + (off64_t)sizeof(header), table, table_len)) {
+    MEM_freeN(table);
+    return NULL;
+  }
+
+  ZstdReadState *zstd = MEM_callocN(sizeof(*zstd), __func__);
+  zstd->frames_len = (int)frames_len;
+  zstd->compressed_ofs = MEM_mallocN(sizeof(size_t) * (frames_len + 1), __func__);
+  zstd->uncompressed_ofs = MEM_mallocN(sizeof(size_t) * (frames_len + 1), __func__);
+  zstd->compressed_ofs[0] = 0;
+  zstd->uncompressed_ofs[0] = 0;
+  for (uint32_t i = 0; i < frames_len; i++) {
+    const uint32_t compressed_len = fd_zstd_uint32_unpack(&table[i * entry_len]);
+    const uint32_t uncompressed_len = fd_zstd_uint32_unpack(&table[i * entry_len + 4]);
+    zstd->compressed_ofs[i + 1] = zstd->compressed_ofs[i] + compressed_len;
+    zstd->uncompressed_ofs[i + 1] = zstd->uncompressed_ofs[i] + uncompressed_len;
+    zstd->frame_len_max = MAX2(zstd->frame_len_max, uncompressed_len);
+  }
+  MEM_freeN(table);
+
+  /* The frames must end exactly where the seek table starts. */
+  if (zstd->compressed_ofs[frames_len] != (size_t)table_frame_ofs) {
+    fd_zstd_state_free(zstd);
+    return NULL;
+  }
+
+  zstd->frame_cache_len = max_ii(BLI_task_scheduler_num_threads(), 1);
+  zstd->frame_cache = MEM_mallocN(sizeof(*zstd->frame_cache) * (zstd->frame_cache_len + 1),
+                                  __func__);
+  for (int i = 0; i < zstd->frame_cache_len + 1; i++) {
+    zstd->frame_cache[i].frame = -1;
+    zstd->frame_cache[i].buf = MEM_mallocN(zstd->frame_len_max, __func__);
+  }
+  zstd->frame_ahead_first = -1;
+
+  return zstd;
+}
+
+static void fd_zstd_frame_decompress_task(TaskPool *__restrict UNUSED(pool), void *taskdata)
+{
+  ZstdReadFrame *frame = taskdata;
+  const size_t out_len = ZSTD_decompress(frame->buf, frame->out_len, frame->in_buf, frame->in_len);
+  frame->error = ZSTD_isError(out_len) || (out_len != frame->out_len);
+}
+
+/**
+ * Decompress frames `[frame_first, frame_end)` into `frame_cache` (from the cache start).
+ */
+static bool fd_zstd_frames_decompress(FileData *fd,
+                                      ZstdReadFrame *frame_cache,
+                                      int frame_first,
+                                      int frame_end)
+{
+  ZstdReadState *zstd = fd->zstd;
+  const size_t in_ofs = zstd->compressed_ofs[frame_first];
+  const size_t in_len = zstd->compressed_ofs[frame_end] - in_ofs;
+
+  if (in_len > zstd->in_buf_len) {
+    MEM_SAFE_FREE(zstd->in_buf);
+    zstd->in_buf = MEM_mallocN(in_len, __func__);
+    zstd->in_buf_len = in_len;
+  }
+  if (!fd_zstd_read_exact(fd->filedes, (off64_t)in_ofs, zstd->in_buf, in_len)) {
+    return false;
+  }
+
+  const int frames_num = frame_end - frame_first;
+  for (int i = 0; i < frames_num; i++) {
+    const int frame_index = frame_first + i;
+    ZstdReadFrame *frame = &frame_cache[i];
+    frame->frame = frame_index;
+    frame->in_buf = zstd->in_buf + (zstd->compressed_ofs[frame_index] - in_ofs);
+    frame->in_len = zstd->compressed_ofs[frame_index + 1] - zstd->compressed_ofs[frame_index];
+    frame->out_len = zstd->uncompressed_ofs[frame_index + 1] -
+                     zstd->uncompressed_ofs[frame_index];
+    frame->error = false;
+  }
+
+  if (frames_num == 1) {
+    fd_zstd_frame_decompress_task(NULL, &frame_cache[0]);
+  }
+  else {
+    TaskPool *task_pool = BLI_task_pool_create(NULL, TASK_PRIORITY_HIGH);
+    for (int i = 0; i < frames_num; i++) {
+      BLI_task_pool_push(task_pool, fd_zstd_frame_decompress_task, &frame_cache[i], false, NULL);
+    }
+    BLI_task_pool_work_and_wait(task_pool);
+    BLI_task_pool_free(task_pool);
+  }
+
+  bool ok = true;
+  for (int i = 0; i < frames_num; i++) {
+    if (frame_cache[i].error) {
+      frame_cache[i].frame = -1;
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+static const ZstdReadFrame *fd_zstd_frame_ensure(FileData *fd, int frame_index)
+{
+  ZstdReadState *zstd = fd->zstd;
+
+  for (int i = 0; i < zstd->frame_cache_len + 1; i++) {
+    if (zstd->frame_cache[i].frame == frame_index) {
+      return &zstd->frame_cache[i];
+    }
+  }
+
+  if (frame_index > zstd->frame_ahead_first) {
+    /* Reading forward: decompress the frames that follow in parallel too. */
+    const int frame_end = min_ii(frame_index + zstd->frame_cache_len, zstd->frames_len);
+    for (int i = 0; i < zstd->frame_cache_len; i++) {
+      zstd->frame_cache[i].frame = -1;
+    }
+    zstd->frame_ahead_first = frame_index;
+    if (!fd_zstd_frames_decompress(fd, zstd->frame_cache, frame_index, frame_end)) {
+      return NULL;
+    }
+    return &zstd->frame_cache[0];
+  }
+
+  /* Random access (reading data-blocks on demand for e.g.),
+   * use the last slot so the frames ahead are kept. */
+  ZstdReadFrame *frame_random = &zstd->frame_cache[zstd->frame_cache_len];
+  if (!fd_zstd_frames_decompress(fd, frame_random, frame_index, frame_index + 1)) {
+    return NULL;
+  }
+  return frame_random;
+}
+
+static int fd_zstd_frame_find(const ZstdReadState *zstd, size_t offset)
+{
+  /* Binary search for the last frame starting at or before `offset`. */
+  int low = 0, high = zstd->frames_len;
+  while (high - low > 1) {
+    const int mid = (low + high) / 2;
+    if (zstd->uncompressed_ofs[mid] <= offset) {
+      low = mid;
+    }
+    else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+static int fd_read_zstd_from_file(FileData *filedata,
+                                  void *buffer,
+                                  uint size,
+                                  bool *UNUSED(r_is_memchunck_identical))
+{
+  const ZstdReadState *zstd = filedata->zstd;
+  const size_t offset_end = MIN2((size_t)filedata->file_offset + size,
+                                 zstd->uncompressed_ofs[zstd->frames_len]);
+  size_t offset = (size_t)filedata->file_offset;
+  char *buffer_step = buffer;
+
+  while (offset < offset_end) {
+    const int frame_index = fd_zstd_frame_find(zstd, offset);
+    const ZstdReadFrame *frame = fd_zstd_frame_ensure(filedata, frame_index);
+    if (frame == NULL) {
+      return EOF;
+    }
+    const size_t frame_offset = offset - zstd->uncompressed_ofs[frame_index];
+    const size_t copy_len = MIN2(offset_end - offset, frame->out_len - frame_offset);
+    memcpy(buffer_step, frame->buf + frame_offset, copy_len);
+    buffer_step += copy_len;
+    offset += copy_len;
+  }
+
+  const int readsize = (int)(offset - (size_t)filedata->file_offset);
+  filedata->file_offset = (int64_t)offset;
+  return readsize;
+}
+
+static off64_t fd_seek_zstd_from_file(FileData *filedata, off64_t offset, int whence)
+{
+  const ZstdReadState *zstd = filedata->zstd;
+  const off64_t file_len = (off64_t)zstd->uncompressed_ofs[zstd->frames_len];
+  off64_t offset_new;
+
+  switch (whence) {
+    case SEEK_SET:
+      offset_new = offset;
+      break;
+    case SEEK_CUR:
+      offset_new = filedata->file_offset + offset;
+      break;
+    case SEEK_END:
+      offset_new = file_len + offset;
+      break;
+    default:
+      return -1;
+  }
+
+  if (offset_new < 0 || offset_new > file_len) {
+    return -1;
+  }
+  filedata->file_offset = offset_new;
+  return offset_new;
+}
+
+static int fd_read_zstd_stream_from_file(FileData *filedata,
+                                         void *buffer,
+                                         uint size,
+                                         bool *UNUSED(r_is_memchunck_identical))
+{
+  ZstdReadState *zstd = filedata->zstd;
+  ZSTD_outBuffer output = {buffer, size, 0};
+
+  while (output.pos < output.size) {
+    if (zstd->stream_in.pos == zstd->stream_in.size) {
+      const int readsize = read(filedata->filedes, zstd->in_buf, (uint)zstd->in_buf_len);
+      if (readsize < 0) {
+        return EOF;
+      }
+      if (readsize == 0) {
+        break;
+      }
+      zstd->stream_in.src = zstd->in_buf;
+      zstd->stream_in.size = (size_t)readsize;
+      zstd->stream_in.pos = 0;
+    }
+
+    if (ZSTD_isError(ZSTD_decompressStream(zstd->stream, &output, &zstd->stream_in))) {
+      return EOF;
+    }
+  }
+
+  filedata->file_offset += output.pos;
+  return (int)output.pos;
+}
+
+static ZstdReadState *fd_zstd_state_stream_new(void)
+{
+  ZstdReadState *zstd = MEM_callocN(sizeof(*zstd), __func__);
+  zstd->stream = ZSTD_createDStream();
+  ZSTD_initDStream(zstd->stream);
+  zstd->in_buf_len = ZSTD_DStreamInSize();
+  zstd->in_buf = MEM_mallocN(zstd->in_buf_len, __func__);
+  return zstd;
+}
+#endif /* WITH_ZSTD */
+
 /* Memory reading. */
 
 static int fd_read_from_memory(FileData *filedata,
@@ -1328,11 +2239,19 @@ static FileData *filedata_new(void)
   return fd;
 }
 
-static FileData *blo_decode_and_check(FileData *fd, ReportList *reports)
+/**
+ * \param use_id_index: Only read the blocks that are needed (for linking),
+ * when the file contains an ID index.
+ */
+static FileData *blo_decode_and_check(FileData *fd, const bool use_id_index, ReportList *reports)
 {
   decode_blender_header(fd);
 
   if (fd->flags & FD_FLAGS_FILE_OK) {
+    if (use_id_index) {
+      fd->id_index = id_index_read(fd);
+    }
+
     const char *error_message = NULL;
     if (read_file_dna(fd, &error_message) == false) {
       BKE_reportf(
@@ -1359,8 +2278,11 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
   FileDataSeekFn *seek_fn = NULL; /* Optional. */
 
   gzFile gzfile = (gzFile)Z_NULL;
+  struct ZstdReadState *zstd = NULL;
+  BLI_mmap_file *mmap_file = NULL;
 
-  char header[7];
+  /* Unsigned, so the magic bytes of compressed files can be compared. */
+  uchar header[7];
 
   /* Regular file. */
   errno = 0;
@@ -1377,8 +2299,15 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
 
   /* Regular file. */
   if (memcmp(header, "BLENDER", sizeof(header)) == 0) {
-    read_fn = fd_read_data_from_file;
-    seek_fn = fd_seek_data_from_file;
+    mmap_file = BLI_mmap_open(file);
+    if (mmap_file != NULL) {
+      read_fn = fd_read_from_mmap;
+      seek_fn = fd_seek_from_mmap;
+    }
+    else {
+      read_fn = fd_read_data_from_file;
+      seek_fn = fd_seek_data_from_file;
+    }
   }
 
   /* Gzip file. */
@@ -1402,6 +2331,31 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
     file = -1;
   }
 
+  /* Zstd file. */
+  if ((read_fn == NULL) &&
+      /* Check header magic (little endian). */
+      (header[0] == 0x28 && header[1] == 0xb5 && header[2] == 0x2f && header[3] == 0xfd)) {
+#ifdef WITH_ZSTD
+    zstd = fd_zstd_state_from_seek_table(file);
+    if (zstd != NULL) {
+      read_fn = fd_read_zstd_from_file;
+      seek_fn = fd_seek_zstd_from_file;
+    }
+    else {
+      /* Not written by Blender, decompress as a stream. */
+      zstd = fd_zstd_state_stream_new();
+      read_fn = fd_read_zstd_stream_from_file;
+    }
+    BLI_lseek(file, 0, SEEK_SET);
+#else
+    BKE_reportf(reports,
+                RPT_WARNING,
+                "Unable to read '%s': Zstd compression is not supported by this build",
+                filepath);
+    return NULL;
+#endif
+  }
+
   if (read_fn == NULL) {
     BKE_reportf(reports, RPT_WARNING, "Unrecognized file format '%s'", filepath);
     return NULL;
@@ -1411,6 +2365,8 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
 
   fd->filedes = file;
   fd->gzfiledes = gzfile;
+  fd->zstd = zstd;
+  fd->mmap_file = mmap_file;
 
   fd->read = read_fn;
   fd->seek = seek_fn;
@@ -1446,7 +2402,26 @@ FileData *blo_filedata_from_file(const char *filepath, ReportList *reports)
     /* needed for library_append and read_libraries */
     BLI_strncpy(fd->relabase, filepath, sizeof(fd->relabase));
 
-    return blo_decode_and_check(fd, reports);
+    return blo_decode_and_check(fd, false, reports);
+  }
+  return NULL;
+}
+
+/**
+ * Same as #blo_filedata_from_file, but only reads the blocks needed for linking,
+ * for files containing an ID index (see #BlendIDIndexHeader).
+ *
+ * \note Functions that loop over all blocks (such as listing the data-blocks in the file)
+ * only see the blocks that have been read, only use this for linking.
+ */
+FileData *blo_filedata_from_file_for_link(const char *filepath, ReportList *reports)
+{
+  FileData *fd = blo_filedata_from_file_open(filepath, reports);
+  if (fd != NULL) {
+    /* needed for library_append and read_libraries */
+    BLI_strncpy(fd->relabase, filepath, sizeof(fd->relabase));
+
+    return blo_decode_and_check(fd, true, reports);
   }
   return NULL;
 }
@@ -1538,7 +2513,7 @@ FileData *blo_filedata_from_memory(const void *mem, int memsize, ReportList *rep
 
   fd->flags |= FD_FLAGS_NOT_MY_BUFFER;
 
-  return blo_decode_and_check(fd, reports);
+  return blo_decode_and_check(fd, false, reports);
 }
 
 FileData *blo_filedata_from_memfile(MemFile *memfile,
@@ -1550,6 +2525,9 @@ FileData *blo_filedata_from_memfile(MemFile *memfile,
     return NULL;
   }
 
+  /* Chunks of undo steps which weren't used recently may be compressed. */
+  BLO_memfile_uncompress(memfile);
+
   FileData *fd = filedata_new();
   fd->memfile = memfile;
   fd->undo_direction = params->undo_direction;
@@ -1557,7 +2535,7 @@ FileData *blo_filedata_from_memfile(MemFile *memfile,
   fd->read = fd_read_from_memfile;
   fd->flags |= FD_FLAGS_NOT_MY_BUFFER;
 
-  return blo_decode_and_check(fd, reports);
+  return blo_decode_and_check(fd, false, reports);
 }
 
 void blo_filedata_free(FileData *fd)
@@ -1571,6 +2549,19 @@ void blo_filedata_free(FileData *fd)
       gzclose(fd->gzfiledes);
     }
 
+#ifdef WITH_ZSTD
+    if (fd->zstd != NULL) {
+      fd_zstd_state_free(fd->zstd);
+    }
+#endif
+
+    MEM_SAFE_FREE(fd->stream_data);
+
+    if (fd->mmap_file != NULL) {
+      BLI_mmap_free(fd->mmap_file);
+    }
+    MEM_SAFE_FREE(fd->mmap_bheads);
+
     if (fd->strm.next_in) {
       if (inflateEnd(&fd->strm) != Z_OK) {
         printf("close gzip stream error\n");
@@ -1628,12 +2619,228 @@ void blo_filedata_free(FileData *fd)
     }
 #endif
 
+    if (fd->id_index != NULL) {
+      id_index_free(fd->id_index);
+    }
+
     MEM_freeN(fd);
   }
 }
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name Streaming BHead Access
+ *
+ * Visits the blocks of a file in order, one at a time, without building the list of
+ * #BHeadN's. The data of a block is only read when it's requested (and only as much of it as
+ * requested), otherwise it's skipped (seeking over it when possible).
+ *
+ * Memory mapped files are accessed directly, other files use a single buffer for the data
+ * of the current block.
+ * \{ */
+
+static bool bhead_stream_data_read(FileData *fd, const int len)
+{
+  BLI_assert(len <= fd->stream_bhead->len);
+  if (fd->stream_data_len >= len) {
+    return true;
+  }
+
+  if ((size_t)len > fd->stream_data_alloc) {
+    fd->stream_data_alloc = MAX2((size_t)len, fd->stream_data_alloc * 2);
+    fd->stream_data = MEM_reallocN(fd->stream_data, fd->stream_data_alloc);
+  }
+
+  const int read_len = len - fd->stream_data_len;
+  if (fd->read(fd, POINTER_OFFSET(fd->stream_data, fd->stream_data_len), read_len, NULL) !=
+      read_len) {
+    fd->is_eof = true;
+    return false;
+  }
+  fd->stream_data_len = len;
+  return true;
+}
+
+static void bhead_stream_data_skip(FileData *fd)
+{
+  const int skip_len = fd->stream_bhead->len - fd->stream_data_len;
+  if (skip_len == 0) {
+    return;
+  }
+  if (fd->seek != NULL) {
+    if (fd->seek(fd, skip_len, SEEK_CUR) == -1) {
+      fd->is_eof = true;
+    }
+  }
+  else {
+    /* Compressed streams can only be read in order. */
+    bhead_stream_data_read(fd, fd->stream_bhead->len);
+  }
+}
+
+/**
+ * \return The next block of the file (the first one on the first call),
+ * NULL after the #ENDB block or when the file ends.
+ * The block is valid until the next call.
+ */
+BHead *blo_bhead_stream_next(FileData *fd)
+{
+  if (fd->is_eof || (fd->stream_bhead && fd->stream_bhead->code == ENDB)) {
+    return NULL;
+  }
+
+  if (fd->flags & FD_FLAGS_BHEAD_FROM_MMAP) {
+    fd->stream_bhead = (fd->stream_bhead == NULL) ?
+                           bhead_from_mmap(fd, SIZEOFBLENDERHEADER) :
+                           bhead_next_from_mmap(fd, fd->stream_bhead);
+    return fd->stream_bhead;
+  }
+
+  if (fd->stream_bhead != NULL) {
+    bhead_stream_data_skip(fd);
+    if (fd->is_eof) {
+      return NULL;
+    }
+  }
+
+  BHead bhead = {0};
+  bhead_read_header(fd, &bhead);
+  if (fd->is_eof) {
+    fd->stream_bhead = NULL;
+    return NULL;
+  }
+
+  fd->stream_bhead_buf = bhead;
+  fd->stream_bhead = &fd->stream_bhead_buf;
+  fd->stream_data_len = 0;
+  return fd->stream_bhead;
+}
+
+/**
+ * \return The data of the current block, at least \a len bytes of it (clamped to the
+ * length of the block), or NULL on failure. The data is valid until the next call.
+ */
+const void *blo_bhead_stream_data(FileData *fd, int len)
+{
+  BHead *bhead = fd->stream_bhead;
+  if (bhead == NULL) {
+    return NULL;
+  }
+  if (fd->flags & FD_FLAGS_BHEAD_FROM_MMAP) {
+    return &bhead[1];
+  }
+  CLAMP_MAX(len, bhead->len);
+  if (!bhead_stream_data_read(fd, len)) {
+    return NULL;
+  }
+  return fd->stream_data;
+}
+
+static void bhead_stream_rewind(FileData *fd)
+{
+  fd->stream_bhead = NULL;
+  fd->stream_data_len = 0;
+  fd->is_eof = false;
+}
+
+/**
+ * Read the DNA without keeping any blocks in memory, see #read_file_dna.
+ */
+static bool read_file_dna_stream(FileData *fd, const char **r_error_message)
+{
+  int subversion = 0;
+
+  for (BHead *bhead = blo_bhead_stream_next(fd); bhead; bhead = blo_bhead_stream_next(fd)) {
+    if (bhead->code == GLOB) {
+      if (fd->fileversion <= 242) {
+        continue;
+      }
+      const FileGlobal *fg = blo_bhead_stream_data(fd, sizeof(fg->subvstr));
+      if (fg != NULL) {
+        subversion = read_file_subversion(fg);
+      }
+    }
+    else if (bhead->code == DNA1) {
+      const void *data = blo_bhead_stream_data(fd, bhead->len);
+      if (data == NULL) {
+        break;
+      }
+      return read_file_dna_decode(fd, data, bhead->len, subversion, r_error_message);
+    }
+  }
+
+  *r_error_message = "Missing DNA block";
+  return false;
+}
+
+/**
+ * Open a file for streaming access to its blocks, see #blo_bhead_stream_next.
+ *
+ * \note The DNA is stored at the end of files, compressed files that can't seek
+ * are decompressed twice.
+ */
+FileData *blo_filedata_from_file_for_stream(const char *filepath, ReportList *reports)
+{
+  FileData *fd = blo_filedata_from_file_open(filepath, reports);
+  if (fd == NULL) {
+    return NULL;
+  }
+  BLI_strncpy(fd->relabase, filepath, sizeof(fd->relabase));
+
+  decode_blender_header(fd);
+  if ((fd->flags & FD_FLAGS_FILE_OK) == 0) {
+    BKE_reportf(reports, RPT_ERROR, "Failed to read blend file '%s', not a blend file", filepath);
+    blo_filedata_free(fd);
+    return NULL;
+  }
+
+  const char *error_message = NULL;
+  bool success;
+  if (fd->flags & FD_FLAGS_BHEAD_FROM_MMAP) {
+    success = read_file_dna(fd, &error_message);
+  }
+  else {
+    success = read_file_dna_stream(fd, &error_message);
+  }
+  if (!success) {
+    BKE_reportf(
+        reports, RPT_ERROR, "Failed to read blend file '%s': %s", filepath, error_message);
+    blo_filedata_free(fd);
+    return NULL;
+  }
+
+  /* Go back to the first block. */
+  if ((fd->flags & FD_FLAGS_BHEAD_FROM_MMAP) == 0) {
+    if (fd->seek != NULL) {
+      if (fd->seek(fd, SIZEOFBLENDERHEADER, SEEK_SET) == -1) {
+        fd->is_eof = true;
+      }
+    }
+    else {
+      /* Re-open the file, keeping the DNA. */
+      FileData *fd_reopen = blo_filedata_from_file_open(filepath, reports);
+      if (fd_reopen != NULL) {
+        decode_blender_header(fd_reopen);
+        SWAP(SDNA *, fd->filesdna, fd_reopen->filesdna);
+        SWAP(const char *, fd->compflags, fd_reopen->compflags);
+        fd_reopen->id_name_offs = fd->id_name_offs;
+        BLI_strncpy(fd_reopen->relabase, filepath, sizeof(fd_reopen->relabase));
+      }
+      blo_filedata_free(fd);
+      fd = fd_reopen;
+      if (fd == NULL) {
+        return NULL;
+      }
+    }
+  }
+  bhead_stream_rewind(fd);
+
+  return fd;
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name Public Utilities
  * \{ */
@@ -2138,6 +3345,16 @@ static void *read_struct(FileData *fd, BHead *bh, const char *blockname)
 {
   void *temp = NULL;
 
+#ifdef USE_PARALLEL_STRUCT_READ
+  if (fd->bhead_preread_map != NULL) {
+    /* Pop, since each block is read once, the remaining items are freed afterwards. */
+    temp = BLI_ghash_popkey(fd->bhead_preread_map, bh, NULL);
+    if (temp != NULL) {
+      return temp;
+    }
+  }
+#endif
+
   if (bh->len) {
 #ifdef USE_BHEAD_READ_ON_DEMAND
     BHead *bh_orig = bh;
@@ -2146,7 +3363,7 @@ static void *read_struct(FileData *fd, BHead *bh, const char *blockname)
     /* switch is based on file dna */
     if (bh->SDNAnr && (fd->flags & FD_FLAGS_SWITCH_ENDIAN)) {
 #ifdef USE_BHEAD_READ_ON_DEMAND
-      if (BHEADN_FROM_BHEAD(bh)->has_data == false) {
+      if (blo_bhead_has_data(fd, bh) == false) {
         bh = blo_bhead_read_full(fd, bh);
         if (UNLIKELY(bh == NULL)) {
           fd->flags &= ~FD_FLAGS_FILE_OK;
@@ -2160,7 +3377,7 @@ static void *read_struct(FileData *fd, BHead *bh, const char *blockname)
     if (fd->compflags[bh->SDNAnr] != SDNA_CMP_REMOVED) {
       if (fd->compflags[bh->SDNAnr] == SDNA_CMP_NOT_EQUAL) {
 #ifdef USE_BHEAD_READ_ON_DEMAND
-        if (BHEADN_FROM_BHEAD(bh)->has_data == false) {
+        if (blo_bhead_has_data(fd, bh) == false) {
           bh = blo_bhead_read_full(fd, bh);
           if (UNLIKELY(bh == NULL)) {
             fd->flags &= ~FD_FLAGS_FILE_OK;
@@ -2175,7 +3392,7 @@ static void *read_struct(FileData *fd, BHead *bh, const char *blockname)
         /* SDNA_CMP_EQUAL */
         temp = MEM_mallocN(bh->len, blockname);
 #ifdef USE_BHEAD_READ_ON_DEMAND
-        if (BHEADN_FROM_BHEAD(bh)->has_data) {
+        if (blo_bhead_has_data(fd, bh)) {
           memcpy(temp, (bh + 1), bh->len);
         }
         else {
@@ -2198,6 +3415,13 @@ static void *read_struct(FileData *fd, BHead *bh, const char *blockname)
       MEM_freeN(BHEADN_FROM_BHEAD(bh));
     }
 #endif
+
+    /* The flags aren't changed here, this runs in parallel for #USE_PARALLEL_STRUCT_READ.
+     * Loading fails after the blocks have been read, see #blo_read_file_internal. */
+    if (temp && UNLIKELY(bhead_mmap_has_io_error(fd))) {
+      MEM_freeN(temp);
+      temp = NULL;
+    }
   }
 
   return temp;
@@ -8410,6 +9634,16 @@ static BHead *read_data_into_datamap(FileData *fd, BHead *bhead, const char *all
   return bhead;
 }
 
+/* Size of the ID block and the data following it, up to (not including) \a bhead_end. */
+static size_t read_libblock_len(FileData *fd, BHead *bhead, const BHead *bhead_end)
+{
+  size_t len = 0;
+  for (; bhead && bhead != bhead_end; bhead = blo_bhead_next(fd, bhead)) {
+    len += (size_t)bhead->len;
+  }
+  return len;
+}
+
 /* Verify if the datablock and all associated data is identical. */
 static bool read_libblock_is_identical(FileData *fd, BHead *bhead)
 {
@@ -8674,6 +9908,9 @@ static BHead *read_libblock(FileData *fd,
     }
   }
 
+  const double time_start = blo_read_profile_time(fd);
+  BHead *bhead_id = bhead;
+
   /* Read libblock struct. */
   ID *id = read_struct(fd, bhead, "lib block");
   if (id == NULL) {
@@ -8738,6 +9975,10 @@ static BHead *read_libblock(FileData *fd,
   const bool success = direct_link_id(fd, main, id_tag, id, id_old);
   oldnewmap_clear(fd->datamap);
 
+  if (fd->profile != NULL) {
+    blo_read_profile_id_read_add(fd, id, read_libblock_len(fd, bhead_id, bhead), time_start);
+  }
+
   if (!success) {
     /* XXX This is probably working OK currently given the very limited scope of that flag.
      * However, it is absolutely **not** handled correctly: it is freeing an ID pointer that has
@@ -8865,6 +10106,58 @@ static void do_versions_userdef(FileData *fd, BlendFileData *bfd)
   }
 }
 
+/**
+ * Versioning passes, in the order they run.
+ *
+ * Passes that only contain code for older files (all guarded by version checks) store the
+ * version from which on they don't change anything, so they're skipped for newer files.
+ * This means files at the current version don't go over all the checks of legacy versioning.
+ *
+ * \note Passes that are still being worked on, or that have code which isn't guarded by
+ * version checks, must use a zero version so they always run.
+ */
+typedef struct DoVersionsPass {
+  const char *name;
+  void (*exec)(FileData *fd, Library *lib, Main *bmain);
+  short versionfile_skip, subversionfile_skip;
+} DoVersionsPass;
+
+static const DoVersionsPass do_versions_passes[] = {
+    {"do_versions_pre250", blo_do_versions_pre250, 249, 0},
+    {"do_versions_250", blo_do_versions_250, 259, 4},
+    {"do_versions_260", blo_do_versions_260, 269, 11},
+    {"do_versions_270", blo_do_versions_270, 279, 4},
+    /* Has un-versioned code, see "Keep un-versioned until we're finished adding space types". */
+    {"do_versions_280", blo_do_versions_280, 0, 0},
+    {"do_versions_290", blo_do_versions_290, 0, 0},
+    {"do_versions_cycles", blo_do_versions_cycles, 0, 0},
+};
+
+typedef struct DoVersionsAfterLinkingPass {
+  const char *name;
+  /* Only one of these is set. */
+  void (*exec)(Main *bmain);
+  void (*exec_reports)(Main *bmain, ReportList *reports);
+  short versionfile_skip, subversionfile_skip;
+} DoVersionsAfterLinkingPass;
+
+static const DoVersionsAfterLinkingPass do_versions_after_linking_passes[] = {
+    {"do_versions_after_linking_250", do_versions_after_linking_250, NULL, 258, 0},
+    {"do_versions_after_linking_260", do_versions_after_linking_260, NULL, 280, 60},
+    {"do_versions_after_linking_270", do_versions_after_linking_270, NULL, 279, 2},
+    {"do_versions_after_linking_280", NULL, do_versions_after_linking_280, 0, 0},
+    {"do_versions_after_linking_290", NULL, do_versions_after_linking_290, 0, 0},
+    {"do_versions_after_linking_cycles", do_versions_after_linking_cycles, NULL, 0, 0},
+};
+
+static bool do_versions_pass_skip(const Main *main,
+                                  const short versionfile_skip,
+                                  const short subversionfile_skip)
+{
+  return (versionfile_skip != 0) &&
+         MAIN_VERSION_ATLEAST(main, versionfile_skip, subversionfile_skip);
+}
+
 static void do_versions(FileData *fd, Library *lib, Main *main)
 {
   /* WATCH IT!!!: pointers from libdata have not been converted */
@@ -8891,13 +10184,15 @@ static void do_versions(FileData *fd, Library *lib, Main *main)
            main->build_hash);
   }
 
-  blo_do_versions_pre250(fd, lib, main);
-  blo_do_versions_250(fd, lib, main);
-  blo_do_versions_260(fd, lib, main);
-  blo_do_versions_270(fd, lib, main);
-  blo_do_versions_280(fd, lib, main);
-  blo_do_versions_290(fd, lib, main);
-  blo_do_versions_cycles(fd, lib, main);
+  for (int i = 0; i < ARRAY_SIZE(do_versions_passes); i++) {
+    const DoVersionsPass *pass = &do_versions_passes[i];
+    if (do_versions_pass_skip(main, pass->versionfile_skip, pass->subversionfile_skip)) {
+      continue;
+    }
+    const double time_start = blo_read_profile_time(fd);
+    pass->exec(fd, lib, main);
+    blo_read_profile_pass_add(fd, pass->name, time_start);
+  }
 
   /* WATCH IT!!!: pointers from libdata have not been converted yet here! */
   /* WATCH IT 2!: Userdef struct init see do_versions_userdef() above! */
@@ -8907,7 +10202,7 @@ static void do_versions(FileData *fd, Library *lib, Main *main)
   main->is_locked_for_linking = false;
 }
 
-static void do_versions_after_linking(Main *main, ReportList *reports)
+static void do_versions_after_linking(FileData *fd, Main *main)
 {
   //  printf("%s for %s (%s), %d.%d\n", __func__, main->curlib ? main->curlib->filepath :
   //         main->name, main->curlib ? "LIB" : "MAIN", main->versionfile, main->subversionfile);
@@ -8915,12 +10210,20 @@ static void do_versions_after_linking(Main *main, ReportList *reports)
   /* Don't allow versioning to create new data-blocks. */
   main->is_locked_for_linking = true;
 
-  do_versions_after_linking_250(main);
-  do_versions_after_linking_260(main);
-  do_versions_after_linking_270(main);
-  do_versions_after_linking_280(main, reports);
-  do_versions_after_linking_290(main, reports);
-  do_versions_after_linking_cycles(main);
+  for (int i = 0; i < ARRAY_SIZE(do_versions_after_linking_passes); i++) {
+    const DoVersionsAfterLinkingPass *pass = &do_versions_after_linking_passes[i];
+    if (do_versions_pass_skip(main, pass->versionfile_skip, pass->subversionfile_skip)) {
+      continue;
+    }
+    const double time_start = blo_read_profile_time(fd);
+    if (pass->exec_reports != NULL) {
+      pass->exec_reports(main, fd->reports);
+    }
+    else {
+      pass->exec(main);
+    }
+    blo_read_profile_pass_add(fd, pass->name, time_start);
+  }
 
   main->is_locked_for_linking = false;
 }
@@ -8957,6 +10260,8 @@ static void lib_link_all(FileData *fd, Main *bmain)
       continue;
     }
 
+    const double time_start = blo_read_profile_time(fd);
+
     lib_link_id(&reader, id);
 
     /* Note: ID types are processed in reverse order as defined by INDEX_ID_XXX enums in DNA_ID.h.
@@ -9092,6 +10397,8 @@ static void lib_link_all(FileData *fd, Main *bmain)
     }
 
     id->tag &= ~LIB_TAG_NEED_LINK;
+
+    blo_read_profile_id_lib_link_add(fd, id, time_start);
   }
   FOREACH_MAIN_ID_END;
 
@@ -9218,6 +10525,185 @@ static BHead *read_userdef(BlendFileData *bfd, FileData *fd, BHead *bhead)
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name Parallel Struct Reading
+ *
+ * Converting the file data to the current DNA (#DNA_struct_reconstruct) is the most expensive
+ * part of reading files with many data-blocks. This only depends on the block itself,
+ * so it's done up-front for all blocks in parallel, storing the results in
+ * #FileData.bhead_preread_map.
+ *
+ * The regular (single threaded) reading pass then takes these results in file order
+ * from #read_struct, so pointer relinking and the order data-blocks are added to #Main
+ * is exactly the same as for serial reading.
+ * \{ */
+
+#ifdef USE_PARALLEL_STRUCT_READ
+
+/** Limit the memory used by blocks read from the file (not the reconstructed structs). */
+#  define PREREAD_BATCH_SIZE_MAX (64 * 1024 * 1024)
+
+typedef struct PrereadStruct {
+  /** Block as it's used by the main reading loop, the key for #FileData.bhead_preread_map. */
+  BHead *bhead;
+  /** Block including its data, may be a temporary copy of #PrereadStruct.bhead. */
+  BHead *bhead_data;
+  const char *allocname;
+  void *data;
+} PrereadStruct;
+
+typedef struct PrereadStructData {
+  FileData *fd;
+  PrereadStruct *items;
+} PrereadStructData;
+
+static void read_file_preread_struct_fn(void *__restrict userdata,
+                                        const int index,
+                                        const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  PrereadStructData *data = userdata;
+  PrereadStruct *item = &data->items[index];
+  /* Thread safe since the data is available in memory, so no reading from the file is done. */
+  item->data = read_struct(data->fd, item->bhead_data, item->allocname);
+}
+
+static void read_file_preread_batch(FileData *fd, PrereadStruct *items, const int items_len)
+{
+  PrereadStructData data = {
+      .fd = fd,
+      .items = items,
+  };
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 8;
+  BLI_task_parallel_range(0, items_len, &data, read_file_preread_struct_fn, &settings);
+
+  for (int i = 0; i < items_len; i++) {
+    PrereadStruct *item = &items[i];
+    if (item->data != NULL) {
+      BLI_ghash_insert(fd->bhead_preread_map, item->bhead, item->data);
+    }
+#  ifdef USE_BHEAD_READ_ON_DEMAND
+    if (item->bhead_data != item->bhead) {
+      MEM_freeN(BHEADN_FROM_BHEAD(item->bhead_data));
+    }
+#  endif
+  }
+}
+
+/**
+ * Read the structs of all data-blocks that the main reading loop in
+ * #blo_read_file_internal passes to #read_libblock.
+ *
+ * Blocks that end up not being used (unknown ID types for example) remain in the map
+ * and are freed by #read_file_preread_structs_end.
+ */
+static void read_file_preread_structs(FileData *fd)
+{
+  if (BLI_task_scheduler_num_threads() <= 1) {
+    return;
+  }
+
+  const bool is_eof = fd->is_eof;
+
+  fd->bhead_preread_map = BLI_ghash_ptr_new(__func__);
+
+  int items_alloc = 1024;
+  int items_len = 0;
+  size_t batch_size = 0;
+  PrereadStruct *items = MEM_mallocN(sizeof(*items) * items_alloc, __func__);
+
+  /* Allocation name for the data of the last ID, NULL when its data isn't read. */
+  const char *allocname = NULL;
+
+  for (BHead *bhead = blo_bhead_first(fd); bhead && bhead->code != ENDB;
+       bhead = blo_bhead_next(fd, bhead)) {
+    const char *item_allocname;
+    switch (bhead->code) {
+      case DATA:
+        item_allocname = allocname;
+        break;
+      case DNA1:
+      case TEST:
+      case REND:
+      case GLOB:
+      case USER:
+        /* Not read by #read_libblock, neither is the data following these blocks. */
+        allocname = item_allocname = NULL;
+        break;
+      case ID_LINK_PLACEHOLDER:
+        item_allocname = "lib block";
+        allocname = NULL;
+        break;
+      default:
+        item_allocname = "lib block";
+        allocname = dataname((bhead->code == ID_SCRN) ? ID_SCR : bhead->code);
+        break;
+    }
+
+    if (item_allocname == NULL || bhead->len == 0) {
+      continue;
+    }
+
+    BHead *bhead_data = bhead;
+#  ifdef USE_BHEAD_READ_ON_DEMAND
+    if (blo_bhead_has_data(fd, bhead) == false) {
+      /* Reading from the file can't be done from multiple threads. */
+      bhead_data = blo_bhead_read_full(fd, bhead);
+      if (UNLIKELY(bhead_data == NULL)) {
+        /* Let the main reading loop handle the error. */
+        continue;
+      }
+    }
+#  endif
+
+    if (items_len == items_alloc) {
+      items_alloc *= 2;
+      items = MEM_reallocN(items, sizeof(*items) * items_alloc);
+    }
+    items[items_len++] = (PrereadStruct){
+        .bhead = bhead,
+        .bhead_data = bhead_data,
+        .allocname = item_allocname,
+        .data = NULL,
+    };
+
+    batch_size += (size_t)bhead->len;
+    blo_read_profile_bytes_add(fd, (size_t)bhead->len);
+    if (batch_size >= PREREAD_BATCH_SIZE_MAX) {
+      read_file_preread_batch(fd, items, items_len);
+      items_len = 0;
+      batch_size = 0;
+    }
+  }
+
+  if (items_len != 0) {
+    read_file_preread_batch(fd, items, items_len);
+  }
+  MEM_freeN(items);
+
+  /* A truncated file (without #ENDB) sets this, when reading from a memory mapping this
+   * prevents accessing any blocks, while the main loop still needs to read them. */
+  if (fd->flags & FD_FLAGS_BHEAD_FROM_MMAP) {
+    fd->is_eof = is_eof;
+  }
+}
+
+static void read_file_preread_structs_end(FileData *fd)
+{
+  if (fd->bhead_preread_map != NULL) {
+    BLI_ghash_free(fd->bhead_preread_map, NULL, MEM_freeN);
+    fd->bhead_preread_map = NULL;
+  }
+}
+
+#  undef PREREAD_BATCH_SIZE_MAX
+
+#endif /* USE_PARALLEL_STRUCT_READ */
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name Read File (Internal)
  * \{ */
@@ -9267,6 +10753,16 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
     }
   }
 
+#ifdef USE_PARALLEL_STRUCT_READ
+  /* Undo reads from memory and restores unchanged data-blocks, gains are too small there. */
+  if (fd->memfile == NULL && (fd->skip_flags & BLO_READ_SKIP_DATA) == 0) {
+    blo_read_profile_phase_begin(fd, BLO_READ_PHASE_RECONSTRUCT);
+    read_file_preread_structs(fd);
+  }
+#endif
+
+  blo_read_profile_phase_begin(fd, BLO_READ_PHASE_READ);
+
   while (bhead) {
     switch (bhead->code) {
       case DATA:
@@ -9318,8 +10814,31 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
     }
   }
 
+#ifdef USE_PARALLEL_STRUCT_READ
+  read_file_preread_structs_end(fd);
+#endif
+
+  if (UNLIKELY(bhead_mmap_has_io_error(fd))) {
+    /* Blocks that failed to read are missing, don't continue with incomplete data. */
+    BKE_reportf(fd->reports,
+                RPT_ERROR,
+                "Failed to read blend file '%s': %s",
+                filepath,
+                TIP_("unknown error reading file"));
+    if (mainlist.first != NULL) {
+      blo_join_main(&mainlist);
+    }
+    BKE_main_free(bfd->main);
+    MEM_freeN(bfd);
+    blo_read_profile_phase_end(fd);
+    fd->mainlist = NULL;
+    return NULL;
+  }
+
   /* do before read_libraries, but skip undo case */
   if (fd->memfile == NULL) {
+    blo_read_profile_phase_begin(fd, BLO_READ_PHASE_VERSIONING);
+
     if ((fd->skip_flags & BLO_READ_SKIP_DATA) == 0) {
       do_versions(fd, NULL, bfd->main);
     }
@@ -9330,14 +10849,20 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
   }
 
   if ((fd->skip_flags & BLO_READ_SKIP_DATA) == 0) {
+    blo_read_profile_phase_begin(fd, BLO_READ_PHASE_LIBRARIES);
+
     read_libraries(fd, &mainlist);
 
     blo_join_main(&mainlist);
 
+    blo_read_profile_phase_begin(fd, BLO_READ_PHASE_LIB_LINK);
+
     lib_link_all(fd, bfd->main);
 
     /* Skip in undo case. */
     if (fd->memfile == NULL) {
+      blo_read_profile_phase_begin(fd, BLO_READ_PHASE_VERSIONING_AFTER_LINKING);
+
       /* Note that we can't recompute user-counts at this point in undo case, we play too much with
        * IDs from different memory realms, and Main database is not in a fully valid state yet.
        */
@@ -9351,7 +10876,7 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
       blo_split_main(&mainlist, bfd->main);
       LISTBASE_FOREACH (Main *, mainvar, &mainlist) {
         BLI_assert(mainvar->versionfile != 0);
-        do_versions_after_linking(mainvar, fd->reports);
+        do_versions_after_linking(fd, mainvar);
       }
       blo_join_main(&mainlist);
 
@@ -9364,6 +10889,8 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
       ntreeUpdateAllNew(bfd->main);
     }
 
+    blo_read_profile_phase_begin(fd, BLO_READ_PHASE_FINALIZE);
+
     placeholders_ensure_valid(bfd->main);
 
     BKE_main_id_tag_all(bfd->main, LIB_TAG_NEW, false);
@@ -9383,6 +10910,8 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
     link_global(fd, bfd); /* as last */
   }
 
+  blo_read_profile_phase_end(fd);
+
   fd->mainlist = NULL; /* Safety, this is local variable, shall not be used afterward. */
 
   return bfd;
@@ -9477,6 +11006,10 @@ static BHead *find_bhead(FileData *fd, void *old)
     return bhs->bhead;
   }
 
+  if ((fd->id_index != NULL) && id_index_ensure_from_old(fd, old)) {
+    return find_bhead(fd, old);
+  }
+
 #if 0
   for (bhead = blo_bhead_first(fd); bhead; bhead = blo_bhead_next(fd, bhead)) {
     if (bhead->old == old) {
@@ -9497,6 +11030,10 @@ static BHead *find_bhead_from_code_name(FileData *fd, const short idcode, const
   *((short *)idname_full) = idcode;
   BLI_strncpy(idname_full + 2, name, sizeof(idname_full) - 2);
 
+  if (fd->id_index != NULL) {
+    id_index_ensure_from_idname(fd, idname_full);
+  }
+
   return BLI_ghash_lookup(fd->bhead_idname_hash, idname_full);
 
 #else
@@ -9521,6 +11058,9 @@ static BHead *find_bhead_from_code_name(FileData *fd, const short idcode, const
 static BHead *find_bhead_from_idname(FileData *fd, const char *idname)
 {
 #ifdef USE_GHASH_BHEAD
+  if (fd->id_index != NULL) {
+    id_index_ensure_from_idname(fd, idname);
+  }
   return BLI_ghash_lookup(fd->bhead_idname_hash, idname);
 #else
   return find_bhead_from_code_name(fd, GS(idname), idname + 2);
@@ -10944,7 +12484,7 @@ static void library_link_end(Main *mainl,
      * or they will go again through do_versions - bad, very bad! */
     split_main_newid(mainvar, main_newid);
 
-    do_versions_after_linking(main_newid, (*fd)->reports);
+    do_versions_after_linking(*fd, main_newid);
 
     add_main_to_main(mainvar, main_newid);
   }
@@ -11201,7 +12741,7 @@ static FileData *read_library_file_data(FileData *basefd,
                      mainptr->curlib->filepath_abs,
                      mainptr->curlib->filepath,
                      library_parent_filepath(mainptr->curlib));
-    fd = blo_filedata_from_file(mainptr->curlib->filepath_abs, basefd->reports);
+    fd = blo_filedata_from_file_for_link(mainptr->curlib->filepath_abs, basefd->reports);
   }
 
   if (fd) {
@@ -11212,6 +12752,8 @@ static FileData *read_library_file_data(FileData *basefd,
     fd->mainlist = mainlist;
 
     fd->reports = basefd->reports;
+    fd->profile = basefd->profile;
+    blo_read_profile_library_add(fd);
 
     if (fd->libmap) {
       oldnewmap_free(fd->libmap);
@@ -11286,7 +12828,9 @@ static void read_libraries(FileData *basefd, ListBase *mainlist)
 
         /* Test if linked data-locks need to read further linked data-locks
          * and create link placeholders for them. */
+        const double time_start = blo_read_profile_time(basefd);
         BLO_expand_main(fd, mainptr);
+        blo_read_profile_pass_add(basefd, "expand_main", time_start);
       }
     }
   }
@@ -11327,6 +12871,13 @@ static void read_libraries(FileData *basefd, ListBase *mainlist)
 
     /* Free file data we no longer need. */
     if (mainptr->curlib->filedata) {
+      if (UNLIKELY(bhead_mmap_has_io_error(mainptr->curlib->filedata))) {
+        /* Data-blocks that failed to read are missing, like from a missing library. */
+        blo_reportf_wrap(basefd->reports,
+                         RPT_ERROR,
+                         TIP_("Read error in library '%s', some linked data is missing"),
+                         mainptr->curlib->filepath_abs);
+      }
       blo_filedata_free(mainptr->curlib->filedata);
     }
     mainptr->curlib->filedata = NULL;
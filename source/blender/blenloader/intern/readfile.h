@@ -29,8 +29,12 @@
 #include "DNA_windowmanager_types.h" /* for ReportType */
 #include "zlib.h"
 
+struct BHead;
+struct BLI_mmap_file;
 struct BLOCacheStorage;
+struct BlendFileReadProfile;
 struct GSet;
+struct IDIndex;
 struct IDNameLib_Map;
 struct Key;
 struct MemFile;
@@ -39,6 +43,7 @@ struct OldNewMap;
 struct PartEff;
 struct ReportList;
 struct View3D;
+struct ZstdReadState;
 
 typedef struct IDNameLib_Map IDNameLib_Map;
 
@@ -50,6 +55,8 @@ enum eFileDataFlag {
   FD_FLAGS_NOT_MY_BUFFER = 1 << 4,
   /* XXX Unused in practice (checked once but never set). */
   FD_FLAGS_NOT_MY_LIBMAP = 1 << 5,
+  /** #BHead's point directly into #FileData.mmap_file (no #BHeadN's are allocated). */
+  FD_FLAGS_BHEAD_FROM_MMAP = 1 << 6,
 };
 
 /* Disallow since it's 32bit on ms-windows. */
@@ -80,6 +87,11 @@ typedef struct FileData {
 
   /** Regular file reading. */
   int filedes;
+  /** Memory mapped file reading (uncompressed files). */
+  struct BLI_mmap_file *mmap_file;
+  /** All #BHead's in the mapping, created when needed by #blo_bhead_prev. */
+  struct BHead **mmap_bheads;
+  int mmap_bheads_len;
 
   /** Variables needed for reading from memory / stream. */
   const char *buffer;
@@ -93,6 +105,8 @@ typedef struct FileData {
   gzFile gzfiledes;
   /** Gzip stream for memory decompression. */
   z_stream strm;
+  /** Zstd compressed file reading (only used when built with `WITH_ZSTD`). */
+  struct ZstdReadState *zstd;
 
   /** Now only in use for library appending. */
   char relabase[FILE_MAX];
@@ -124,16 +138,100 @@ typedef struct FileData {
   /** See: #USE_GHASH_BHEAD. */
   struct GHash *bhead_idname_hash;
 
+  /**
+   * When opened for linking and the file has an ID index (see #BlendIDIndexHeader),
+   * only the blocks of the IDs that are needed are read, see #blo_filedata_from_file_for_link.
+   */
+  struct IDIndex *id_index;
+
+  /** Structs reconstructed in parallel ahead of time, #BHead to data, see #read_struct. */
+  struct GHash *bhead_preread_map;
+
   ListBase *mainlist;
   /** Used for undo. */
   ListBase *old_mainlist;
   struct IDNameLib_Map *old_idmap;
 
   struct ReportList *reports;
+
+  /** Current block of streaming access, see #blo_bhead_stream_next. */
+  BHead *stream_bhead;
+  /** Storage for #FileData.stream_bhead, unless it points into #FileData.mmap_file. */
+  BHead stream_bhead_buf;
+  /** The first #FileData.stream_data_len bytes of the data of the current block. */
+  void *stream_data;
+  int stream_data_len;
+  size_t stream_data_alloc;
+
+  /** Timing of reading, shared with the #FileData of libraries, see #G_DEBUG_IO_TIMING. */
+  struct BlendFileReadProfile *profile;
 } FileData;
 
 #define SIZEOFBLENDERHEADER 12
 
+/**
+ * Zstd compressed files are written as independent frames followed by a seek table,
+ * using the "seekable" format from the zstd project, see:
+ * https://github.com/facebook/zstd/blob/dev/contrib/seekable_format/zstd_seekable_compression_format.md
+ *
+ * This allows the reader to seek and to decompress frames in parallel.
+ */
+#define SEEKABLE_ZSTD_MAGIC_FRAME 0xFD2FB528
+#define SEEKABLE_ZSTD_MAGIC_SKIPPABLE 0x184D2A5E
+#define SEEKABLE_ZSTD_MAGIC_FOOTER 0x8F92EAB1
+/** Number of frames (uint32), seek table descriptor (uint8) & footer magic (uint32). */
+#define SEEKABLE_ZSTD_FOOTER_SIZE 9
+/** Uncompressed size of each frame written, any size is supported when reading. */
+#define SEEKABLE_ZSTD_FRAME_SIZE (1 << 20)
+
+/**
+ * The ID index, written as the last #DATA block of regular files (just before #ENDB).
+ * It maps ID names and addresses to the location of their blocks in the file,
+ * along with the IDs they use, so linking can read only the blocks it needs.
+ *
+ * #DATA blocks that don't follow an ID are ignored when reading, so older versions
+ * of Blender can read files containing the index.
+ *
+ * The block contains a #BlendIDIndexHeader, `entries_len` #BlendIDIndexEntry's,
+ * `deps_len` entry indices (`uint32_t`) and a #BlendIDIndexFooter.
+ * All values use the endianness of the file.
+ */
+#define BLEND_ID_INDEX_MAGIC "IDIX"
+#define BLEND_ID_INDEX_VERSION 1
+
+typedef struct BlendIDIndexHeader {
+  char magic[4];
+  int version;
+  uint32_t entries_len;
+  uint32_t deps_len;
+  /** Offsets of the #GLOB and #DNA1 blocks in the (uncompressed) file. */
+  uint64_t glob_offset;
+  uint64_t dna_offset;
+} BlendIDIndexHeader;
+
+typedef struct BlendIDIndexEntry {
+  /** #BHead.old of the ID block. */
+  uint64_t old;
+  /** Offset of the ID block in the (uncompressed) file, entries are sorted by offset. */
+  uint64_t offset;
+  /** Size of the ID block and the #DATA blocks following it. */
+  uint64_t len;
+  /** #BHead.code of the ID block. */
+  int code;
+  /** Range of IDs used by this ID in the dependencies array. */
+  uint32_t deps_start;
+  uint32_t deps_len;
+  char name[MAX_ID_NAME];
+  char _pad[6];
+} BlendIDIndexEntry;
+
+typedef struct BlendIDIndexFooter {
+  /** Size of the index, including the header and the footer. */
+  uint64_t len;
+  char magic[4];
+  int _pad;
+} BlendIDIndexFooter;
+
 /***/
 struct Main;
 void blo_join_main(ListBase *mainlist);
@@ -142,6 +240,8 @@ void blo_split_main(ListBase *mainlist, struct Main *main);
 BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath);
 
 FileData *blo_filedata_from_file(const char *filepath, struct ReportList *reports);
+FileData *blo_filedata_from_file_for_link(const char *filepath, struct ReportList *reports);
+FileData *blo_filedata_from_file_for_stream(const char *filepath, struct ReportList *reports);
 FileData *blo_filedata_from_memory(const void *buffer, int buffersize, struct ReportList *reports);
 FileData *blo_filedata_from_memfile(struct MemFile *memfile,
                                     const struct BlendFileReadParams *params,
@@ -165,6 +265,44 @@ BHead *blo_bhead_prev(FileData *fd, BHead *thisblock);
 
 const char *blo_bhead_id_name(const FileData *fd, const BHead *bhead);
 
+BHead *blo_bhead_stream_next(FileData *fd);
+const void *blo_bhead_stream_data(FileData *fd, int len);
+
+/* readfile_profile.c */
+
+/** Phases of reading a file, in the order they're done. */
+typedef enum eBlendFileReadPhase {
+  /** Opening the file, reading the header, the DNA and the list of blocks. */
+  BLO_READ_PHASE_OPEN = 0,
+  /** Converting data-blocks to the current DNA ahead of time (on multiple threads). */
+  BLO_READ_PHASE_RECONSTRUCT,
+  /** Reading the data-blocks of the file. */
+  BLO_READ_PHASE_READ,
+  BLO_READ_PHASE_VERSIONING,
+  /** Reading linked data-blocks, including their versioning & expanding. */
+  BLO_READ_PHASE_LIBRARIES,
+  BLO_READ_PHASE_LIB_LINK,
+  BLO_READ_PHASE_VERSIONING_AFTER_LINKING,
+  BLO_READ_PHASE_FINALIZE,
+} eBlendFileReadPhase;
+#define BLO_READ_PHASE_NUM (BLO_READ_PHASE_FINALIZE + 1)
+
+struct BlendFileReadProfile *blo_read_profile_new(const char *filepath);
+void blo_read_profile_free(struct BlendFileReadProfile *profile);
+void blo_read_profile_report(struct BlendFileReadProfile *profile);
+
+double blo_read_profile_time(const FileData *fd);
+void blo_read_profile_phase_begin(FileData *fd, const eBlendFileReadPhase phase);
+void blo_read_profile_phase_end(FileData *fd);
+void blo_read_profile_bytes_add(FileData *fd, const size_t bytes);
+double blo_read_profile_pass_add(FileData *fd, const char *name, const double time_start);
+void blo_read_profile_id_read_add(FileData *fd,
+                                  const struct ID *id,
+                                  const size_t bytes,
+                                  const double time_start);
+void blo_read_profile_id_lib_link_add(FileData *fd, const struct ID *id, const double time_start);
+void blo_read_profile_library_add(FileData *fd);
+
 /* do versions stuff */
 
 void blo_reportf_wrap(struct ReportList *reports, ReportType type, const char *format, ...)
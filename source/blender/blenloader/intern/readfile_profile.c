@@ -0,0 +1,522 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup blenloader
+ *
+ * Timing of blend-file reading, enabled with `--debug-io-timing`.
+ *
+ * Records the time spent in each phase of #blo_read_file_internal, in the versioning passes
+ * and per ID type, so it's possible to tell which data makes a file slow to open.
+ * The results are logged (`blo.readfile.timing`) and optionally written as JSON,
+ * see #BLO_read_profile_json_filepath_set.
+ *
+ * The totals, phases, versioning passes & ID types are logged at the default log level (1),
+ * the slowest data-blocks only at level 2 (`--log-level 2`).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_fileops.h"
+#include "BLI_path_util.h"
+#include "BLI_sort.h"
+#include "BLI_string.h"
+#include "BLI_utildefines.h"
+
+#include "PIL_time.h"
+
+#include "DNA_ID.h"
+
+#include "BKE_global.h"
+#include "BKE_idtype.h"
+
+#include "BLO_readfile.h"
+
+#include "CLG_log.h"
+
+#include "readfile.h"
+
+static CLG_LogRef LOG = {"blo.readfile.timing"};
+
+/* -------------------------------------------------------------------- */
+/** \name Profile Data
+ * \{ */
+
+/** Log levels of the results, see the file description. */
+#define PROFILE_LOG_LEVEL_TOTAL 0
+#define PROFILE_LOG_LEVEL_DETAILS 1
+#define PROFILE_LOG_LEVEL_IDS_SLOWEST 2
+
+/** Number of the slowest data-blocks to report. */
+#define PROFILE_IDS_SLOWEST_MAX 16
+/** Enough for all versioning passes & expanding. */
+#define PROFILE_PASSES_MAX 32
+
+typedef struct BlendFileReadProfilePass {
+  /** Static string, passes with the same name are accumulated. */
+  const char *name;
+  double time;
+} BlendFileReadProfilePass;
+
+typedef struct BlendFileReadProfileIDType {
+  int num;
+  size_t bytes;
+  double time_read;
+  double time_lib_link;
+} BlendFileReadProfileIDType;
+
+typedef struct BlendFileReadProfileID {
+  char name[MAX_ID_NAME];
+  char filepath[FILE_MAX];
+  size_t bytes;
+  double time_read;
+} BlendFileReadProfileID;
+
+typedef struct BlendFileReadProfile {
+  char filepath[FILE_MAX];
+  double time_start;
+  double time_end;
+
+  eBlendFileReadPhase phase;
+  double phase_time_start;
+  double phase_time[BLO_READ_PHASE_NUM];
+  size_t phase_bytes[BLO_READ_PHASE_NUM];
+
+  BlendFileReadProfilePass passes[PROFILE_PASSES_MAX];
+  int passes_len;
+
+  BlendFileReadProfileIDType id_types[INDEX_ID_MAX];
+
+  /** Sorted by decreasing #BlendFileReadProfileID.time_read. */
+  BlendFileReadProfileID ids_slowest[PROFILE_IDS_SLOWEST_MAX];
+  int ids_slowest_len;
+
+  int libraries_num;
+} BlendFileReadProfile;
+
+static const char *read_profile_phase_names[BLO_READ_PHASE_NUM] = {
+    [BLO_READ_PHASE_OPEN] = "open",
+    [BLO_READ_PHASE_RECONSTRUCT] = "reconstruct",
+    [BLO_READ_PHASE_READ] = "read",
+    [BLO_READ_PHASE_VERSIONING] = "versioning",
+    [BLO_READ_PHASE_LIBRARIES] = "libraries",
+    [BLO_READ_PHASE_LIB_LINK] = "lib_link",
+    [BLO_READ_PHASE_VERSIONING_AFTER_LINKING] = "versioning_after_linking",
+    [BLO_READ_PHASE_FINALIZE] = "finalize",
+};
+
+/** Written to by #BLO_read_profile_json_filepath_set, an empty string when unset. */
+static char read_profile_json_filepath[FILE_MAX] = "";
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Recording
+ * \{ */
+
+BlendFileReadProfile *blo_read_profile_new(const char *filepath)
+{
+  BlendFileReadProfile *profile = MEM_callocN(sizeof(*profile), __func__);
+  BLI_strncpy(profile->filepath, filepath, sizeof(profile->filepath));
+  profile->time_start = PIL_check_seconds_timer();
+  /* The profile is created before opening the file. */
+  profile->phase = BLO_READ_PHASE_OPEN;
+  profile->phase_time_start = profile->time_start;
+  return profile;
+}
+
+void blo_read_profile_free(BlendFileReadProfile *profile)
+{
+  MEM_freeN(profile);
+}
+
+/**
+ * \return The current time when profiling is enabled for \a fd, zero otherwise.
+ */
+double blo_read_profile_time(const FileData *fd)
+{
+  return (fd->profile != NULL) ? PIL_check_seconds_timer() : 0.0;
+}
+
+/**
+ * Phases don't overlap, beginning a phase ends the previous one.
+ */
+void blo_read_profile_phase_begin(FileData *fd, const eBlendFileReadPhase phase)
+{
+  BlendFileReadProfile *profile = fd->profile;
+  if (profile == NULL) {
+    return;
+  }
+  blo_read_profile_phase_end(fd);
+  profile->phase = phase;
+  profile->phase_time_start = PIL_check_seconds_timer();
+}
+
+void blo_read_profile_phase_end(FileData *fd)
+{
+  BlendFileReadProfile *profile = fd->profile;
+  if (profile == NULL || profile->phase == BLO_READ_PHASE_NUM) {
+    return;
+  }
+  profile->phase_time[profile->phase] += PIL_check_seconds_timer() - profile->phase_time_start;
+  profile->phase = BLO_READ_PHASE_NUM;
+}
+
+/**
+ * Add to the number of bytes processed by the current phase.
+ */
+void blo_read_profile_bytes_add(FileData *fd, const size_t bytes)
+{
+  BlendFileReadProfile *profile = fd->profile;
+  if (profile == NULL || profile->phase == BLO_READ_PHASE_NUM) {
+    return;
+  }
+  profile->phase_bytes[profile->phase] += bytes;
+}
+
+/**
+ * Accumulate the time of a named pass (within a phase), such as a versioning function.
+ *
+ * \param name: Must be a static string.
+ * \return The current time, to time the next pass.
+ */
+double blo_read_profile_pass_add(FileData *fd, const char *name, const double time_start)
+{
+  BlendFileReadProfile *profile = fd->profile;
+  if (profile == NULL) {
+    return 0.0;
+  }
+
+  const double time = PIL_check_seconds_timer();
+
+  BlendFileReadProfilePass *pass = NULL;
+  for (int i = 0; i < profile->passes_len; i++) {
+    if (STREQ(profile->passes[i].name, name)) {
+      pass = &profile->passes[i];
+      break;
+    }
+  }
+  if (pass == NULL) {
+    if (profile->passes_len == PROFILE_PASSES_MAX) {
+      BLI_assert(0);
+      return time;
+    }
+    pass = &profile->passes[profile->passes_len++];
+    pass->name = name;
+  }
+  pass->time += time - time_start;
+
+  return time;
+}
+
+static void read_profile_id_slowest_add(BlendFileReadProfile *profile,
+                                        const FileData *fd,
+                                        const ID *id,
+                                        const size_t bytes,
+                                        const double time)
+{
+  int index = profile->ids_slowest_len;
+  while (index > 0 && profile->ids_slowest[index - 1].time_read < time) {
+    index--;
+  }
+  if (index == PROFILE_IDS_SLOWEST_MAX) {
+    return;
+  }
+
+  if (profile->ids_slowest_len < PROFILE_IDS_SLOWEST_MAX) {
+    profile->ids_slowest_len++;
+  }
+  memmove(&profile->ids_slowest[index + 1],
+          &profile->ids_slowest[index],
+          sizeof(*profile->ids_slowest) * (size_t)(profile->ids_slowest_len - index - 1));
+
+  BlendFileReadProfileID *id_profile = &profile->ids_slowest[index];
+  BLI_strncpy(id_profile->name, id->name, sizeof(id_profile->name));
+  BLI_strncpy(id_profile->filepath, fd->relabase, sizeof(id_profile->filepath));
+  id_profile->bytes = bytes;
+  id_profile->time_read = time;
+}
+
+/**
+ * Record reading a data-block (its struct and all data following it in the file).
+ *
+ * \param bytes: The size of the data-block in the file.
+ */
+void blo_read_profile_id_read_add(FileData *fd,
+                                  const ID *id,
+                                  const size_t bytes,
+                                  const double time_start)
+{
+  BlendFileReadProfile *profile = fd->profile;
+  if (profile == NULL) {
+    return;
+  }
+
+  const double time = PIL_check_seconds_timer() - time_start;
+  const int index = BKE_idtype_idcode_to_index(GS(id->name));
+  if (index != -1) {
+    BlendFileReadProfileIDType *id_type = &profile->id_types[index];
+    id_type->num++;
+    id_type->bytes += bytes;
+    id_type->time_read += time;
+  }
+
+  blo_read_profile_bytes_add(fd, bytes);
+  read_profile_id_slowest_add(profile, fd, id, bytes, time);
+}
+
+void blo_read_profile_id_lib_link_add(FileData *fd, const ID *id, const double time_start)
+{
+  BlendFileReadProfile *profile = fd->profile;
+  if (profile == NULL) {
+    return;
+  }
+
+  const int index = BKE_idtype_idcode_to_index(GS(id->name));
+  if (index != -1) {
+    profile->id_types[index].time_lib_link += PIL_check_seconds_timer() - time_start;
+  }
+}
+
+void blo_read_profile_library_add(FileData *fd)
+{
+  if (fd->profile != NULL) {
+    fd->profile->libraries_num++;
+  }
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Reporting
+ * \{ */
+
+static double read_profile_id_type_time(const BlendFileReadProfileIDType *id_type)
+{
+  return id_type->time_read + id_type->time_lib_link;
+}
+
+static int read_profile_id_type_cmp(const void *a, const void *b, void *user_data)
+{
+  const BlendFileReadProfile *profile = user_data;
+  const double time_a = read_profile_id_type_time(&profile->id_types[*(const int *)a]);
+  const double time_b = read_profile_id_type_time(&profile->id_types[*(const int *)b]);
+  if (time_a > time_b) {
+    return -1;
+  }
+  if (time_a < time_b) {
+    return 1;
+  }
+  return 0;
+}
+
+/**
+ * \return The number of ID types that were read, sorted by decreasing time in \a r_indices.
+ */
+static int read_profile_id_types_sorted(const BlendFileReadProfile *profile,
+                                        int r_indices[INDEX_ID_MAX])
+{
+  int indices_len = 0;
+  for (int i = 0; i < INDEX_ID_MAX; i++) {
+    if (profile->id_types[i].num != 0) {
+      r_indices[indices_len++] = i;
+    }
+  }
+  BLI_qsort_r(r_indices,
+              (size_t)indices_len,
+              sizeof(*r_indices),
+              read_profile_id_type_cmp,
+              (void *)profile);
+  return indices_len;
+}
+
+static void read_profile_log(const BlendFileReadProfile *profile)
+{
+  char bytes_str[15];
+
+  CLOG_INFO(&LOG,
+            PROFILE_LOG_LEVEL_TOTAL,
+            "Read \"%s\" in %.4f sec, %d libraries",
+            profile->filepath,
+            profile->time_end - profile->time_start,
+            profile->libraries_num);
+
+  for (int i = 0; i < BLO_READ_PHASE_NUM; i++) {
+    BLI_str_format_byte_unit(bytes_str, (long long int)profile->phase_bytes[i], false);
+    CLOG_INFO(&LOG,
+              PROFILE_LOG_LEVEL_DETAILS,
+              "Phase %-24s %10.4f sec %14s",
+              read_profile_phase_names[i],
+              profile->phase_time[i],
+              bytes_str);
+  }
+
+  for (int i = 0; i < profile->passes_len; i++) {
+    CLOG_INFO(&LOG,
+              PROFILE_LOG_LEVEL_DETAILS,
+              "Pass %-25s %10.4f sec",
+              profile->passes[i].name,
+              profile->passes[i].time);
+  }
+
+  int indices[INDEX_ID_MAX];
+  const int indices_len = read_profile_id_types_sorted(profile, indices);
+  for (int i = 0; i < indices_len; i++) {
+    const BlendFileReadProfileIDType *id_type = &profile->id_types[indices[i]];
+    BLI_str_format_byte_unit(bytes_str, (long long int)id_type->bytes, false);
+    CLOG_INFO(&LOG,
+              PROFILE_LOG_LEVEL_DETAILS,
+              "Type %-16s %8d IDs %14s, read %.4f sec, lib link %.4f sec",
+              BKE_idtype_idcode_to_name(BKE_idtype_idcode_from_index(indices[i])),
+              id_type->num,
+              bytes_str,
+              id_type->time_read,
+              id_type->time_lib_link);
+  }
+
+  for (int i = 0; i < profile->ids_slowest_len; i++) {
+    const BlendFileReadProfileID *id_profile = &profile->ids_slowest[i];
+    BLI_str_format_byte_unit(bytes_str, (long long int)id_profile->bytes, false);
+    CLOG_INFO(&LOG,
+              PROFILE_LOG_LEVEL_IDS_SLOWEST,
+              "ID %-24s %10.4f sec %14s (%s)",
+              id_profile->name,
+              id_profile->time_read,
+              bytes_str,
+              id_profile->filepath);
+  }
+}
+
+static void read_profile_json_write_string(FILE *fp, const char *str)
+{
+  fputc('"', fp);
+  for (const char *c = str; *c; c++) {
+    if (ELEM(*c, '"', '\\')) {
+      fputc('\\', fp);
+      fputc(*c, fp);
+    }
+    else if ((unsigned char)*c < 0x20) {
+      fprintf(fp, "\\u%04x", (unsigned int)*c);
+    }
+    else {
+      fputc(*c, fp);
+    }
+  }
+  fputc('"', fp);
+}
+
+static void read_profile_json_write(const BlendFileReadProfile *profile, const char *filepath)
+{
+  FILE *fp = BLI_fopen(filepath, "w");
+  if (fp == NULL) {
+    CLOG_ERROR(&LOG, "Cannot open \"%s\" for writing", filepath);
+    return;
+  }
+
+  fprintf(fp, "{\n  \"filepath\": ");
+  read_profile_json_write_string(fp, profile->filepath);
+  fprintf(fp, ",\n  \"time\": %f,\n", profile->time_end - profile->time_start);
+  fprintf(fp, "  \"libraries_num\": %d,\n", profile->libraries_num);
+
+  fprintf(fp, "  \"phases\": [");
+  for (int i = 0; i < BLO_READ_PHASE_NUM; i++) {
+    fprintf(fp,
+            "%s\n    {\"name\": \"%s\", \"time\": %f, \"bytes\": %llu}",
+            (i != 0) ? "," : "",
+            read_profile_phase_names[i],
+            profile->phase_time[i],
+            (unsigned long long)profile->phase_bytes[i]);
+  }
+  fprintf(fp, "\n  ],\n");
+
+  fprintf(fp, "  \"passes\": [");
+  for (int i = 0; i < profile->passes_len; i++) {
+    fprintf(fp, "%s\n    {\"name\": ", (i != 0) ? "," : "");
+    read_profile_json_write_string(fp, profile->passes[i].name);
+    fprintf(fp, ", \"time\": %f}", profile->passes[i].time);
+  }
+  fprintf(fp, "\n  ],\n");
+
+  int indices[INDEX_ID_MAX];
+  const int indices_len = read_profile_id_types_sorted(profile, indices);
+  fprintf(fp, "  \"id_types\": [");
+  for (int i = 0; i < indices_len; i++) {
+    const BlendFileReadProfileIDType *id_type = &profile->id_types[indices[i]];
+    fprintf(fp,
+            "%s\n    {\"name\": \"%s\", \"num\": %d, \"bytes\": %llu, "
+            "\"time_read\": %f, \"time_lib_link\": %f}",
+            (i != 0) ? "," : "",
+            BKE_idtype_idcode_to_name(BKE_idtype_idcode_from_index(indices[i])),
+            id_type->num,
+            (unsigned long long)id_type->bytes,
+            id_type->time_read,
+            id_type->time_lib_link);
+  }
+  fprintf(fp, "\n  ],\n");
+
+  fprintf(fp, "  \"ids_slowest\": [");
+  for (int i = 0; i < profile->ids_slowest_len; i++) {
+    const BlendFileReadProfileID *id_profile = &profile->ids_slowest[i];
+    fprintf(fp, "%s\n    {\"name\": ", (i != 0) ? "," : "");
+    read_profile_json_write_string(fp, id_profile->name);
+    fprintf(fp, ", \"filepath\": ");
+    read_profile_json_write_string(fp, id_profile->filepath);
+    fprintf(fp,
+            ", \"bytes\": %llu, \"time_read\": %f}",
+            (unsigned long long)id_profile->bytes,
+            id_profile->time_read);
+  }
+  fprintf(fp, "\n  ]\n}\n");
+
+  fclose(fp);
+}
+
+/**
+ * Log the results and write them to the JSON file (when set).
+ */
+void blo_read_profile_report(BlendFileReadProfile *profile)
+{
+  profile->time_end = PIL_check_seconds_timer();
+
+  read_profile_log(profile);
+
+  if (read_profile_json_filepath[0] != '\0') {
+    read_profile_json_write(profile, read_profile_json_filepath);
+  }
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Public API
+ * \{ */
+
+/**
+ * Write the timings of reading blend-files as JSON to \a filepath.
+ * The file is overwritten for every blend-file read, so it contains the last one.
+ *
+ * \note Only has an effect when #G_DEBUG_IO_TIMING is set.
+ */
+void BLO_read_profile_json_filepath_set(const char *filepath)
+{
+  BLI_strncpy(read_profile_json_filepath, filepath, sizeof(read_profile_json_filepath));
+}
+
+/** \} */
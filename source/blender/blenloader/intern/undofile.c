@@ -38,10 +38,20 @@
 
 #include "MEM_guardedalloc.h"
 
+#ifdef WITH_LZO
+#  ifdef WITH_SYSTEM_LZO
+#    include <lzo/lzo1x.h>
+#  else
+#    include "minilzo.h"
+#  endif
+#endif
+
 #include "DNA_listBase.h"
 
 #include "BLI_blenlib.h"
 #include "BLI_ghash.h"
+#include "BLI_hash_mm2a.h"
+#include "BLI_threads.h"
 
 #include "BLO_readfile.h"
 #include "BLO_undofile.h"
@@ -54,15 +64,196 @@
 
 /* **************** support for memory-write, for undo buffers *************** */
 
+/* -------------------------------------------------------------------- */
+/** \name Shared Chunk Buffers
+ *
+ * The contents of chunks are stored once, no matter how many chunks (from any undo step)
+ * contain the same data. Buffers are looked up by their contents and reference counted.
+ *
+ * Buffers only used by a single chunk can be compressed (see #BLO_memfile_compress),
+ * compressed buffers are removed from the look-up set until they are uncompressed.
+ * \{ */
+
+struct MemFileSharedBuffer {
+  /** Uncompressed contents, NULL while compressed. */
+  char *buf;
+  /** Compressed contents, only set while compressed. */
+  char *buf_compressed;
+  uint size;
+  uint size_compressed;
+  uint hash;
+  /** Number of #MemFileChunk using this buffer. */
+  uint users;
+  /**
+   * The memfile that added this buffer, its #MemFile.size accounts for the buffer.
+   * NULL once that memfile is freed (without merging into the next one).
+   */
+  const MemFile *owner;
+};
+
+/** All uncompressed buffers, lazily allocated. */
+static GSet *memfile_shared_buffers = NULL;
+static ThreadMutex memfile_shared_buffers_mutex = BLI_MUTEX_INITIALIZER;
+
+static uint memfile_shared_buffer_hash(const void *key)
+{
+  const MemFileSharedBuffer *shared = key;
+  return shared->hash;
+}
+
+static bool memfile_shared_buffer_cmp(const void *a, const void *b)
+{
+  const MemFileSharedBuffer *shared_a = a;
+  const MemFileSharedBuffer *shared_b = b;
+  return !((shared_a->hash == shared_b->hash) && (shared_a->size == shared_b->size) &&
+           (memcmp(shared_a->buf, shared_b->buf, shared_a->size) == 0));
+}
+
+/**
+ * \return A buffer with a copy of \a buf, adding a user.
+ * \param r_is_new: Set when no buffer with the same contents existed,
+ * the new buffer is owned by \a memfile.
+ */
+static MemFileSharedBuffer *memfile_shared_buffer_ensure(const char *buf,
+                                                         uint size,
+                                                         const MemFile *memfile,
+                                                         bool *r_is_new)
+{
+  MemFileSharedBuffer key = {
+      .buf = (char *)buf,
+      .size = size,
+      .hash = BLI_hash_mm2((const uchar *)buf, size, 0),
+      .owner = memfile,
+  };
+  MemFileSharedBuffer *shared;
+
+  BLI_mutex_lock(&memfile_shared_buffers_mutex);
+  if (memfile_shared_buffers == NULL) {
+    memfile_shared_buffers = BLI_gset_new(
+        memfile_shared_buffer_hash, memfile_shared_buffer_cmp, __func__);
+  }
+
+  void **key_p;
+  if (BLI_gset_ensure_p_ex(memfile_shared_buffers, &key, &key_p)) {
+    shared = *key_p;
+    *r_is_new = false;
+  }
+  else {
+    shared = MEM_mallocN(sizeof(*shared), "MemFileSharedBuffer");
+    *shared = key;
+    shared->buf = MEM_mallocN(size, "Chunk buffer");
+    memcpy(shared->buf, buf, size);
+    *key_p = shared;
+    *r_is_new = true;
+  }
+  shared->users++;
+  BLI_mutex_unlock(&memfile_shared_buffers_mutex);
+
+  return shared;
+}
+
+/**
+ * Remove from the look-up set, which may contain another buffer with the same contents
+ * (added while this one was compressed).
+ */
+static void memfile_shared_buffer_unlink(MemFileSharedBuffer *shared)
+{
+  if (BLI_gset_lookup(memfile_shared_buffers, shared) == shared) {
+    BLI_gset_remove(memfile_shared_buffers, shared, NULL);
+  }
+}
+
+/** The size \a shared accounts for in the #MemFile.size of its owner. */
+static size_t memfile_shared_buffer_owned_size(const MemFileSharedBuffer *shared)
+{
+  return (shared->buf != NULL) ? shared->size : shared->size_compressed;
+}
+
+static void memfile_shared_buffer_release(MemFileSharedBuffer *shared, const MemFile *memfile)
+{
+  BLI_mutex_lock(&memfile_shared_buffers_mutex);
+  BLI_assert(shared->users != 0);
+  shared->users--;
+  if (shared->owner == memfile) {
+    shared->owner = NULL;
+  }
+  if (shared->users == 0) {
+    if (shared->buf != NULL) {
+      memfile_shared_buffer_unlink(shared);
+      MEM_freeN(shared->buf);
+    }
+    MEM_SAFE_FREE(shared->buf_compressed);
+    MEM_freeN(shared);
+
+    /* Don't keep the set allocated when there is no undo data. */
+    if (BLI_gset_len(memfile_shared_buffers) == 0) {
+      BLI_gset_free(memfile_shared_buffers, NULL);
+      memfile_shared_buffers = NULL;
+    }
+  }
+  BLI_mutex_unlock(&memfile_shared_buffers_mutex);
+}
+
+#ifdef WITH_LZO
+/* Worst case size of LZO compressed data. */
+#  define LZO_OUT_LEN(size) ((size) + (size) / 16 + 64 + 3)
+
+/**
+ * \param buf_tmp: Temporary storage, at least #LZO_OUT_LEN of the buffer size.
+ * \return True when the buffer was compressed (incompressible data is kept as-is).
+ */
+static bool memfile_shared_buffer_compress(MemFileSharedBuffer *shared,
+                                           char *buf_tmp,
+                                           void *wrkmem)
+{
+  lzo_uint out_len = 0;
+  const int r = lzo1x_1_compress(
+      (const uchar *)shared->buf, (lzo_uint)shared->size, (uchar *)buf_tmp, &out_len, wrkmem);
+  if ((r != LZO_E_OK) || (out_len >= shared->size)) {
+    return false;
+  }
+
+  shared->size_compressed = (uint)out_len;
+  shared->buf_compressed = MEM_mallocN(shared->size_compressed, "Chunk buffer compressed");
+  memcpy(shared->buf_compressed, buf_tmp, shared->size_compressed);
+
+  memfile_shared_buffer_unlink(shared);
+  MEM_freeN(shared->buf);
+  shared->buf = NULL;
+  return true;
+}
+
+static void memfile_shared_buffer_uncompress(MemFileSharedBuffer *shared)
+{
+  shared->buf = MEM_mallocN(shared->size, "Chunk buffer");
+
+  lzo_uint out_len = shared->size;
+  const int r = lzo1x_decompress_safe((const uchar *)shared->buf_compressed,
+                                      (lzo_uint)shared->size_compressed,
+                                      (uchar *)shared->buf,
+                                      &out_len,
+                                      NULL);
+  BLI_assert((r == LZO_E_OK) && (out_len == shared->size));
+  UNUSED_VARS_NDEBUG(r);
+
+  MEM_freeN(shared->buf_compressed);
+  shared->buf_compressed = NULL;
+  shared->size_compressed = 0;
+
+  /* When the same contents were added in the mean time, this buffer just isn't shared. */
+  BLI_gset_add(memfile_shared_buffers, shared);
+}
+#endif /* WITH_LZO */
+
+/** \} */
+
 /* not memfile itself */
 void BLO_memfile_free(MemFile *memfile)
 {
   MemFileChunk *chunk;
 
   while ((chunk = BLI_pophead(&memfile->chunks))) {
-    if (chunk->is_identical == false) {
-      MEM_freeN((void *)chunk->buf);
-    }
+    memfile_shared_buffer_release(chunk->shared, memfile);
     MEM_freeN(chunk);
   }
   memfile->size = 0;
@@ -72,37 +263,85 @@ void BLO_memfile_free(MemFile *memfile)
 /* result is that 'first' is being freed */
 void BLO_memfile_merge(MemFile *first, MemFile *second)
 {
-  /* We use this mapping to store the memory buffers from second memfile chunks which are not owned
-   * by it (i.e. shared with some previous memory steps). */
-  GHash *buffer_to_second_memchunk = BLI_ghash_new(
-      BLI_ghashutil_ptrhash, BLI_ghashutil_ptrcmp, __func__);
-
-  /* First, detect all memchunks in second memfile that are not owned by it. */
-  for (MemFileChunk *sc = second->chunks.first; sc != NULL; sc = sc->next) {
-    if (sc->is_identical) {
-      BLI_ghash_insert(buffer_to_second_memchunk, (void *)sc->buf, sc);
+  /* Buffers are reference counted, any data used by 'second' is kept,
+   * its size now accounts for the buffers that were accounted for by 'first'. */
+  BLI_mutex_lock(&memfile_shared_buffers_mutex);
+  LISTBASE_FOREACH (MemFileChunk *, chunk, &second->chunks) {
+    MemFileSharedBuffer *shared = chunk->shared;
+    if (shared->owner == first) {
+      shared->owner = second;
+      second->size += memfile_shared_buffer_owned_size(shared);
     }
   }
+  BLI_mutex_unlock(&memfile_shared_buffers_mutex);
 
-  /* Now, check all chunks from first memfile (the one we are removing), and if a memchunk owned by
-   * it is also used by the second memfile, transfer the ownership. */
-  for (MemFileChunk *fc = first->chunks.first; fc != NULL; fc = fc->next) {
-    if (!fc->is_identical) {
-      MemFileChunk *sc = BLI_ghash_lookup(buffer_to_second_memchunk, fc->buf);
-      if (sc != NULL) {
-        BLI_assert(sc->is_identical);
-        sc->is_identical = false;
-        fc->is_identical = true;
+  BLO_memfile_free(first);
+}
+
+/**
+ * Compress data only used by this memfile,
+ * for undo steps that aren't likely to be loaded soon.
+ * #MemFileChunk.buf is NULL for compressed chunks, see #BLO_memfile_uncompress.
+ * #MemFile.size only changes for the buffers this memfile accounts for.
+ */
+void BLO_memfile_compress(MemFile *memfile)
+{
+#ifdef WITH_LZO
+  uint size_max = 0;
+  LISTBASE_FOREACH (MemFileChunk *, chunk, &memfile->chunks) {
+    size_max = MAX2(size_max, chunk->size);
+  }
+  if (size_max == 0) {
+    return;
+  }
+
+  char *buf_tmp = MEM_mallocN(LZO_OUT_LEN(size_max), __func__);
+  void *wrkmem = MEM_mallocN(LZO1X_1_MEM_COMPRESS, __func__);
+
+  BLI_mutex_lock(&memfile_shared_buffers_mutex);
+  LISTBASE_FOREACH (MemFileChunk *, chunk, &memfile->chunks) {
+    MemFileSharedBuffer *shared = chunk->shared;
+    if ((shared->buf == NULL) || (shared->users != 1)) {
+      continue;
+    }
+    if (memfile_shared_buffer_compress(shared, buf_tmp, wrkmem)) {
+      chunk->buf = NULL;
+      if (shared->owner == memfile) {
+        BLI_assert(memfile->size >= shared->size);
+        memfile->size -= (size_t)(shared->size - shared->size_compressed);
       }
-      /* Note that if the second memfile does not use that chunk, we assume that the first one
-       * fully owns it without sharing it with any other memfile, and hence it should be freed with
-       * it. */
     }
   }
+  BLI_mutex_unlock(&memfile_shared_buffers_mutex);
 
-  BLI_ghash_free(buffer_to_second_memchunk, NULL, NULL);
+  MEM_freeN(buf_tmp);
+  MEM_freeN(wrkmem);
+#else
+  UNUSED_VARS(memfile);
+#endif
+}
 
-  BLO_memfile_free(first);
+/**
+ * Ensure all chunks of \a memfile can be read, after #BLO_memfile_compress.
+ */
+void BLO_memfile_uncompress(MemFile *memfile)
+{
+#ifdef WITH_LZO
+  BLI_mutex_lock(&memfile_shared_buffers_mutex);
+  LISTBASE_FOREACH (MemFileChunk *, chunk, &memfile->chunks) {
+    if (chunk->buf == NULL) {
+      MemFileSharedBuffer *shared = chunk->shared;
+      if (shared->owner == memfile) {
+        memfile->size += (size_t)(shared->size - shared->size_compressed);
+      }
+      memfile_shared_buffer_uncompress(shared);
+      chunk->buf = shared->buf;
+    }
+  }
+  BLI_mutex_unlock(&memfile_shared_buffers_mutex);
+#else
+  UNUSED_VARS(memfile);
+#endif
 }
 
 /* Clear is_identical_future before adding next memfile. */
@@ -161,7 +400,6 @@ void BLO_memfile_chunk_add(MemFileWriteData *mem_data, const char *buf, uint siz
 
   MemFileChunk *curchunk = MEM_mallocN(sizeof(MemFileChunk), "MemFileChunk");
   curchunk->size = size;
-  curchunk->buf = NULL;
   curchunk->is_identical = false;
   /* This is unsafe in the sense that an app handler or other code that does not
    * perform an undo push may make changes after the last undo push that
@@ -170,26 +408,23 @@ void BLO_memfile_chunk_add(MemFileWriteData *mem_data, const char *buf, uint siz
   curchunk->id_session_uuid = mem_data->current_id_session_uuid;
   BLI_addtail(&memfile->chunks, curchunk);
 
+  /* Identical data (from this or any other memfile) is only stored once. */
+  bool is_new;
+  curchunk->shared = memfile_shared_buffer_ensure(buf, size, memfile, &is_new);
+  curchunk->buf = curchunk->shared->buf;
+  if (is_new) {
+    memfile->size += size;
+  }
+
   /* we compare compchunk with buf */
   if (*compchunk_step != NULL) {
     MemFileChunk *compchunk = *compchunk_step;
-    if (compchunk->size == curchunk->size) {
-      if (memcmp(compchunk->buf, buf, size) == 0) {
-        curchunk->buf = compchunk->buf;
-        curchunk->is_identical = true;
-        compchunk->is_identical_future = true;
-      }
+    if (compchunk->shared == curchunk->shared) {
+      curchunk->is_identical = true;
+      compchunk->is_identical_future = true;
     }
     *compchunk_step = compchunk->next;
   }
-
-  /* not equal... */
-  if (curchunk->buf == NULL) {
-    char *buf_new = MEM_mallocN(size, "Chunk buffer");
-    memcpy(buf_new, buf, size);
-    curchunk->buf = buf_new;
-    memfile->size += size;
-  }
 }
 
 struct Main *BLO_memfile_main_get(struct MemFile *memfile,
@@ -241,6 +476,8 @@ bool BLO_memfile_write_file(struct MemFile *memfile, const char *filename)
 #    warning "Symbolic links will be followed on undo save, possibly causing CVE-2008-1103"
 #  endif
 #endif
+  BLO_memfile_uncompress(memfile);
+
   file = BLI_open(filename, oflags, 0666);
 
   if (file == -1) {
@@ -635,6 +635,8 @@ static void do_versions_socket_default_value_259(bNodeSocket *sock)
   }
 }
 
+/* Skipped for files from 2.59 (4) on, keep all code guarded by version checks
+ * (see #do_versions_passes). */
 /* NOLINTNEXTLINE: readability-function-size */
 void blo_do_versions_250(FileData *fd, Library *lib, Main *bmain)
 {
@@ -2337,6 +2339,8 @@ static void lib_node_do_versions_group_indices(bNode *gnode)
   }
 }
 
+/* Skipped for files from 2.58 on, keep all code guarded by version checks
+ * (see #do_versions_after_linking_passes). */
 void do_versions_after_linking_250(Main *bmain)
 {
   if (bmain->versionfile < 256 || (bmain->versionfile == 256 && bmain->subversionfile < 2)) {
@@ -658,6 +658,8 @@ static void do_versions_nodetree_customnodes(bNodeTree *ntree, int UNUSED(is_gro
   }
 }
 
+/* Skipped for files from 2.69 (11) on, keep all code guarded by version checks
+ * (see #do_versions_passes). */
 /* NOLINTNEXTLINE: readability-function-size */
 void blo_do_versions_260(FileData *fd, Library *UNUSED(lib), Main *bmain)
 {
@@ -2582,6 +2584,8 @@ void blo_do_versions_260(FileData *fd, Library *UNUSED(lib), Main *bmain)
   }
 }
 
+/* Skipped for files from 2.80 (60) on, keep all code guarded by version checks
+ * (see #do_versions_after_linking_passes). */
 void do_versions_after_linking_260(Main *bmain)
 {
   /* Convert the previously used ntree->inputs/ntree->outputs lists to interface nodes.
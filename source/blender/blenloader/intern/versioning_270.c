@@ -420,6 +420,8 @@ static void do_version_bbone_easing_fcurve_fix(ID *UNUSED(id),
   }
 }
 
+/* Skipped for files from 2.79 (4) on, keep all code guarded by version checks
+ * (see #do_versions_passes). */
 /* NOLINTNEXTLINE: readability-function-size */
 void blo_do_versions_270(FileData *fd, Library *UNUSED(lib), Main *bmain)
 {
@@ -1714,6 +1716,8 @@ void blo_do_versions_270(FileData *fd, Library *UNUSED(lib), Main *bmain)
   }
 }
 
+/* Skipped for files from 2.79 (2) on, keep all code guarded by version checks
+ * (see #do_versions_after_linking_passes). */
 void do_versions_after_linking_270(Main *bmain)
 {
   /* To be added to next subversion bump! */
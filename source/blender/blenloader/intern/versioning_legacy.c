@@ -493,6 +493,8 @@ void blo_do_version_old_trackto_to_constraints(Object *ob)
   ob->track = NULL;
 }
 
+/* Skipped for files from 2.49 on, keep all code guarded by version checks
+ * (see #do_versions_passes). */
 /* NOLINTNEXTLINE: readability-function-size */
 void blo_do_versions_pre250(FileData *fd, Library *lib, Main *bmain)
 {
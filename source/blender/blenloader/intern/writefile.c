@@ -148,7 +148,9 @@
 
 #include "BLI_bitmap.h"
 #include "BLI_blenlib.h"
+#include "BLI_math_base.h"
 #include "BLI_mempool.h"
+#include "BLI_task.h"
 #include "MEM_guardedalloc.h"  // MEM_freeN
 
 #include "BKE_action.h"
@@ -170,6 +172,7 @@
 #include "BKE_layer.h"
 #include "BKE_lib_id.h"
 #include "BKE_lib_override.h"
+#include "BKE_lib_query.h"
 #include "BKE_main.h"
 #include "BKE_modifier.h"
 #include "BKE_node.h"
@@ -192,18 +195,22 @@
 
 #include <errno.h>
 
+#ifdef WITH_ZSTD
+#  include <zstd.h>
+#endif
+
 /* Make preferences read-only. */
 #define U (*((const UserDef *)&U))
 
+/* Serialize IDs into separate buffers on multiple threads, see #write_id_list_parallel. */
+#define USE_PARALLEL_WRITE
+
 /* ********* my write, buffered writing with minimum size chunks ************ */
 
 /* Use optimal allocation since blocks of this size are kept in memory for undo. */
 #define MYWRITE_BUFFER_SIZE (MEM_SIZE_OPTIMAL(1 << 17)) /* 128kb */
 #define MYWRITE_MAX_CHUNK (MEM_SIZE_OPTIMAL(1 << 15))   /* ~32kb */
 
-/** Use if we want to store how many bytes have been written to the file. */
-// #define USE_WRITE_DATA_LEN
-
 /* -------------------------------------------------------------------- */
 /** \name Internal Write Wrapper's (Abstracts Compression)
  * \{ */
@@ -211,6 +218,9 @@
 typedef enum {
   WW_WRAP_NONE = 1,
   WW_WRAP_ZLIB,
+  WW_WRAP_ZSTD,
+  /** Write into a #MemFile, see #BLO_write_file_snapshot. */
+  WW_WRAP_MEMFILE,
 } eWriteWrapType;
 
 typedef struct WriteWrap WriteWrap;
@@ -227,6 +237,8 @@ struct WriteWrap {
   union {
     int file_handle;
     gzFile gz_handle;
+    struct ZstdWriteWrap *zstd_handle;
+    MemFileWriteData *mem_handle;
   } _user_data;
 };
 
@@ -282,6 +294,282 @@ static size_t ww_write_zlib(WriteWrap *ww, const char *buf, size_t buf_len)
 }
 #undef FILE_HANDLE
 
+#ifdef WITH_ZSTD
+/* zstd */
+
+/**
+ * Data is split into frames of #SEEKABLE_ZSTD_FRAME_SIZE which are compressed independently.
+ *
+ * Frames are collected into batches, while one batch is being compressed (in parallel)
+ * the next one is filled, frames are written in order once their batch is done.
+ * A seek table is written at the end of the file, see #SEEKABLE_ZSTD_MAGIC_SKIPPABLE.
+ */
+#  define ZSTD_COMPRESSION_LEVEL 3
+
+typedef struct ZstdFrame {
+  char *in_buf;
+  size_t in_len;
+  char *out_buf;
+  size_t out_len;
+  bool error;
+} ZstdFrame;
+
+typedef struct ZstdFrameBatch {
+  TaskPool *task_pool;
+  ZstdFrame *frames;
+  /** Number of frames containing data, the last one may be partially filled. */
+  int frames_len;
+  /** The frames have been pushed to the task pool and not written yet. */
+  bool is_pending;
+} ZstdFrameBatch;
+
+typedef struct ZstdWriteWrap {
+  int file_handle;
+  /** One batch is filled while the other one is being compressed. */
+  ZstdFrameBatch batches[2];
+  int batch_active;
+  /** Number of frames in each batch. */
+  int batch_frames_len;
+
+  /** Compressed & uncompressed size of every frame written, for the seek table. */
+  uint32_t *seek_table;
+  int seek_table_frames_len;
+  int seek_table_frames_alloc;
+
+  bool error;
+} ZstdWriteWrap;
+
+#  define FILE_HANDLE(ww) (ww)->_user_data.zstd_handle
+
+static void ww_zstd_uint32_pack(uchar *dst, uint32_t value)
+{
+  /* The seekable format is always little endian. */
+  dst[0] = (uchar)(value);
+  dst[1] = (uchar)(value >> 8);
+  dst[2] = (uchar)(value >> 16);
+  dst[3] = (uchar)(value >> 24);
+}
+
+static void ww_zstd_compress_task(TaskPool *__restrict UNUSED(pool), void *taskdata)
+{
+  ZstdFrame *frame = taskdata;
+  const size_t out_len = ZSTD_compress(frame->out_buf,
+                                       ZSTD_compressBound(SEEKABLE_ZSTD_FRAME_SIZE),
+                                       frame->in_buf,
+                                       frame->in_len,
+                                       ZSTD_COMPRESSION_LEVEL);
+  if (ZSTD_isError(out_len)) {
+    frame->error = true;
+    frame->out_len = 0;
+  }
+  else {
+    frame->out_len = out_len;
+  }
+}
+
+static void ww_zstd_batch_submit(ZstdFrameBatch *batch)
+{
+  BLI_assert(batch->is_pending == false);
+  for (int i = 0; i < batch->frames_len; i++) {
+    BLI_task_pool_push(batch->task_pool, ww_zstd_compress_task, &batch->frames[i], false, NULL);
+  }
+  batch->is_pending = (batch->frames_len != 0);
+}
+
+static void ww_zstd_batch_write(ZstdWriteWrap *zstd, ZstdFrameBatch *batch)
+{
+  if (!batch->is_pending) {
+    return;
+  }
+
+  BLI_task_pool_work_and_wait(batch->task_pool);
+
+  for (int i = 0; i < batch->frames_len; i++) {
+    ZstdFrame *frame = &batch->frames[i];
+    if (zstd->error == false) {
+      if (frame->error ||
+          (write(zstd->file_handle, frame->out_buf, frame->out_len) != frame->out_len)) {
+        zstd->error = true;
+      }
+      else {
+        if (zstd->seek_table_frames_len == zstd->seek_table_frames_alloc) {
+          zstd->seek_table_frames_alloc *= 2;
+          zstd->seek_table = MEM_reallocN(zstd->seek_table,
+                                          sizeof(uint32_t[2]) * zstd->seek_table_frames_alloc);
+        }
+        uint32_t *seek_entry = &zstd->seek_table[zstd->seek_table_frames_len * 2];
+        seek_entry[0] = (uint32_t)frame->out_len;
+        seek_entry[1] = (uint32_t)frame->in_len;
+        zstd->seek_table_frames_len += 1;
+      }
+    }
+    frame->in_len = 0;
+    frame->out_len = 0;
+    frame->error = false;
+  }
+
+  batch->frames_len = 0;
+  batch->is_pending = false;
+}
+
+/**
+ * Start compressing the active batch, making the other batch active.
+ */
+static void ww_zstd_batch_swap(ZstdWriteWrap *zstd)
+{
+  ZstdFrameBatch *batch = &zstd->batches[zstd->batch_active];
+  ZstdFrameBatch *batch_other = &zstd->batches[!zstd->batch_active];
+
+  /* Frames must be written in order, so finish the previous batch first. */
+  ww_zstd_batch_write(zstd, batch_other);
+  ww_zstd_batch_submit(batch);
+
+  zstd->batch_active = !zstd->batch_active;
+}
+
+static bool ww_zstd_write_seek_table(ZstdWriteWrap *zstd)
+{
+  const uint32_t frames_len = (uint32_t)zstd->seek_table_frames_len;
+  const uint32_t frame_size = (frames_len * sizeof(uint32_t[2])) + SEEKABLE_ZSTD_FOOTER_SIZE;
+  const size_t buf_len = sizeof(uint32_t[2]) + frame_size;
+  uchar *buf = MEM_mallocN(buf_len, __func__);
+  uchar *buf_step = buf;
+
+  /* Skippable frame header. */
+  ww_zstd_uint32_pack(buf_step, SEEKABLE_ZSTD_MAGIC_SKIPPABLE);
+  ww_zstd_uint32_pack(buf_step + 4, frame_size);
+  buf_step += 8;
+
+  /* Seek table entries (without checksums). */
+  for (uint32_t i = 0; i < frames_len * 2; i++) {
+    ww_zstd_uint32_pack(buf_step, zstd->seek_table[i]);
+    buf_step += 4;
+  }
+
+  /* Footer. */
+  ww_zstd_uint32_pack(buf_step, frames_len);
+  buf_step[4] = 0; /* Seek table descriptor. */
+  ww_zstd_uint32_pack(buf_step + 5, SEEKABLE_ZSTD_MAGIC_FOOTER);
+
+  const bool ok = (write(zstd->file_handle, buf, buf_len) == buf_len);
+  MEM_freeN(buf);
+  return ok;
+}
+
+static bool ww_open_zstd(WriteWrap *ww, const char *filepath)
+{
+  int file;
+
+  file = BLI_open(filepath, O_BINARY + O_WRONLY + O_CREAT + O_TRUNC, 0666);
+
+  if (file == -1) {
+    return false;
+  }
+
+  ZstdWriteWrap *zstd = MEM_callocN(sizeof(*zstd), __func__);
+  zstd->file_handle = file;
+  zstd->batch_frames_len = max_ii(BLI_task_scheduler_num_threads(), 1);
+
+  const size_t out_len_max = ZSTD_compressBound(SEEKABLE_ZSTD_FRAME_SIZE);
+  for (int b = 0; b < ARRAY_SIZE(zstd->batches); b++) {
+    ZstdFrameBatch *batch = &zstd->batches[b];
+    batch->task_pool = BLI_task_pool_create(NULL, TASK_PRIORITY_HIGH);
+    batch->frames = MEM_callocN(sizeof(*batch->frames) * zstd->batch_frames_len, __func__);
+    for (int i = 0; i < zstd->batch_frames_len; i++) {
+      batch->frames[i].in_buf = MEM_mallocN(SEEKABLE_ZSTD_FRAME_SIZE, __func__);
+      batch->frames[i].out_buf = MEM_mallocN(out_len_max, __func__);
+    }
+  }
+
+  zstd->seek_table_frames_alloc = 64;
+  zstd->seek_table = MEM_mallocN(sizeof(uint32_t[2]) * zstd->seek_table_frames_alloc, __func__);
+
+  FILE_HANDLE(ww) = zstd;
+  return true;
+}
+static bool ww_close_zstd(WriteWrap *ww)
+{
+  ZstdWriteWrap *zstd = FILE_HANDLE(ww);
+
+  /* Compress remaining data & write both batches (in order). */
+  ww_zstd_batch_swap(zstd);
+  ww_zstd_batch_write(zstd, &zstd->batches[!zstd->batch_active]);
+
+  bool ok = (zstd->error == false) && ww_zstd_write_seek_table(zstd);
+  if (close(zstd->file_handle) == -1) {
+    ok = false;
+  }
+
+  for (int b = 0; b < ARRAY_SIZE(zstd->batches); b++) {
+    ZstdFrameBatch *batch = &zstd->batches[b];
+    BLI_task_pool_free(batch->task_pool);
+    for (int i = 0; i < zstd->batch_frames_len; i++) {
+      MEM_freeN(batch->frames[i].in_buf);
+      MEM_freeN(batch->frames[i].out_buf);
+    }
+    MEM_freeN(batch->frames);
+  }
+  MEM_freeN(zstd->seek_table);
+  MEM_freeN(zstd);
+
+  return ok;
+}
+static size_t ww_write_zstd(WriteWrap *ww, const char *buf, size_t buf_len)
+{
+  ZstdWriteWrap *zstd = FILE_HANDLE(ww);
+  size_t buf_remaining = buf_len;
+
+  if (zstd->error) {
+    return 0;
+  }
+
+  while (buf_remaining != 0) {
+    ZstdFrameBatch *batch = &zstd->batches[zstd->batch_active];
+    ZstdFrame *frame = batch->frames_len ? &batch->frames[batch->frames_len - 1] : NULL;
+
+    if ((frame == NULL) || (frame->in_len == SEEKABLE_ZSTD_FRAME_SIZE)) {
+      if (batch->frames_len == zstd->batch_frames_len) {
+        ww_zstd_batch_swap(zstd);
+        if (zstd->error) {
+          return 0;
+        }
+        continue;
+      }
+      frame = &batch->frames[batch->frames_len++];
+    }
+
+    const size_t copy_len = MIN2(buf_remaining, SEEKABLE_ZSTD_FRAME_SIZE - frame->in_len);
+    memcpy(frame->in_buf + frame->in_len, buf, copy_len);
+    frame->in_len += copy_len;
+    buf += copy_len;
+    buf_remaining -= copy_len;
+  }
+
+  return buf_len;
+}
+#  undef FILE_HANDLE
+#endif /* WITH_ZSTD */
+
+/* memfile */
+#define FILE_HANDLE(ww) (ww)->_user_data.mem_handle
+
+static bool ww_open_memfile(WriteWrap *UNUSED(ww), const char *UNUSED(filepath))
+{
+  /* The #MemFileWriteData is passed in by the caller. */
+  return true;
+}
+static bool ww_close_memfile(WriteWrap *ww)
+{
+  BLO_memfile_write_finalize(FILE_HANDLE(ww));
+  return true;
+}
+static size_t ww_write_memfile(WriteWrap *ww, const char *buf, size_t buf_len)
+{
+  BLO_memfile_chunk_add(FILE_HANDLE(ww), buf, (uint)buf_len);
+  return buf_len;
+}
+#undef FILE_HANDLE
+
 /* --- end compression types --- */
 
 static void ww_handle_init(eWriteWrapType ww_type, WriteWrap *r_ww)
@@ -296,6 +584,24 @@ static void ww_handle_init(eWriteWrapType ww_type, WriteWrap *r_ww)
       r_ww->use_buf = false;
       break;
     }
+#ifdef WITH_ZSTD
+    case WW_WRAP_ZSTD: {
+      r_ww->open = ww_open_zstd;
+      r_ww->close = ww_close_zstd;
+      r_ww->write = ww_write_zstd;
+      /* Data is already buffered into frames. */
+      r_ww->use_buf = false;
+      break;
+    }
+#endif
+    case WW_WRAP_MEMFILE: {
+      r_ww->open = ww_open_memfile;
+      r_ww->close = ww_close_memfile;
+      r_ww->write = ww_write_memfile;
+      /* Keep chunks at #MYWRITE_BUFFER_SIZE, matching undo. */
+      r_ww->use_buf = true;
+      break;
+    }
     default: {
       r_ww->open = ww_open_none;
       r_ww->close = ww_close_none;
@@ -320,10 +626,8 @@ typedef struct {
   /** Number of bytes used in #WriteData.buf (flushed when exceeded). */
   int buf_used_len;
 
-#ifdef USE_WRITE_DATA_LEN
-  /** Total number of bytes written. */
+  /** Total number of bytes written, used as the file offset for the ID index. */
   size_t write_len;
-#endif
 
   /** Set on unlikely case of an error (ignores further file writing).  */
   bool error;
@@ -339,6 +643,15 @@ typedef struct {
    * Will be NULL for UNDO.
    */
   WriteWrap *ww;
+
+  /** Index of the written IDs, see #BlendIDIndexHeader. Will be NULL for UNDO. */
+  struct IDIndexWriteData *id_index;
+
+  /**
+   * When set, data is stored to be written later instead of being written,
+   * see #USE_PARALLEL_WRITE.
+   */
+  struct WriteDataRecord *record;
 } WriteData;
 
 typedef struct BlendWriter {
@@ -391,6 +704,51 @@ static void writedata_free(WriteData *wd)
 
 /** \} */
 
+#ifdef USE_PARALLEL_WRITE
+/* -------------------------------------------------------------------- */
+/** \name Write Data Recording
+ *
+ * Stores the data passed to #mywrite, so it can be written later, in order.
+ * \{ */
+
+typedef struct WriteDataRecord {
+  /** All data passed to #mywrite. */
+  uchar *buf;
+  size_t buf_len;
+  size_t buf_len_alloc;
+  /** The length of each #mywrite call, so they can be repeated exactly. */
+  int *calls_len;
+  int calls_num;
+  int calls_num_alloc;
+} WriteDataRecord;
+
+static void write_data_record_add(WriteDataRecord *record, const void *adr, int len)
+{
+  if (record->buf_len + (size_t)len > record->buf_len_alloc) {
+    record->buf_len_alloc = MAX2(record->buf_len_alloc * 2, record->buf_len + (size_t)len);
+    record->buf_len_alloc = MAX2(record->buf_len_alloc, MYWRITE_BUFFER_SIZE);
+    record->buf = MEM_reallocN(record->buf, record->buf_len_alloc);
+  }
+  if (record->calls_num == record->calls_num_alloc) {
+    record->calls_num_alloc = MAX2(record->calls_num_alloc * 2, 256);
+    record->calls_len = MEM_reallocN(record->calls_len,
+                                     sizeof(*record->calls_len) * (size_t)record->calls_num_alloc);
+  }
+
+  memcpy(&record->buf[record->buf_len], adr, (size_t)len);
+  record->buf_len += (size_t)len;
+  record->calls_len[record->calls_num++] = len;
+}
+
+static void write_data_record_free(WriteDataRecord *record)
+{
+  MEM_SAFE_FREE(record->buf);
+  MEM_SAFE_FREE(record->calls_len);
+}
+
+/** \} */
+#endif /* USE_PARALLEL_WRITE */
+
 /* -------------------------------------------------------------------- */
 /** \name Local Writing API 'mywrite'
  * \{ */
@@ -423,10 +781,15 @@ static void mywrite(WriteData *wd, const void *adr, int len)
     return;
   }
 
-#ifdef USE_WRITE_DATA_LEN
-  wd->write_len += len;
+#ifdef USE_PARALLEL_WRITE
+  if (wd->record) {
+    write_data_record_add(wd->record, adr, len);
+    return;
+  }
 #endif
 
+  wd->write_len += len;
+
   if (wd->buf == NULL) {
     writedata_do_write(wd, adr, len);
   }
@@ -461,6 +824,20 @@ static void mywrite(WriteData *wd, const void *adr, int len)
   }
 }
 
+#ifdef USE_PARALLEL_WRITE
+/**
+ * Write recorded data, making the same #mywrite calls as when the data was recorded.
+ */
+static void mywrite_record(WriteData *wd, const WriteDataRecord *record)
+{
+  const uchar *adr = record->buf;
+  for (int i = 0; i < record->calls_num; i++) {
+    mywrite(wd, adr, record->calls_len[i]);
+    adr += record->calls_len[i];
+  }
+}
+#endif
+
 /**
  * BeGiN initializer for mywrite
  * \param ww: File write wrapper.
@@ -652,6 +1029,183 @@ static void writelist_id(WriteData *wd, int filecode, const char *structname, co
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name ID Index Writing
+ *
+ * Store where each ID is written along with the IDs it uses, see #BlendIDIndexHeader.
+ * \{ */
+
+typedef struct IDIndexWriteData {
+  BlendIDIndexEntry *entries;
+  uint entries_len, entries_alloc;
+  /** ID pointers used by the entries, only resolved to entry indices when the index is written. */
+  const void **deps;
+  uint deps_len, deps_alloc;
+
+  uint64_t glob_offset;
+  uint64_t dna_offset;
+} IDIndexWriteData;
+
+static IDIndexWriteData *id_index_write_new(void)
+{
+  IDIndexWriteData *index = MEM_callocN(sizeof(*index), __func__);
+  index->entries_alloc = 1024;
+  index->entries = MEM_malloc_arrayN(index->entries_alloc, sizeof(*index->entries), __func__);
+  index->deps_alloc = 1024;
+  index->deps = MEM_malloc_arrayN(index->deps_alloc, sizeof(*index->deps), __func__);
+  return index;
+}
+
+static void id_index_write_free(IDIndexWriteData *index)
+{
+  MEM_freeN(index->entries);
+  MEM_freeN(index->deps);
+  MEM_freeN(index);
+}
+
+static void id_index_write_dep_add(IDIndexWriteData *index, const void *id_address)
+{
+  if (index->deps_len == index->deps_alloc) {
+    index->deps_alloc *= 2;
+    index->deps = MEM_reallocN(index->deps, sizeof(*index->deps) * index->deps_alloc);
+  }
+  index->deps[index->deps_len++] = id_address;
+  index->entries[index->entries_len - 1].deps_len++;
+}
+
+static int id_index_write_dep_add_cb(LibraryIDLinkCallbackData *cb_data)
+{
+  IDIndexWriteData *index = cb_data->user_data;
+  const ID *id = *cb_data->id_pointer;
+  /* Embedded IDs are written as part of their owner, loop-back pointers don't need to be read
+   * for the owner to be valid (e.g. a shape-key pointing back to its mesh). */
+  if (id != NULL && (cb_data->cb_flag & (IDWALK_CB_EMBEDDED | IDWALK_CB_LOOPBACK)) == 0) {
+    id_index_write_dep_add(index, id);
+  }
+  return IDWALK_RET_NOP;
+}
+
+/**
+ * Start an entry for an ID written at the current location,
+ * \a id_address is the address the ID is written at.
+ */
+static void id_index_write_entry_begin(WriteData *wd,
+                                       const ID *id,
+                                       const void *id_address,
+                                       int code)
+{
+  IDIndexWriteData *index = wd->id_index;
+  if (index == NULL) {
+    return;
+  }
+
+  if (index->entries_len == index->entries_alloc) {
+    index->entries_alloc *= 2;
+    index->entries = MEM_reallocN(index->entries, sizeof(*index->entries) * index->entries_alloc);
+  }
+
+  BlendIDIndexEntry *entry = &index->entries[index->entries_len++];
+  memset(entry, 0, sizeof(*entry));
+  entry->old = (uint64_t)(uintptr_t)id_address;
+  entry->offset = (uint64_t)wd->write_len;
+  entry->code = code;
+  entry->deps_start = index->deps_len;
+  BLI_strncpy(entry->name, id->name, sizeof(entry->name));
+}
+
+/**
+ * Finish the entry started by #id_index_write_entry_begin,
+ * once the ID and all its data has been written.
+ */
+static void id_index_write_entry_end(WriteData *wd, Main *bmain, ID *id)
+{
+  IDIndexWriteData *index = wd->id_index;
+  if (index == NULL) {
+    return;
+  }
+
+  BlendIDIndexEntry *entry = &index->entries[index->entries_len - 1];
+  entry->len = (uint64_t)wd->write_len - entry->offset;
+  if (entry->len == 0) {
+    /* Nothing written (deprecated ID types). */
+    index->entries_len--;
+    return;
+  }
+
+  if (id->lib != NULL) {
+    /* Link placeholders are read from the library they belong to. */
+    id_index_write_dep_add(index, id->lib);
+  }
+  else if (GS(id->name) != ID_LI) {
+    BKE_library_foreach_ID_link(bmain, id, id_index_write_dep_add_cb, index, IDWALK_READONLY);
+  }
+}
+
+/**
+ * Write the index as the last #DATA block, ID pointers are converted into entry indices,
+ * pointers to IDs that weren't written are skipped.
+ */
+static void id_index_write(WriteData *wd)
+{
+  IDIndexWriteData *index = wd->id_index;
+
+  GHash *entry_from_old = BLI_ghash_ptr_new_ex(__func__, index->entries_len);
+  for (uint i = 0; i < index->entries_len; i++) {
+    const BlendIDIndexEntry *entry = &index->entries[i];
+    BLI_ghash_insert(entry_from_old, (void *)(uintptr_t)entry->old, POINTER_FROM_UINT(i));
+  }
+
+  const size_t index_len_max = sizeof(BlendIDIndexHeader) +
+                               sizeof(BlendIDIndexEntry) * index->entries_len +
+                               sizeof(uint32_t) * index->deps_len + sizeof(BlendIDIndexFooter);
+  char *buf = MEM_callocN(index_len_max, __func__);
+
+  BlendIDIndexHeader *header = (BlendIDIndexHeader *)buf;
+  BlendIDIndexEntry *entries = (BlendIDIndexEntry *)(header + 1);
+  uint32_t *deps = (uint32_t *)(entries + index->entries_len);
+  uint32_t deps_len = 0;
+
+  for (uint i = 0; i < index->entries_len; i++) {
+    const BlendIDIndexEntry *entry_src = &index->entries[i];
+    BlendIDIndexEntry *entry = &entries[i];
+    *entry = *entry_src;
+    entry->deps_start = deps_len;
+    entry->deps_len = 0;
+    for (uint j = 0; j < entry_src->deps_len; j++) {
+      void **dep_p = BLI_ghash_lookup_p(entry_from_old, index->deps[entry_src->deps_start + j]);
+      if (dep_p == NULL) {
+        continue;
+      }
+      const uint32_t dep = POINTER_AS_UINT(*dep_p);
+      if (dep == i) {
+        continue;
+      }
+      deps[deps_len++] = dep;
+      entry->deps_len++;
+    }
+  }
+  BLI_ghash_free(entry_from_old, NULL, NULL);
+
+  memcpy(header->magic, BLEND_ID_INDEX_MAGIC, sizeof(header->magic));
+  header->version = BLEND_ID_INDEX_VERSION;
+  header->entries_len = index->entries_len;
+  header->deps_len = deps_len;
+  header->glob_offset = index->glob_offset;
+  header->dna_offset = index->dna_offset;
+
+  /* Copied since the footer is only 4 byte aligned. */
+  BlendIDIndexFooter footer = {0};
+  footer.len = (uint64_t)((const char *)(deps + deps_len) - buf) + sizeof(footer);
+  memcpy(footer.magic, BLEND_ID_INDEX_MAGIC, sizeof(footer.magic));
+  memcpy(deps + deps_len, &footer, sizeof(footer));
+
+  writedata(wd, DATA, (int)footer.len, buf);
+
+  MEM_freeN(buf);
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name Typed DNA File Writing
  *
@@ -3653,6 +4207,7 @@ static void write_libraries(WriteData *wd, Main *main)
       /* Not overridable. */
 
       BlendWriter writer = {wd};
+      id_index_write_entry_begin(wd, &main->curlib->id, main->curlib, ID_LI);
       writestruct(wd, ID_LI, Library, 1, main->curlib);
       write_iddata(&writer, &main->curlib->id);
 
@@ -3664,6 +4219,7 @@ static void write_libraries(WriteData *wd, Main *main)
           printf("write packed .blend: %s\n", main->curlib->filepath);
         }
       }
+      id_index_write_entry_end(wd, main, &main->curlib->id);
 
       /* Write link placeholders for all direct linked IDs. */
       while (a--) {
@@ -3679,7 +4235,9 @@ static void write_libraries(WriteData *wd, Main *main)
                   main->curlib->filepath_abs);
               BLI_assert(0);
             }
+            id_index_write_entry_begin(wd, id, id, ID_LINK_PLACEHOLDER);
             writestruct(wd, ID_LINK_PLACEHOLDER, ID, 1, id);
+            id_index_write_entry_end(wd, main, id);
           }
         }
       }
@@ -3757,60 +4315,361 @@ static void write_thumb(WriteData *wd, const BlendThumbnail *thumb)
 /** \name File Writing (Private)
  * \{ */
 
-/* if MemFile * there's filesave to memory */
-static bool write_file_handle(Main *mainvar,
-                              WriteWrap *ww,
-                              MemFile *compare,
-                              MemFile *current,
-                              int write_flags,
-                              bool use_userdef,
-                              const BlendThumbnail *thumb)
+/**
+ * Record the changes that happened up to this undo push in
+ * recalc_up_to_undo_push, and clear recalc_after_undo_push again
+ * to start accumulating for the next undo push.
+ */
+static void write_id_undo_recalc_store(ID *id)
 {
-  BHead bhead;
-  ListBase mainlist;
-  char buf[16];
-  WriteData *wd;
-
-  blo_split_main(&mainlist, mainvar);
-
-  wd = mywrite_begin(ww, compare, current);
-  BlendWriter writer = {wd};
-
-  sprintf(buf,
-          "BLENDER%c%c%.3d",
-          (sizeof(void *) == 8) ? '-' : '_',
-          (ENDIAN_ORDER == B_ENDIAN) ? 'V' : 'v',
-          BLENDER_FILE_VERSION);
+  id->recalc_up_to_undo_push = id->recalc_after_undo_push;
+  id->recalc_after_undo_push = 0;
 
-  mywrite(wd, buf, 12);
-
-  write_renderinfo(wd, mainvar);
-  write_thumb(wd, thumb);
-  write_global(wd, write_flags, mainvar);
-
-  /* The windowmanager and screen often change,
-   * avoid thumbnail detecting changes because of this. */
-  mywrite_flush(wd);
+  bNodeTree *nodetree = ntreeFromID(id);
+  if (nodetree != NULL) {
+    nodetree->id.recalc_up_to_undo_push = nodetree->id.recalc_after_undo_push;
+    nodetree->id.recalc_after_undo_push = 0;
+  }
+  if (GS(id->name) == ID_SCE) {
+    Scene *scene = (Scene *)id;
+    if (scene->master_collection != NULL) {
+      scene->master_collection->id.recalc_up_to_undo_push =
+          scene->master_collection->id.recalc_after_undo_push;
+      scene->master_collection->id.recalc_after_undo_push = 0;
+    }
+  }
+}
 
-  OverrideLibraryStorage *override_storage = wd->use_memfile ?
-                                                 NULL :
-                                                 BKE_lib_override_library_operations_store_init();
+/**
+ * Write a single ID and all its data.
+ *
+ * \param id_buffer: Temporary storage of at least the ID type's struct size.
+ */
+static void write_id_data(BlendWriter *writer, ID *id, void *id_buffer)
+{
+  memcpy(id_buffer, id, BKE_idtype_get_info_from_id(id)->struct_size);
 
-#define ID_BUFFER_STATIC_SIZE 8192
-  /* This outer loop allows to save first data-blocks from real mainvar,
-   * then the temp ones from override process,
-   * if needed, without duplicating whole code. */
-  Main *bmain = mainvar;
-  do {
-    ListBase *lbarray[MAX_LIBARRAY];
-    int a = set_listbasepointers(bmain, lbarray);
-    while (a--) {
-      ID *id = lbarray[a]->first;
+  ((ID *)id_buffer)->tag = 0;
+  /* Those listbase data change every time we add/remove an ID, and also often when
+   * renaming one (due to re-sorting). This avoids generating a lot of false 'is changed'
+   * detections between undo steps. */
+  ((ID *)id_buffer)->prev = NULL;
+  ((ID *)id_buffer)->next = NULL;
 
-      if (id == NULL || GS(id->name) == ID_LI) {
-        continue; /* Libraries are handled separately below. */
+  switch ((ID_Type)GS(id->name)) {
+    case ID_WM:
+      write_windowmanager(writer, (wmWindowManager *)id_buffer, id);
+      break;
+    case ID_WS:
+      write_workspace(writer, (WorkSpace *)id_buffer, id);
+      break;
+    case ID_SCR:
+      write_screen(writer, (bScreen *)id_buffer, id);
+      break;
+    case ID_MC:
+      write_movieclip(writer, (MovieClip *)id_buffer, id);
+      break;
+    case ID_MSK:
+      write_mask(writer, (Mask *)id_buffer, id);
+      break;
+    case ID_SCE:
+      write_scene(writer, (Scene *)id_buffer, id);
+      break;
+    case ID_CU:
+      write_curve(writer, (Curve *)id_buffer, id);
+      break;
+    case ID_MB:
+      write_mball(writer, (MetaBall *)id_buffer, id);
+      break;
+    case ID_IM:
+      write_image(writer, (Image *)id_buffer, id);
+      break;
+    case ID_CA:
+      write_camera(writer, (Camera *)id_buffer, id);
+      break;
+    case ID_LA:
+      write_light(writer, (Light *)id_buffer, id);
+      break;
+    case ID_LT:
+      write_lattice(writer, (Lattice *)id_buffer, id);
+      break;
+    case ID_VF:
+      write_vfont(writer, (VFont *)id_buffer, id);
+      break;
+    case ID_KE:
+      write_key(writer, (Key *)id_buffer, id);
+      break;
+    case ID_WO:
+      write_world(writer, (World *)id_buffer, id);
+      break;
+    case ID_TXT:
+      write_text(writer, (Text *)id_buffer, id);
+      break;
+    case ID_SPK:
+      write_speaker(writer, (Speaker *)id_buffer, id);
+      break;
+    case ID_LP:
+      write_probe(writer, (LightProbe *)id_buffer, id);
+      break;
+    case ID_SO:
+      write_sound(writer, (bSound *)id_buffer, id);
+      break;
+    case ID_GR:
+      write_collection(writer, (Collection *)id_buffer, id);
+      break;
+    case ID_AR:
+      write_armature(writer, (bArmature *)id_buffer, id);
+      break;
+    case ID_AC:
+      write_action(writer, (bAction *)id_buffer, id);
+      break;
+    case ID_OB:
+      write_object(writer, (Object *)id_buffer, id);
+      break;
+    case ID_MA:
+      write_material(writer, (Material *)id_buffer, id);
+      break;
+    case ID_TE:
+      write_texture(writer, (Tex *)id_buffer, id);
+      break;
+    case ID_ME:
+      write_mesh(writer, (Mesh *)id_buffer, id);
+      break;
+    case ID_PA:
+      write_particlesettings(writer, (ParticleSettings *)id_buffer, id);
+      break;
+    case ID_NT:
+      write_nodetree(writer, (bNodeTree *)id_buffer, id);
+      break;
+    case ID_BR:
+      write_brush(writer, (Brush *)id_buffer, id);
+      break;
+    case ID_PAL:
+      write_palette(writer, (Palette *)id_buffer, id);
+      break;
+    case ID_PC:
+      write_paintcurve(writer, (PaintCurve *)id_buffer, id);
+      break;
+    case ID_GD:
+      write_gpencil(writer, (bGPdata *)id_buffer, id);
+      break;
+    case ID_LS:
+      write_linestyle(writer, (FreestyleLineStyle *)id_buffer, id);
+      break;
+    case ID_CF:
+      write_cachefile(writer, (CacheFile *)id_buffer, id);
+      break;
+    case ID_HA:
+      write_hair(writer, (Hair *)id_buffer, id);
+      break;
+    case ID_PT:
+      write_pointcloud(writer, (PointCloud *)id_buffer, id);
+      break;
+    case ID_VO:
+      write_volume(writer, (Volume *)id_buffer, id);
+      break;
+    case ID_SIM:
+      write_simulation(writer, (Simulation *)id_buffer, id);
+      break;
+    case ID_LI:
+      /* Do nothing, handled below - and should never be reached. */
+      BLI_assert(0);
+      break;
+    case ID_IP:
+      /* Do nothing, deprecated. */
+      break;
+    default:
+      /* Should never be reached. */
+      BLI_assert(0);
+      break;
+  }
+}
+
+#define ID_BUFFER_STATIC_SIZE 8192
+
+#ifdef USE_PARALLEL_WRITE
+/* Number of IDs written at once, per thread (limits memory use). */
+#  define WRITE_PARALLEL_BATCH_PER_THREAD 4
+
+typedef struct WriteIDParallelData {
+  const WriteData *wd;
+  ID **ids;
+  WriteDataRecord *records;
+} WriteIDParallelData;
+
+static void write_id_parallel_fn(void *__restrict userdata,
+                                 const int i,
+                                 const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const WriteIDParallelData *data = userdata;
+  ID *id = data->ids[i];
+
+  WriteData wd_record = {
+      .sdna = data->wd->sdna,
+      .use_memfile = data->wd->use_memfile,
+      .record = &data->records[i],
+  };
+  BlendWriter writer = {&wd_record};
+
+  char id_buffer_static[ID_BUFFER_STATIC_SIZE];
+  void *id_buffer = id_buffer_static;
+  const size_t idtype_struct_size = BKE_idtype_get_info_from_id(id)->struct_size;
+  if (idtype_struct_size > ID_BUFFER_STATIC_SIZE) {
+    BLI_assert(0);
+    id_buffer = MEM_mallocN(idtype_struct_size, __func__);
+  }
+
+  write_id_data(&writer, id, id_buffer);
+
+  if (id_buffer != id_buffer_static) {
+    MEM_freeN(id_buffer);
+  }
+}
+
+/**
+ * Write a list of IDs (starting with \a id), serializing IDs on multiple threads.
+ * The output is identical to writing them one after another (matching undo chunks too).
+ */
+static void write_id_list_parallel(WriteData *wd,
+                                   Main *bmain,
+                                   OverrideLibraryStorage *override_storage,
+                                   ID *id)
+{
+  const int batch_len_max = BLI_task_scheduler_num_threads() * WRITE_PARALLEL_BATCH_PER_THREAD;
+  ID **ids = MEM_malloc_arrayN((size_t)batch_len_max, sizeof(*ids), __func__);
+  bool *do_override = MEM_malloc_arrayN((size_t)batch_len_max, sizeof(*do_override), __func__);
+  WriteDataRecord *records = MEM_malloc_arrayN(
+      (size_t)batch_len_max, sizeof(*records), __func__);
+
+  while (id) {
+    int batch_len = 0;
+    for (; id && (batch_len < batch_len_max); id = id->next, batch_len++) {
+      /* We should never attempt to write non-regular IDs
+       * (i.e. all kind of temp/runtime ones). */
+      BLI_assert(
+          (id->tag & (LIB_TAG_NO_MAIN | LIB_TAG_NO_USER_REFCOUNT | LIB_TAG_NOT_ALLOCATED)) == 0);
+
+      ids[batch_len] = id;
+      do_override[batch_len] = !ELEM(override_storage, NULL, bmain) &&
+                               ID_IS_OVERRIDE_LIBRARY_REAL(id);
+
+      if (do_override[batch_len]) {
+        BKE_lib_override_library_operations_store_start(bmain, override_storage, id);
+      }
+
+      if (wd->use_memfile) {
+        write_id_undo_recalc_store(id);
+      }
+    }
+
+    memset(records, 0, sizeof(*records) * (size_t)batch_len);
+
+    WriteIDParallelData data = {
+        .wd = wd,
+        .ids = ids,
+        .records = records,
+    };
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    settings.min_iter_per_thread = 1;
+    BLI_task_parallel_range(0, batch_len, &data, write_id_parallel_fn, &settings);
+
+    for (int i = 0; i < batch_len; i++) {
+      ID *id_write = ids[i];
+
+      mywrite_id_begin(wd, id_write);
+      id_index_write_entry_begin(wd, id_write, id_write, GS(id_write->name));
+
+      mywrite_record(wd, &records[i]);
+      write_data_record_free(&records[i]);
+
+      if (do_override[i]) {
+        BKE_lib_override_library_operations_store_end(override_storage, id_write);
       }
 
+      id_index_write_entry_end(wd, bmain, id_write);
+      mywrite_id_end(wd, id_write);
+    }
+  }
+
+  MEM_freeN(ids);
+  MEM_freeN(do_override);
+  MEM_freeN(records);
+}
+#endif /* USE_PARALLEL_WRITE */
+
+/* if MemFile * there's filesave to memory */
+static bool write_file_handle(Main *mainvar,
+                              WriteWrap *ww,
+                              MemFile *compare,
+                              MemFile *current,
+                              int write_flags,
+                              bool use_userdef,
+                              const BlendThumbnail *thumb)
+{
+  BHead bhead;
+  ListBase mainlist;
+  char buf[16];
+  WriteData *wd;
+
+  blo_split_main(&mainlist, mainvar);
+
+  wd = mywrite_begin(ww, compare, current);
+  BlendWriter writer = {wd};
+
+  if (wd->use_memfile == false) {
+    wd->id_index = id_index_write_new();
+  }
+
+  sprintf(buf,
+          "BLENDER%c%c%.3d",
+          (sizeof(void *) == 8) ? '-' : '_',
+          (ENDIAN_ORDER == B_ENDIAN) ? 'V' : 'v',
+          BLENDER_FILE_VERSION);
+
+  mywrite(wd, buf, 12);
+
+  write_renderinfo(wd, mainvar);
+  write_thumb(wd, thumb);
+  if (wd->id_index) {
+    wd->id_index->glob_offset = wd->write_len;
+  }
+  write_global(wd, write_flags, mainvar);
+
+  /* The windowmanager and screen often change,
+   * avoid thumbnail detecting changes because of this. */
+  mywrite_flush(wd);
+
+  OverrideLibraryStorage *override_storage = wd->use_memfile ?
+                                                 NULL :
+                                                 BKE_lib_override_library_operations_store_init();
+
+#ifdef USE_PARALLEL_WRITE
+  const bool use_parallel = BLI_task_scheduler_num_threads() > 1;
+#endif
+
+  /* This outer loop allows to save first data-blocks from real mainvar,
+   * then the temp ones from override process,
+   * if needed, without duplicating whole code. */
+  Main *bmain = mainvar;
+  do {
+    ListBase *lbarray[MAX_LIBARRAY];
+    int a = set_listbasepointers(bmain, lbarray);
+    while (a--) {
+      ID *id = lbarray[a]->first;
+
+      if (id == NULL || GS(id->name) == ID_LI) {
+        continue; /* Libraries are handled separately below. */
+      }
+
+#ifdef USE_PARALLEL_WRITE
+      if (use_parallel && (id->next != NULL)) {
+        write_id_list_parallel(wd, bmain, override_storage, id);
+        mywrite_flush(wd);
+        continue;
+      }
+#endif
+
       char id_buffer_static[ID_BUFFER_STATIC_SIZE];
       void *id_buffer = id_buffer_static;
       const size_t idtype_struct_size = BKE_idtype_get_info_from_id(id)->struct_size;
@@ -3833,170 +4692,19 @@ static bool write_file_handle(Main *mainvar,
         }
 
         if (wd->use_memfile) {
-          /* Record the changes that happened up to this undo push in
-           * recalc_up_to_undo_push, and clear recalc_after_undo_push again
-           * to start accumulating for the next undo push. */
-          id->recalc_up_to_undo_push = id->recalc_after_undo_push;
-          id->recalc_after_undo_push = 0;
-
-          bNodeTree *nodetree = ntreeFromID(id);
-          if (nodetree != NULL) {
-            nodetree->id.recalc_up_to_undo_push = nodetree->id.recalc_after_undo_push;
-            nodetree->id.recalc_after_undo_push = 0;
-          }
-          if (GS(id->name) == ID_SCE) {
-            Scene *scene = (Scene *)id;
-            if (scene->master_collection != NULL) {
-              scene->master_collection->id.recalc_up_to_undo_push =
-                  scene->master_collection->id.recalc_after_undo_push;
-              scene->master_collection->id.recalc_after_undo_push = 0;
-            }
-          }
+          write_id_undo_recalc_store(id);
         }
 
         mywrite_id_begin(wd, id);
+        id_index_write_entry_begin(wd, id, id, GS(id->name));
 
-        memcpy(id_buffer, id, idtype_struct_size);
-
-        ((ID *)id_buffer)->tag = 0;
-        /* Those listbase data change every time we add/remove an ID, and also often when
-         * renaming one (due to re-sorting). This avoids generating a lot of false 'is changed'
-         * detections between undo steps. */
-        ((ID *)id_buffer)->prev = NULL;
-        ((ID *)id_buffer)->next = NULL;
-
-        switch ((ID_Type)GS(id->name)) {
-          case ID_WM:
-            write_windowmanager(&writer, (wmWindowManager *)id_buffer, id);
-            break;
-          case ID_WS:
-            write_workspace(&writer, (WorkSpace *)id_buffer, id);
-            break;
-          case ID_SCR:
-            write_screen(&writer, (bScreen *)id_buffer, id);
-            break;
-          case ID_MC:
-            write_movieclip(&writer, (MovieClip *)id_buffer, id);
-            break;
-          case ID_MSK:
-            write_mask(&writer, (Mask *)id_buffer, id);
-            break;
-          case ID_SCE:
-            write_scene(&writer, (Scene *)id_buffer, id);
-            break;
-          case ID_CU:
-            write_curve(&writer, (Curve *)id_buffer, id);
-            break;
-          case ID_MB:
-            write_mball(&writer, (MetaBall *)id_buffer, id);
-            break;
-          case ID_IM:
-            write_image(&writer, (Image *)id_buffer, id);
-            break;
-          case ID_CA:
-            write_camera(&writer, (Camera *)id_buffer, id);
-            break;
-          case ID_LA:
-            write_light(&writer, (Light *)id_buffer, id);
-            break;
-          case ID_LT:
-            write_lattice(&writer, (Lattice *)id_buffer, id);
-            break;
-          case ID_VF:
-            write_vfont(&writer, (VFont *)id_buffer, id);
-            break;
-          case ID_KE:
-            write_key(&writer, (Key *)id_buffer, id);
-            break;
-          case ID_WO:
-            write_world(&writer, (World *)id_buffer, id);
-            break;
-          case ID_TXT:
-            write_text(&writer, (Text *)id_buffer, id);
-            break;
-          case ID_SPK:
-            write_speaker(&writer, (Speaker *)id_buffer, id);
-            break;
-          case ID_LP:
-            write_probe(&writer, (LightProbe *)id_buffer, id);
-            break;
-          case ID_SO:
-            write_sound(&writer, (bSound *)id_buffer, id);
-            break;
-          case ID_GR:
-            write_collection(&writer, (Collection *)id_buffer, id);
-            break;
-          case ID_AR:
-            write_armature(&writer, (bArmature *)id_buffer, id);
-            break;
-          case ID_AC:
-            write_action(&writer, (bAction *)id_buffer, id);
-            break;
-          case ID_OB:
-            write_object(&writer, (Object *)id_buffer, id);
-            break;
-          case ID_MA:
-            write_material(&writer, (Material *)id_buffer, id);
-            break;
-          case ID_TE:
-            write_texture(&writer, (Tex *)id_buffer, id);
-            break;
-          case ID_ME:
-            write_mesh(&writer, (Mesh *)id_buffer, id);
-            break;
-          case ID_PA:
-            write_particlesettings(&writer, (ParticleSettings *)id_buffer, id);
-            break;
-          case ID_NT:
-            write_nodetree(&writer, (bNodeTree *)id_buffer, id);
-            break;
-          case ID_BR:
-            write_brush(&writer, (Brush *)id_buffer, id);
-            break;
-          case ID_PAL:
-            write_palette(&writer, (Palette *)id_buffer, id);
-            break;
-          case ID_PC:
-            write_paintcurve(&writer, (PaintCurve *)id_buffer, id);
-            break;
-          case ID_GD:
-            write_gpencil(&writer, (bGPdata *)id_buffer, id);
-            break;
-          case ID_LS:
-            write_linestyle(&writer, (FreestyleLineStyle *)id_buffer, id);
-            break;
-          case ID_CF:
-            write_cachefile(&writer, (CacheFile *)id_buffer, id);
-            break;
-          case ID_HA:
-            write_hair(&writer, (Hair *)id_buffer, id);
-            break;
-          case ID_PT:
-            write_pointcloud(&writer, (PointCloud *)id_buffer, id);
-            break;
-          case ID_VO:
-            write_volume(&writer, (Volume *)id_buffer, id);
-            break;
-          case ID_SIM:
-            write_simulation(&writer, (Simulation *)id_buffer, id);
-            break;
-          case ID_LI:
-            /* Do nothing, handled below - and should never be reached. */
-            BLI_assert(0);
-            break;
-          case ID_IP:
-            /* Do nothing, deprecated. */
-            break;
-          default:
-            /* Should never be reached. */
-            BLI_assert(0);
-            break;
-        }
+        write_id_data(&writer, id, id_buffer);
 
         if (do_override) {
           BKE_lib_override_library_operations_store_end(override_storage, id);
         }
 
+        id_index_write_entry_end(wd, bmain, id);
         mywrite_id_end(wd, id);
       }
 
@@ -4027,8 +4735,18 @@ static bool write_file_handle(Main *mainvar,
    *
    * Note that we *borrow* the pointer to 'DNAstr',
    * so writing each time uses the same address and doesn't cause unnecessary undo overhead. */
+  if (wd->id_index) {
+    wd->id_index->dna_offset = wd->write_len;
+  }
   writedata(wd, DNA1, wd->sdna->data_len, wd->sdna->data);
 
+  /* The index must be the last block, so it can be found from the end of the file. */
+  if (wd->id_index) {
+    id_index_write(wd);
+    id_index_write_free(wd->id_index);
+    wd->id_index = NULL;
+  }
+
   /* end of file */
   memset(&bhead, 0, sizeof(BHead));
   bhead.code = ENDB;
@@ -4081,6 +4799,135 @@ static bool do_history(const char *name, ReportList *reports)
   return 0;
 }
 
+static eWriteWrapType write_file_ww_type(const int write_flags)
+{
+  if (write_flags & G_FILE_COMPRESS) {
+#ifdef WITH_ZSTD
+    return WW_WRAP_ZSTD;
+#else
+    return WW_WRAP_ZLIB;
+#endif
+  }
+  return WW_WRAP_NONE;
+}
+
+#define WRITE_FILE_PATH_LIST_FLAG \
+  (BKE_BPATH_TRAVERSE_SKIP_LIBRARY | BKE_BPATH_TRAVERSE_SKIP_MULTIFILE)
+
+/**
+ * Remapping of relative paths to new file location.
+ *
+ * \return Paths to restore with #write_file_path_remap_end (only set for \a use_save_as_copy).
+ */
+static void *write_file_path_remap_begin(Main *mainvar,
+                                         const char *filepath,
+                                         eBLO_WritePathRemap remap_mode,
+                                         const bool use_save_as_copy)
+{
+  void *path_list_backup = NULL;
+
+  if (remap_mode == BLO_WRITE_PATH_REMAP_NONE) {
+    return path_list_backup;
+  }
+
+  if (remap_mode == BLO_WRITE_PATH_REMAP_RELATIVE) {
+    /* Make all relative as none of the existing paths can be relative in an unsaved document.
+     */
+    if (G.relbase_valid == false) {
+      remap_mode = BLO_WRITE_PATH_REMAP_RELATIVE_ALL;
+    }
+  }
+
+  char dir_src[FILE_MAX];
+  char dir_dst[FILE_MAX];
+  BLI_split_dir_part(mainvar->name, dir_src, sizeof(dir_src));
+  BLI_split_dir_part(filepath, dir_dst, sizeof(dir_dst));
+
+  /* Just in case there is some subtle difference. */
+  BLI_path_normalize(mainvar->name, dir_dst);
+  BLI_path_normalize(mainvar->name, dir_src);
+
+  /* Only for relative, not relative-all, as this means making existing paths relative. */
+  if (remap_mode == BLO_WRITE_PATH_REMAP_RELATIVE) {
+    if (G.relbase_valid && (BLI_path_cmp(dir_dst, dir_src) == 0)) {
+      /* Saved to same path. Nothing to do. */
+      remap_mode = BLO_WRITE_PATH_REMAP_NONE;
+    }
+  }
+  else if (remap_mode == BLO_WRITE_PATH_REMAP_ABSOLUTE) {
+    if (G.relbase_valid == false) {
+      /* Unsaved, all paths are absolute.Even if the user manages to set a relative path,
+       * there is no base-path that can be used to make it absolute. */
+      remap_mode = BLO_WRITE_PATH_REMAP_NONE;
+    }
+  }
+
+  if (remap_mode != BLO_WRITE_PATH_REMAP_NONE) {
+    /* Check if we need to backup and restore paths. */
+    if (UNLIKELY(use_save_as_copy)) {
+      path_list_backup = BKE_bpath_list_backup(mainvar, WRITE_FILE_PATH_LIST_FLAG);
+    }
+
+    switch (remap_mode) {
+      case BLO_WRITE_PATH_REMAP_RELATIVE:
+        /* Saved, make relative paths relative to new location (if possible). */
+        BKE_bpath_relative_rebase(mainvar, dir_src, dir_dst, NULL);
+        break;
+      case BLO_WRITE_PATH_REMAP_RELATIVE_ALL:
+        /* Make all relative (when requested or unsaved). */
+        BKE_bpath_relative_convert(mainvar, dir_dst, NULL);
+        break;
+      case BLO_WRITE_PATH_REMAP_ABSOLUTE:
+        /* Make all absolute (when requested or unsaved). */
+        BKE_bpath_absolute_convert(mainvar, dir_src, NULL);
+        break;
+      case BLO_WRITE_PATH_REMAP_NONE:
+        BLI_assert(0); /* Unreachable. */
+        break;
+    }
+  }
+
+  return path_list_backup;
+}
+
+static void write_file_path_remap_end(Main *mainvar, void *path_list_backup)
+{
+  if (UNLIKELY(path_list_backup)) {
+    BKE_bpath_list_restore(mainvar, WRITE_FILE_PATH_LIST_FLAG, path_list_backup);
+    BKE_bpath_list_free(path_list_backup);
+  }
+}
+
+#undef WRITE_FILE_PATH_LIST_FLAG
+
+/**
+ * Move the fully written temporary file into place.
+ *
+ * \return Success.
+ */
+static bool write_file_commit(const char *tempname,
+                              const char *filepath,
+                              const bool use_save_versions,
+                              ReportList *reports)
+{
+  /* file save to temporary file was successful */
+  /* now do reverse file history (move .blend1 -> .blend2, .blend -> .blend1) */
+  if (use_save_versions) {
+    const bool err_hist = do_history(filepath, reports);
+    if (err_hist) {
+      BKE_report(reports, RPT_ERROR, "Version backup failed (file saved with @)");
+      return false;
+    }
+  }
+
+  if (BLI_rename(tempname, filepath) != 0) {
+    BKE_report(reports, RPT_ERROR, "Cannot change old file (file saved with @)");
+    return false;
+  }
+
+  return true;
+}
+
 /** \} */
 
 /* -------------------------------------------------------------------- */
@@ -4097,19 +4944,11 @@ bool BLO_write_file(Main *mainvar,
                     ReportList *reports)
 {
   char tempname[FILE_MAX + 1];
-  eWriteWrapType ww_type;
   WriteWrap ww;
 
-  eBLO_WritePathRemap remap_mode = params->remap_mode;
-  const bool use_save_versions = params->use_save_versions;
-  const bool use_save_as_copy = params->use_save_as_copy;
   const bool use_userdef = params->use_userdef;
   const BlendThumbnail *thumb = params->thumb;
 
-  /* path backup/restore */
-  void *path_list_backup = NULL;
-  const int path_list_flag = (BKE_BPATH_TRAVERSE_SKIP_LIBRARY | BKE_BPATH_TRAVERSE_SKIP_MULTIFILE);
-
   if (G.debug & G_DEBUG_IO && mainvar->lock != NULL) {
     BKE_report(reports, RPT_INFO, "Checking sanity of current .blend file *BEFORE* save to disk");
     BLO_main_validate_libraries(mainvar, reports);
@@ -4119,14 +4958,7 @@ bool BLO_write_file(Main *mainvar,
   /* open temporary file, so we preserve the original in case we crash */
   BLI_snprintf(tempname, sizeof(tempname), "%s@", filepath);
 
-  if (write_flags & G_FILE_COMPRESS) {
-    ww_type = WW_WRAP_ZLIB;
-  }
-  else {
-    ww_type = WW_WRAP_NONE;
-  }
-
-  ww_handle_init(ww_type, &ww);
+  ww_handle_init(write_file_ww_type(write_flags), &ww);
 
   if (ww.open(&ww, tempname) == false) {
     BKE_reportf(
@@ -4134,76 +4966,16 @@ bool BLO_write_file(Main *mainvar,
     return 0;
   }
 
-  /* Remapping of relative paths to new file location. */
-  if (remap_mode != BLO_WRITE_PATH_REMAP_NONE) {
-
-    if (remap_mode == BLO_WRITE_PATH_REMAP_RELATIVE) {
-      /* Make all relative as none of the existing paths can be relative in an unsaved document.
-       */
-      if (G.relbase_valid == false) {
-        remap_mode = BLO_WRITE_PATH_REMAP_RELATIVE_ALL;
-      }
-    }
-
-    char dir_src[FILE_MAX];
-    char dir_dst[FILE_MAX];
-    BLI_split_dir_part(mainvar->name, dir_src, sizeof(dir_src));
-    BLI_split_dir_part(filepath, dir_dst, sizeof(dir_dst));
-
-    /* Just in case there is some subtle difference. */
-    BLI_path_normalize(mainvar->name, dir_dst);
-    BLI_path_normalize(mainvar->name, dir_src);
-
-    /* Only for relative, not relative-all, as this means making existing paths relative. */
-    if (remap_mode == BLO_WRITE_PATH_REMAP_RELATIVE) {
-      if (G.relbase_valid && (BLI_path_cmp(dir_dst, dir_src) == 0)) {
-        /* Saved to same path. Nothing to do. */
-        remap_mode = BLO_WRITE_PATH_REMAP_NONE;
-      }
-    }
-    else if (remap_mode == BLO_WRITE_PATH_REMAP_ABSOLUTE) {
-      if (G.relbase_valid == false) {
-        /* Unsaved, all paths are absolute.Even if the user manages to set a relative path,
-         * there is no base-path that can be used to make it absolute. */
-        remap_mode = BLO_WRITE_PATH_REMAP_NONE;
-      }
-    }
-
-    if (remap_mode != BLO_WRITE_PATH_REMAP_NONE) {
-      /* Check if we need to backup and restore paths. */
-      if (UNLIKELY(use_save_as_copy)) {
-        path_list_backup = BKE_bpath_list_backup(mainvar, path_list_flag);
-      }
-
-      switch (remap_mode) {
-        case BLO_WRITE_PATH_REMAP_RELATIVE:
-          /* Saved, make relative paths relative to new location (if possible). */
-          BKE_bpath_relative_rebase(mainvar, dir_src, dir_dst, NULL);
-          break;
-        case BLO_WRITE_PATH_REMAP_RELATIVE_ALL:
-          /* Make all relative (when requested or unsaved). */
-          BKE_bpath_relative_convert(mainvar, dir_dst, NULL);
-          break;
-        case BLO_WRITE_PATH_REMAP_ABSOLUTE:
-          /* Make all absolute (when requested or unsaved). */
-          BKE_bpath_absolute_convert(mainvar, dir_src, NULL);
-          break;
-        case BLO_WRITE_PATH_REMAP_NONE:
-          BLI_assert(0); /* Unreachable. */
-          break;
-      }
-    }
-  }
+  /* path backup/restore */
+  void *path_list_backup = write_file_path_remap_begin(
+      mainvar, filepath, params->remap_mode, params->use_save_as_copy);
 
   /* actual file writing */
   const bool err = write_file_handle(mainvar, &ww, NULL, NULL, write_flags, use_userdef, thumb);
 
   ww.close(&ww);
 
-  if (UNLIKELY(path_list_backup)) {
-    BKE_bpath_list_restore(mainvar, path_list_flag, path_list_backup);
-    BKE_bpath_list_free(path_list_backup);
-  }
+  write_file_path_remap_end(mainvar, path_list_backup);
 
   if (err) {
     BKE_report(reports, RPT_ERROR, strerror(errno));
@@ -4212,18 +4984,7 @@ bool BLO_write_file(Main *mainvar,
     return 0;
   }
 
-  /* file save to temporary file was successful */
-  /* now do reverse file history (move .blend1 -> .blend2, .blend -> .blend1) */
-  if (use_save_versions) {
-    const bool err_hist = do_history(filepath, reports);
-    if (err_hist) {
-      BKE_report(reports, RPT_ERROR, "Version backup failed (file saved with @)");
-      return 0;
-    }
-  }
-
-  if (BLI_rename(tempname, filepath) != 0) {
-    BKE_report(reports, RPT_ERROR, "Cannot change old file (file saved with @)");
+  if (!write_file_commit(tempname, filepath, params->use_save_versions, reports)) {
     return 0;
   }
 
@@ -4248,6 +5009,202 @@ bool BLO_write_file_mem(Main *mainvar, MemFile *compare, MemFile *current, int w
   return (err == 0);
 }
 
+/**
+ * An in-memory copy of a file, so it can be compressed & written to disk from a thread
+ * while the user continues editing, see #BLO_write_file_snapshot.
+ */
+struct BlendFileWriteSnapshot {
+  /** Uncompressed file contents. */
+  MemFile memfile;
+  char filepath[FILE_MAX];
+  int write_flags;
+  bool use_save_versions;
+};
+
+static BlendFileWriteSnapshot *write_file_snapshot_new(const char *filepath,
+                                                       const int write_flags,
+                                                       const bool use_save_versions)
+{
+  BlendFileWriteSnapshot *snapshot = MEM_callocN(sizeof(*snapshot), __func__);
+  BLI_strncpy(snapshot->filepath, filepath, sizeof(snapshot->filepath));
+  snapshot->write_flags = write_flags;
+  snapshot->use_save_versions = use_save_versions;
+  return snapshot;
+}
+
+/**
+ * Store the file contents in memory, this is the only part of saving that needs access to
+ * \a mainvar. Use #BLO_write_file_snapshot_write to write the file to \a filepath.
+ *
+ * \return The snapshot or NULL on failure.
+ */
+BlendFileWriteSnapshot *BLO_write_file_snapshot(Main *mainvar,
+                                                const char *filepath,
+                                                const int write_flags,
+                                                const struct BlendFileWriteParams *params,
+                                                ReportList *reports)
+{
+  BlendFileWriteSnapshot *snapshot = write_file_snapshot_new(
+      filepath, write_flags, params->use_save_versions);
+
+  if (G.debug & G_DEBUG_IO && mainvar->lock != NULL) {
+    BKE_report(reports, RPT_INFO, "Checking sanity of current .blend file *BEFORE* save to disk");
+    BLO_main_validate_libraries(mainvar, reports);
+    BLO_main_validate_shapekeys(mainvar, reports);
+  }
+
+  MemFileWriteData mem_data = {NULL};
+  BLO_memfile_write_init(&mem_data, &snapshot->memfile, NULL);
+
+  WriteWrap ww;
+  ww_handle_init(WW_WRAP_MEMFILE, &ww);
+  ww._user_data.mem_handle = &mem_data;
+  ww.open(&ww, filepath);
+
+  void *path_list_backup = write_file_path_remap_begin(
+      mainvar, filepath, params->remap_mode, params->use_save_as_copy);
+
+  const bool err = write_file_handle(
+      mainvar, &ww, NULL, NULL, write_flags, params->use_userdef, params->thumb);
+
+  ww.close(&ww);
+
+  write_file_path_remap_end(mainvar, path_list_backup);
+
+  if (err) {
+    BKE_report(reports, RPT_ERROR, "Unable to store the file contents for saving");
+    BLO_write_file_snapshot_free(snapshot);
+    return NULL;
+  }
+
+  return snapshot;
+}
+
+/**
+ * Store an undo step, for writing with #BLO_write_file_snapshot_write
+ * (uncompressed, without version backups).
+ */
+BlendFileWriteSnapshot *BLO_write_file_snapshot_from_memfile(MemFile *memfile,
+                                                             const char *filepath)
+{
+  BlendFileWriteSnapshot *snapshot = write_file_snapshot_new(filepath, 0, false);
+
+  /* Chunks are shared (not copied) as their contents match. */
+  BLO_memfile_uncompress(memfile);
+
+  MemFileWriteData mem_data = {NULL};
+  BLO_memfile_write_init(&mem_data, &snapshot->memfile, NULL);
+  LISTBASE_FOREACH (const MemFileChunk *, chunk, &memfile->chunks) {
+    BLO_memfile_chunk_add(&mem_data, chunk->buf, chunk->size);
+  }
+  BLO_memfile_write_finalize(&mem_data);
+
+  return snapshot;
+}
+
+/**
+ * Flush the contents of \a filepath to the disk, so renaming it over an existing file
+ * can't leave an incomplete file in its place when the system crashes.
+ */
+static bool write_file_sync(const char *filepath)
+{
+  const int file = BLI_open(filepath, O_BINARY | O_RDWR, 0);
+  if (file == -1) {
+    return false;
+  }
+#ifdef WIN32
+  const bool ok = (_commit(file) == 0);
+#else
+  const bool ok = (fsync(file) == 0);
+#endif
+  close(file);
+  return ok;
+}
+
+/**
+ * Compress and write the snapshot to disk, using a temporary file that is renamed on success.
+ *
+ * This doesn't access any global data-base state, so it can run in a thread.
+ *
+ * \param stop: When not NULL, writing is cancelled once it's set, leaving the existing file as is.
+ * \param r_progress: When not NULL, set to the fraction of the file written.
+ * \return Success, false when cancelled.
+ */
+bool BLO_write_file_snapshot_write(BlendFileWriteSnapshot *snapshot,
+                                   const short *stop,
+                                   float *r_progress,
+                                   ReportList *reports)
+{
+  char tempname[FILE_MAX + 1];
+  WriteWrap ww;
+
+  BLI_snprintf(tempname, sizeof(tempname), "%s@", snapshot->filepath);
+
+  ww_handle_init(write_file_ww_type(snapshot->write_flags), &ww);
+
+  if (ww.open(&ww, tempname) == false) {
+    BKE_reportf(
+        reports, RPT_ERROR, "Cannot open file %s for writing: %s", tempname, strerror(errno));
+    return false;
+  }
+
+  const size_t size_total = MAX2(snapshot->memfile.size, 1);
+  size_t size_written = 0;
+  bool err = false;
+  bool is_stopped = false;
+
+  LISTBASE_FOREACH (const MemFileChunk *, chunk, &snapshot->memfile.chunks) {
+    if (stop && *stop) {
+      is_stopped = true;
+      break;
+    }
+    if (ww.write(&ww, chunk->buf, chunk->size) != chunk->size) {
+      err = true;
+      break;
+    }
+    size_written += chunk->size;
+    if (r_progress) {
+      *r_progress = (float)((double)size_written / (double)size_total);
+    }
+  }
+
+  if (ww.close(&ww) == false) {
+    err = true;
+  }
+
+  if (err) {
+    BKE_report(reports, RPT_ERROR, strerror(errno));
+    remove(tempname);
+    return false;
+  }
+
+  /* Compressing the last frame when closing can take a while, check again before syncing. */
+  if (is_stopped || (stop && *stop)) {
+    remove(tempname);
+    return false;
+  }
+
+  if (write_file_sync(tempname) == false) {
+    BKE_reportf(reports, RPT_ERROR, "Cannot write file %s: %s", tempname, strerror(errno));
+    remove(tempname);
+    return false;
+  }
+
+  /* Last chance to cancel, renaming the file replaces the existing one. */
+  if (stop && *stop) {
+    remove(tempname);
+    return false;
+  }
+
+  return write_file_commit(tempname, snapshot->filepath, snapshot->use_save_versions, reports);
+}
+
+void BLO_write_file_snapshot_free(BlendFileWriteSnapshot *snapshot)
+{
+  BLO_memfile_free(&snapshot->memfile);
+  MEM_freeN(snapshot);
+}
+
 void BLO_write_raw(BlendWriter *writer, int size_in_bytes, const void *data_ptr)
 {
   writedata(writer->wd, DATA, size_in_bytes, data_ptr);
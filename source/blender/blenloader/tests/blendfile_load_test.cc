@@ -17,6 +17,18 @@
  */
 #include "blendfile_loading_base_test.h"
 
+#include <set>
+#include <string>
+
+#include "BLI_linklist.h"
+#include "BLI_path_util.h"
+
+#include "DNA_ID.h"
+#include "DNA_sdna_types.h"
+
+#include "BLO_blend_defs.h"
+#include "BLO_readfile.h"
+
 class BlendfileLoadingTest : public BlendfileLoadingBaseTest {
 };
 
@@ -29,3 +41,50 @@ TEST_F(BlendfileLoadingTest, CanaryTest)
   depsgraph_create(DAG_EVAL_RENDER);
   EXPECT_NE(nullptr, this->depsgraph);
 }
+
+TEST_F(BlendfileLoadingTest, StreamIDNames)
+{
+  const std::string &test_assets_dir = blender::tests::flags_test_asset_dir();
+  if (test_assets_dir.empty()) {
+    return;
+  }
+  char filepath[FILENAME_MAX];
+  BLI_path_join(filepath,
+                sizeof(filepath),
+                test_assets_dir.c_str(),
+                "modifier_stack/array_test.blend",
+                NULL);
+
+  std::set<std::string> names_expected;
+  BlendHandle *bh = BLO_blendhandle_from_file(filepath, nullptr);
+  ASSERT_NE(nullptr, bh);
+  int names_len;
+  LinkNode *names = BLO_blendhandle_get_datablock_names(bh, ID_OB, &names_len);
+  for (LinkNode *link = names; link; link = link->next) {
+    names_expected.insert(static_cast<const char *>(link->link));
+  }
+  BLI_linklist_free(names, free);
+  BLO_blendhandle_close(bh);
+
+  BlendFileStream *stream = BLO_blendfile_stream_open(filepath, nullptr);
+  ASSERT_NE(nullptr, stream);
+  const int name_offset = BLO_blendfile_stream_member_offset(stream, "ID", "char", "name[]");
+  EXPECT_NE(-1, name_offset);
+  EXPECT_EQ(-1, BLO_blendfile_stream_member_offset(stream, "ID", "char", "no_such_member"));
+
+  std::set<std::string> names_stream;
+  bool has_endb = false;
+  while (const BHead *bhead = BLO_blendfile_stream_next(stream)) {
+    if (bhead->code == ID_OB) {
+      const char *idname = BLO_blendfile_stream_id_name(stream);
+      ASSERT_NE(nullptr, idname);
+      names_stream.insert(idname + 2);
+    }
+    has_endb = (bhead->code == ENDB);
+  }
+  BLO_blendfile_stream_close(stream);
+
+  EXPECT_TRUE(has_endb);
+  EXPECT_FALSE(names_expected.empty());
+  EXPECT_EQ(names_expected, names_stream);
+}
@@ -0,0 +1,176 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <cstring>
+
+#include "MEM_guardedalloc.h"
+
+#include "DNA_listBase.h"
+
+#include "BLI_listbase.h"
+#include "BLI_utildefines.h"
+
+#include "BLO_undofile.h"
+
+#define CHUNK_SIZE 4096u
+
+static void memfile_write_chunks(MemFile *memfile,
+                                 MemFile *reference,
+                                 const char *chunks[],
+                                 const int chunks_len)
+{
+  MemFileWriteData mem_data = {nullptr};
+  BLO_memfile_write_init(&mem_data, memfile, reference);
+  for (int i = 0; i < chunks_len; i++) {
+    BLO_memfile_chunk_add(&mem_data, chunks[i], CHUNK_SIZE);
+  }
+  BLO_memfile_write_finalize(&mem_data);
+}
+
+TEST(memfile, SharedChunks)
+{
+  char *a = (char *)MEM_callocN(CHUNK_SIZE, __func__);
+  char *b = (char *)MEM_callocN(CHUNK_SIZE, __func__);
+  char *c = (char *)MEM_callocN(CHUNK_SIZE, __func__);
+  memset(b, 'b', CHUNK_SIZE);
+  memset(c, 'c', CHUNK_SIZE);
+
+  MemFile first = {{nullptr}};
+  MemFile second = {{nullptr}};
+
+  const char *first_chunks[] = {a, b};
+  memfile_write_chunks(&first, nullptr, first_chunks, ARRAY_SIZE(first_chunks));
+  EXPECT_EQ(first.size, 2 * CHUNK_SIZE);
+
+  /* Only the new contents are stored, even when at another position. */
+  const char *second_chunks[] = {a, c, b};
+  memfile_write_chunks(&second, &first, second_chunks, ARRAY_SIZE(second_chunks));
+  EXPECT_EQ(second.size, CHUNK_SIZE);
+
+  const MemFileChunk *first_a = (const MemFileChunk *)BLI_findlink(&first.chunks, 0);
+  const MemFileChunk *first_b = (const MemFileChunk *)BLI_findlink(&first.chunks, 1);
+  const MemFileChunk *second_a = (const MemFileChunk *)BLI_findlink(&second.chunks, 0);
+  const MemFileChunk *second_c = (const MemFileChunk *)BLI_findlink(&second.chunks, 1);
+  const MemFileChunk *second_b = (const MemFileChunk *)BLI_findlink(&second.chunks, 2);
+
+  EXPECT_EQ(first_a->buf, second_a->buf);
+  EXPECT_EQ(first_b->buf, second_b->buf);
+  EXPECT_TRUE(second_a->is_identical);
+  EXPECT_FALSE(second_c->is_identical);
+  /* Shared, but not at the same position as in the previous step. */
+  EXPECT_FALSE(second_b->is_identical);
+
+  /* Freeing the first keeps the data used by the second, which now accounts for its size. */
+  BLO_memfile_merge(&first, &second);
+  EXPECT_EQ(memcmp(second_b->buf, b, CHUNK_SIZE), 0);
+  EXPECT_EQ(second.size, 3 * CHUNK_SIZE);
+  BLO_memfile_free(&second);
+
+  MEM_freeN(a);
+  MEM_freeN(b);
+  MEM_freeN(c);
+}
+
+TEST(memfile, Compress)
+{
+  char *a = (char *)MEM_mallocN(CHUNK_SIZE, __func__);
+  for (uint i = 0; i < CHUNK_SIZE; i++) {
+    a[i] = (char)(i % 7);
+  }
+  const char *chunks[] = {a};
+
+  MemFile memfile = {{nullptr}};
+  memfile_write_chunks(&memfile, nullptr, chunks, ARRAY_SIZE(chunks));
+  const MemFileChunk *chunk = (const MemFileChunk *)memfile.chunks.first;
+
+  BLO_memfile_compress(&memfile);
+#ifdef WITH_LZO
+  EXPECT_EQ(chunk->buf, nullptr);
+  EXPECT_LT(memfile.size, CHUNK_SIZE);
+#endif
+
+  /* Compressed data isn't shared. */
+  MemFile memfile_other = {{nullptr}};
+  memfile_write_chunks(&memfile_other, nullptr, chunks, ARRAY_SIZE(chunks));
+#ifdef WITH_LZO
+  EXPECT_EQ(memfile_other.size, CHUNK_SIZE);
+#endif
+
+  BLO_memfile_uncompress(&memfile);
+  EXPECT_EQ(memfile.size, CHUNK_SIZE);
+  ASSERT_NE(chunk->buf, nullptr);
+  EXPECT_EQ(memcmp(chunk->buf, a, CHUNK_SIZE), 0);
+
+  /* Shared data isn't compressed. */
+  MemFile memfile_shared = {{nullptr}};
+  memfile_write_chunks(&memfile_shared, nullptr, chunks, ARRAY_SIZE(chunks));
+  EXPECT_EQ(memfile_shared.size, 0u);
+  BLO_memfile_compress(&memfile_shared);
+  EXPECT_NE(((const MemFileChunk *)memfile_shared.chunks.first)->buf, nullptr);
+
+  BLO_memfile_free(&memfile);
+  BLO_memfile_free(&memfile_other);
+  BLO_memfile_free(&memfile_shared);
+  MEM_freeN(a);
+}
+
+TEST(memfile, CompressOwnedSize)
+{
+  char *a = (char *)MEM_mallocN(CHUNK_SIZE, __func__);
+  for (uint i = 0; i < CHUNK_SIZE; i++) {
+    a[i] = (char)(i % 7);
+  }
+  const char *chunks[] = {a};
+
+  MemFile memfile = {{nullptr}};
+  MemFile memfile_shared = {{nullptr}};
+  memfile_write_chunks(&memfile, nullptr, chunks, ARRAY_SIZE(chunks));
+  memfile_write_chunks(&memfile_shared, nullptr, chunks, ARRAY_SIZE(chunks));
+  EXPECT_EQ(memfile_shared.size, 0u);
+
+  /* The only user left doesn't account for the buffer, compressing doesn't change its size. */
+  BLO_memfile_free(&memfile);
+  BLO_memfile_compress(&memfile_shared);
+#ifdef WITH_LZO
+  EXPECT_EQ(((const MemFileChunk *)memfile_shared.chunks.first)->buf, nullptr);
+#endif
+  EXPECT_EQ(memfile_shared.size, 0u);
+  BLO_memfile_uncompress(&memfile_shared);
+  EXPECT_EQ(memfile_shared.size, 0u);
+
+  BLO_memfile_free(&memfile_shared);
+  MEM_freeN(a);
+}
+
+TEST(memfile, MergeCompressed)
+{
+  char *a = (char *)MEM_mallocN(CHUNK_SIZE, __func__);
+  char *b = (char *)MEM_callocN(CHUNK_SIZE, __func__);
+  for (uint i = 0; i < CHUNK_SIZE; i++) {
+    a[i] = (char)(i % 7);
+  }
+  const char *first_chunks[] = {a};
+  const char *second_chunks[] = {a, b};
+
+  MemFile first = {{nullptr}};
+  MemFile second = {{nullptr}};
+  memfile_write_chunks(&first, nullptr, first_chunks, ARRAY_SIZE(first_chunks));
+  memfile_write_chunks(&second, &first, second_chunks, ARRAY_SIZE(second_chunks));
+  EXPECT_EQ(second.size, CHUNK_SIZE);
+
+  /* The size of compressed data moves along with it, uncompressing restores the full size. */
+  BLO_memfile_merge(&first, &second);
+  BLO_memfile_compress(&second);
+  const size_t size_compressed = second.size;
+#ifdef WITH_LZO
+  EXPECT_LT(size_compressed, 2 * CHUNK_SIZE);
+#endif
+  EXPECT_GT(size_compressed, 0u);
+  BLO_memfile_uncompress(&second);
+  EXPECT_EQ(second.size, 2 * CHUNK_SIZE);
+
+  BLO_memfile_free(&second);
+  MEM_freeN(a);
+  MEM_freeN(b);
+}
@@ -152,13 +152,15 @@ extern "C" {
  *
  * In the above example ExecutionGroup B has an outputoperation (ViewerOperation)
  * and is being executed.
- * The first chunk is evaluated [@ref ExecutionGroup.scheduleChunkWhenPossible],
+ * The first chunk is added to the task graph [@ref ExecutionGroup.scheduleChunkWhenPossible],
  * but not all input chunks are available.
  * The relevant ExecutionGroup (that can calculate the missing chunks; ExecutionGroup A)
- * is asked to calculate the area ExecutionGroup B is missing.
+ * is asked to add the area ExecutionGroup B is missing to the task graph.
  * [@ref ExecutionGroup.scheduleAreaWhenPossible]
- * ExecutionGroup B checks what chunks the area spans, and tries to schedule these chunks.
- * If all input data is available these chunks are scheduled [@ref ExecutionGroup.scheduleChunk]
+ * ExecutionGroup A checks what chunks the area spans, and adds these chunks as dependencies
+ * of the chunk of ExecutionGroup B.
+ * If all input data is available these chunks are scheduled [@ref ExecutionGroup.scheduleChunk],
+ * the chunk of ExecutionGroup B is scheduled as soon as its last dependency has been executed.
  *
  * <pre>
  *
@@ -195,7 +197,8 @@ extern "C" {
  *            .                                O                                            |
  * </pre>
  *
- * This happens until all chunks of (ExecutionGroup B) are finished executing or the user break's the process.
+ * This happens until all chunks of (ExecutionGroup B) are in the task graph. The task graph is
+ * executed until all chunks are finished executing or the user break's the process.
  *
  * NodeOperation like the ScaleOperation can influence the area of interest by reimplementing the
  * [@ref NodeOperation.determineAreaOfInterest] method
@@ -219,12 +222,11 @@ extern "C" {
  *
  * </pre>
  *
- * \see ExecutionGroup.execute Execute a complete ExecutionGroup.
- * Halts until finished or breaked by user
- * \see ExecutionGroup.scheduleChunkWhenPossible Tries to schedule a single chunk,
- * checks if all input data is available. Can trigger dependent chunks to be calculated
+ * \see ExecutionGroup.execute Add a complete ExecutionGroup to the task graph.
+ * \see ExecutionGroup.scheduleChunkWhenPossible Adds a single chunk to the task graph,
+ * together with the chunks of its input data that haven't been calculated yet
  * \see ExecutionGroup.scheduleAreaWhenPossible
- * Tries to schedule an area. This can be multiple chunks
+ * Adds an area to the task graph. This can be multiple chunks
  * (is called from [@ref ExecutionGroup.scheduleChunkWhenPossible])
  * \see ExecutionGroup.scheduleChunk Schedule a chunk on the WorkScheduler
  * \see NodeOperation.determineDependingAreaOfInterest Influence the area of interest of a chunk.
@@ -241,12 +243,10 @@ extern "C" {
  * For witching these between the state you need to recompile blender
  *
  * \subsection multithread Multi threaded
- * Default the work-scheduler will place all work as WorkPackage in a queue.
- * For every CPUcore a working thread is created.
- * These working threads will ask the WorkScheduler if there is work
- * for a specific Device.
- * the work-scheduler will find work for the device and the device
- * will be asked to execute the WorkPackage.
+ * Default the work-scheduler will execute every WorkPackage as a task of the BLI_task scheduler.
+ * A WorkPackage is pushed as a task when all WorkPackages it depends on have been executed.
+ * The task waits for a free Device and asks the Device to execute the WorkPackage.
+ * After that the WorkPackages that were waiting for it are pushed.
  *
  * \subsection singlethread Single threaded
  * For debugging reasons the multi-threading can be disabled.
@@ -268,10 +268,10 @@ extern "C" {
  * When an ExecutionGroup schedules a Chunk the schedule method of the WorkScheduler
  * The Workscheduler determines if the chunk can be run on an OpenCLDevice
  * (and that there are available OpenCLDevice).
- * If this is the case the chunk will be added to the worklist for OpenCLDevice's
- * otherwise the chunk will be added to the worklist of CPUDevices.
+ * If this is the case the chunk will wait for a free OpenCLDevice
+ * otherwise the chunk will wait for a free CPUDevice.
  *
- * A thread will read the work-list and sends a workpackage to its device.
+ * The task of the chunk sends the workpackage to the device and returns the device afterwards.
  *
  * \see WorkScheduler.schedule method that is called to schedule a chunk
  * \see Device.execute method called to execute a chunk
@@ -356,8 +356,12 @@ void COM_deinitialize(void);
 /**
  * \brief Clear all compositor caches. (Compositor system will still remain available).
  * To deinitialize the compositor use the COM_deinitialize method.
+ *
+ * Call this when data used by the compositor changed outside of the node tree, like render
+ * results, images or masks. Node results kept for later executions would show the old data.
+ * \see bNodeTree.cache_size
  */
-// void COM_clearCaches(void); // NOT YET WRITTEN
+void COM_clearCaches(void);
 
 #ifdef __cplusplus
 }
@@ -267,4 +267,20 @@ class CompositorContext {
   {
     return (this->getbNodeTree()->flag & NTREE_COM_GROUPNODE_BUFFER) != 0;
   }
+  bool isFullFrameEnabled() const
+  {
+    return (this->getbNodeTree()->flag & NTREE_COM_FULL_FRAME) != 0;
+  }
+  bool isHalfFloatEnabled() const
+  {
+    return (this->getbNodeTree()->flag & NTREE_COM_HALF_FLOAT) != 0;
+  }
+
+  /**
+   * \brief get the memory budget of the MemoryBufferCache in bytes, 0 when caching is disabled
+   */
+  size_t getCacheLimit() const
+  {
+    return (size_t)this->getbNodeTree()->cache_size * 1024 * 1024;
+  }
 };
@@ -46,6 +46,7 @@ ExecutionGroup::ExecutionGroup()
   this->m_isOutput = false;
   this->m_complex = false;
   this->m_chunkExecutionStates = NULL;
+  this->m_chunkWorkPackages = NULL;
   this->m_bTree = NULL;
   this->m_height = 0;
   this->m_width = 0;
@@ -134,6 +135,8 @@ void ExecutionGroup::initExecution()
     for (index = 0; index < this->m_numberOfChunks; index++) {
       this->m_chunkExecutionStates[index] = COM_ES_NOT_SCHEDULED;
     }
+    this->m_chunkWorkPackages = (WorkPackage **)MEM_callocN(
+        sizeof(WorkPackage *) * this->m_numberOfChunks, __func__);
   }
 
   unsigned int maxNumber = 0;
@@ -150,12 +153,39 @@ void ExecutionGroup::initExecution()
   this->m_cachedMaxReadBufferOffset = maxNumber;
 }
 
+bool ExecutionGroup::isExecuted() const
+{
+  if (this->m_numberOfChunks == 0) {
+    return false;
+  }
+  for (unsigned int index = 0; index < this->m_numberOfChunks; index++) {
+    if (this->m_chunkExecutionStates[index] != COM_ES_EXECUTED) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void ExecutionGroup::setExecuted()
+{
+  for (unsigned int index = 0; index < this->m_numberOfChunks; index++) {
+    this->m_chunkExecutionStates[index] = COM_ES_EXECUTED;
+  }
+}
+
 void ExecutionGroup::deinitExecution()
 {
   if (this->m_chunkExecutionStates != NULL) {
     MEM_freeN(this->m_chunkExecutionStates);
     this->m_chunkExecutionStates = NULL;
   }
+  if (this->m_chunkWorkPackages != NULL) {
+    for (unsigned int index = 0; index < this->m_numberOfChunks; index++) {
+      delete this->m_chunkWorkPackages[index];
+    }
+    MEM_freeN(this->m_chunkWorkPackages);
+    this->m_chunkWorkPackages = NULL;
+  }
   this->m_numberOfChunks = 0;
   this->m_numberOfXChunks = 0;
   this->m_numberOfYChunks = 0;
@@ -322,49 +352,13 @@ void ExecutionGroup::execute(ExecutionSystem *graph)
   DebugInfo::execution_group_started(this);
   DebugInfo::graphviz(graph);
 
-  bool breaked = false;
-  bool finished = false;
-  unsigned int startIndex = 0;
-  const int maxNumberEvaluated = BLI_system_thread_count() * 2;
-
-  while (!finished && !breaked) {
-    bool startEvaluated = false;
-    finished = true;
-    int numberEvaluated = 0;
-
-    for (index = startIndex;
-         index < this->m_numberOfChunks && numberEvaluated < maxNumberEvaluated;
-         index++) {
-      chunkNumber = chunkOrder[index];
-      int yChunk = chunkNumber / this->m_numberOfXChunks;
-      int xChunk = chunkNumber - (yChunk * this->m_numberOfXChunks);
-      const ChunkExecutionState state = this->m_chunkExecutionStates[chunkNumber];
-      if (state == COM_ES_NOT_SCHEDULED) {
-        scheduleChunkWhenPossible(graph, xChunk, yChunk);
-        finished = false;
-        startEvaluated = true;
-        numberEvaluated++;
-
-        if (bTree->update_draw) {
-          bTree->update_draw(bTree->udh);
-        }
-      }
-      else if (state == COM_ES_SCHEDULED) {
-        finished = false;
-        startEvaluated = true;
-        numberEvaluated++;
-      }
-      else if (state == COM_ES_EXECUTED && !startEvaluated) {
-        startIndex = index + 1;
-      }
-    }
-
-    WorkScheduler::finish();
-
-    if (bTree->test_break && bTree->test_break(bTree->tbh)) {
-      breaked = true;
-    }
+  for (index = 0; index < this->m_numberOfChunks; index++) {
+    chunkNumber = chunkOrder[index];
+    int yChunk = chunkNumber / this->m_numberOfXChunks;
+    int xChunk = chunkNumber - (yChunk * this->m_numberOfXChunks);
+    scheduleChunkWhenPossible(graph, xChunk, yChunk, NULL);
   }
+
   DebugInfo::execution_group_finished(this);
   DebugInfo::graphviz(graph);
 
@@ -422,6 +416,15 @@ void ExecutionGroup::finalizeChunkExecution(int chunkNumber, MemoryBuffer **memo
     }
     MEM_freeN(memoryBuffers);
   }
+  /* Chunks calculated by the other threads are reported when the execution thread finishes a
+   * chunk, or after the task graph has been executed. */
+  if (WorkScheduler::isExecutionThread()) {
+    updateProgress();
+  }
+}
+
+void ExecutionGroup::updateProgress()
+{
   if (this->m_bTree) {
     // status report is only performed for top level Execution Groups.
     float progress = this->m_chunksFinished;
@@ -435,6 +438,10 @@ void ExecutionGroup::finalizeChunkExecution(int chunkNumber, MemoryBuffer **memo
                  this->m_chunksFinished,
                  this->m_numberOfChunks);
     this->m_bTree->stats_draw(this->m_bTree->sdh, buf);
+
+    if (this->m_bTree->update_draw) {
+      this->m_bTree->update_draw(this->m_bTree->udh);
+    }
   }
 }
 
@@ -481,10 +488,13 @@ MemoryBuffer *ExecutionGroup::allocateOutputBuffer(int /*chunkNumber*/, rcti *re
   return NULL;
 }
 
-bool ExecutionGroup::scheduleAreaWhenPossible(ExecutionSystem *graph, rcti *area)
+void ExecutionGroup::scheduleAreaWhenPossible(ExecutionSystem *graph,
+                                              rcti *area,
+                                              WorkPackage *dependent)
 {
   if (this->m_singleThreaded) {
-    return scheduleChunkWhenPossible(graph, 0, 0);
+    scheduleChunkWhenPossible(graph, 0, 0, dependent);
+    return;
   }
   // find all chunks inside the rect
   // determine minxchunk, minychunk, maxxchunk, maxychunk where x and y are chunknumbers
@@ -503,55 +513,54 @@ bool ExecutionGroup::scheduleAreaWhenPossible(ExecutionSystem *graph, rcti *area
   maxxchunk = min_ii(maxxchunk, (int)m_numberOfXChunks);
   maxychunk = min_ii(maxychunk, (int)m_numberOfYChunks);
 
-  bool result = true;
   for (indexx = minxchunk; indexx < maxxchunk; indexx++) {
     for (indexy = minychunk; indexy < maxychunk; indexy++) {
-      if (!scheduleChunkWhenPossible(graph, indexx, indexy)) {
-        result = false;
-      }
+      scheduleChunkWhenPossible(graph, indexx, indexy, dependent);
     }
   }
-
-  return result;
 }
 
-bool ExecutionGroup::scheduleChunk(unsigned int chunkNumber)
+void ExecutionGroup::scheduleChunk(unsigned int chunkNumber)
 {
-  if (this->m_chunkExecutionStates[chunkNumber] == COM_ES_NOT_SCHEDULED) {
-    this->m_chunkExecutionStates[chunkNumber] = COM_ES_SCHEDULED;
-    WorkScheduler::schedule(this, chunkNumber);
-    return true;
-  }
-  return false;
+  WorkScheduler::schedule(this->m_chunkWorkPackages[chunkNumber]);
 }
 
-bool ExecutionGroup::scheduleChunkWhenPossible(ExecutionSystem *graph, int xChunk, int yChunk)
+void ExecutionGroup::scheduleChunkWhenPossible(ExecutionSystem *graph,
+                                               int xChunk,
+                                               int yChunk,
+                                               WorkPackage *dependent)
 {
   if (xChunk < 0 || xChunk >= (int)this->m_numberOfXChunks) {
-    return true;
+    return;
   }
   if (yChunk < 0 || yChunk >= (int)this->m_numberOfYChunks) {
-    return true;
+    return;
   }
   int chunkNumber = yChunk * this->m_numberOfXChunks + xChunk;
   // chunk is already executed
   if (this->m_chunkExecutionStates[chunkNumber] == COM_ES_EXECUTED) {
-    return true;
+    return;
   }
 
   // chunk is scheduled, but not executed
   if (this->m_chunkExecutionStates[chunkNumber] == COM_ES_SCHEDULED) {
-    return false;
+    if (dependent) {
+      this->m_chunkWorkPackages[chunkNumber]->addDependent(dependent);
+    }
+    return;
   }
 
   // chunk is nor executed nor scheduled.
+  WorkPackage *package = new WorkPackage(this, chunkNumber);
+  this->m_chunkWorkPackages[chunkNumber] = package;
+  this->m_chunkExecutionStates[chunkNumber] = COM_ES_SCHEDULED;
+
   vector<MemoryProxy *> memoryProxies;
   this->determineDependingMemoryProxies(&memoryProxies);
 
   rcti rect;
   determineChunkRect(&rect, xChunk, yChunk);
   unsigned int index;
-  bool canBeExecuted = true;
   rcti area;
 
   for (index = 0; index < this->m_cachedReadOperations.size(); index++) {
@@ -563,20 +572,23 @@ bool ExecutionGroup::scheduleChunkWhenPossible(ExecutionSystem *graph, int xChun
     ExecutionGroup *group = memoryProxy->getExecutor();
 
     if (group != NULL) {
-      if (!group->scheduleAreaWhenPossible(graph, &area)) {
-        canBeExecuted = false;
-      }
+      group->scheduleAreaWhenPossible(graph, &area, package);
     }
     else {
       throw "ERROR";
     }
   }
 
-  if (canBeExecuted) {
+  /* The WorkScheduler holds back all chunks until the task graph is complete, so no dependency
+   * can have been executed between adding it and this check. */
+  if (package->getNumberOfDependencies() == 0) {
     scheduleChunk(chunkNumber);
   }
 
-  return false;
+  /* Without threading the chunk has been executed by scheduling it. */
+  if (dependent && this->m_chunkExecutionStates[chunkNumber] != COM_ES_EXECUTED) {
+    package->addDependent(dependent);
+  }
 }
 
 void ExecutionGroup::determineDependingAreaOfInterest(rcti *input,
@@ -36,6 +36,7 @@ class ExecutionSystem;
 class MemoryProxy;
 class ReadBufferOperation;
 class Device;
+class WorkPackage;
 
 /**
  * \brief the execution state of a chunk in an ExecutionGroup
@@ -158,6 +159,12 @@ class ExecutionGroup {
    */
   ChunkExecutionState *m_chunkExecutionStates;
 
+  /**
+   * \brief the WorkPackage of every chunk that has been added to the task graph.
+   * \note NULL for the chunks that have not been scheduled.
+   */
+  WorkPackage **m_chunkWorkPackages;
+
   /**
    * \brief indicator when this ExecutionGroup has valid Operations in its vector for Execution
    * \note When building the ExecutionGroup Operations are added via recursion.
@@ -210,35 +217,38 @@ class ExecutionGroup {
   void determineNumberOfChunks();
 
   /**
-   * \brief try to schedule a specific chunk.
-   * \note scheduling succeeds when all input requirements are met and the chunks hasn't been
-   * scheduled yet.
+   * \brief add a specific chunk to the task graph.
+   * \note The chunks of the input ExecutionGroups the chunk reads are added as well. When all of
+   * them have been executed already the chunk is scheduled right away, otherwise the WorkScheduler
+   * schedules it as soon as the last of them has been executed.
    * \param graph:
    * \param xChunk:
    * \param yChunk:
-   * \return [true:false]
-   * true: package(s) are scheduled
-   * false: scheduling is deferred (depending workpackages are scheduled)
+   * \param dependent: WorkPackage that reads the chunk, or NULL.
+   * dependent is not scheduled before the chunk has been executed.
    */
-  bool scheduleChunkWhenPossible(ExecutionSystem *graph, int xChunk, int yChunk);
+  void scheduleChunkWhenPossible(ExecutionSystem *graph,
+                                 int xChunk,
+                                 int yChunk,
+                                 WorkPackage *dependent);
 
   /**
-   * \brief try to schedule a specific area.
-   * \note Check if a certain area is available, when not available this are will be checked.
+   * \brief add a specific area to the task graph.
+   * \note All chunks the area spans are added to the task graph.
    * \note This method is called from other ExecutionGroup's.
    * \param graph:
    * \param rect:
-   * \return [true:false]
-   * true: package(s) are scheduled
-   * false: scheduling is deferred (depending workpackages are scheduled)
+   * \param dependent: WorkPackage that reads the area.
+   * dependent is not scheduled before all chunks of the area have been executed.
    */
-  bool scheduleAreaWhenPossible(ExecutionSystem *graph, rcti *rect);
+  void scheduleAreaWhenPossible(ExecutionSystem *graph, rcti *rect, WorkPackage *dependent);
 
   /**
    * \brief add a chunk to the WorkScheduler.
+   * \note All chunks the chunk depends on must have been executed.
    * \param chunknumber:
    */
-  bool scheduleChunk(unsigned int chunkNumber);
+  void scheduleChunk(unsigned int chunkNumber);
 
   /**
    * \brief determine the area of interest of a certain input area
@@ -375,6 +385,24 @@ class ExecutionGroup {
    */
   void finalizeChunkExecution(int chunkNumber, MemoryBuffer **memoryBuffers);
 
+  /**
+   * \brief report the progress of the chunks and redraw the result.
+   * The callbacks of the node tree are only called from the thread that started the execution.
+   * \see WorkScheduler.isExecutionThread
+   */
+  void updateProgress();
+
+  /**
+   * \brief have all chunks of this ExecutionGroup been executed
+   */
+  bool isExecuted() const;
+
+  /**
+   * \brief mark all chunks as executed, so they won't be scheduled
+   * \note used when the output buffer is kept from an earlier execution, see MemoryBufferCache
+   */
+  void setExecuted();
+
   /**
    * \brief deinitExecution is called just after execution the whole graph.
    * \note It will release all needed resources
@@ -383,7 +411,8 @@ class ExecutionGroup {
 
   /**
    * \brief schedule an ExecutionGroup
-   * \note this method will return when all chunks have been calculated, or the execution has
+   * \note this method adds all chunks to the task graph of the WorkScheduler and returns.
+   * The chunks are calculated during WorkScheduler.finish, or until the execution has been
    * breaked (by user)
    *
    * first the order of the chunks will be determined. This is determined by finding the
@@ -32,6 +32,10 @@
 #include "COM_NodeOperationBuilder.h"
 #include "COM_ReadBufferOperation.h"
 #include "COM_WorkScheduler.h"
+#include "COM_WriteBufferOperation.h"
+
+#include <algorithm>
+#include <set>
 
 #ifdef WITH_CXX_GUARDEDALLOC
 #  include "MEM_guardedalloc.h"
@@ -147,6 +151,17 @@ void ExecutionSystem::execute()
   }
   unsigned int index;
 
+  if (this->m_context.isHalfFloatEnabled()) {
+    determineHalfFloatBuffers();
+  }
+
+  /* The fast pass of two pass execution isn't cached, it would only push out the full results. */
+  const bool use_cache = this->m_context.getCacheLimit() > 0 &&
+                         !this->m_context.isFastCalculation();
+  if (use_cache) {
+    acquireCachedBuffers();
+  }
+
   // First allocale all write buffer
   for (index = 0; index < this->m_operations.size(); index++) {
     NodeOperation *operation = this->m_operations[index];
@@ -174,8 +189,13 @@ void ExecutionSystem::execute()
   for (index = 0; index < this->m_groups.size(); index++) {
     ExecutionGroup *executionGroup = this->m_groups[index];
     executionGroup->setChunksize(this->m_context.getChunksize());
+    executionGroup->getOutputOperation()->setUseFullFrame(this->m_context.isFullFrameEnabled());
     executionGroup->initExecution();
   }
+  /* Groups feeding only the cached groups aren't scheduled either. */
+  for (index = 0; index < this->m_cachedGroups.size(); index++) {
+    this->m_cachedGroups[index]->setExecuted();
+  }
 
   WorkScheduler::start(this->m_context);
 
@@ -185,9 +205,12 @@ void ExecutionSystem::execute()
     executeGroups(COM_PRIORITY_LOW);
   }
 
-  WorkScheduler::finish();
   WorkScheduler::stop();
 
+  if (use_cache) {
+    releaseCachedBuffers();
+  }
+
   editingtree->stats_draw(editingtree->sdh, TIP_("Compositing | De-initializing execution"));
   for (index = 0; index < this->m_operations.size(); index++) {
     NodeOperation *operation = this->m_operations[index];
@@ -209,6 +232,99 @@ void ExecutionSystem::executeGroups(CompositorPriority priority)
     ExecutionGroup *group = executionGroups[index];
     group->execute(this);
   }
+
+  /* All output groups of the priority share one task graph, so chunks of a group don't wait for
+   * the other groups to finish. */
+  WorkScheduler::finish();
+
+  for (index = 0; index < executionGroups.size(); index++) {
+    executionGroups[index]->updateProgress();
+  }
+}
+
+void ExecutionSystem::determineHalfFloatBuffers()
+{
+  /* Complex operations access the buffers of their inputs directly as float. */
+  std::set<MemoryProxy *> floatProxies;
+  unsigned int index;
+  for (index = 0; index < this->m_operations.size(); index++) {
+    NodeOperation *operation = this->m_operations[index];
+    if (!operation->isComplex()) {
+      continue;
+    }
+    for (unsigned int inputIndex = 0; inputIndex < operation->getNumberOfInputSockets();
+         inputIndex++) {
+      NodeOperationInput *input = operation->getInputSocket(inputIndex);
+      if (input->isConnected() && input->getLink()->getOperation().isReadBufferOperation()) {
+        ReadBufferOperation *readOperation = (ReadBufferOperation *)&input->getLink()
+                                                 ->getOperation();
+        floatProxies.insert(readOperation->getMemoryProxy());
+      }
+    }
+  }
+
+  /* Only color buffers are stored as half float, values and vectors are often data like depth
+   * or positions that need the precision. */
+  for (index = 0; index < this->m_operations.size(); index++) {
+    NodeOperation *operation = this->m_operations[index];
+    if (!operation->isWriteBufferOperation()) {
+      continue;
+    }
+    MemoryProxy *memoryProxy = ((WriteBufferOperation *)operation)->getMemoryProxy();
+    NodeOperationInput *input = operation->getInputSocket(0);
+    memoryProxy->setHalfFloat(memoryProxy->getDataType() == COM_DT_COLOR &&
+                              input->isConnected() &&
+                              input->getLink()->getOperation().isHalfFloat() &&
+                              floatProxies.find(memoryProxy) == floatProxies.end());
+  }
+}
+
+void ExecutionSystem::acquireCachedBuffers()
+{
+  MemoryBufferCache::OperationKeys keys;
+  for (unsigned int index = 0; index < this->m_operations.size(); index++) {
+    NodeOperation *operation = this->m_operations[index];
+    if (!operation->isWriteBufferOperation()) {
+      continue;
+    }
+    WriteBufferOperation *writeOperation = (WriteBufferOperation *)operation;
+    MemoryProxy *memoryProxy = writeOperation->getMemoryProxy();
+    if (memoryProxy->getExecutor() == NULL) {
+      continue;
+    }
+    MemoryBufferCache::Key key = MemoryBufferCache::determineKey(
+        this->m_context, writeOperation, keys);
+    this->m_bufferKeys[writeOperation] = key;
+
+    MemoryBuffer *buffer = MemoryBufferCache::acquire(key);
+    if (buffer) {
+      memoryProxy->setBuffer(buffer);
+      this->m_cachedGroups.push_back(memoryProxy->getExecutor());
+    }
+  }
+}
+
+void ExecutionSystem::releaseCachedBuffers()
+{
+  const bNodeTree *editingtree = this->m_context.getbNodeTree();
+  const size_t limit = this->m_context.getCacheLimit();
+  /* After a break chunks can be stopped halfway, only the cached buffers are known to be
+   * complete. */
+  const bool breaked = editingtree->test_break(editingtree->tbh);
+
+  std::map<WriteBufferOperation *, MemoryBufferCache::Key>::iterator iter;
+  for (iter = this->m_bufferKeys.begin(); iter != this->m_bufferKeys.end(); ++iter) {
+    MemoryProxy *memoryProxy = iter->first->getMemoryProxy();
+    ExecutionGroup *group = memoryProxy->getExecutor();
+    const bool cached = std::find(this->m_cachedGroups.begin(),
+                                  this->m_cachedGroups.end(),
+                                  group) != this->m_cachedGroups.end();
+    if (cached || (!breaked && group->isExecuted())) {
+      MemoryBufferCache::release(iter->second, memoryProxy->releaseBuffer(), limit);
+    }
+  }
+  this->m_bufferKeys.clear();
+  this->m_cachedGroups.clear();
 }
 
 void ExecutionSystem::findOutputExecutionGroup(vector<ExecutionGroup *> *result,
@@ -22,6 +22,7 @@ class ExecutionGroup;
 
 #include "BKE_text.h"
 #include "COM_ExecutionGroup.h"
+#include "COM_MemoryBufferCache.h"
 #include "COM_Node.h"
 #include "COM_NodeOperation.h"
 #include "DNA_color_types.h"
@@ -133,6 +134,16 @@ class ExecutionSystem {
    */
   Groups m_groups;
 
+  /**
+   * \brief keys of the buffers of the write buffer operations in the MemoryBufferCache
+   */
+  std::map<WriteBufferOperation *, MemoryBufferCache::Key> m_bufferKeys;
+
+  /**
+   * \brief groups of which the output buffer is kept from an earlier execution
+   */
+  Groups m_cachedGroups;
+
  private:  // methods
   /**
    * find all execution group with output nodes
@@ -188,6 +199,24 @@ class ExecutionSystem {
  private:
   void executeGroups(CompositorPriority priority);
 
+  /**
+   * \brief store the buffers of write buffer operations as half float when possible
+   * \see NTREE_COM_HALF_FLOAT
+   */
+  void determineHalfFloatBuffers();
+
+  /**
+   * \brief let the write buffer operations use the buffers kept from earlier executions
+   * \note must be called before the write buffer operations are initialized
+   */
+  void acquireCachedBuffers();
+
+  /**
+   * \brief hand the completely calculated write buffers over to the MemoryBufferCache
+   * \note must be called before the write buffer operations are deinitialized
+   */
+  void releaseCachedBuffers();
+
   /* allow the DebugInfo class to look at internals */
   friend class DebugInfo;
 
@@ -0,0 +1,173 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Copyright 2020, Blender Foundation.
+ */
+
+#include "COM_FullFrameEvaluator.h"
+#include "COM_ReadBufferOperation.h"
+
+FullFrameEvaluator::FullFrameEvaluator(rcti *area)
+{
+  BLI_rcti_init(&this->m_area, area->xmin, area->xmax, area->ymin, area->ymax);
+  this->m_braked = false;
+}
+
+FullFrameEvaluator::~FullFrameEvaluator()
+{
+  for (unsigned int index = 0; index < this->m_temporaryBuffers.size(); index++) {
+    delete this->m_temporaryBuffers[index];
+  }
+  this->m_temporaryBuffers.clear();
+  this->m_buffers.clear();
+}
+
+MemoryBuffer *FullFrameEvaluator::getBuffer(NodeOperation *operation)
+{
+  std::map<NodeOperation *, MemoryBuffer *>::iterator it = this->m_buffers.find(operation);
+  if (it != this->m_buffers.end()) {
+    return it->second;
+  }
+
+  MemoryBuffer *buffer;
+  if (operation->isReadBufferOperation()) {
+    /* Read directly from the buffer of the write operation when it contains the area, half
+     * float buffers are converted by reading them pixel by pixel. */
+    ReadBufferOperation *readOperation = (ReadBufferOperation *)operation;
+    buffer = readOperation->getMemoryBuffer();
+    if (buffer && !readOperation->isSingleValue() && !buffer->isHalfFloat() &&
+        BLI_rcti_inside_rcti(buffer->getRect(), &this->m_area)) {
+      this->m_buffers[operation] = buffer;
+      return buffer;
+    }
+  }
+
+  buffer = new MemoryBuffer(operation->getOutputSocket()->getDataType(), &this->m_area);
+  this->m_temporaryBuffers.push_back(buffer);
+  execute(operation, buffer);
+  this->m_buffers[operation] = buffer;
+  return buffer;
+}
+
+void FullFrameEvaluator::execute(NodeOperation *operation, MemoryBuffer *output)
+{
+  BLI_assert(BLI_rcti_inside_rcti(output->getRect(), &this->m_area));
+
+  if (this->m_braked) {
+    return;
+  }
+  if (!canExecuteFullFrame(operation)) {
+    executePixels(operation, output);
+    return;
+  }
+
+  const unsigned int numberOfInputs = operation->getNumberOfInputSockets();
+  std::vector<MemoryBuffer *> inputs(numberOfInputs);
+  for (unsigned int index = 0; index < numberOfInputs; index++) {
+    NodeOperationInput *input = operation->getInputSocket(index);
+    inputs[index] = getBuffer(&input->getLink()->getOperation());
+  }
+  if (this->m_braked || operation->isBraked()) {
+    this->m_braked = true;
+    return;
+  }
+  operation->executeFullFrame(output, &this->m_area, inputs.data());
+}
+
+bool FullFrameEvaluator::copyOutputArea(NodeOperation *output,
+                                        rcti *area,
+                                        int dx,
+                                        int dy,
+                                        NodeOperation *image,
+                                        NodeOperation *alpha,
+                                        NodeOperation *depth,
+                                        float *colorBuffer,
+                                        float *depthBuffer)
+{
+  rcti inputArea;
+  BLI_rcti_init(&inputArea, area->xmin + dx, area->xmax + dx, area->ymin + dy, area->ymax + dy);
+  FullFrameEvaluator evaluator(&inputArea);
+  MemoryBuffer *imageInput = evaluator.getBuffer(image);
+  MemoryBuffer *alphaInput = alpha ? evaluator.getBuffer(alpha) : NULL;
+  MemoryBuffer *depthInput = evaluator.getBuffer(depth);
+  if (evaluator.isBraked()) {
+    return false;
+  }
+
+  const int width = output->getWidth();
+  const int areaWidth = BLI_rcti_size_x(area);
+  for (int y = area->ymin; y < area->ymax; y++) {
+    if (output->isBraked()) {
+      return false;
+    }
+    const float *imageElem = imageInput->getElem(inputArea.xmin, y + dy);
+    const float *alphaElem = alphaInput ? alphaInput->getElem(inputArea.xmin, y + dy) : NULL;
+    const float *depthElem = depthInput->getElem(inputArea.xmin, y + dy);
+    const int offset = y * width + area->xmin;
+    float *color = colorBuffer + offset * COM_NUM_CHANNELS_COLOR;
+    memcpy(color, imageElem, sizeof(float) * COM_NUM_CHANNELS_COLOR * areaWidth);
+    if (alphaElem) {
+      for (int x = 0; x < areaWidth; x++) {
+        color[x * COM_NUM_CHANNELS_COLOR + 3] = alphaElem[x];
+      }
+    }
+    memcpy(depthBuffer + offset, depthElem, sizeof(float) * areaWidth);
+  }
+  return true;
+}
+
+bool FullFrameEvaluator::canExecuteFullFrame(NodeOperation *operation)
+{
+  if (!operation->isFullFrame()) {
+    return false;
+  }
+  for (unsigned int index = 0; index < operation->getNumberOfInputSockets(); index++) {
+    if (!operation->getInputSocket(index)->isConnected()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void FullFrameEvaluator::executePixels(NodeOperation *operation, MemoryBuffer *output)
+{
+  const int num_channels = output->get_num_channels();
+  void *data = NULL;
+  float color[4];
+
+  if (operation->isComplex()) {
+    data = operation->initializeTileData(&this->m_area);
+  }
+  for (int y = this->m_area.ymin; y < this->m_area.ymax; y++) {
+    if (operation->isBraked()) {
+      this->m_braked = true;
+      break;
+    }
+    float *elem = output->getElem(this->m_area.xmin, y);
+    for (int x = this->m_area.xmin; x < this->m_area.xmax; x++) {
+      if (operation->isComplex()) {
+        operation->read(color, x, y, data);
+      }
+      else {
+        operation->readSampled(color, x, y, COM_PS_NEAREST);
+      }
+      memcpy(elem, color, sizeof(float) * num_channels);
+      elem += num_channels;
+    }
+  }
+  if (data) {
+    operation->deinitializeTileData(&this->m_area, data);
+  }
+}
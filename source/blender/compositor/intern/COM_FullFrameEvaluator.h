@@ -0,0 +1,107 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Copyright 2020, Blender Foundation.
+ */
+
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include "COM_MemoryBuffer.h"
+#include "COM_NodeOperation.h"
+
+/**
+ * \brief calculates the operations of an execution group buffer-at-a-time for an area.
+ *
+ * Used by output operations instead of reading their inputs pixel by pixel when full-frame
+ * execution is enabled. Operations that support it calculate the whole area at once with
+ * NodeOperation.executeFullFrame, reading the buffers of their inputs in tight loops. Other
+ * operations are read pixel by pixel into a buffer, giving the same result as before.
+ * Every operation is calculated once, also when it's used by multiple operations. When the
+ * execution is braked the remaining operations are skipped, leaving their buffers incomplete.
+ *
+ * \see NodeOperation.isFullFrame
+ * \see NTREE_COM_FULL_FRAME
+ */
+class FullFrameEvaluator {
+ private:
+  rcti m_area;
+
+  /**
+   * \brief calculated buffers of the operations
+   */
+  std::map<NodeOperation *, MemoryBuffer *> m_buffers;
+
+  /**
+   * \brief buffers allocated for the area, freed with the evaluator
+   */
+  std::vector<MemoryBuffer *> m_temporaryBuffers;
+
+  /**
+   * \brief was the execution braked while calculating the buffers?
+   */
+  bool m_braked;
+
+ public:
+  FullFrameEvaluator(rcti *area);
+  ~FullFrameEvaluator();
+
+  /**
+   * \brief get the output of an operation, calculated for the area if needed
+   */
+  MemoryBuffer *getBuffer(NodeOperation *operation);
+
+  /**
+   * \brief calculate the output of an operation for the area into the given buffer
+   * \param output: buffer that contains the area
+   */
+  void execute(NodeOperation *operation, MemoryBuffer *output);
+
+  /**
+   * \brief was the execution braked, so the buffers can be incomplete?
+   */
+  bool isBraked() const
+  {
+    return this->m_braked;
+  }
+
+  /**
+   * \brief calculate the inputs of an output operation and copy them into its result buffers
+   *
+   * The inputs are read at the area moved by dx and dy, the result buffers have the size of
+   * the output operation. Stops between rows when the execution is braked.
+   * \param alpha: optional input that replaces the alpha of the image input
+   * \return false when the execution was braked
+   */
+  static bool copyOutputArea(NodeOperation *output,
+                             rcti *area,
+                             int dx,
+                             int dy,
+                             NodeOperation *image,
+                             NodeOperation *alpha,
+                             NodeOperation *depth,
+                             float *colorBuffer,
+                             float *depthBuffer);
+
+ private:
+  bool canExecuteFullFrame(NodeOperation *operation);
+  void executePixels(NodeOperation *operation, MemoryBuffer *output);
+
+#ifdef WITH_CXX_GUARDEDALLOC
+  MEM_CXX_CLASS_ALLOC_FUNCS("COM:FullFrameEvaluator")
+#endif
+};
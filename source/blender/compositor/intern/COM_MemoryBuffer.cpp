@@ -58,8 +58,18 @@ MemoryBuffer::MemoryBuffer(MemoryProxy *memoryProxy, unsigned int chunkNumber, r
   this->m_memoryProxy = memoryProxy;
   this->m_chunkNumber = chunkNumber;
   this->m_num_channels = determine_num_channels(memoryProxy->getDataType());
-  this->m_buffer = (float *)MEM_mallocN_aligned(
-      sizeof(float) * determineBufferSize() * this->m_num_channels, 16, "COM_MemoryBuffer");
+  if (memoryProxy->isHalfFloat()) {
+    this->m_buffer = NULL;
+    this->m_halfBuffer = (unsigned short *)MEM_mallocN_aligned(
+        sizeof(unsigned short) * determineBufferSize() * this->m_num_channels,
+        16,
+        "COM_MemoryBuffer");
+  }
+  else {
+    this->m_buffer = (float *)MEM_mallocN_aligned(
+        sizeof(float) * determineBufferSize() * this->m_num_channels, 16, "COM_MemoryBuffer");
+    this->m_halfBuffer = NULL;
+  }
   this->m_state = COM_MB_ALLOCATED;
   this->m_datatype = memoryProxy->getDataType();
 }
@@ -74,6 +84,7 @@ MemoryBuffer::MemoryBuffer(MemoryProxy *memoryProxy, rcti *rect)
   this->m_num_channels = determine_num_channels(memoryProxy->getDataType());
   this->m_buffer = (float *)MEM_mallocN_aligned(
       sizeof(float) * determineBufferSize() * this->m_num_channels, 16, "COM_MemoryBuffer");
+  this->m_halfBuffer = NULL;
   this->m_state = COM_MB_TEMPORARILY;
   this->m_datatype = memoryProxy->getDataType();
 }
@@ -88,12 +99,17 @@ MemoryBuffer::MemoryBuffer(DataType dataType, rcti *rect)
   this->m_num_channels = determine_num_channels(dataType);
   this->m_buffer = (float *)MEM_mallocN_aligned(
       sizeof(float) * determineBufferSize() * this->m_num_channels, 16, "COM_MemoryBuffer");
+  this->m_halfBuffer = NULL;
   this->m_state = COM_MB_TEMPORARILY;
   this->m_datatype = dataType;
 }
 MemoryBuffer *MemoryBuffer::duplicate()
 {
   MemoryBuffer *result = new MemoryBuffer(this->m_memoryProxy, &this->m_rect);
+  if (this->m_halfBuffer) {
+    result->copyContentFrom(this);
+    return result;
+  }
   memcpy(result->m_buffer,
          this->m_buffer,
          this->determineBufferSize() * this->m_num_channels * sizeof(float));
@@ -101,15 +117,30 @@ MemoryBuffer *MemoryBuffer::duplicate()
 }
 void MemoryBuffer::clear()
 {
+  if (this->m_halfBuffer) {
+    /* half float zero has all bits cleared as well */
+    memset(this->m_halfBuffer, 0, getMemorySize());
+    return;
+  }
   memset(this->m_buffer, 0, this->determineBufferSize() * this->m_num_channels * sizeof(float));
 }
 
 float MemoryBuffer::getMaximumValue()
 {
-  float result = this->m_buffer[0];
   const unsigned int size = this->determineBufferSize();
   unsigned int i;
 
+  if (this->m_halfBuffer) {
+    float result = half_to_float(this->m_halfBuffer[0]);
+    const unsigned short *half_src = this->m_halfBuffer;
+    for (i = 0; i < size; i++, half_src += this->m_num_channels) {
+      result = max(result, half_to_float(*half_src));
+    }
+    return result;
+  }
+
+  float result = this->m_buffer[0];
+
   const float *fp_src = this->m_buffer;
 
   for (i = 0; i < size; i++, fp_src += this->m_num_channels) {
@@ -147,6 +178,10 @@ MemoryBuffer::~MemoryBuffer()
     MEM_freeN(this->m_buffer);
     this->m_buffer = NULL;
   }
+  if (this->m_halfBuffer) {
+    MEM_freeN(this->m_halfBuffer);
+    this->m_halfBuffer = NULL;
+  }
 }
 
 void MemoryBuffer::copyContentFrom(MemoryBuffer *otherBuffer)
@@ -169,9 +204,27 @@ void MemoryBuffer::copyContentFrom(MemoryBuffer *otherBuffer)
                   this->m_num_channels;
     offset = ((otherY - this->m_rect.ymin) * this->m_width + minX - this->m_rect.xmin) *
              this->m_num_channels;
-    memcpy(&this->m_buffer[offset],
-           &otherBuffer->m_buffer[otherOffset],
-           (maxX - minX) * this->m_num_channels * sizeof(float));
+    const unsigned int length = (maxX - minX) * this->m_num_channels;
+    if (this->m_halfBuffer && otherBuffer->m_halfBuffer) {
+      memcpy(&this->m_halfBuffer[offset],
+             &otherBuffer->m_halfBuffer[otherOffset],
+             length * sizeof(unsigned short));
+    }
+    else if (this->m_halfBuffer) {
+      for (unsigned int i = 0; i < length; i++) {
+        this->m_halfBuffer[offset + i] = float_to_half(otherBuffer->m_buffer[otherOffset + i]);
+      }
+    }
+    else if (otherBuffer->m_halfBuffer) {
+      for (unsigned int i = 0; i < length; i++) {
+        this->m_buffer[offset + i] = half_to_float(otherBuffer->m_halfBuffer[otherOffset + i]);
+      }
+    }
+    else {
+      memcpy(&this->m_buffer[offset],
+             &otherBuffer->m_buffer[otherOffset],
+             length * sizeof(float));
+    }
   }
 }
 
@@ -181,6 +234,12 @@ void MemoryBuffer::writePixel(int x, int y, const float color[4])
       y < this->m_rect.ymax) {
     const int offset = (this->m_width * (y - this->m_rect.ymin) + x - this->m_rect.xmin) *
                        this->m_num_channels;
+    if (this->m_halfBuffer) {
+      for (unsigned int i = 0; i < this->m_num_channels; i++) {
+        this->m_halfBuffer[offset + i] = float_to_half(color[i]);
+      }
+      return;
+    }
     memcpy(&this->m_buffer[offset], color, sizeof(float) * this->m_num_channels);
   }
 }
@@ -191,6 +250,13 @@ void MemoryBuffer::addPixel(int x, int y, const float color[4])
       y < this->m_rect.ymax) {
     const int offset = (this->m_width * (y - this->m_rect.ymin) + x - this->m_rect.xmin) *
                        this->m_num_channels;
+    if (this->m_halfBuffer) {
+      for (unsigned int i = 0; i < this->m_num_channels; i++) {
+        this->m_halfBuffer[offset + i] = float_to_half(
+            half_to_float(this->m_halfBuffer[offset + i]) + color[i]);
+      }
+      return;
+    }
     float *dst = &this->m_buffer[offset];
     const float *src = color;
     for (int i = 0; i < this->m_num_channels; i++, dst++, src++) {
@@ -199,6 +265,83 @@ void MemoryBuffer::addPixel(int x, int y, const float color[4])
   }
 }
 
+void MemoryBuffer::readBilinearHalf(float *result, float u, float v, bool wrap_x, bool wrap_y)
+{
+  /* Same sampling as BLI_bilinear_interpolation_wrap_fl, converting the four pixels. */
+  const int width = this->m_width;
+  const int height = this->m_height;
+  int x1 = (int)floorf(u);
+  int x2 = (int)ceilf(u);
+  int y1 = (int)floorf(v);
+  int y2 = (int)ceilf(v);
+
+  if (wrap_x) {
+    if (x1 < 0) {
+      x1 = width - 1;
+    }
+    if (x2 >= width) {
+      x2 = 0;
+    }
+  }
+  else if (x2 < 0 || x1 >= width) {
+    copy_vn_fl(result, this->m_num_channels, 0.0f);
+    return;
+  }
+  if (wrap_y) {
+    if (y1 < 0) {
+      y1 = height - 1;
+    }
+    if (y2 >= height) {
+      y2 = 0;
+    }
+  }
+  else if (y2 < 0 || y1 >= height) {
+    copy_vn_fl(result, this->m_num_channels, 0.0f);
+    return;
+  }
+
+  const float empty[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+  float row1[4], row2[4], row3[4], row4[4];
+  const bool x1_inside = x1 >= 0;
+  const bool x2_inside = x2 <= width - 1;
+  const bool y1_inside = y1 >= 0;
+  const bool y2_inside = y2 <= height - 1;
+  if (x1_inside && y1_inside) {
+    readHalf(row1, (width * y1 + x1) * this->m_num_channels);
+  }
+  else {
+    copy_v4_v4(row1, empty);
+  }
+  if (x1_inside && y2_inside) {
+    readHalf(row2, (width * y2 + x1) * this->m_num_channels);
+  }
+  else {
+    copy_v4_v4(row2, empty);
+  }
+  if (x2_inside && y1_inside) {
+    readHalf(row3, (width * y1 + x2) * this->m_num_channels);
+  }
+  else {
+    copy_v4_v4(row3, empty);
+  }
+  if (x2_inside && y2_inside) {
+    readHalf(row4, (width * y2 + x2) * this->m_num_channels);
+  }
+  else {
+    copy_v4_v4(row4, empty);
+  }
+
+  const float a = u - floorf(u);
+  const float b = v - floorf(v);
+  const float a_b = a * b;
+  const float ma_b = (1.0f - a) * b;
+  const float a_mb = a * (1.0f - b);
+  const float ma_mb = (1.0f - a) * (1.0f - b);
+  for (unsigned int i = 0; i < this->m_num_channels; i++) {
+    result[i] = ma_mb * row1[i] + a_mb * row3[i] + ma_b * row2[i] + a_b * row4[i];
+  }
+}
+
 static void read_ewa_pixel_sampled(void *userdata, int x, int y, float result[4])
 {
   MemoryBuffer *buffer = (MemoryBuffer *)userdata;
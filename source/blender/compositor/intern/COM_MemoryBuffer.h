@@ -49,6 +49,72 @@ typedef enum MemoryBufferExtend {
 
 class MemoryProxy;
 
+/**
+ * \brief convert a half float to float, including denormals, infinity and NaN
+ */
+inline float half_to_float(unsigned short value)
+{
+  union {
+    unsigned int u;
+    float f;
+  } result, magic;
+  const unsigned int shifted_exponent = 0x7c00 << 13;
+  magic.u = 113 << 23;
+  result.u = (value & 0x7fff) << 13;
+  const unsigned int exponent = result.u & shifted_exponent;
+  result.u += (127 - 15) << 23;
+  if (exponent == shifted_exponent) {
+    /* infinity and NaN */
+    result.u += (128 - 16) << 23;
+  }
+  else if (exponent == 0) {
+    /* zero and denormals */
+    result.u += 1 << 23;
+    result.f -= magic.f;
+  }
+  result.u |= (value & 0x8000) << 16;
+  return result.f;
+}
+
+/**
+ * \brief convert a float to half float rounding to the nearest value. Values too large for half
+ * float are clamped to the largest one instead of becoming infinite.
+ */
+inline unsigned short float_to_half(float value)
+{
+  union {
+    unsigned int u;
+    float f;
+  } f, denormal_magic;
+  const unsigned int infinity = 255 << 23;
+  const unsigned int half_max = 0x477fe000; /* 65504.0f */
+  denormal_magic.u = ((127 - 15) + (23 - 10) + 1) << 23;
+  f.f = value;
+  const unsigned int sign = f.u & 0x80000000u;
+  unsigned short result;
+  f.u ^= sign;
+  if (f.u > infinity) {
+    result = 0x7e00;
+  }
+  else if (f.u == infinity) {
+    result = 0x7c00;
+  }
+  else if (f.u > half_max) {
+    result = 0x7bff;
+  }
+  else if (f.u < (113 << 23)) {
+    /* zero and denormals */
+    f.f += denormal_magic.f;
+    result = (unsigned short)(f.u - denormal_magic.u);
+  }
+  else {
+    const unsigned int mantissa_odd = (f.u >> 13) & 1;
+    f.u += ((unsigned int)(15 - 127) << 23) + 0xfff + mantissa_odd;
+    result = (unsigned short)(f.u >> 13);
+  }
+  return result | (unsigned short)(sign >> 16);
+}
+
 /**
  * \brief a MemoryBuffer contains access to the data of a chunk
  */
@@ -81,10 +147,16 @@ class MemoryBuffer {
   MemoryBufferState m_state;
 
   /**
-   * \brief the actual float buffer/data
+   * \brief the actual float buffer/data, NULL when the data is stored as half float
    */
   float *m_buffer;
 
+  /**
+   * \brief the data stored as half float, NULL when the data is stored as float
+   * \see MemoryProxy.isHalfFloat
+   */
+  unsigned short *m_halfBuffer;
+
   /**
    * \brief the number of channels of a single value in the buffer.
    * For value buffers this is 1, vector 3 and color 4
@@ -128,15 +200,45 @@ class MemoryBuffer {
     return this->m_num_channels;
   }
 
+  /**
+   * \brief hand this MemoryBuffer over to another MemoryProxy
+   * \note used for buffers that are reused by a later execution, see MemoryBufferCache
+   */
+  void setMemoryProxy(MemoryProxy *memoryProxy)
+  {
+    this->m_memoryProxy = memoryProxy;
+  }
+
   /**
    * \brief get the data of this MemoryBuffer
    * \note buffer should already be available in memory
+   * \note not available when the data is stored as half float
    */
   float *getBuffer()
   {
+    BLI_assert(!isHalfFloat());
     return this->m_buffer;
   }
 
+  /**
+   * \brief is the data stored as half float.
+   * Half float buffers can only be accessed by reading and writing pixels, which convert the
+   * values to and from float.
+   */
+  bool isHalfFloat() const
+  {
+    return this->m_halfBuffer != NULL;
+  }
+
+  /**
+   * \brief get the number of bytes used by the data of this MemoryBuffer
+   */
+  size_t getMemorySize() const
+  {
+    return (size_t)this->m_width * this->m_height * this->m_num_channels *
+           (isHalfFloat() ? sizeof(unsigned short) : sizeof(float));
+  }
+
   /**
    * \brief after execution the state will be set to available by calling this method
    */
@@ -245,6 +347,10 @@ class MemoryBuffer {
       int v = y;
       this->wrap_pixel(u, v, extend_x, extend_y);
       const int offset = (this->m_width * y + x) * this->m_num_channels;
+      if (this->m_halfBuffer) {
+        readHalf(result, offset);
+        return;
+      }
       float *buffer = &this->m_buffer[offset];
       memcpy(result, buffer, sizeof(float) * this->m_num_channels);
     }
@@ -271,10 +377,27 @@ class MemoryBuffer {
     BLI_assert((int)(MEM_allocN_len(this->m_buffer) / sizeof(*this->m_buffer)) ==
                (int)(this->determineBufferSize() * COM_NUMBER_OF_CHANNELS));
 #endif
+    if (this->m_halfBuffer) {
+      readHalf(result, offset);
+      return;
+    }
     float *buffer = &this->m_buffer[offset];
     memcpy(result, buffer, sizeof(float) * this->m_num_channels);
   }
 
+  /**
+   * \brief get the element of the pixel at (x, y), which must be inside the rect
+   * \note elements of a row are adjacent, for iterating over rows in tight loops
+   */
+  inline float *getElem(int x, int y)
+  {
+    BLI_assert(!isHalfFloat());
+    BLI_assert(x >= m_rect.xmin && x < m_rect.xmax && y >= m_rect.ymin && y < m_rect.ymax);
+    const int offset = (this->m_width * (y - m_rect.ymin) + (x - m_rect.xmin)) *
+                       this->m_num_channels;
+    return &this->m_buffer[offset];
+  }
+
   void writePixel(int x, int y, const float color[4]);
   void addPixel(int x, int y, const float color[4]);
   inline void readBilinear(float *result,
@@ -291,6 +414,10 @@ class MemoryBuffer {
       copy_vn_fl(result, this->m_num_channels, 0.0f);
       return;
     }
+    if (this->m_halfBuffer) {
+      readBilinearHalf(result, u, v, extend_x == COM_MB_REPEAT, extend_y == COM_MB_REPEAT);
+      return;
+    }
     BLI_bilinear_interpolation_wrap_fl(this->m_buffer,
                                        result,
                                        this->m_width,
@@ -352,6 +479,16 @@ class MemoryBuffer {
  private:
   unsigned int determineBufferSize();
 
+  inline void readHalf(float *result, int offset)
+  {
+    const unsigned short *buffer = &this->m_halfBuffer[offset];
+    for (unsigned int channel = 0; channel < this->m_num_channels; channel++) {
+      result[channel] = half_to_float(buffer[channel]);
+    }
+  }
+
+  void readBilinearHalf(float *result, float u, float v, bool wrap_x, bool wrap_y);
+
 #ifdef WITH_CXX_GUARDEDALLOC
   MEM_CXX_CLASS_ALLOC_FUNCS("COM:MemoryBuffer")
 #endif
@@ -0,0 +1,287 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Copyright 2020, Blender Foundation.
+ */
+
+#include <cstddef>
+#include <cstring>
+#include <list>
+#include <typeinfo>
+
+#include "MEM_guardedalloc.h"
+
+#include "atomic_ops.h"
+
+#include "DNA_ID.h"
+#include "DNA_color_types.h"
+#include "DNA_image_types.h"
+#include "DNA_node_types.h"
+#include "DNA_scene_types.h"
+#include "DNA_texture_types.h"
+
+#include "BKE_node.h"
+
+#include "COM_MemoryBufferCache.h"
+#include "COM_ReadBufferOperation.h"
+
+typedef MemoryBufferCache::Key Key;
+
+struct CachedBuffer {
+  Key key;
+  MemoryBuffer *buffer;
+  size_t size;
+};
+
+/// \brief the kept buffers, the most recently used buffer first
+static std::list<CachedBuffer> g_buffers;
+/// \brief memory used by the kept buffers in bytes
+static size_t g_memory_used = 0;
+/// \brief set by MemoryBufferCache.tagClear, checked by MemoryBufferCache.update
+static int32_t g_clear_tagged = 0;
+
+/* Keys are 64 bit FNV-1a hashes. */
+#define KEY_INIT 0xcbf29ce484222325ULL
+#define KEY_PRIME 0x100000001b3ULL
+
+static Key hash_bytes(Key key, const void *data, size_t size)
+{
+  const unsigned char *bytes = (const unsigned char *)data;
+  for (size_t index = 0; index < size; index++) {
+    key = (key ^ bytes[index]) * KEY_PRIME;
+  }
+  return key;
+}
+
+template<typename T> static Key hash_value(Key key, const T &value)
+{
+  return hash_bytes(key, &value, sizeof(value));
+}
+
+static Key hash_string(Key key, const char *str)
+{
+  return hash_bytes(key, str, strlen(str) + 1);
+}
+
+static Key hash_curve_mapping(Key key, const CurveMapping *cumap)
+{
+  /* The tables are calculated from the points, the view and the sample are only drawn. */
+  key = hash_value(key, cumap->flag);
+  key = hash_value(key, cumap->preset);
+  key = hash_value(key, cumap->clipr);
+  for (int index = 0; index < CM_TOT; index++) {
+    const CurveMap *cuma = &cumap->cm[index];
+    key = hash_value(key, cuma->totpoint);
+    if (cuma->curve) {
+      key = hash_bytes(key, cuma->curve, sizeof(CurveMapPoint) * cuma->totpoint);
+    }
+  }
+  key = hash_value(key, cumap->black);
+  key = hash_value(key, cumap->white);
+  key = hash_value(key, cumap->tone);
+  return key;
+}
+
+/* Storage with pointers is hashed by the data it points to, the addresses differ between
+ * evaluated copies of the same node and can be reused by other data. */
+static Key hash_node_storage(Key key, const bNode *node)
+{
+  switch (node->type) {
+    case CMP_NODE_CURVE_VEC:
+    case CMP_NODE_CURVE_RGB:
+    case CMP_NODE_TIME:
+    case CMP_NODE_HUECORRECT:
+      return hash_curve_mapping(key, (const CurveMapping *)node->storage);
+    case CMP_NODE_CRYPTOMATTE: {
+      const NodeCryptomatte *crypto = (const NodeCryptomatte *)node->storage;
+      key = hash_value(key, crypto->add);
+      key = hash_value(key, crypto->remove);
+      key = hash_value(key, crypto->num_inputs);
+      return hash_string(key, crypto->matte_id ? crypto->matte_id : "");
+    }
+    case CMP_NODE_IMAGE:
+    case CMP_NODE_VIEWER:
+    case CMP_NODE_SPLITVIEWER:
+      /* The scene of the image user is only set for drawing render results. */
+      return hash_bytes(key,
+                        (const char *)node->storage + offsetof(ImageUser, framenr),
+                        sizeof(ImageUser) - offsetof(ImageUser, framenr));
+    case CMP_NODE_MAP_VALUE:
+      /* The object is only used for texture coordinates. */
+      return hash_bytes(key, node->storage, offsetof(TexMapping, ob));
+    case CMP_NODE_MOVIEDISTORTION:
+      /* Calculated from the movie clip, which is hashed by the node. */
+      return key;
+    case CMP_NODE_OUTPUT_FILE:
+      /* Only the format of the output, with pointers to view settings. Outputs aren't cached. */
+      return key;
+    default:
+      /* The storage of the other nodes doesn't have pointers. */
+      return hash_bytes(key, node->storage, MEM_allocN_len(node->storage));
+  }
+}
+
+static Key hash_editor_node(Key key, const bNode *node)
+{
+  key = hash_value(key, node->type);
+  key = hash_value(key, node->custom1);
+  key = hash_value(key, node->custom2);
+  key = hash_value(key, node->custom3);
+  key = hash_value(key, node->custom4);
+  /* Evaluated copies share the session UUID of the original data-block. */
+  if (node->id) {
+    key = hash_value(key, node->id->session_uuid);
+  }
+  if (node->storage) {
+    key = hash_node_storage(key, node);
+  }
+  for (bNodeSocket *socket = (bNodeSocket *)node->inputs.first; socket; socket = socket->next) {
+    if (socket->default_value) {
+      key = hash_bytes(key, socket->default_value, MEM_allocN_len(socket->default_value));
+    }
+  }
+  return key;
+}
+
+static Key hash_context(Key key, const CompositorContext &context)
+{
+  const RenderData *rd = context.getRenderData();
+  key = hash_value(key, rd->xsch);
+  key = hash_value(key, rd->ysch);
+  key = hash_value(key, rd->size);
+  key = hash_value(key, rd->mode & (R_BORDER | R_CROP));
+  key = hash_value(key, rd->border);
+  key = hash_value(key, context.getScene()->id.session_uuid);
+  key = hash_value(key, context.getFramenumber());
+  key = hash_value(key, context.getQuality());
+  key = hash_value(key, context.isRendering());
+  key = hash_string(key, context.getViewName() ? context.getViewName() : "");
+  return key;
+}
+
+static Key operation_key(NodeOperation *operation, MemoryBufferCache::OperationKeys &keys)
+{
+  MemoryBufferCache::OperationKeys::iterator iter = keys.find(operation);
+  if (iter != keys.end()) {
+    return iter->second;
+  }
+
+  Key key = hash_string(KEY_INIT, typeid(*operation).name());
+  key = hash_value(key, operation->getWidth());
+  key = hash_value(key, operation->getHeight());
+  if (operation->getbNode()) {
+    key = hash_editor_node(key, operation->getbNode());
+  }
+  if (operation->isSetOperation()) {
+    /* The value of a constant is its output at any position. */
+    float value[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    operation->readSampled(value, 0.0f, 0.0f, COM_PS_NEAREST);
+    key = hash_bytes(key, value, sizeof(value));
+  }
+  if (operation->isReadBufferOperation()) {
+    MemoryProxy *memoryProxy = ((ReadBufferOperation *)operation)->getMemoryProxy();
+    key = hash_value(key, operation_key(memoryProxy->getWriteBufferOperation(), keys));
+  }
+  for (unsigned int index = 0; index < operation->getNumberOfInputSockets(); index++) {
+    NodeOperationInput *input = operation->getInputSocket(index);
+    key = hash_value(key, input->getDataType());
+    if (input->isConnected()) {
+      key = hash_value(key, operation_key(&input->getLink()->getOperation(), keys));
+    }
+  }
+  /* Nodes create operations of the same type for different outputs, e.g. for render passes. */
+  for (unsigned int index = 0; index < operation->getNumberOfOutputSockets(); index++) {
+    NodeOperationOutput *output = operation->getOutputSocket(index);
+    key = hash_value(key, output->getDataType());
+    if (output->getbNodeSocket()) {
+      key = hash_string(key, output->getbNodeSocket()->identifier);
+    }
+  }
+
+  keys[operation] = key;
+  return key;
+}
+
+Key MemoryBufferCache::determineKey(const CompositorContext &context,
+                                    WriteBufferOperation *operation,
+                                    OperationKeys &keys)
+{
+  Key key = hash_context(operation_key(operation, keys), context);
+  return hash_value(key, operation->getMemoryProxy()->isHalfFloat());
+}
+
+MemoryBuffer *MemoryBufferCache::acquire(Key key)
+{
+  for (std::list<CachedBuffer>::iterator iter = g_buffers.begin(); iter != g_buffers.end();
+       ++iter) {
+    if (iter->key == key) {
+      MemoryBuffer *buffer = iter->buffer;
+      g_memory_used -= iter->size;
+      g_buffers.erase(iter);
+      return buffer;
+    }
+  }
+  return NULL;
+}
+
+static void free_least_recently_used(size_t limit)
+{
+  while (g_memory_used > limit) {
+    CachedBuffer &cached = g_buffers.back();
+    g_memory_used -= cached.size;
+    delete cached.buffer;
+    g_buffers.pop_back();
+  }
+}
+
+void MemoryBufferCache::release(Key key, MemoryBuffer *buffer, size_t limit)
+{
+  CachedBuffer cached;
+  cached.key = key;
+  cached.buffer = buffer;
+  cached.size = buffer->getMemorySize();
+  if (cached.size > limit) {
+    delete buffer;
+    return;
+  }
+  /* Two buffers with the same key have the same content. */
+  MemoryBuffer *existing = acquire(key);
+  if (existing) {
+    delete existing;
+  }
+  g_buffers.push_front(cached);
+  g_memory_used += cached.size;
+  free_least_recently_used(limit);
+}
+
+void MemoryBufferCache::update(size_t limit)
+{
+  if (atomic_fetch_and_and_int32(&g_clear_tagged, 0) || limit == 0) {
+    clear();
+  }
+  else {
+    free_least_recently_used(limit);
+  }
+}
+
+void MemoryBufferCache::tagClear()
+{
+  atomic_fetch_and_or_int32(&g_clear_tagged, 1);
+}
+
+void MemoryBufferCache::clear()
+{
+  free_least_recently_used(0);
+}
@@ -0,0 +1,91 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Copyright 2020, Blender Foundation.
+ */
+
+#pragma once
+
+#include <map>
+
+#include "BLI_sys_types.h"
+
+#include "COM_CompositorContext.h"
+#include "COM_MemoryBuffer.h"
+#include "COM_NodeOperation.h"
+#include "COM_WriteBufferOperation.h"
+
+/**
+ * \brief keeps the buffers of write buffer operations between executions of the compositor.
+ *
+ * A buffer is identified by a key calculated from the operations it depends on: their types,
+ * resolutions and the settings of their editor nodes, and from the context of the execution.
+ * When an execution calculates a buffer with the key of a kept buffer, the ExecutionSystem uses
+ * the kept buffer and skips the chunks of the ExecutionGroup and the groups feeding it. After
+ * changing a node only the buffers after that node are calculated again.
+ *
+ * The cache uses at most CompositorContext.getCacheLimit bytes, the least recently used buffers
+ * are freed first. Changes of data outside the node tree (render results, images, masks and
+ * movie clips) are not part of the keys, COM_clearCaches needs to be called for them.
+ *
+ * \note only used from the thread that executes the compositor, when it holds the compositor
+ * mutex
+ * \see bNodeTree.cache_size
+ */
+class MemoryBufferCache {
+ public:
+  typedef uint64_t Key;
+  typedef std::map<NodeOperation *, Key> OperationKeys;
+
+  /**
+   * \brief determine the key of the buffer of a write buffer operation
+   * \param keys: keys of the already visited operations, shared by all calls of an execution
+   */
+  static Key determineKey(const CompositorContext &context,
+                          WriteBufferOperation *operation,
+                          OperationKeys &keys);
+
+  /**
+   * \brief take a kept buffer out of the cache
+   * \return the buffer, the caller becomes the owner. NULL when no buffer with the key is kept.
+   */
+  static MemoryBuffer *acquire(Key key);
+
+  /**
+   * \brief keep a completely calculated buffer for later executions
+   * \note the cache becomes the owner of the buffer, it's freed when it doesn't fit in the limit
+   * \param limit: memory budget of the cache in bytes
+   */
+  static void release(Key key, MemoryBuffer *buffer, size_t limit);
+
+  /**
+   * \brief free the least recently used buffers until the cache fits in the limit, or all
+   * buffers when the cache is disabled or tagged to be cleared.
+   * \note called at the start of every execution
+   * \param limit: memory budget of the cache in bytes
+   */
+  static void update(size_t limit);
+
+  /**
+   * \brief tag the kept buffers to be freed before the next execution
+   * \note can be called from any thread, also during an execution
+   */
+  static void tagClear();
+
+  /**
+   * \brief free all kept buffers
+   */
+  static void clear();
+};
@@ -22,7 +22,9 @@ MemoryProxy::MemoryProxy(DataType datatype)
 {
   this->m_writeBufferOperation = NULL;
   this->m_executor = NULL;
+  this->m_buffer = NULL;
   this->m_datatype = datatype;
+  this->m_halfFloat = false;
 }
 
 void MemoryProxy::allocate(unsigned int width, unsigned int height)
@@ -36,6 +38,20 @@ void MemoryProxy::allocate(unsigned int width, unsigned int height)
   this->m_buffer = new MemoryBuffer(this, 1, &result);
 }
 
+void MemoryProxy::setBuffer(MemoryBuffer *buffer)
+{
+  BLI_assert(this->m_buffer == NULL);
+  buffer->setMemoryProxy(this);
+  this->m_buffer = buffer;
+}
+
+MemoryBuffer *MemoryProxy::releaseBuffer()
+{
+  MemoryBuffer *buffer = this->m_buffer;
+  this->m_buffer = NULL;
+  return buffer;
+}
+
 void MemoryProxy::free()
 {
   if (this->m_buffer) {
@@ -64,6 +64,12 @@ class MemoryProxy {
    */
   DataType m_datatype;
 
+  /**
+   * \brief store the buffer as half float
+   * \see NodeOperation.isHalfFloat
+   */
+  bool m_halfFloat;
+
  public:
   MemoryProxy(DataType type);
 
@@ -107,6 +113,18 @@ class MemoryProxy {
    */
   void allocate(unsigned int width, unsigned int height);
 
+  /**
+   * \brief use a buffer calculated by an earlier execution instead of allocating memory
+   * \note the MemoryProxy becomes the owner of the buffer
+   */
+  void setBuffer(MemoryBuffer *buffer);
+
+  /**
+   * \brief take the allocated memory out of this MemoryProxy
+   * \note the caller becomes the owner of the returned buffer
+   */
+  MemoryBuffer *releaseBuffer();
+
   /**
    * \brief free the allocated memory
    */
@@ -125,6 +143,19 @@ class MemoryProxy {
     return this->m_datatype;
   }
 
+  /**
+   * \brief set if the buffer is stored as half float, must be set before allocating
+   */
+  void setHalfFloat(bool halfFloat)
+  {
+    this->m_halfFloat = halfFloat;
+  }
+
+  bool isHalfFloat() const
+  {
+    return this->m_halfFloat;
+  }
+
 #ifdef WITH_CXX_GUARDEDALLOC
   MEM_CXX_CLASS_ALLOC_FUNCS("COM:MemoryProxy")
 #endif
@@ -36,7 +36,11 @@ NodeOperation::NodeOperation()
   this->m_height = 0;
   this->m_isResolutionSet = false;
   this->m_openCL = false;
+  this->m_fullFrame = false;
+  this->m_useFullFrame = false;
+  this->m_halfFloat = false;
   this->m_btree = NULL;
+  this->m_bnode = NULL;
 }
 
 NodeOperation::~NodeOperation()
@@ -225,7 +229,7 @@ void NodeOperationInput::determineResolution(unsigned int resolution[2],
  ******************/
 
 NodeOperationOutput::NodeOperationOutput(NodeOperation *op, DataType datatype)
-    : m_operation(op), m_datatype(datatype)
+    : m_operation(op), m_datatype(datatype), m_editorSocket(NULL)
 {
 }
 
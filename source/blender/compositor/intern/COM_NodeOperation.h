@@ -102,6 +102,25 @@ class NodeOperation : public SocketReader {
    */
   bool m_openCL;
 
+  /**
+   * \brief can this operation calculate whole areas at once.
+   * \see NodeOperation.executeFullFrame
+   */
+  bool m_fullFrame;
+
+  /**
+   * \brief calculate the inputs of this output operation buffer-at-a-time.
+   * \see FullFrameEvaluator
+   */
+  bool m_useFullFrame;
+
+  /**
+   * \brief can the color output of this operation be stored as half float when it's buffered.
+   * Set by operations of which the results are images, not data that needs float precision.
+   * \see NTREE_COM_HALF_FLOAT
+   */
+  bool m_halfFloat;
+
   /**
    * \brief mutex reference for very special node initializations
    * \note only use when you really know what you are doing.
@@ -118,6 +137,13 @@ class NodeOperation : public SocketReader {
    */
   const bNodeTree *m_btree;
 
+  /**
+   * \brief the editor node this operation is created for, NULL for operations added by the
+   * compositor itself
+   * \see MemoryBufferCache
+   */
+  const bNode *m_bnode;
+
   /**
    * \brief set to truth when resolution for this operation is set
    */
@@ -187,6 +213,14 @@ class NodeOperation : public SocketReader {
   {
     this->m_btree = tree;
   }
+  void setbNode(const bNode *node)
+  {
+    this->m_bnode = node;
+  }
+  const bNode *getbNode() const
+  {
+    return this->m_bnode;
+  }
   virtual void initExecution();
 
   /**
@@ -200,6 +234,22 @@ class NodeOperation : public SocketReader {
   {
   }
 
+  /**
+   * \brief calculate an area of the output at once, used by full-frame execution
+   * \ingroup execution
+   * \note only called when the operation is set to be full-frame. The pixel at (x, y) of the
+   * output may only depend on the pixels at (x, y) of the inputs, as read with COM_PS_NEAREST.
+   * \param output: the buffer to write to, contains the area
+   * \param area: the rectangle to calculate
+   * \param inputs: the buffers of the input operations, contain the area
+   * \see FullFrameEvaluator
+   */
+  virtual void executeFullFrame(MemoryBuffer * /*output*/,
+                                rcti * /*area*/,
+                                MemoryBuffer ** /*inputs*/)
+  {
+  }
+
   /**
    * \brief when a chunk is executed by an OpenCLDevice, this method is called
    * \ingroup execution
@@ -276,6 +326,35 @@ class NodeOperation : public SocketReader {
     return this->m_complex;
   }
 
+  /**
+   * \brief can this operation calculate whole areas at once with executeFullFrame
+   */
+  bool isFullFrame() const
+  {
+    return this->m_fullFrame;
+  }
+
+  /**
+   * \brief can the color output of this operation be stored as half float when it's buffered
+   */
+  bool isHalfFloat() const
+  {
+    return this->m_halfFloat;
+  }
+
+  /**
+   * \brief set whether this output operation calculates its inputs buffer-at-a-time
+   * \see FullFrameEvaluator
+   */
+  void setUseFullFrame(bool useFullFrame)
+  {
+    this->m_useFullFrame = useFullFrame;
+  }
+  bool useFullFrame() const
+  {
+    return this->m_useFullFrame;
+  }
+
   virtual bool isSetOperation() const
   {
     return false;
@@ -420,6 +499,22 @@ class NodeOperation : public SocketReader {
     this->m_openCL = openCL;
   }
 
+  /**
+   * \brief set if the color output of this NodeOperation can be stored as half float
+   */
+  void setHalfFloat(bool halfFloat)
+  {
+    this->m_halfFloat = halfFloat;
+  }
+
+  /**
+   * \brief set if this NodeOperation implements executeFullFrame
+   */
+  void setFullFrame(bool fullFrame)
+  {
+    this->m_fullFrame = fullFrame;
+  }
+
   /* allow the DebugInfo class to look at internals */
   friend class DebugInfo;
 
@@ -497,6 +592,11 @@ class NodeOperationOutput {
    */
   DataType m_datatype;
 
+  /** The editor node socket this socket is mapped to, NULL for internal sockets of a node.
+   * \see MemoryBufferCache
+   */
+  const bNodeSocket *m_editorSocket;
+
  public:
   NodeOperationOutput(NodeOperation *op, DataType datatype);
 
@@ -508,6 +608,14 @@ class NodeOperationOutput {
   {
     return m_datatype;
   }
+  void setbNodeSocket(const bNodeSocket *socket)
+  {
+    m_editorSocket = socket;
+  }
+  const bNodeSocket *getbNodeSocket() const
+  {
+    return m_editorSocket;
+  }
 
   /**
    * \brief determine the resolution of this data going through this socket
@@ -18,8 +18,22 @@
 
 #include "COM_WorkPackage.h"
 
+#include "atomic_ops.h"
+
 WorkPackage::WorkPackage(ExecutionGroup *group, unsigned int chunkNumber)
 {
   this->m_executionGroup = group;
   this->m_chunkNumber = chunkNumber;
+  this->m_numberOfDependencies = 0;
+}
+
+void WorkPackage::addDependent(WorkPackage *dependent)
+{
+  this->m_dependents.push_back(dependent);
+  dependent->m_numberOfDependencies++;
+}
+
+bool WorkPackage::dependencyExecuted()
+{
+  return atomic_sub_and_fetch_u(&this->m_numberOfDependencies, 1) == 0;
 }
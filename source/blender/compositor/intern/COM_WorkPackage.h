@@ -22,6 +22,7 @@ class WorkPackage;
 
 class ExecutionGroup;
 #include "COM_ExecutionGroup.h"
+#include <vector>
 
 /**
  * \brief contains data about work that can be scheduled
@@ -39,6 +40,18 @@ class WorkPackage {
    */
   unsigned int m_chunkNumber;
 
+  /**
+   * \brief number of chunks of input ExecutionGroups that still need to be executed
+   * before this chunk can be executed
+   */
+  unsigned int m_numberOfDependencies;
+
+  /**
+   * \brief WorkPackages reading the chunk of this WorkPackage.
+   * \note A WorkPackage is scheduled when its last dependency has been executed.
+   */
+  std::vector<WorkPackage *> m_dependents;
+
  public:
   /**
    * constructor
@@ -63,6 +76,35 @@ class WorkPackage {
     return this->m_chunkNumber;
   }
 
+  /**
+   * \brief get the number of chunks that still need to be executed before this chunk
+   */
+  unsigned int getNumberOfDependencies() const
+  {
+    return this->m_numberOfDependencies;
+  }
+
+  /**
+   * \brief get the WorkPackages reading the chunk of this WorkPackage
+   */
+  const std::vector<WorkPackage *> &getDependents() const
+  {
+    return this->m_dependents;
+  }
+
+  /**
+   * \brief let another WorkPackage wait until this WorkPackage has been executed.
+   * \note Only to be called while building the task graph, before any chunk is executed.
+   * \param dependent: the WorkPackage reading the chunk of this WorkPackage
+   */
+  void addDependent(WorkPackage *dependent);
+
+  /**
+   * \brief notify that one of the dependencies of this WorkPackage has been executed.
+   * \return true when this was the last dependency and the WorkPackage can be scheduled
+   */
+  bool dependencyExecuted();
+
 #ifdef WITH_CXX_GUARDEDALLOC
   MEM_CXX_CLASS_ALLOC_FUNCS("COM:WorkPackage")
 #endif
@@ -29,6 +29,8 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "BLI_assert.h"
+#include "BLI_task.h"
 #include "BLI_threads.h"
 #include "PIL_time.h"
 
@@ -38,7 +40,7 @@
 #  ifndef DEBUG /* test this so we dont get warnings in debug builds */
 #    warning COM_CURRENT_THREADING_MODEL COM_TM_NOTHREAD is activated. Use only for debugging.
 #  endif
-#elif COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
+#elif COM_CURRENT_THREADING_MODEL == COM_TM_TASK
 /* do nothing - default */
 #else
 #  error COM_CURRENT_THREADING_MODEL No threading model selected
@@ -48,22 +50,29 @@
 static vector<CPUDevice *> g_cpudevices;
 static ThreadLocal(CPUDevice *) g_thread_device;
 
-#if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
-/// \brief list of all thread for every CPUDevice in cpudevices a thread exists
-static ListBase g_cputhreads;
+#if COM_CURRENT_THREADING_MODEL == COM_TM_TASK
+/// \brief devices of one kind that are not executing a chunk, and the chunks waiting for one
+struct DeviceQueue {
+  ThreadMutex mutex;
+  vector<Device *> devices;
+  list<WorkPackage *> pending;
+};
+
 static bool g_cpuInitialized = false;
-/// \brief all scheduled work for the cpu
-static ThreadQueue *g_cpuqueue;
-static ThreadQueue *g_gpuqueue;
+/// \brief task pool executing the scheduled chunks
+static TaskPool *g_taskpool;
+/// \brief all CPUDevices that are not executing a chunk
+static DeviceQueue g_cpuqueue;
+/// \brief thread that started the execution and waits for the task graph
+static pthread_t g_execution_thread;
 #  ifdef COM_OPENCL_ENABLED
+/// \brief all OpenCLDevices that are not executing a chunk
+static DeviceQueue g_gpuqueue;
 static cl_context g_context;
 static cl_program g_program;
 /// \brief list of all OpenCLDevices. for every OpenCL GPU device an instance of OpenCLDevice is
 /// created
 static vector<OpenCLDevice *> g_gpudevices;
-/// \brief list of all thread for every GPUDevice in cpudevices a thread exists
-static ListBase g_gputhreads;
-/// \brief all scheduled work for the gpu
 #    ifdef COM_OPENCL_ENABLED
 static bool g_openclActive = false;
 static bool g_openclInitialized = false;
@@ -71,73 +80,103 @@ static bool g_openclInitialized = false;
 #  endif
 #endif
 
-#if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
-void *WorkScheduler::thread_execute_cpu(void *data)
+/**
+ * \brief schedule the WorkPackages that were only waiting for an executed WorkPackage.
+ */
+static void schedule_dependents(WorkPackage *work)
 {
-  CPUDevice *device = (CPUDevice *)data;
-  WorkPackage *work;
-  BLI_thread_local_set(g_thread_device, device);
-  while ((work = (WorkPackage *)BLI_thread_queue_pop(g_cpuqueue))) {
-    device->execute(work);
-    delete work;
+  const vector<WorkPackage *> &dependents = work->getDependents();
+  for (unsigned int index = 0; index < dependents.size(); index++) {
+    WorkPackage *dependent = dependents[index];
+    if (dependent->dependencyExecuted()) {
+      WorkScheduler::schedule(dependent);
+    }
   }
-
-  return NULL;
 }
 
-void *WorkScheduler::thread_execute_gpu(void *data)
+#if COM_CURRENT_THREADING_MODEL == COM_TM_TASK
+static void thread_execute_task(TaskPool *__restrict pool, void *taskdata)
 {
-  Device *device = (Device *)data;
-  WorkPackage *work;
+  WorkPackage *work = (WorkPackage *)taskdata;
+  CompositorContext *context = (CompositorContext *)BLI_task_pool_user_data(pool);
+  const bNodeTree *bTree = context->getbNodeTree();
+
+  /* Leave the dependent chunks unscheduled, so the remaining task graph is skipped. */
+  if (bTree->test_break && bTree->test_break(bTree->tbh)) {
+    return;
+  }
 
-  while ((work = (WorkPackage *)BLI_thread_queue_pop(g_gpuqueue))) {
-    device->execute(work);
-    delete work;
+  DeviceQueue *queue = &g_cpuqueue;
+#  ifdef COM_OPENCL_ENABLED
+  if (work->getExecutionGroup()->isOpenCL() && g_openclActive) {
+    queue = &g_gpuqueue;
   }
+#  endif
+  /* Don't block the thread of the task pool while waiting for a device, the number of devices
+   * limits the number of chunks executed at the same time. Leave the chunk to the task that
+   * releases the next device instead, so the thread can execute other chunks meanwhile. */
+  BLI_mutex_lock(&queue->mutex);
+  if (queue->devices.empty()) {
+    queue->pending.push_back(work);
+    BLI_mutex_unlock(&queue->mutex);
+    return;
+  }
+  Device *device = queue->devices.back();
+  queue->devices.pop_back();
+  BLI_mutex_unlock(&queue->mutex);
 
-  return NULL;
+  if (queue == &g_cpuqueue) {
+    BLI_thread_local_set(g_thread_device, (CPUDevice *)device);
+  }
+  while (work) {
+    const bool is_break = bTree->test_break && bTree->test_break(bTree->tbh);
+    if (!is_break) {
+      device->execute(work);
+    }
+
+    /* Keep the device for the next pending chunk. Otherwise release it before scheduling,
+     * without threads the dependents run right away. */
+    BLI_mutex_lock(&queue->mutex);
+    WorkPackage *next = NULL;
+    if (!queue->pending.empty()) {
+      next = queue->pending.front();
+      queue->pending.pop_front();
+    }
+    else {
+      queue->devices.push_back(device);
+    }
+    BLI_mutex_unlock(&queue->mutex);
+
+    if (!is_break) {
+      schedule_dependents(work);
+    }
+    work = next;
+  }
 }
 #endif
 
-void WorkScheduler::schedule(ExecutionGroup *group, int chunkNumber)
+void WorkScheduler::schedule(WorkPackage *package)
 {
-  WorkPackage *package = new WorkPackage(group, chunkNumber);
 #if COM_CURRENT_THREADING_MODEL == COM_TM_NOTHREAD
   CPUDevice device(0);
   device.execute(package);
-  delete package;
-#elif COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
-#  ifdef COM_OPENCL_ENABLED
-  if (group->isOpenCL() && g_openclActive) {
-    BLI_thread_queue_push(g_gpuqueue, package);
-  }
-  else {
-    BLI_thread_queue_push(g_cpuqueue, package);
-  }
-#  else
-  BLI_thread_queue_push(g_cpuqueue, package);
-#  endif
+  schedule_dependents(package);
+#elif COM_CURRENT_THREADING_MODEL == COM_TM_TASK
+  BLI_task_pool_push(g_taskpool, thread_execute_task, package, false, NULL);
 #endif
 }
 
 void WorkScheduler::start(CompositorContext &context)
 {
-#if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
-  unsigned int index;
-  g_cpuqueue = BLI_thread_queue_init();
-  BLI_threadpool_init(&g_cputhreads, thread_execute_cpu, g_cpudevices.size());
-  for (index = 0; index < g_cpudevices.size(); index++) {
-    Device *device = g_cpudevices[index];
-    BLI_threadpool_insert(&g_cputhreads, device);
-  }
+#if COM_CURRENT_THREADING_MODEL == COM_TM_TASK
+  g_execution_thread = pthread_self();
+  g_taskpool = BLI_task_pool_create_suspended(&context, TASK_PRIORITY_HIGH);
+  BLI_mutex_init(&g_cpuqueue.mutex);
+  g_cpuqueue.devices.assign(g_cpudevices.begin(), g_cpudevices.end());
 #  ifdef COM_OPENCL_ENABLED
   if (context.getHasActiveOpenCLDevices()) {
-    g_gpuqueue = BLI_thread_queue_init();
-    BLI_threadpool_init(&g_gputhreads, thread_execute_gpu, g_gpudevices.size());
-    for (index = 0; index < g_gpudevices.size(); index++) {
-      Device *device = g_gpudevices[index];
-      BLI_threadpool_insert(&g_gputhreads, device);
-    }
+    BLI_mutex_init(&g_gpuqueue.mutex);
+    g_gpuqueue.devices.assign(g_gpudevices.begin(), g_gpudevices.end());
     g_openclActive = true;
   }
   else {
@@ -148,33 +187,31 @@ void WorkScheduler::start(CompositorContext &context)
 }
 void WorkScheduler::finish()
 {
-#if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
-#  ifdef COM_OPENCL_ENABLED
-  if (g_openclActive) {
-    BLI_thread_queue_wait_finish(g_gpuqueue);
-    BLI_thread_queue_wait_finish(g_cpuqueue);
-  }
-  else {
-    BLI_thread_queue_wait_finish(g_cpuqueue);
-  }
-#  else
-  BLI_thread_queue_wait_finish(cpuqueue);
-#  endif
+#if COM_CURRENT_THREADING_MODEL == COM_TM_TASK
+  /* Start the suspended chunks, chunks scheduled from here on are scheduled by their last
+   * dependency. */
+  BLI_task_pool_work_and_wait(g_taskpool);
+
+  /* Hold back the chunks of the next task graph again until it is complete. */
+  void *context = BLI_task_pool_user_data(g_taskpool);
+  BLI_task_pool_free(g_taskpool);
+  g_taskpool = BLI_task_pool_create_suspended(context, TASK_PRIORITY_HIGH);
 #endif
 }
 void WorkScheduler::stop()
 {
-#if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
-  BLI_thread_queue_nowait(g_cpuqueue);
-  BLI_threadpool_end(&g_cputhreads);
-  BLI_thread_queue_free(g_cpuqueue);
-  g_cpuqueue = NULL;
+#if COM_CURRENT_THREADING_MODEL == COM_TM_TASK
+  BLI_task_pool_free(g_taskpool);
+  g_taskpool = NULL;
+  /* The task releasing the last device took the pending chunks, also after a break. */
+  BLI_assert(g_cpuqueue.pending.empty());
+  g_cpuqueue.devices.clear();
+  BLI_mutex_end(&g_cpuqueue.mutex);
 #  ifdef COM_OPENCL_ENABLED
   if (g_openclActive) {
-    BLI_thread_queue_nowait(g_gpuqueue);
-    BLI_threadpool_end(&g_gputhreads);
-    BLI_thread_queue_free(g_gpuqueue);
-    g_gpuqueue = NULL;
+    BLI_assert(g_gpuqueue.pending.empty());
+    g_gpuqueue.devices.clear();
+    BLI_mutex_end(&g_gpuqueue.mutex);
   }
 #  endif
 #endif
@@ -182,7 +219,7 @@ void WorkScheduler::stop()
 
 bool WorkScheduler::hasGPUDevices()
 {
-#if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
+#if COM_CURRENT_THREADING_MODEL == COM_TM_TASK
 #  ifdef COM_OPENCL_ENABLED
   return !g_gpudevices.empty();
 #  else
@@ -193,7 +230,7 @@ bool WorkScheduler::hasGPUDevices()
 #endif
 }
 
-#if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
+#if COM_CURRENT_THREADING_MODEL == COM_TM_TASK
 static void CL_CALLBACK clContextError(const char *errinfo,
                                        const void * /*private_info*/,
                                        size_t /*cb*/,
@@ -205,7 +242,7 @@ static void CL_CALLBACK clContextError(const char *errinfo,
 
 void WorkScheduler::initialize(bool use_opencl, int num_cpu_threads)
 {
-#if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
+#if COM_CURRENT_THREADING_MODEL == COM_TM_TASK
   /* deinitialize if number of threads doesn't match */
   if (g_cpudevices.size() != num_cpu_threads) {
     Device *device;
@@ -327,7 +364,7 @@ void WorkScheduler::initialize(bool use_opencl, int num_cpu_threads)
 
 void WorkScheduler::deinitialize()
 {
-#if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
+#if COM_CURRENT_THREADING_MODEL == COM_TM_TASK
   /* deinitialize CPU threads */
   if (g_cpuInitialized) {
     Device *device;
@@ -371,3 +408,12 @@ int WorkScheduler::current_thread_id()
   CPUDevice *device = (CPUDevice *)BLI_thread_local_get(g_thread_device);
   return device->thread_id();
 }
+
+bool WorkScheduler::isExecutionThread()
+{
+#if COM_CURRENT_THREADING_MODEL == COM_TM_TASK
+  return pthread_equal(pthread_self(), g_execution_thread);
+#else
+  return true;
+#endif
+}
@@ -30,36 +30,18 @@
  * \ingroup execution
  */
 class WorkScheduler {
-
-#if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
-  /**
-   * \brief are we being stopped.
-   */
-  static bool isStopping();
-
-  /**
-   * \brief main thread loop for cpudevices
-   * inside this loop new work is queried and being executed
-   */
-  static void *thread_execute_cpu(void *data);
-
-  /**
-   * \brief main thread loop for gpudevices
-   * inside this loop new work is queried and being executed
-   */
-  static void *thread_execute_gpu(void *data);
-#endif
  public:
   /**
    * \brief schedule a chunk of a group to be calculated.
-   * An execution group schedules a chunk in the WorkScheduler
+   * An execution group schedules a chunk in the WorkScheduler when all chunks it depends on
+   * have been executed. After the chunk has been executed the WorkScheduler schedules the
+   * dependent chunks of which this was the last dependency.
    * when ExecutionGroup.isOpenCL is set the work will be handled by a OpenCLDevice
    * otherwise the work is scheduled for an CPUDevice
    * \see ExecutionGroup.execute
-   * \param group: the execution group
-   * \param chunkNumber: the number of the chunk in the group to be executed
+   * \param package: the WorkPackage of the chunk to be executed
    */
-  static void schedule(ExecutionGroup *group, int chunkNumber);
+  static void schedule(WorkPackage *package);
 
   /**
    * \brief initialize the WorkScheduler
@@ -83,21 +65,22 @@ class WorkScheduler {
 
   /**
    * \brief Start the execution
-   * this methods will start the WorkScheduler. Inside this method all threads are initialized.
-   * for every device a thread is created.
+   * this methods will start the WorkScheduler. Inside this method the task pool is created.
+   * Scheduled chunks are held back until finish is called, so the task graph can be completed
+   * before any of its chunks is executed.
    * \see initialize Initialization and query of the number of devices
    */
   static void start(CompositorContext &context);
 
   /**
    * \brief stop the execution
-   * All created thread by the start method are destroyed.
+   * The task pool created by the start method is destroyed.
    * \see start
    */
   static void stop();
 
   /**
-   * \brief wait for all work to be completed.
+   * \brief execute the scheduled chunks and wait for all work to be completed.
    */
   static void finish();
 
@@ -111,6 +94,14 @@ class WorkScheduler {
 
   static int current_thread_id();
 
+  /**
+   * \brief is this the thread that executes the task graph?
+   * Callbacks of the node tree are only called from this thread, other threads only calculate
+   * chunks.
+   * \see finish
+   */
+  static bool isExecutionThread();
+
 #ifdef WITH_CXX_GUARDEDALLOC
   MEM_CXX_CLASS_ALLOC_FUNCS("COM:WorkScheduler")
 #endif
@@ -24,6 +24,7 @@
 #include "BKE_scene.h"
 
 #include "COM_ExecutionSystem.h"
+#include "COM_MemoryBufferCache.h"
 #include "COM_MovieDistortionOperation.h"
 #include "COM_WorkScheduler.h"
 #include "COM_compositor.h"
@@ -76,6 +77,9 @@ void COM_execute(RenderData *rd,
   }
   BKE_node_preview_init_tree(editingtree, preview_width, preview_height, false);
 
+  /* free the node results kept by earlier executions that can't be used anymore */
+  MemoryBufferCache::update((size_t)editingtree->cache_size * 1024 * 1024);
+
   /* initialize workscheduler, will check if already done. TODO deinitialize somewhere */
   bool use_opencl = (editingtree->flag & NTREE_COM_OPENCL) != 0;
   WorkScheduler::initialize(use_opencl, BKE_render_num_threads(rd));
@@ -112,9 +116,16 @@ void COM_deinitialize()
 {
   if (is_compositorMutex_init) {
     BLI_mutex_lock(&s_compositorMutex);
+    MemoryBufferCache::clear();
     WorkScheduler::deinitialize();
     is_compositorMutex_init = false;
     BLI_mutex_unlock(&s_compositorMutex);
     BLI_mutex_end(&s_compositorMutex);
   }
 }
+
+void COM_clearCaches()
+{
+  /* The compositor can be executing, the cache is cleared before the next execution. */
+  MemoryBufferCache::tagClear();
+}
@@ -27,6 +27,7 @@ BilateralBlurOperation::BilateralBlurOperation() : NodeOperation()
   this->addInputSocket(COM_DT_COLOR);
   this->addOutputSocket(COM_DT_COLOR);
   this->setComplex(true);
+  this->setHalfFloat(true);
 
   this->m_inputColorProgram = NULL;
   this->m_inputDeterminatorProgram = NULL;
@@ -29,6 +29,7 @@ BlurBaseOperation::BlurBaseOperation(DataType data_type) : NodeOperation()
   this->addInputSocket(COM_DT_VALUE);
   this->addOutputSocket(data_type);
   this->setComplex(true);
+  this->setHalfFloat(true);
   this->m_inputProgram = NULL;
   memset(&m_data, 0, sizeof(NodeBlurData));
   this->m_size = 1.0f;
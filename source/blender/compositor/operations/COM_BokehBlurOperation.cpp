@@ -18,7 +18,10 @@
 
 #include "COM_BokehBlurOperation.h"
 #include "BLI_math.h"
+#include "BLI_task.h"
+#include "COM_FastHartleyTransform.h"
 #include "COM_OpenCLDevice.h"
+#include "MEM_guardedalloc.h"
 
 #include "RE_pipeline.h"
 
@@ -31,14 +34,18 @@ BokehBlurOperation::BokehBlurOperation() : NodeOperation()
   this->addOutputSocket(COM_DT_COLOR);
   this->setComplex(true);
   this->setOpenCL(true);
+  this->setHalfFloat(true);
 
   this->m_size = 1.0f;
   this->m_sizeavailable = false;
+  this->m_sizeconstant = false;
   this->m_inputProgram = NULL;
   this->m_inputBokehProgram = NULL;
   this->m_inputBoundingBoxReader = NULL;
 
   this->m_extend_bounds = false;
+  this->m_bokehKernel = NULL;
+  this->m_convolved = NULL;
 }
 
 void *BokehBlurOperation::initializeTileData(rcti * /*rect*/)
@@ -48,13 +55,254 @@ void *BokehBlurOperation::initializeTileData(rcti * /*rect*/)
     updateSize();
   }
   void *buffer = getInputOperation(0)->initializeTileData(NULL);
+  const int pixelSize = getPixelSize();
+  if (this->m_bokehKernel == NULL && pixelSize > 0) {
+    updateBokehKernel(pixelSize);
+  }
   unlockMutex();
+
+  /* Convolved in parallel, without holding the operation mutex for the whole transform. The
+   * chunks wait for it in the meantime as they all read from the result. */
+  if (useFHT()) {
+    BLI_mutex_lock(&this->m_convolvedMutex);
+    if (this->m_convolved == NULL) {
+      this->m_convolved = convolveFHT((MemoryBuffer *)buffer, pixelSize);
+    }
+    BLI_mutex_unlock(&this->m_convolvedMutex);
+  }
   return buffer;
 }
 
+int BokehBlurOperation::getPixelSize() const
+{
+  const float max_dim = max(this->getWidth(), this->getHeight());
+  return this->m_size * max_dim / 100.0f;
+}
+
+bool BokehBlurOperation::useFHT() const
+{
+  /* The whole input is needed, so the size must be known before the chunks are scheduled. */
+  return this->m_sizeconstant && getPixelSize() >= BOKEH_BLUR_FHT_RADIUS * getStep();
+}
+
+void BokehBlurOperation::updateBokehKernel(int pixelSize)
+{
+  const int kernelSize = 2 * pixelSize;
+  float *kernel = (float *)MEM_mallocN_aligned(
+      sizeof(float) * kernelSize * kernelSize * COM_NUM_CHANNELS_COLOR, 16, __func__);
+
+  /* Same sampling as the taps of executePixel, done once instead of for every pixel. */
+  float m = this->m_bokehDimension / pixelSize;
+  float *bokeh = kernel;
+  for (int dy = -pixelSize; dy < pixelSize; dy++) {
+    for (int dx = -pixelSize; dx < pixelSize; dx++) {
+      float u = this->m_bokehMidX - dx * m;
+      float v = this->m_bokehMidY - dy * m;
+      this->m_inputBokehProgram->readSampled(bokeh, u, v, COM_PS_NEAREST);
+      bokeh += COM_NUM_CHANNELS_COLOR;
+    }
+  }
+  this->m_bokehKernel = kernel;
+}
+
+struct BokehBlurFHTData {
+  const float *bokehKernel;
+  const float *imageBuffer;
+  float *resultBuffer;
+  fREAL *data1;
+  int imageWidth;
+  int imageHeight;
+  int kernelSize;
+  int size;
+  unsigned int log2_size;
+  int blockSize;
+  int offset;
+  /* Blocks of the pass, every other block in both directions. */
+  int blocksX;
+  int passX;
+  int passY;
+};
+
+static void bokeh_blur_fht_kernel_cb(void *__restrict userdata,
+                                     const int ch,
+                                     const TaskParallelTLS *__restrict /*tls*/)
+{
+  const BokehBlurFHTData *data = (const BokehBlurFHTData *)userdata;
+  const int kernelSize = data->kernelSize;
+  const int size = data->size;
+  fREAL *data1ch = &data->data1[ch * size * size];
+  for (int y = 0; y < kernelSize; y++) {
+    const float *bokeh = &data->bokehKernel[(kernelSize - 1 - y) * kernelSize *
+                                            COM_NUM_CHANNELS_COLOR];
+    for (int x = 0; x < kernelSize; x++) {
+      data1ch[y * size + x] = bokeh[(kernelSize - 1 - x) * COM_NUM_CHANNELS_COLOR + ch];
+    }
+  }
+  FHT2D(data1ch, data->log2_size, data->log2_size, kernelSize, 0);
+}
+
+static void bokeh_blur_fht_block_cb(void *__restrict userdata,
+                                    const int iter,
+                                    const TaskParallelTLS *__restrict tls)
+{
+  const BokehBlurFHTData *data = (const BokehBlurFHTData *)userdata;
+  const int size = data->size;
+  const int blockSize = data->blockSize;
+  const int imageWidth = data->imageWidth;
+  const int imageHeight = data->imageHeight;
+  /* Channels of a block are transformed separately, they add to different floats. */
+  const int ch = iter % COM_NUM_CHANNELS_COLOR;
+  const int block = iter / COM_NUM_CHANNELS_COLOR;
+  const int xmin = (2 * (block % data->blocksX) + data->passX) * blockSize;
+  const int ymin = (2 * (block / data->blocksX) + data->passY) * blockSize;
+  if (xmin >= imageWidth || ymin >= imageHeight) {
+    return;
+  }
+
+  fREAL **data2_p = (fREAL **)tls->userdata_chunk;
+  if (*data2_p == NULL) {
+    *data2_p = (fREAL *)MEM_mallocN(size * size * sizeof(fREAL), "bokeh blur FHT data2");
+  }
+  fREAL *data2 = *data2_p;
+
+  memset(data2, 0, size * size * sizeof(fREAL));
+  for (int y = 0; y < blockSize && ymin + y < imageHeight; y++) {
+    const int index = ((ymin + y) * imageWidth + xmin) * COM_NUM_CHANNELS_COLOR + ch;
+    const float *color = &data->imageBuffer[index];
+    fREAL *fp = &data2[y * size];
+    for (int x = 0; x < blockSize && xmin + x < imageWidth; x++) {
+      fp[x] = color[x * COM_NUM_CHANNELS_COLOR];
+    }
+  }
+
+  FHT2D(data2, data->log2_size, data->log2_size, blockSize, 0);
+  /* FHT2D transposed data, convolve & inverse FHT puts it in order again. */
+  fht_convolve(data2, &data->data1[ch * size * size], data->log2_size, data->log2_size);
+  FHT2D(data2, data->log2_size, data->log2_size, 0, 1);
+
+  for (int y = 0; y < size; y++) {
+    const int yy = ymin + y - data->offset;
+    if (yy < 0 || yy >= imageHeight) {
+      continue;
+    }
+    const fREAL *fp = &data2[y * size];
+    float *color = &data->resultBuffer[yy * imageWidth * COM_NUM_CHANNELS_COLOR + ch];
+    for (int x = 0; x < size; x++) {
+      const int xx = xmin + x - data->offset;
+      if (xx < 0 || xx >= imageWidth) {
+        continue;
+      }
+      color[xx * COM_NUM_CHANNELS_COLOR] += fp[x];
+    }
+  }
+}
+
+static void bokeh_blur_fht_block_free(const void *__restrict /*userdata*/,
+                                      void *__restrict chunk)
+{
+  fREAL **data2_p = (fREAL **)chunk;
+  MEM_SAFE_FREE(*data2_p);
+}
+
+MemoryBuffer *BokehBlurOperation::convolveFHT(MemoryBuffer *inputBuffer, int pixelSize)
+{
+  const int kernelSize = 2 * pixelSize;
+  const int imageWidth = inputBuffer->getWidth();
+  const int imageHeight = inputBuffer->getHeight();
+  MemoryBuffer *result = new MemoryBuffer(COM_DT_COLOR, inputBuffer->getRect());
+  float *resultBuffer = result->getBuffer();
+  result->clear();
+
+  BokehBlurFHTData data;
+  data.bokehKernel = this->m_bokehKernel;
+  data.imageBuffer = inputBuffer->getBuffer();
+  data.resultBuffer = resultBuffer;
+  data.imageWidth = imageWidth;
+  data.imageHeight = imageHeight;
+  data.kernelSize = kernelSize;
+  /* Block add-overlap as in GlareFogGlowOperation, FHT pow2 required size & log2. Small kernels
+   * get larger blocks than needed, which need fewer transforms for the image. */
+  data.size = fht_next_pow2(max(2 * kernelSize - 1, 512), &data.log2_size);
+  data.blockSize = (data.size + 1) - kernelSize;
+  /* The kernel is mirrored, so the bokeh weights the colors at the offsets used by
+   * executePixel, of which the first is -pixelSize. */
+  data.offset = pixelSize - 1;
+  data.data1 = (fREAL *)MEM_callocN(
+      COM_NUM_CHANNELS_COLOR * data.size * data.size * sizeof(fREAL), "bokeh blur FHT data1");
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1;
+  BLI_task_parallel_range(0, COM_NUM_CHANNELS_COLOR, &data, bokeh_blur_fht_kernel_cb, &settings);
+
+  /* A block adds to the blocks next to it, as blockSize is at least the kernel size. Blocks two
+   * apart don't overlap, so the four passes of every other block are added in parallel. */
+  const int blocksX = (imageWidth + 2 * data.blockSize - 1) / (2 * data.blockSize);
+  const int blocksY = (imageHeight + 2 * data.blockSize - 1) / (2 * data.blockSize);
+  fREAL *data2 = NULL;
+  settings.userdata_chunk = &data2;
+  settings.userdata_chunk_size = sizeof(data2);
+  settings.func_free = bokeh_blur_fht_block_free;
+  data.blocksX = blocksX;
+  for (data.passY = 0; data.passY < 2; data.passY++) {
+    for (data.passX = 0; data.passX < 2; data.passX++) {
+      BLI_task_parallel_range(0,
+                              blocksX * blocksY * COM_NUM_CHANNELS_COLOR,
+                              &data,
+                              bokeh_blur_fht_block_cb,
+                              &settings);
+    }
+  }
+  MEM_freeN(data.data1);
+
+  /* Divide by the sum of the bokeh at the offsets inside the image like executePixel does,
+   * taken from a summed area table of the kernel. */
+  const int tableSize = kernelSize + 1;
+  double *table = (double *)MEM_callocN(
+      sizeof(double) * tableSize * tableSize * COM_NUM_CHANNELS_COLOR, "bokeh blur FHT table");
+  for (int y = 0; y < kernelSize; y++) {
+    for (int x = 0; x < kernelSize; x++) {
+      const float *bokeh = &this->m_bokehKernel[(y * kernelSize + x) * COM_NUM_CHANNELS_COLOR];
+      double *sum = &table[((y + 1) * tableSize + x + 1) * COM_NUM_CHANNELS_COLOR];
+      for (int ch = 0; ch < COM_NUM_CHANNELS_COLOR; ch++) {
+        sum[ch] = bokeh[ch] + sum[ch - COM_NUM_CHANNELS_COLOR] +
+                  sum[ch - tableSize * COM_NUM_CHANNELS_COLOR] -
+                  sum[ch - (tableSize + 1) * COM_NUM_CHANNELS_COLOR];
+      }
+    }
+  }
+  float *color = resultBuffer;
+  for (int y = 0; y < imageHeight; y++) {
+    const int kernel_ymin = max(pixelSize - y, 0);
+    const int kernel_ymax = min(imageHeight - y + pixelSize, kernelSize);
+    for (int x = 0; x < imageWidth; x++) {
+      const int kernel_xmin = max(pixelSize - x, 0);
+      const int kernel_xmax = min(imageWidth - x + pixelSize, kernelSize);
+      const double *sum_min_min = &table[(kernel_ymin * tableSize + kernel_xmin) *
+                                         COM_NUM_CHANNELS_COLOR];
+      const double *sum_min_max = &table[(kernel_ymin * tableSize + kernel_xmax) *
+                                         COM_NUM_CHANNELS_COLOR];
+      const double *sum_max_min = &table[(kernel_ymax * tableSize + kernel_xmin) *
+                                         COM_NUM_CHANNELS_COLOR];
+      const double *sum_max_max = &table[(kernel_ymax * tableSize + kernel_xmax) *
+                                         COM_NUM_CHANNELS_COLOR];
+      for (int ch = 0; ch < COM_NUM_CHANNELS_COLOR; ch++) {
+        const float multiplier = sum_max_max[ch] - sum_max_min[ch] - sum_min_max[ch] +
+                                 sum_min_min[ch];
+        color[ch] *= 1.0f / multiplier;
+      }
+      color += COM_NUM_CHANNELS_COLOR;
+    }
+  }
+  MEM_freeN(table);
+
+  return result;
+}
+
 void BokehBlurOperation::initExecution()
 {
   initMutex();
+  BLI_mutex_init(&this->m_convolvedMutex);
   this->m_inputProgram = getInputSocketReader(0);
   this->m_inputBokehProgram = getInputSocketReader(1);
   this->m_inputBoundingBoxReader = getInputSocketReader(2);
@@ -72,20 +320,21 @@ void BokehBlurOperation::initExecution()
 
 void BokehBlurOperation::executePixel(float output[4], int x, int y, void *data)
 {
-  float color_accum[4];
+  float ATTR_ALIGN(16) color_accum[4];
   float tempBoundingBox[4];
-  float bokeh[4];
 
   this->m_inputBoundingBoxReader->readSampled(tempBoundingBox, x, y, COM_PS_NEAREST);
-  if (tempBoundingBox[0] > 0.0f) {
-    float multiplier_accum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+  if (tempBoundingBox[0] > 0.0f && this->m_convolved) {
+    this->m_convolved->read(output, x, y);
+  }
+  else if (tempBoundingBox[0] > 0.0f) {
+    float ATTR_ALIGN(16) multiplier_accum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
     MemoryBuffer *inputBuffer = (MemoryBuffer *)data;
     float *buffer = inputBuffer->getBuffer();
     int bufferwidth = inputBuffer->getWidth();
     int bufferstartx = inputBuffer->getRect()->xmin;
     int bufferstarty = inputBuffer->getRect()->ymin;
-    const float max_dim = max(this->getWidth(), this->getHeight());
-    int pixelSize = this->m_size * max_dim / 100.0f;
+    int pixelSize = getPixelSize();
     zero_v4(color_accum);
 
     if (pixelSize < 2) {
@@ -106,20 +355,43 @@ void BokehBlurOperation::executePixel(float output[4], int x, int y, void *data)
 
     int step = getStep();
     int offsetadd = getOffsetAdd() * COM_NUM_CHANNELS_COLOR;
+    const int kernelSize = 2 * pixelSize;
 
-    float m = this->m_bokehDimension / pixelSize;
+#ifdef __SSE2__
+    __m128 color_accum_r = _mm_load_ps(color_accum);
+    __m128 multiplier_accum_r = _mm_load_ps(multiplier_accum);
     for (int ny = miny; ny < maxy; ny += step) {
       int bufferindex = ((minx - bufferstartx) * COM_NUM_CHANNELS_COLOR) +
                         ((ny - bufferstarty) * COM_NUM_CHANNELS_COLOR * bufferwidth);
+      const float *bokeh = &this->m_bokehKernel[((ny - y + pixelSize) * kernelSize +
+                                                  (minx - x + pixelSize)) *
+                                                 COM_NUM_CHANNELS_COLOR];
+      for (int nx = minx; nx < maxx; nx += step) {
+        __m128 reg_bokeh = _mm_load_ps(bokeh);
+        __m128 reg_a = _mm_mul_ps(_mm_load_ps(&buffer[bufferindex]), reg_bokeh);
+        color_accum_r = _mm_add_ps(color_accum_r, reg_a);
+        multiplier_accum_r = _mm_add_ps(multiplier_accum_r, reg_bokeh);
+        bufferindex += offsetadd;
+        bokeh += step * COM_NUM_CHANNELS_COLOR;
+      }
+    }
+    _mm_store_ps(color_accum, color_accum_r);
+    _mm_store_ps(multiplier_accum, multiplier_accum_r);
+#else
+    for (int ny = miny; ny < maxy; ny += step) {
+      int bufferindex = ((minx - bufferstartx) * COM_NUM_CHANNELS_COLOR) +
+                        ((ny - bufferstarty) * COM_NUM_CHANNELS_COLOR * bufferwidth);
+      const float *bokeh = &this->m_bokehKernel[((ny - y + pixelSize) * kernelSize +
+                                                  (minx - x + pixelSize)) *
+                                                 COM_NUM_CHANNELS_COLOR];
       for (int nx = minx; nx < maxx; nx += step) {
-        float u = this->m_bokehMidX - (nx - x) * m;
-        float v = this->m_bokehMidY - (ny - y) * m;
-        this->m_inputBokehProgram->readSampled(bokeh, u, v, COM_PS_NEAREST);
         madd_v4_v4v4(color_accum, bokeh, &buffer[bufferindex]);
         add_v4_v4(multiplier_accum, bokeh);
         bufferindex += offsetadd;
+        bokeh += step * COM_NUM_CHANNELS_COLOR;
       }
     }
+#endif
     output[0] = color_accum[0] * (1.0f / multiplier_accum[0]);
     output[1] = color_accum[1] * (1.0f / multiplier_accum[1]);
     output[2] = color_accum[2] * (1.0f / multiplier_accum[2]);
@@ -133,6 +405,15 @@ void BokehBlurOperation::executePixel(float output[4], int x, int y, void *data)
 void BokehBlurOperation::deinitExecution()
 {
   deinitMutex();
+  BLI_mutex_end(&this->m_convolvedMutex);
+  if (this->m_bokehKernel) {
+    MEM_freeN(this->m_bokehKernel);
+    this->m_bokehKernel = NULL;
+  }
+  if (this->m_convolved) {
+    delete this->m_convolved;
+    this->m_convolved = NULL;
+  }
   this->m_inputProgram = NULL;
   this->m_inputBokehProgram = NULL;
   this->m_inputBoundingBoxReader = NULL;
@@ -146,7 +427,13 @@ bool BokehBlurOperation::determineDependingAreaOfInterest(rcti *input,
   rcti bokehInput;
   const float max_dim = max(this->getWidth(), this->getHeight());
 
-  if (this->m_sizeavailable) {
+  if (useFHT()) {
+    newInput.xmax = this->getWidth();
+    newInput.xmin = 0;
+    newInput.ymax = this->getHeight();
+    newInput.ymin = 0;
+  }
+  else if (this->m_sizeavailable) {
     newInput.xmax = input->xmax + (this->m_size * max_dim / 100.0f);
     newInput.xmin = input->xmin - (this->m_size * max_dim / 100.0f);
     newInput.ymax = input->ymax + (this->m_size * max_dim / 100.0f);
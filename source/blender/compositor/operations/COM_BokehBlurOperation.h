@@ -21,22 +21,57 @@
 #include "COM_NodeOperation.h"
 #include "COM_QualityStepHelper.h"
 
+/* Radius in pixels from which the whole image is blurred at once, with a fast Hartley transform
+ * convolution of which the cost per pixel doesn't grow with the radius. The convolution takes
+ * every offset, lower qualities skip offsets so it's only used from a radius of this times the
+ * step, where it's still faster than the skipped offsets. Both are threaded, the offsets are
+ * about as fast from a radius of 12 and three times slower from 16, which leaves room for the
+ * convolution to use fewer threads on small images. */
+#define BOKEH_BLUR_FHT_RADIUS 16
+
 class BokehBlurOperation : public NodeOperation, public QualityStepHelper {
  private:
   SocketReader *m_inputProgram;
   SocketReader *m_inputBokehProgram;
   SocketReader *m_inputBoundingBoxReader;
   void updateSize();
+  void updateBokehKernel(int pixelSize);
+  MemoryBuffer *convolveFHT(MemoryBuffer *inputBuffer, int pixelSize);
   float m_size;
   bool m_sizeavailable;
+  bool m_sizeconstant;
   float m_bokehMidX;
   float m_bokehMidY;
   float m_bokehDimension;
   bool m_extend_bounds;
 
+  /**
+   * \brief the bokeh image sampled for every offset of the blur, 2 * pixelSize squared colors
+   */
+  float *m_bokehKernel;
+
+  /**
+   * \brief the whole image blurred at once
+   * \see BOKEH_BLUR_FHT_RADIUS
+   */
+  MemoryBuffer *m_convolved;
+  /**
+   * \brief held while convolving, so the operation mutex isn't held for the whole transform
+   */
+  ThreadMutex m_convolvedMutex;
+
+  int getPixelSize() const;
+
  public:
   BokehBlurOperation();
 
+  /**
+   * \brief is the whole image blurred at once with a fast Hartley transform convolution?
+   * Only when the size is constant, from a radius depending on the quality.
+   * \see BOKEH_BLUR_FHT_RADIUS
+   */
+  bool useFHT() const;
+
   void *initializeTileData(rcti *rect);
   /**
    * the inner loop of this program
@@ -61,6 +96,7 @@ class BokehBlurOperation : public NodeOperation, public QualityStepHelper {
   {
     this->m_size = size;
     this->m_sizeavailable = true;
+    this->m_sizeconstant = true;
   }
 
   void executeOpenCL(OpenCLDevice *device,
@@ -17,6 +17,7 @@
  */
 
 #include "COM_CompositorOperation.h"
+#include "COM_FullFrameEvaluator.h"
 #include "BKE_global.h"
 #include "BKE_image.h"
 #include "BLI_listbase.h"
@@ -193,6 +194,19 @@ void CompositorOperation::executeRegion(rcti *rect, unsigned int /*tileNumber*/)
   }
 #endif
 
+  if (this->useFullFrame()) {
+    FullFrameEvaluator::copyOutputArea(this,
+                                       rect,
+                                       dx,
+                                       dy,
+                                       this->getInputOperation(0),
+                                       this->m_useAlphaInput ? this->getInputOperation(1) : NULL,
+                                       this->getInputOperation(2),
+                                       buffer,
+                                       zbuffer);
+    return;
+  }
+
   for (y = y1; y < y2 && (!breaked); y++) {
     for (x = x1; x < x2 && (!breaked); x++) {
       int input_x = x + dx, input_y = y + dy;
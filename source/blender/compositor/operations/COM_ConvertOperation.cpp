@@ -41,6 +41,7 @@ ConvertValueToColorOperation::ConvertValueToColorOperation() : ConvertBaseOperat
 {
   this->addInputSocket(COM_DT_VALUE);
   this->addOutputSocket(COM_DT_COLOR);
+  this->setFullFrame(true);
 }
 
 void ConvertValueToColorOperation::executePixelSampled(float output[4],
@@ -54,12 +55,23 @@ void ConvertValueToColorOperation::executePixelSampled(float output[4],
   output[3] = 1.0f;
 }
 
+void ConvertValueToColorOperation::executeFullFrame(MemoryBuffer *output,
+                                                    rcti *area,
+                                                    MemoryBuffer **inputs)
+{
+  executeFullFrameConvert(output, area, inputs, [](float *out, const float *in) {
+    out[0] = out[1] = out[2] = in[0];
+    out[3] = 1.0f;
+  });
+}
+
 /* ******** Color to Value ******** */
 
 ConvertColorToValueOperation::ConvertColorToValueOperation() : ConvertBaseOperation()
 {
   this->addInputSocket(COM_DT_COLOR);
   this->addOutputSocket(COM_DT_VALUE);
+  this->setFullFrame(true);
 }
 
 void ConvertColorToValueOperation::executePixelSampled(float output[4],
@@ -72,12 +84,22 @@ void ConvertColorToValueOperation::executePixelSampled(float output[4],
   output[0] = (inputColor[0] + inputColor[1] + inputColor[2]) / 3.0f;
 }
 
+void ConvertColorToValueOperation::executeFullFrame(MemoryBuffer *output,
+                                                    rcti *area,
+                                                    MemoryBuffer **inputs)
+{
+  executeFullFrameConvert(output, area, inputs, [](float *out, const float *in) {
+    out[0] = (in[0] + in[1] + in[2]) / 3.0f;
+  });
+}
+
 /* ******** Color to BW ******** */
 
 ConvertColorToBWOperation::ConvertColorToBWOperation() : ConvertBaseOperation()
 {
   this->addInputSocket(COM_DT_COLOR);
   this->addOutputSocket(COM_DT_VALUE);
+  this->setFullFrame(true);
 }
 
 void ConvertColorToBWOperation::executePixelSampled(float output[4],
@@ -90,12 +112,22 @@ void ConvertColorToBWOperation::executePixelSampled(float output[4],
   output[0] = IMB_colormanagement_get_luminance(inputColor);
 }
 
+void ConvertColorToBWOperation::executeFullFrame(MemoryBuffer *output,
+                                                 rcti *area,
+                                                 MemoryBuffer **inputs)
+{
+  executeFullFrameConvert(output, area, inputs, [](float *out, const float *in) {
+    out[0] = IMB_colormanagement_get_luminance(in);
+  });
+}
+
 /* ******** Color to Vector ******** */
 
 ConvertColorToVectorOperation::ConvertColorToVectorOperation() : ConvertBaseOperation()
 {
   this->addInputSocket(COM_DT_COLOR);
   this->addOutputSocket(COM_DT_VECTOR);
+  this->setFullFrame(true);
 }
 
 void ConvertColorToVectorOperation::executePixelSampled(float output[4],
@@ -108,12 +140,22 @@ void ConvertColorToVectorOperation::executePixelSampled(float output[4],
   copy_v3_v3(output, color);
 }
 
+void ConvertColorToVectorOperation::executeFullFrame(MemoryBuffer *output,
+                                                     rcti *area,
+                                                     MemoryBuffer **inputs)
+{
+  executeFullFrameConvert(output, area, inputs, [](float *out, const float *in) {
+    copy_v3_v3(out, in);
+  });
+}
+
 /* ******** Value to Vector ******** */
 
 ConvertValueToVectorOperation::ConvertValueToVectorOperation() : ConvertBaseOperation()
 {
   this->addInputSocket(COM_DT_VALUE);
   this->addOutputSocket(COM_DT_VECTOR);
+  this->setFullFrame(true);
 }
 
 void ConvertValueToVectorOperation::executePixelSampled(float output[4],
@@ -126,12 +168,22 @@ void ConvertValueToVectorOperation::executePixelSampled(float output[4],
   output[0] = output[1] = output[2] = value;
 }
 
+void ConvertValueToVectorOperation::executeFullFrame(MemoryBuffer *output,
+                                                     rcti *area,
+                                                     MemoryBuffer **inputs)
+{
+  executeFullFrameConvert(output, area, inputs, [](float *out, const float *in) {
+    out[0] = out[1] = out[2] = in[0];
+  });
+}
+
 /* ******** Vector to Color ******** */
 
 ConvertVectorToColorOperation::ConvertVectorToColorOperation() : ConvertBaseOperation()
 {
   this->addInputSocket(COM_DT_VECTOR);
   this->addOutputSocket(COM_DT_COLOR);
+  this->setFullFrame(true);
 }
 
 void ConvertVectorToColorOperation::executePixelSampled(float output[4],
@@ -143,12 +195,23 @@ void ConvertVectorToColorOperation::executePixelSampled(float output[4],
   output[3] = 1.0f;
 }
 
+void ConvertVectorToColorOperation::executeFullFrame(MemoryBuffer *output,
+                                                     rcti *area,
+                                                     MemoryBuffer **inputs)
+{
+  executeFullFrameConvert(output, area, inputs, [](float *out, const float *in) {
+    copy_v3_v3(out, in);
+    out[3] = 1.0f;
+  });
+}
+
 /* ******** Vector to Value ******** */
 
 ConvertVectorToValueOperation::ConvertVectorToValueOperation() : ConvertBaseOperation()
 {
   this->addInputSocket(COM_DT_VECTOR);
   this->addOutputSocket(COM_DT_VALUE);
+  this->setFullFrame(true);
 }
 
 void ConvertVectorToValueOperation::executePixelSampled(float output[4],
@@ -161,6 +224,15 @@ void ConvertVectorToValueOperation::executePixelSampled(float output[4],
   output[0] = (input[0] + input[1] + input[2]) / 3.0f;
 }
 
+void ConvertVectorToValueOperation::executeFullFrame(MemoryBuffer *output,
+                                                     rcti *area,
+                                                     MemoryBuffer **inputs)
+{
+  executeFullFrameConvert(output, area, inputs, [](float *out, const float *in) {
+    out[0] = (in[0] + in[1] + in[2]) / 3.0f;
+  });
+}
+
 /* ******** RGB to YCC ******** */
 
 ConvertRGBToYCCOperation::ConvertRGBToYCCOperation() : ConvertBaseOperation()
@@ -346,6 +418,7 @@ ConvertPremulToStraightOperation::ConvertPremulToStraightOperation() : ConvertBa
 {
   this->addInputSocket(COM_DT_COLOR);
   this->addOutputSocket(COM_DT_COLOR);
+  this->setFullFrame(true);
 }
 
 void ConvertPremulToStraightOperation::executePixelSampled(float output[4],
@@ -370,12 +443,30 @@ void ConvertPremulToStraightOperation::executePixelSampled(float output[4],
   output[3] = alpha;
 }
 
+void ConvertPremulToStraightOperation::executeFullFrame(MemoryBuffer *output,
+                                                        rcti *area,
+                                                        MemoryBuffer **inputs)
+{
+  executeFullFrameConvert(output, area, inputs, [](float *out, const float *in) {
+    const float alpha = in[3];
+    if (fabsf(alpha) < 1e-5f) {
+      zero_v3(out);
+    }
+    else {
+      mul_v3_v3fl(out, in, 1.0f / alpha);
+    }
+    /* never touches the alpha */
+    out[3] = alpha;
+  });
+}
+
 /* ******** Straight to Premul ******** */
 
 ConvertStraightToPremulOperation::ConvertStraightToPremulOperation() : ConvertBaseOperation()
 {
   this->addInputSocket(COM_DT_COLOR);
   this->addOutputSocket(COM_DT_COLOR);
+  this->setFullFrame(true);
 }
 
 void ConvertStraightToPremulOperation::executePixelSampled(float output[4],
@@ -395,6 +486,18 @@ void ConvertStraightToPremulOperation::executePixelSampled(float output[4],
   output[3] = alpha;
 }
 
+void ConvertStraightToPremulOperation::executeFullFrame(MemoryBuffer *output,
+                                                        rcti *area,
+                                                        MemoryBuffer **inputs)
+{
+  executeFullFrameConvert(output, area, inputs, [](float *out, const float *in) {
+    const float alpha = in[3];
+    mul_v3_v3fl(out, in, alpha);
+    /* never touches the alpha */
+    out[3] = alpha;
+  });
+}
+
 /* ******** Separate Channels ******** */
 
 SeparateChannelOperation::SeparateChannelOperation() : NodeOperation()
@@ -24,6 +24,28 @@ class ConvertBaseOperation : public NodeOperation {
  protected:
   SocketReader *m_inputOperation;
 
+  /**
+   * Full-frame loop calling `convert(output, input)` for every pixel of the area.
+   */
+  template<typename ConvertFunc>
+  void executeFullFrameConvert(MemoryBuffer *output,
+                               rcti *area,
+                               MemoryBuffer **inputs,
+                               ConvertFunc convert)
+  {
+    const int output_channels = output->get_num_channels();
+    const int input_channels = inputs[0]->get_num_channels();
+    for (int y = area->ymin; y < area->ymax; y++) {
+      float *out = output->getElem(area->xmin, y);
+      const float *in = inputs[0]->getElem(area->xmin, y);
+      for (int x = area->xmin; x < area->xmax; x++) {
+        convert(out, in);
+        out += output_channels;
+        in += input_channels;
+      }
+    }
+  }
+
  public:
   ConvertBaseOperation();
 
@@ -36,6 +58,7 @@ class ConvertValueToColorOperation : public ConvertBaseOperation {
   ConvertValueToColorOperation();
 
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+  void executeFullFrame(MemoryBuffer *output, rcti *area, MemoryBuffer **inputs);
 };
 
 class ConvertColorToValueOperation : public ConvertBaseOperation {
@@ -43,6 +66,7 @@ class ConvertColorToValueOperation : public ConvertBaseOperation {
   ConvertColorToValueOperation();
 
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+  void executeFullFrame(MemoryBuffer *output, rcti *area, MemoryBuffer **inputs);
 };
 
 class ConvertColorToBWOperation : public ConvertBaseOperation {
@@ -50,6 +74,7 @@ class ConvertColorToBWOperation : public ConvertBaseOperation {
   ConvertColorToBWOperation();
 
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+  void executeFullFrame(MemoryBuffer *output, rcti *area, MemoryBuffer **inputs);
 };
 
 class ConvertColorToVectorOperation : public ConvertBaseOperation {
@@ -57,6 +82,7 @@ class ConvertColorToVectorOperation : public ConvertBaseOperation {
   ConvertColorToVectorOperation();
 
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+  void executeFullFrame(MemoryBuffer *output, rcti *area, MemoryBuffer **inputs);
 };
 
 class ConvertValueToVectorOperation : public ConvertBaseOperation {
@@ -64,6 +90,7 @@ class ConvertValueToVectorOperation : public ConvertBaseOperation {
   ConvertValueToVectorOperation();
 
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+  void executeFullFrame(MemoryBuffer *output, rcti *area, MemoryBuffer **inputs);
 };
 
 class ConvertVectorToColorOperation : public ConvertBaseOperation {
@@ -71,6 +98,7 @@ class ConvertVectorToColorOperation : public ConvertBaseOperation {
   ConvertVectorToColorOperation();
 
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+  void executeFullFrame(MemoryBuffer *output, rcti *area, MemoryBuffer **inputs);
 };
 
 class ConvertVectorToValueOperation : public ConvertBaseOperation {
@@ -78,6 +106,7 @@ class ConvertVectorToValueOperation : public ConvertBaseOperation {
   ConvertVectorToValueOperation();
 
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+  void executeFullFrame(MemoryBuffer *output, rcti *area, MemoryBuffer **inputs);
 };
 
 class ConvertRGBToYCCOperation : public ConvertBaseOperation {
@@ -141,6 +170,7 @@ class ConvertPremulToStraightOperation : public ConvertBaseOperation {
   ConvertPremulToStraightOperation();
 
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+  void executeFullFrame(MemoryBuffer *output, rcti *area, MemoryBuffer **inputs);
 };
 
 class ConvertStraightToPremulOperation : public ConvertBaseOperation {
@@ -148,6 +178,7 @@ class ConvertStraightToPremulOperation : public ConvertBaseOperation {
   ConvertStraightToPremulOperation();
 
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+  void executeFullFrame(MemoryBuffer *output, rcti *area, MemoryBuffer **inputs);
 };
 
 class SeparateChannelOperation : public NodeOperation {
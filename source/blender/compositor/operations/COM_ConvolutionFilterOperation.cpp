@@ -30,6 +30,7 @@ ConvolutionFilterOperation::ConvolutionFilterOperation() : NodeOperation()
   this->setResolutionInputSocketIndex(0);
   this->m_inputOperation = NULL;
   this->setComplex(true);
+  this->setHalfFloat(true);
 }
 void ConvolutionFilterOperation::initExecution()
 {
@@ -32,6 +32,7 @@ DenoiseOperation::DenoiseOperation() : SingleThreadedOperation()
   this->addInputSocket(COM_DT_VECTOR);
   this->addInputSocket(COM_DT_COLOR);
   this->addOutputSocket(COM_DT_COLOR);
+  this->setHalfFloat(true);
   this->m_settings = NULL;
 }
 void DenoiseOperation::initExecution()
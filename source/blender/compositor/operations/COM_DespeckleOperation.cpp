@@ -30,6 +30,7 @@ DespeckleOperation::DespeckleOperation() : NodeOperation()
   this->setResolutionInputSocketIndex(0);
   this->m_inputOperation = NULL;
   this->setComplex(true);
+  this->setHalfFloat(true);
 }
 void DespeckleOperation::initExecution()
 {
@@ -30,6 +30,7 @@ DirectionalBlurOperation::DirectionalBlurOperation() : NodeOperation()
   this->setComplex(true);
 
   this->setOpenCL(true);
+  this->setHalfFloat(true);
   this->m_inputProgram = NULL;
 }
 
@@ -0,0 +1,45 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Copyright 2011, Blender Foundation.
+ */
+
+#pragma once
+
+/*
+ *  2D Fast Hartley Transform, used for convolution
+ */
+
+typedef float fREAL;
+
+/**
+ * \brief next highest power of 2 of x, as well it's log2 in L2
+ */
+unsigned int fht_next_pow2(unsigned int x, unsigned int *L2);
+
+/**
+ * \brief 2D Fast Hartley Transform of data in place
+ * \param Mx, My: log2 of width/height of data
+ * \param nzp: the row where zero pad data starts, skipped by the forward transform
+ * \param inverse: do the inverse transform, the data is expected to be transposed
+ * \note the result is transposed, the rows and columns are swapped
+ */
+void FHT2D(fREAL *data, unsigned int Mx, unsigned int My, unsigned int nzp, unsigned int inverse);
+
+/**
+ * \brief 2D convolution calc of transformed data, d1 *= d2
+ * \param M, N: log2 of width/height
+ */
+void fht_convolve(fREAL *d1, const fREAL *d2, unsigned int M, unsigned int N);
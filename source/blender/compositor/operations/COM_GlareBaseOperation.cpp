@@ -23,6 +23,7 @@ GlareBaseOperation::GlareBaseOperation() : SingleThreadedOperation()
 {
   this->addInputSocket(COM_DT_COLOR);
   this->addOutputSocket(COM_DT_COLOR);
+  this->setHalfFloat(true);
   this->m_settings = NULL;
 }
 void GlareBaseOperation::initExecution()
@@ -32,6 +32,7 @@ InpaintSimpleOperation::InpaintSimpleOperation() : NodeOperation()
   this->addInputSocket(COM_DT_COLOR);
   this->addOutputSocket(COM_DT_COLOR);
   this->setComplex(true);
+  this->setHalfFloat(true);
   this->m_inputImageProgram = NULL;
   this->m_pixelorder = NULL;
   this->m_manhattan_distance = NULL;
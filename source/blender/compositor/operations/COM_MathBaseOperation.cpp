@@ -84,6 +84,11 @@ void MathAddOperation::executePixelSampled(float output[4], float x, float y, Pi
   clampIfNeeded(output);
 }
 
+void MathAddOperation::executeFullFrame(MemoryBuffer *output, rcti *area, MemoryBuffer **inputs)
+{
+  executeFullFrameMath(output, area, inputs, [](float a, float b, float /*c*/) { return a + b; });
+}
+
 void MathSubtractOperation::executePixelSampled(float output[4],
                                                 float x,
                                                 float y,
@@ -100,6 +105,13 @@ void MathSubtractOperation::executePixelSampled(float output[4],
   clampIfNeeded(output);
 }
 
+void MathSubtractOperation::executeFullFrame(MemoryBuffer *output,
+                                             rcti *area,
+                                             MemoryBuffer **inputs)
+{
+  executeFullFrameMath(output, area, inputs, [](float a, float b, float /*c*/) { return a - b; });
+}
+
 void MathMultiplyOperation::executePixelSampled(float output[4],
                                                 float x,
                                                 float y,
@@ -116,6 +128,13 @@ void MathMultiplyOperation::executePixelSampled(float output[4],
   clampIfNeeded(output);
 }
 
+void MathMultiplyOperation::executeFullFrame(MemoryBuffer *output,
+                                             rcti *area,
+                                             MemoryBuffer **inputs)
+{
+  executeFullFrameMath(output, area, inputs, [](float a, float b, float /*c*/) { return a * b; });
+}
+
 void MathDivideOperation::executePixelSampled(float output[4],
                                               float x,
                                               float y,
@@ -137,6 +156,12 @@ void MathDivideOperation::executePixelSampled(float output[4],
   clampIfNeeded(output);
 }
 
+void MathDivideOperation::executeFullFrame(MemoryBuffer *output, rcti *area, MemoryBuffer **inputs)
+{
+  executeFullFrameMath(
+      output, area, inputs, [](float a, float b, float /*c*/) { return (b == 0) ? 0.0f : a / b; });
+}
+
 void MathSineOperation::executePixelSampled(float output[4],
                                             float x,
                                             float y,
@@ -291,6 +316,19 @@ void MathArcTangentOperation::executePixelSampled(float output[4],
   clampIfNeeded(output);
 }
 
+static float math_power(float value1, float value2)
+{
+  if (value1 >= 0) {
+    return pow(value1, value2);
+  }
+  float y_mod_1 = fmod(value2, 1);
+  /* if input value is not nearly an integer, fall back to zero, nicer than straight rounding */
+  if (y_mod_1 > 0.999f || y_mod_1 < 0.001f) {
+    return pow(value1, floorf(value2 + 0.5f));
+  }
+  return 0.0f;
+}
+
 void MathPowerOperation::executePixelSampled(float output[4],
                                              float x,
                                              float y,
@@ -302,23 +340,17 @@ void MathPowerOperation::executePixelSampled(float output[4],
   this->m_inputValue1Operation->readSampled(inputValue1, x, y, sampler);
   this->m_inputValue2Operation->readSampled(inputValue2, x, y, sampler);
 
-  if (inputValue1[0] >= 0) {
-    output[0] = pow(inputValue1[0], inputValue2[0]);
-  }
-  else {
-    float y_mod_1 = fmod(inputValue2[0], 1);
-    /* if input value is not nearly an integer, fall back to zero, nicer than straight rounding */
-    if (y_mod_1 > 0.999f || y_mod_1 < 0.001f) {
-      output[0] = pow(inputValue1[0], floorf(inputValue2[0] + 0.5f));
-    }
-    else {
-      output[0] = 0.0;
-    }
-  }
+  output[0] = math_power(inputValue1[0], inputValue2[0]);
 
   clampIfNeeded(output);
 }
 
+void MathPowerOperation::executeFullFrame(MemoryBuffer *output, rcti *area, MemoryBuffer **inputs)
+{
+  executeFullFrameMath(
+      output, area, inputs, [](float a, float b, float /*c*/) { return math_power(a, b); });
+}
+
 void MathLogarithmOperation::executePixelSampled(float output[4],
                                                  float x,
                                                  float y,
@@ -356,6 +388,14 @@ void MathMinimumOperation::executePixelSampled(float output[4],
   clampIfNeeded(output);
 }
 
+void MathMinimumOperation::executeFullFrame(MemoryBuffer *output,
+                                            rcti *area,
+                                            MemoryBuffer **inputs)
+{
+  executeFullFrameMath(
+      output, area, inputs, [](float a, float b, float /*c*/) { return min(a, b); });
+}
+
 void MathMaximumOperation::executePixelSampled(float output[4],
                                                float x,
                                                float y,
@@ -372,6 +412,14 @@ void MathMaximumOperation::executePixelSampled(float output[4],
   clampIfNeeded(output);
 }
 
+void MathMaximumOperation::executeFullFrame(MemoryBuffer *output,
+                                            rcti *area,
+                                            MemoryBuffer **inputs)
+{
+  executeFullFrameMath(
+      output, area, inputs, [](float a, float b, float /*c*/) { return max(a, b); });
+}
+
 void MathRoundOperation::executePixelSampled(float output[4],
                                              float x,
                                              float y,
@@ -404,6 +452,14 @@ void MathLessThanOperation::executePixelSampled(float output[4],
   clampIfNeeded(output);
 }
 
+void MathLessThanOperation::executeFullFrame(MemoryBuffer *output,
+                                             rcti *area,
+                                             MemoryBuffer **inputs)
+{
+  executeFullFrameMath(
+      output, area, inputs, [](float a, float b, float /*c*/) { return a < b ? 1.0f : 0.0f; });
+}
+
 void MathGreaterThanOperation::executePixelSampled(float output[4],
                                                    float x,
                                                    float y,
@@ -420,6 +476,14 @@ void MathGreaterThanOperation::executePixelSampled(float output[4],
   clampIfNeeded(output);
 }
 
+void MathGreaterThanOperation::executeFullFrame(MemoryBuffer *output,
+                                                rcti *area,
+                                                MemoryBuffer **inputs)
+{
+  executeFullFrameMath(
+      output, area, inputs, [](float a, float b, float /*c*/) { return a > b ? 1.0f : 0.0f; });
+}
+
 void MathModuloOperation::executePixelSampled(float output[4],
                                               float x,
                                               float y,
@@ -455,6 +519,14 @@ void MathAbsoluteOperation::executePixelSampled(float output[4],
   clampIfNeeded(output);
 }
 
+void MathAbsoluteOperation::executeFullFrame(MemoryBuffer *output,
+                                             rcti *area,
+                                             MemoryBuffer **inputs)
+{
+  executeFullFrameMath(
+      output, area, inputs, [](float a, float /*b*/, float /*c*/) { return (float)fabs(a); });
+}
+
 void MathRadiansOperation::executePixelSampled(float output[4],
                                                float x,
                                                float y,
@@ -715,6 +787,13 @@ void MathMultiplyAddOperation::executePixelSampled(float output[4],
   clampIfNeeded(output);
 }
 
+void MathMultiplyAddOperation::executeFullFrame(MemoryBuffer *output,
+                                                rcti *area,
+                                                MemoryBuffer **inputs)
+{
+  executeFullFrameMath(output, area, inputs, [](float a, float b, float c) { return a * b + c; });
+}
+
 void MathSmoothMinOperation::executePixelSampled(float output[4],
                                                  float x,
                                                  float y,
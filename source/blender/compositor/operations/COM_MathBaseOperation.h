@@ -43,6 +43,28 @@ class MathBaseOperation : public NodeOperation {
 
   void clampIfNeeded(float color[4]);
 
+  /**
+   * Full-frame loop setting every pixel of the area to `func(value1, value2, value3)`.
+   */
+  template<typename Func>
+  void executeFullFrameMath(MemoryBuffer *output, rcti *area, MemoryBuffer **inputs, Func func)
+  {
+    for (int y = area->ymin; y < area->ymax; y++) {
+      float *out = output->getElem(area->xmin, y);
+      const float *value1 = inputs[0]->getElem(area->xmin, y);
+      const float *value2 = inputs[1]->getElem(area->xmin, y);
+      const float *value3 = inputs[2]->getElem(area->xmin, y);
+      for (int x = area->xmin; x < area->xmax; x++) {
+        *out = func(*value1, *value2, *value3);
+        clampIfNeeded(out);
+        out++;
+        value1++;
+        value2++;
+        value3++;
+      }
+    }
+  }
+
  public:
   /**
    * the inner loop of this program
@@ -74,29 +96,37 @@ class MathAddOperation : public MathBaseOperation {
  public:
   MathAddOperation() : MathBaseOperation()
   {
+    this->setFullFrame(true);
   }
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+  void executeFullFrame(MemoryBuffer *output, rcti *area, MemoryBuffer **inputs);
 };
 class MathSubtractOperation : public MathBaseOperation {
  public:
   MathSubtractOperation() : MathBaseOperation()
   {
+    this->setFullFrame(true);
   }
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+  void executeFullFrame(MemoryBuffer *output, rcti *area, MemoryBuffer **inputs);
 };
 class MathMultiplyOperation : public MathBaseOperation {
  public:
   MathMultiplyOperation() : MathBaseOperation()
   {
+    this->setFullFrame(true);
   }
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+  void executeFullFrame(MemoryBuffer *output, rcti *area, MemoryBuffer **inputs);
 };
 class MathDivideOperation : public MathBaseOperation {
  public:
   MathDivideOperation() : MathBaseOperation()
   {
+    this->setFullFrame(true);
   }
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+  void executeFullFrame(MemoryBuffer *output, rcti *area, MemoryBuffer **inputs);
 };
 class MathSineOperation : public MathBaseOperation {
  public:
@@ -167,8 +197,10 @@ class MathPowerOperation : public MathBaseOperation {
  public:
   MathPowerOperation() : MathBaseOperation()
   {
+    this->setFullFrame(true);
   }
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+  void executeFullFrame(MemoryBuffer *output, rcti *area, MemoryBuffer **inputs);
 };
 class MathLogarithmOperation : public MathBaseOperation {
  public:
@@ -181,15 +213,19 @@ class MathMinimumOperation : public MathBaseOperation {
  public:
   MathMinimumOperation() : MathBaseOperation()
   {
+    this->setFullFrame(true);
   }
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+  void executeFullFrame(MemoryBuffer *output, rcti *area, MemoryBuffer **inputs);
 };
 class MathMaximumOperation : public MathBaseOperation {
  public:
   MathMaximumOperation() : MathBaseOperation()
   {
+    this->setFullFrame(true);
   }
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+  void executeFullFrame(MemoryBuffer *output, rcti *area, MemoryBuffer **inputs);
 };
 class MathRoundOperation : public MathBaseOperation {
  public:
@@ -202,15 +238,19 @@ class MathLessThanOperation : public MathBaseOperation {
  public:
   MathLessThanOperation() : MathBaseOperation()
   {
+    this->setFullFrame(true);
   }
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+  void executeFullFrame(MemoryBuffer *output, rcti *area, MemoryBuffer **inputs);
 };
 class MathGreaterThanOperation : public MathBaseOperation {
  public:
   MathGreaterThanOperation() : MathBaseOperation()
   {
+    this->setFullFrame(true);
   }
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+  void executeFullFrame(MemoryBuffer *output, rcti *area, MemoryBuffer **inputs);
 };
 
 class MathModuloOperation : public MathBaseOperation {
@@ -225,8 +265,10 @@ class MathAbsoluteOperation : public MathBaseOperation {
  public:
   MathAbsoluteOperation() : MathBaseOperation()
   {
+    this->setFullFrame(true);
   }
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+  void executeFullFrame(MemoryBuffer *output, rcti *area, MemoryBuffer **inputs);
 };
 
 class MathRadiansOperation : public MathBaseOperation {
@@ -353,8 +395,10 @@ class MathMultiplyAddOperation : public MathBaseOperation {
  public:
   MathMultiplyAddOperation() : MathBaseOperation()
   {
+    this->setFullFrame(true);
   }
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+  void executeFullFrame(MemoryBuffer *output, rcti *area, MemoryBuffer **inputs);
 };
 
 class MathSmoothMinOperation : public MathBaseOperation {
@@ -99,7 +99,15 @@ void MixBaseOperation::deinitExecution()
 
 MixAddOperation::MixAddOperation() : MixBaseOperation()
 {
-  /* pass */
+  this->setFullFrame(true);
+}
+
+static void mix_add(float output[4], const float color1[4], const float color2[4], float value)
+{
+  output[0] = color1[0] + value * color2[0];
+  output[1] = color1[1] + value * color2[1];
+  output[2] = color1[2] + value * color2[2];
+  output[3] = color1[3];
 }
 
 void MixAddOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
@@ -116,19 +124,30 @@ void MixAddOperation::executePixelSampled(float output[4], float x, float y, Pix
   if (this->useValueAlphaMultiply()) {
     value *= inputColor2[3];
   }
-  output[0] = inputColor1[0] + value * inputColor2[0];
-  output[1] = inputColor1[1] + value * inputColor2[1];
-  output[2] = inputColor1[2] + value * inputColor2[2];
-  output[3] = inputColor1[3];
+  mix_add(output, inputColor1, inputColor2, value);
 
   clampIfNeeded(output);
 }
 
+void MixAddOperation::executeFullFrame(MemoryBuffer *output, rcti *area, MemoryBuffer **inputs)
+{
+  executeFullFrameMix(output, area, inputs, mix_add);
+}
+
 /* ******** Mix Blend Operation ******** */
 
 MixBlendOperation::MixBlendOperation() : MixBaseOperation()
 {
-  /* pass */
+  this->setFullFrame(true);
+}
+
+static void mix_blend(float output[4], const float color1[4], const float color2[4], float value)
+{
+  float valuem = 1.0f - value;
+  output[0] = valuem * (color1[0]) + value * (color2[0]);
+  output[1] = valuem * (color1[1]) + value * (color2[1]);
+  output[2] = valuem * (color1[2]) + value * (color2[2]);
+  output[3] = color1[3];
 }
 
 void MixBlendOperation::executePixelSampled(float output[4],
@@ -139,25 +158,25 @@ void MixBlendOperation::executePixelSampled(float output[4],
   float inputColor1[4];
   float inputColor2[4];
   float inputValue[4];
-  float value;
 
   this->m_inputValueOperation->readSampled(inputValue, x, y, sampler);
   this->m_inputColor1Operation->readSampled(inputColor1, x, y, sampler);
   this->m_inputColor2Operation->readSampled(inputColor2, x, y, sampler);
-  value = inputValue[0];
 
+  float value = inputValue[0];
   if (this->useValueAlphaMultiply()) {
     value *= inputColor2[3];
   }
-  float valuem = 1.0f - value;
-  output[0] = valuem * (inputColor1[0]) + value * (inputColor2[0]);
-  output[1] = valuem * (inputColor1[1]) + value * (inputColor2[1]);
-  output[2] = valuem * (inputColor1[2]) + value * (inputColor2[2]);
-  output[3] = inputColor1[3];
+  mix_blend(output, inputColor1, inputColor2, value);
 
   clampIfNeeded(output);
 }
 
+void MixBlendOperation::executeFullFrame(MemoryBuffer *output, rcti *area, MemoryBuffer **inputs)
+{
+  executeFullFrameMix(output, area, inputs, mix_blend);
+}
+
 /* ******** Mix Burn Operation ******** */
 
 MixColorBurnOperation::MixColorBurnOperation() : MixBaseOperation()
@@ -290,7 +309,16 @@ void MixColorOperation::executePixelSampled(float output[4],
 
 MixDarkenOperation::MixDarkenOperation() : MixBaseOperation()
 {
-  /* pass */
+  this->setFullFrame(true);
+}
+
+static void mix_darken(float output[4], const float color1[4], const float color2[4], float value)
+{
+  float valuem = 1.0f - value;
+  output[0] = min_ff(color1[0], color2[0]) * value + color1[0] * valuem;
+  output[1] = min_ff(color1[1], color2[1]) * value + color1[1] * valuem;
+  output[2] = min_ff(color1[2], color2[2]) * value + color1[2] * valuem;
+  output[3] = color1[3];
 }
 
 void MixDarkenOperation::executePixelSampled(float output[4],
@@ -310,20 +338,33 @@ void MixDarkenOperation::executePixelSampled(float output[4],
   if (this->useValueAlphaMultiply()) {
     value *= inputColor2[3];
   }
-  float valuem = 1.0f - value;
-  output[0] = min_ff(inputColor1[0], inputColor2[0]) * value + inputColor1[0] * valuem;
-  output[1] = min_ff(inputColor1[1], inputColor2[1]) * value + inputColor1[1] * valuem;
-  output[2] = min_ff(inputColor1[2], inputColor2[2]) * value + inputColor1[2] * valuem;
-  output[3] = inputColor1[3];
+  mix_darken(output, inputColor1, inputColor2, value);
 
   clampIfNeeded(output);
 }
 
+void MixDarkenOperation::executeFullFrame(MemoryBuffer *output, rcti *area, MemoryBuffer **inputs)
+{
+  executeFullFrameMix(output, area, inputs, mix_darken);
+}
+
 /* ******** Mix Difference Operation ******** */
 
 MixDifferenceOperation::MixDifferenceOperation() : MixBaseOperation()
 {
-  /* pass */
+  this->setFullFrame(true);
+}
+
+static void mix_difference(float output[4],
+                           const float color1[4],
+                           const float color2[4],
+                           float value)
+{
+  float valuem = 1.0f - value;
+  output[0] = valuem * color1[0] + value * fabsf(color1[0] - color2[0]);
+  output[1] = valuem * color1[1] + value * fabsf(color1[1] - color2[1]);
+  output[2] = valuem * color1[2] + value * fabsf(color1[2] - color2[2]);
+  output[3] = color1[3];
 }
 
 void MixDifferenceOperation::executePixelSampled(float output[4],
@@ -343,15 +384,18 @@ void MixDifferenceOperation::executePixelSampled(float output[4],
   if (this->useValueAlphaMultiply()) {
     value *= inputColor2[3];
   }
-  float valuem = 1.0f - value;
-  output[0] = valuem * inputColor1[0] + value * fabsf(inputColor1[0] - inputColor2[0]);
-  output[1] = valuem * inputColor1[1] + value * fabsf(inputColor1[1] - inputColor2[1]);
-  output[2] = valuem * inputColor1[2] + value * fabsf(inputColor1[2] - inputColor2[2]);
-  output[3] = inputColor1[3];
+  mix_difference(output, inputColor1, inputColor2, value);
 
   clampIfNeeded(output);
 }
 
+void MixDifferenceOperation::executeFullFrame(MemoryBuffer *output,
+                                              rcti *area,
+                                              MemoryBuffer **inputs)
+{
+  executeFullFrameMix(output, area, inputs, mix_difference);
+}
+
 /* ******** Mix Difference Operation ******** */
 
 MixDivideOperation::MixDivideOperation() : MixBaseOperation()
@@ -676,7 +720,19 @@ void MixLinearLightOperation::executePixelSampled(float output[4],
 
 MixMultiplyOperation::MixMultiplyOperation() : MixBaseOperation()
 {
-  /* pass */
+  this->setFullFrame(true);
+}
+
+static void mix_multiply(float output[4],
+                         const float color1[4],
+                         const float color2[4],
+                         float value)
+{
+  float valuem = 1.0f - value;
+  output[0] = color1[0] * (valuem + value * color2[0]);
+  output[1] = color1[1] * (valuem + value * color2[1]);
+  output[2] = color1[2] * (valuem + value * color2[2]);
+  output[3] = color1[3];
 }
 
 void MixMultiplyOperation::executePixelSampled(float output[4],
@@ -696,15 +752,18 @@ void MixMultiplyOperation::executePixelSampled(float output[4],
   if (this->useValueAlphaMultiply()) {
     value *= inputColor2[3];
   }
-  float valuem = 1.0f - value;
-  output[0] = inputColor1[0] * (valuem + value * inputColor2[0]);
-  output[1] = inputColor1[1] * (valuem + value * inputColor2[1]);
-  output[2] = inputColor1[2] * (valuem + value * inputColor2[2]);
-  output[3] = inputColor1[3];
+  mix_multiply(output, inputColor1, inputColor2, value);
 
   clampIfNeeded(output);
 }
 
+void MixMultiplyOperation::executeFullFrame(MemoryBuffer *output,
+                                            rcti *area,
+                                            MemoryBuffer **inputs)
+{
+  executeFullFrameMix(output, area, inputs, mix_multiply);
+}
+
 /* ******** Mix Ovelray Operation ******** */
 
 MixOverlayOperation::MixOverlayOperation() : MixBaseOperation()
@@ -801,7 +860,16 @@ void MixSaturationOperation::executePixelSampled(float output[4],
 
 MixScreenOperation::MixScreenOperation() : MixBaseOperation()
 {
-  /* pass */
+  this->setFullFrame(true);
+}
+
+static void mix_screen(float output[4], const float color1[4], const float color2[4], float value)
+{
+  float valuem = 1.0f - value;
+  output[0] = 1.0f - (valuem + value * (1.0f - color2[0])) * (1.0f - color1[0]);
+  output[1] = 1.0f - (valuem + value * (1.0f - color2[1])) * (1.0f - color1[1]);
+  output[2] = 1.0f - (valuem + value * (1.0f - color2[2])) * (1.0f - color1[2]);
+  output[3] = color1[3];
 }
 
 void MixScreenOperation::executePixelSampled(float output[4],
@@ -821,16 +889,16 @@ void MixScreenOperation::executePixelSampled(float output[4],
   if (this->useValueAlphaMultiply()) {
     value *= inputColor2[3];
   }
-  float valuem = 1.0f - value;
-
-  output[0] = 1.0f - (valuem + value * (1.0f - inputColor2[0])) * (1.0f - inputColor1[0]);
-  output[1] = 1.0f - (valuem + value * (1.0f - inputColor2[1])) * (1.0f - inputColor1[1]);
-  output[2] = 1.0f - (valuem + value * (1.0f - inputColor2[2])) * (1.0f - inputColor1[2]);
-  output[3] = inputColor1[3];
+  mix_screen(output, inputColor1, inputColor2, value);
 
   clampIfNeeded(output);
 }
 
+void MixScreenOperation::executeFullFrame(MemoryBuffer *output, rcti *area, MemoryBuffer **inputs)
+{
+  executeFullFrameMix(output, area, inputs, mix_screen);
+}
+
 /* ******** Mix Soft Light Operation ******** */
 
 MixSoftLightOperation::MixSoftLightOperation() : MixBaseOperation()
@@ -881,7 +949,18 @@ void MixSoftLightOperation::executePixelSampled(float output[4],
 
 MixSubtractOperation::MixSubtractOperation() : MixBaseOperation()
 {
-  /* pass */
+  this->setFullFrame(true);
+}
+
+static void mix_subtract(float output[4],
+                         const float color1[4],
+                         const float color2[4],
+                         float value)
+{
+  output[0] = color1[0] - value * (color2[0]);
+  output[1] = color1[1] - value * (color2[1]);
+  output[2] = color1[2] - value * (color2[2]);
+  output[3] = color1[3];
 }
 
 void MixSubtractOperation::executePixelSampled(float output[4],
@@ -901,14 +980,18 @@ void MixSubtractOperation::executePixelSampled(float output[4],
   if (this->useValueAlphaMultiply()) {
     value *= inputColor2[3];
   }
-  output[0] = inputColor1[0] - value * (inputColor2[0]);
-  output[1] = inputColor1[1] - value * (inputColor2[1]);
-  output[2] = inputColor1[2] - value * (inputColor2[2]);
-  output[3] = inputColor1[3];
+  mix_subtract(output, inputColor1, inputColor2, value);
 
   clampIfNeeded(output);
 }
 
+void MixSubtractOperation::executeFullFrame(MemoryBuffer *output,
+                                            rcti *area,
+                                            MemoryBuffer **inputs)
+{
+  executeFullFrameMix(output, area, inputs, mix_subtract);
+}
+
 /* ******** Mix Value Operation ******** */
 
 MixValueOperation::MixValueOperation() : MixBaseOperation()
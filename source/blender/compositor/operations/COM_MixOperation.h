@@ -43,6 +43,29 @@ class MixBaseOperation : public NodeOperation {
     }
   }
 
+  /**
+   * Full-frame loop calling `mix(output, color1, color2, value)` for every pixel of the area.
+   * The value is multiplied with the alpha of color2 when needed.
+   */
+  template<typename MixFunc>
+  void executeFullFrameMix(MemoryBuffer *output, rcti *area, MemoryBuffer **inputs, MixFunc mix)
+  {
+    for (int y = area->ymin; y < area->ymax; y++) {
+      float *out = output->getElem(area->xmin, y);
+      const float *value = inputs[0]->getElem(area->xmin, y);
+      const float *color1 = inputs[1]->getElem(area->xmin, y);
+      const float *color2 = inputs[2]->getElem(area->xmin, y);
+      for (int x = area->xmin; x < area->xmax; x++) {
+        mix(out, color1, color2, this->m_valueAlphaMultiply ? *value * color2[3] : *value);
+        clampIfNeeded(out);
+        out += COM_NUM_CHANNELS_COLOR;
+        value += COM_NUM_CHANNELS_VALUE;
+        color1 += COM_NUM_CHANNELS_COLOR;
+        color2 += COM_NUM_CHANNELS_COLOR;
+      }
+    }
+  }
+
  public:
   /**
    * Default constructor
@@ -84,12 +107,14 @@ class MixAddOperation : public MixBaseOperation {
  public:
   MixAddOperation();
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+  void executeFullFrame(MemoryBuffer *output, rcti *area, MemoryBuffer **inputs);
 };
 
 class MixBlendOperation : public MixBaseOperation {
  public:
   MixBlendOperation();
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+  void executeFullFrame(MemoryBuffer *output, rcti *area, MemoryBuffer **inputs);
 };
 
 class MixColorBurnOperation : public MixBaseOperation {
@@ -108,12 +133,14 @@ class MixDarkenOperation : public MixBaseOperation {
  public:
   MixDarkenOperation();
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+  void executeFullFrame(MemoryBuffer *output, rcti *area, MemoryBuffer **inputs);
 };
 
 class MixDifferenceOperation : public MixBaseOperation {
  public:
   MixDifferenceOperation();
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+  void executeFullFrame(MemoryBuffer *output, rcti *area, MemoryBuffer **inputs);
 };
 
 class MixDivideOperation : public MixBaseOperation {
@@ -156,6 +183,7 @@ class MixMultiplyOperation : public MixBaseOperation {
  public:
   MixMultiplyOperation();
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+  void executeFullFrame(MemoryBuffer *output, rcti *area, MemoryBuffer **inputs);
 };
 
 class MixOverlayOperation : public MixBaseOperation {
@@ -174,6 +202,7 @@ class MixScreenOperation : public MixBaseOperation {
  public:
   MixScreenOperation();
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+  void executeFullFrame(MemoryBuffer *output, rcti *area, MemoryBuffer **inputs);
 };
 
 class MixSoftLightOperation : public MixBaseOperation {
@@ -186,6 +215,7 @@ class MixSubtractOperation : public MixBaseOperation {
  public:
   MixSubtractOperation();
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+  void executeFullFrame(MemoryBuffer *output, rcti *area, MemoryBuffer **inputs);
 };
 
 class MixValueOperation : public MixBaseOperation {
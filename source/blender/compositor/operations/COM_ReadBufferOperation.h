@@ -71,4 +71,12 @@ class ReadBufferOperation : public NodeOperation {
   }
   void readResolutionFromWriteBuffer();
   void updateMemoryBuffer();
+  MemoryBuffer *getMemoryBuffer()
+  {
+    return this->m_buffer;
+  }
+  bool isSingleValue() const
+  {
+    return this->m_single_value;
+  }
 };
@@ -31,6 +31,7 @@ ScreenLensDistortionOperation::ScreenLensDistortionOperation() : NodeOperation()
   this->addInputSocket(COM_DT_VALUE);
   this->addOutputSocket(COM_DT_COLOR);
   this->setComplex(true);
+  this->setHalfFloat(true);
   this->m_inputProgram = NULL;
   this->m_distortion = 0.0f;
   this->m_dispersion = 0.0f;
@@ -21,6 +21,7 @@
 SetColorOperation::SetColorOperation() : NodeOperation()
 {
   this->addOutputSocket(COM_DT_COLOR);
+  this->setFullFrame(true);
 }
 
 void SetColorOperation::executePixelSampled(float output[4],
@@ -31,6 +32,19 @@ void SetColorOperation::executePixelSampled(float output[4],
   copy_v4_v4(output, this->m_color);
 }
 
+void SetColorOperation::executeFullFrame(MemoryBuffer *output,
+                                         rcti *area,
+                                         MemoryBuffer ** /*inputs*/)
+{
+  for (int y = area->ymin; y < area->ymax; y++) {
+    float *out = output->getElem(area->xmin, y);
+    for (int x = area->xmin; x < area->xmax; x++) {
+      copy_v4_v4(out, this->m_color);
+      out += COM_NUM_CHANNELS_COLOR;
+    }
+  }
+}
+
 void SetColorOperation::determineResolution(unsigned int resolution[2],
                                             unsigned int preferredResolution[2])
 {
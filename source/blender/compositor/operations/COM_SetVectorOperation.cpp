@@ -22,6 +22,7 @@
 SetVectorOperation::SetVectorOperation() : NodeOperation()
 {
   this->addOutputSocket(COM_DT_VECTOR);
+  this->setFullFrame(true);
 }
 
 void SetVectorOperation::executePixelSampled(float output[4],
@@ -34,6 +35,21 @@ void SetVectorOperation::executePixelSampled(float output[4],
   output[2] = this->m_z;
 }
 
+void SetVectorOperation::executeFullFrame(MemoryBuffer *output,
+                                          rcti *area,
+                                          MemoryBuffer ** /*inputs*/)
+{
+  for (int y = area->ymin; y < area->ymax; y++) {
+    float *out = output->getElem(area->xmin, y);
+    for (int x = area->xmin; x < area->xmax; x++) {
+      out[0] = this->m_x;
+      out[1] = this->m_y;
+      out[2] = this->m_z;
+      out += COM_NUM_CHANNELS_VECTOR;
+    }
+  }
+}
+
 void SetVectorOperation::determineResolution(unsigned int resolution[2],
                                              unsigned int preferredResolution[2])
 {
@@ -26,6 +26,7 @@ SunBeamsOperation::SunBeamsOperation() : NodeOperation()
   this->setResolutionInputSocketIndex(0);
 
   this->setComplex(true);
+  this->setHalfFloat(true);
 }
 
 void SunBeamsOperation::initExecution()
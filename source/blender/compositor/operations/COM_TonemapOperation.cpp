@@ -30,6 +30,7 @@ TonemapOperation::TonemapOperation() : NodeOperation()
   this->m_data = NULL;
   this->m_cachedInstance = NULL;
   this->setComplex(true);
+  this->setHalfFloat(true);
 }
 void TonemapOperation::initExecution()
 {
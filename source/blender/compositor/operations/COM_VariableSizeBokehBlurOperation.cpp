@@ -34,6 +34,7 @@ VariableSizeBokehBlurOperation::VariableSizeBokehBlurOperation() : NodeOperation
   this->addOutputSocket(COM_DT_COLOR);
   this->setComplex(true);
   this->setOpenCL(true);
+  this->setHalfFloat(true);
 
   this->m_inputProgram = NULL;
   this->m_inputBokehProgram = NULL;
@@ -96,18 +97,23 @@ void VariableSizeBokehBlurOperation::executePixel(float output[4], int x, int y,
   MemoryBuffer *inputSizeBuffer = tileData->size;
   float *inputSizeFloatBuffer = inputSizeBuffer->getBuffer();
   float *inputProgramFloatBuffer = inputProgramBuffer->getBuffer();
+  float *inputBokehFloatBuffer = inputBokehBuffer->getBuffer();
   float readColor[4];
-  float bokeh[4];
   float tempSize[4];
-  float multiplier_accum[4];
-  float color_accum[4];
+  float ATTR_ALIGN(16) multiplier_accum[4];
+  float ATTR_ALIGN(16) color_accum[4];
 
   const float max_dim = max(m_width, m_height);
   const float scalar = this->m_do_size_scale ? (max_dim / 100.0f) : 1.0f;
   int maxBlurScalar = tileData->maxBlurScalar;
 
-  BLI_assert(inputBokehBuffer->getWidth() == COM_BLUR_BOKEH_PIXELS);
-  BLI_assert(inputBokehBuffer->getHeight() == COM_BLUR_BOKEH_PIXELS);
+  /* The bokeh input isn't resized, only the bokeh image node is known to have the expected
+   * size. Read other inputs with clipping, the weights would be out of its bounds otherwise. */
+  const rcti *bokeh_rect = inputBokehBuffer->getRect();
+  const bool use_bokeh_direct = bokeh_rect->xmin == 0 && bokeh_rect->ymin == 0 &&
+                                inputBokehBuffer->getWidth() == COM_BLUR_BOKEH_PIXELS &&
+                                inputBokehBuffer->getHeight() == COM_BLUR_BOKEH_PIXELS;
+  float ATTR_ALIGN(16) bokeh_clipped[4];
 
 #ifdef COM_DEFOCUS_SEARCH
   float search[4];
@@ -138,6 +144,10 @@ void VariableSizeBokehBlurOperation::executePixel(float output[4], int x, int y,
     const int addXStepColor = addXStepValue * COM_NUM_CHANNELS_COLOR;
 
     if (size_center > this->m_threshold) {
+#ifdef __SSE2__
+      __m128 color_accum_r = _mm_load_ps(color_accum);
+      __m128 multiplier_accum_r = _mm_load_ps(multiplier_accum);
+#endif
       for (int ny = miny; ny < maxy; ny += addYStepValue) {
         float dy = ny - y;
         int offsetValueNy = ny * inputSizeBuffer->getWidth();
@@ -155,9 +165,27 @@ void VariableSizeBokehBlurOperation::executePixel(float output[4], int x, int y,
                     (float)(COM_BLUR_BOKEH_PIXELS / 2) +
                         (dy / size) * (float)((COM_BLUR_BOKEH_PIXELS / 2) - 1),
                 };
-                inputBokehBuffer->read(bokeh, uv[0], uv[1]);
+                const float *bokeh;
+                if (use_bokeh_direct) {
+                  /* The uv is inside a bokeh of the expected size, read it without clipping. */
+                  bokeh = &inputBokehFloatBuffer[((int)uv[1] * COM_BLUR_BOKEH_PIXELS +
+                                                  (int)uv[0]) *
+                                                 COM_NUM_CHANNELS_COLOR];
+                }
+                else {
+                  inputBokehBuffer->read(bokeh_clipped, uv[0], uv[1]);
+                  bokeh = bokeh_clipped;
+                }
+#ifdef __SSE2__
+                __m128 reg_bokeh = _mm_load_ps(bokeh);
+                __m128 reg_a = _mm_mul_ps(_mm_load_ps(&inputProgramFloatBuffer[offsetColorNxNy]),
+                                          reg_bokeh);
+                color_accum_r = _mm_add_ps(color_accum_r, reg_a);
+                multiplier_accum_r = _mm_add_ps(multiplier_accum_r, reg_bokeh);
+#else
                 madd_v4_v4v4(color_accum, bokeh, &inputProgramFloatBuffer[offsetColorNxNy]);
                 add_v4_v4(multiplier_accum, bokeh);
+#endif
               }
             }
           }
@@ -165,6 +193,10 @@ void VariableSizeBokehBlurOperation::executePixel(float output[4], int x, int y,
           offsetValueNxNy += addXStepValue;
         }
       }
+#ifdef __SSE2__
+      _mm_store_ps(color_accum, color_accum_r);
+      _mm_store_ps(multiplier_accum, multiplier_accum_r);
+#endif
     }
 
     output[0] = color_accum[0] / multiplier_accum[0];
@@ -55,6 +55,7 @@ VectorBlurOperation::VectorBlurOperation() : NodeOperation()
   this->m_inputSpeedProgram = NULL;
   this->m_inputZProgram = NULL;
   setComplex(true);
+  setHalfFloat(true);
 }
 void VectorBlurOperation::initExecution()
 {
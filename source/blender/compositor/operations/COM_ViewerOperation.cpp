@@ -17,6 +17,7 @@
  */
 
 #include "COM_ViewerOperation.h"
+#include "COM_FullFrameEvaluator.h"
 #include "BKE_image.h"
 #include "BKE_scene.h"
 #include "BLI_listbase.h"
@@ -96,6 +97,20 @@ void ViewerOperation::executeRegion(rcti *rect, unsigned int /*tileNumber*/)
   int y;
   bool breaked = false;
 
+  if (this->useFullFrame()) {
+    FullFrameEvaluator::copyOutputArea(this,
+                                       rect,
+                                       0,
+                                       0,
+                                       this->getInputOperation(0),
+                                       this->m_useAlphaInput ? this->getInputOperation(1) : NULL,
+                                       this->getInputOperation(2),
+                                       buffer,
+                                       depthbuffer);
+    updateImage(rect);
+    return;
+  }
+
   for (y = y1; y < y2 && (!breaked); y++) {
     for (x = x1; x < x2; x++) {
       this->m_imageInput->readSampled(&(buffer[offset4]), x, y, COM_PS_NEAREST);
@@ -17,6 +17,7 @@
  */
 
 #include "COM_WriteBufferOperation.h"
+#include "COM_FullFrameEvaluator.h"
 #include "COM_OpenCLDevice.h"
 #include "COM_defines.h"
 #include <stdio.h>
@@ -47,7 +48,10 @@ void WriteBufferOperation::executePixelSampled(float output[4],
 void WriteBufferOperation::initExecution()
 {
   this->m_input = this->getInputOperation(0);
-  this->m_memoryProxy->allocate(this->m_width, this->m_height);
+  /* The buffer can already be set by the MemoryBufferCache. */
+  if (this->m_memoryProxy->getBuffer() == NULL) {
+    this->m_memoryProxy->allocate(this->m_width, this->m_height);
+  }
 }
 
 void WriteBufferOperation::deinitExecution()
@@ -59,9 +63,18 @@ void WriteBufferOperation::deinitExecution()
 void WriteBufferOperation::executeRegion(rcti *rect, unsigned int /*tileNumber*/)
 {
   MemoryBuffer *memoryBuffer = this->m_memoryProxy->getBuffer();
-  float *buffer = memoryBuffer->getBuffer();
-  const int num_channels = memoryBuffer->get_num_channels();
-  if (this->m_input->isComplex()) {
+  /* Half float buffers are calculated in float, and converted when the chunk is done. */
+  MemoryBuffer *outputBuffer = memoryBuffer;
+  if (memoryBuffer->isHalfFloat()) {
+    outputBuffer = new MemoryBuffer(this->m_memoryProxy->getDataType(), rect);
+  }
+  const int num_channels = outputBuffer->get_num_channels();
+  if (this->useFullFrame()) {
+    /* Stops before the next operation or row when braked, like the loops below. */
+    FullFrameEvaluator evaluator(rect);
+    evaluator.execute(this->m_input, outputBuffer);
+  }
+  else if (this->m_input->isComplex()) {
     void *data = this->m_input->initializeTileData(rect);
     int x1 = rect->xmin;
     int y1 = rect->ymin;
@@ -71,10 +84,10 @@ void WriteBufferOperation::executeRegion(rcti *rect, unsigned int /*tileNumber*/
     int y;
     bool breaked = false;
     for (y = y1; y < y2 && (!breaked); y++) {
-      int offset4 = (y * memoryBuffer->getWidth() + x1) * num_channels;
+      float *elem = outputBuffer->getElem(x1, y);
       for (x = x1; x < x2; x++) {
-        this->m_input->read(&(buffer[offset4]), x, y, data);
-        offset4 += num_channels;
+        this->m_input->read(elem, x, y, data);
+        elem += num_channels;
       }
       if (isBraked()) {
         breaked = true;
@@ -95,16 +108,20 @@ void WriteBufferOperation::executeRegion(rcti *rect, unsigned int /*tileNumber*/
     int y;
     bool breaked = false;
     for (y = y1; y < y2 && (!breaked); y++) {
-      int offset4 = (y * memoryBuffer->getWidth() + x1) * num_channels;
+      float *elem = outputBuffer->getElem(x1, y);
       for (x = x1; x < x2; x++) {
-        this->m_input->readSampled(&(buffer[offset4]), x, y, COM_PS_NEAREST);
-        offset4 += num_channels;
+        this->m_input->readSampled(elem, x, y, COM_PS_NEAREST);
+        elem += num_channels;
       }
       if (isBraked()) {
         breaked = true;
       }
     }
   }
+  if (outputBuffer != memoryBuffer) {
+    memoryBuffer->copyContentFrom(outputBuffer);
+    delete outputBuffer;
+  }
   memoryBuffer->setCreatedState();
 }
 
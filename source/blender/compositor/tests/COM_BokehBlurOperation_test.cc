@@ -0,0 +1,230 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <cmath>
+
+#include "COM_BokehBlurOperation.h"
+#include "COM_MemoryBuffer.h"
+#include "COM_SetValueOperation.h"
+#include "COM_VariableSizeBokehBlurOperation.h"
+
+#define IMAGE_WIDTH 400
+#define IMAGE_HEIGHT 300
+#define BOKEH_SIZE 64
+
+/* Image input, reads from a buffer like a read buffer operation. */
+class TestImageOperation : public NodeOperation {
+ private:
+  MemoryBuffer *m_buffer;
+
+ public:
+  TestImageOperation(MemoryBuffer *buffer, DataType data_type = COM_DT_COLOR) : m_buffer(buffer)
+  {
+    this->addOutputSocket(data_type);
+    unsigned int resolution[2] = {(unsigned int)buffer->getWidth(),
+                                  (unsigned int)buffer->getHeight()};
+    this->setResolution(resolution);
+    this->setComplex(true);
+  }
+
+  void *initializeTileData(rcti * /*rect*/)
+  {
+    return this->m_buffer;
+  }
+
+  void executePixelSampled(float output[4], float x, float y, PixelSampler /*sampler*/)
+  {
+    this->m_buffer->read(output, x, y);
+  }
+};
+
+/* Disc shaped bokeh with slightly different colors at the edge. */
+class TestBokehOperation : public NodeOperation {
+ public:
+  TestBokehOperation()
+  {
+    this->addOutputSocket(COM_DT_COLOR);
+    unsigned int resolution[2] = {BOKEH_SIZE, BOKEH_SIZE};
+    this->setResolution(resolution);
+  }
+
+  void executePixelSampled(float output[4], float x, float y, PixelSampler /*sampler*/)
+  {
+    const float center = BOKEH_SIZE / 2.0f;
+    const float distance = sqrtf((x - center) * (x - center) + (y - center) * (y - center));
+    output[0] = distance < 30.0f ? 1.0f : 0.0f;
+    output[1] = distance < 28.0f ? 0.8f : 0.0f;
+    output[2] = distance < 31.0f ? 1.0f + 0.01f * x : 0.0f;
+    output[3] = distance < 30.0f ? 1.0f : 0.0f;
+  }
+};
+
+static void fill_test_image(MemoryBuffer *image)
+{
+  for (int y = 0; y < IMAGE_HEIGHT; y++) {
+    for (int x = 0; x < IMAGE_WIDTH; x++) {
+      float color[4] = {(float)((x / 7 + y / 5) % 3),
+                        (float)((x * 13 + y * 7) % 17) / 16.0f,
+                        0.5f + 0.4f * sinf(x * 0.1f),
+                        1.0f};
+      /* Bright spots, as in the highlights that bokeh blurs are used for. */
+      if ((x * 31 + y * 17) % 101 == 0) {
+        color[0] = 4.0f;
+      }
+      image->writePixel(x, y, color);
+    }
+  }
+}
+
+/* Blur the image with a constant size, or with the size read from an input, into result. */
+static bool bokeh_blur(MemoryBuffer *image,
+                       float size,
+                       bool constant_size,
+                       CompositorQuality quality,
+                       MemoryBuffer *result)
+{
+  TestImageOperation image_operation(image);
+  TestBokehOperation bokeh_operation;
+  SetValueOperation bounding_box_operation;
+  SetValueOperation size_operation;
+  bounding_box_operation.setValue(1.0f);
+  size_operation.setValue(size);
+
+  BokehBlurOperation operation;
+  operation.getInputSocket(0)->setLink(image_operation.getOutputSocket());
+  operation.getInputSocket(1)->setLink(bokeh_operation.getOutputSocket());
+  operation.getInputSocket(2)->setLink(bounding_box_operation.getOutputSocket());
+  operation.getInputSocket(3)->setLink(size_operation.getOutputSocket());
+  unsigned int resolution[2] = {IMAGE_WIDTH, IMAGE_HEIGHT};
+  operation.setResolution(resolution);
+  operation.setQuality(quality);
+  if (constant_size) {
+    operation.setSize(size);
+  }
+
+  operation.initExecution();
+  void *data = operation.initializeTileData(image->getRect());
+  const bool use_fht = operation.useFHT();
+  for (int y = 0; y < IMAGE_HEIGHT; y++) {
+    for (int x = 0; x < IMAGE_WIDTH; x++) {
+      float color[4];
+      operation.executePixel(color, x, y, data);
+      result->writePixel(x, y, color);
+    }
+  }
+  operation.deinitExecution();
+  return use_fht;
+}
+
+/* The fast Hartley transform convolution gives the same result as the taps of executePixel, up
+ * to the precision of the transform. */
+TEST(bokeh_blur, FHTMatchesDirect)
+{
+  rcti rect;
+  BLI_rcti_init(&rect, 0, IMAGE_WIDTH, 0, IMAGE_HEIGHT);
+  MemoryBuffer image(COM_DT_COLOR, &rect);
+  MemoryBuffer fht_result(COM_DT_COLOR, &rect);
+  MemoryBuffer direct_result(COM_DT_COLOR, &rect);
+  fill_test_image(&image);
+
+  /* Radii of 40 and 16 pixels, the second at the threshold of the convolution. */
+  const float sizes[] = {10.0f, 4.0f};
+  for (int i = 0; i < (int)ARRAY_SIZE(sizes); i++) {
+    EXPECT_TRUE(bokeh_blur(&image, sizes[i], true, COM_QUALITY_HIGH, &fht_result));
+    EXPECT_FALSE(bokeh_blur(&image, sizes[i], false, COM_QUALITY_HIGH, &direct_result));
+
+    const float *fht_color = fht_result.getBuffer();
+    const float *direct_color = direct_result.getBuffer();
+    for (int index = 0; index < IMAGE_WIDTH * IMAGE_HEIGHT * COM_NUM_CHANNELS_COLOR; index++) {
+      EXPECT_NEAR(fht_color[index], direct_color[index], 1e-3f);
+    }
+  }
+}
+
+/* Lower qualities skip offsets, the convolution isn't used until its radius is large enough. */
+TEST(bokeh_blur, FHTHonorsQuality)
+{
+  rcti rect;
+  BLI_rcti_init(&rect, 0, IMAGE_WIDTH, 0, IMAGE_HEIGHT);
+  MemoryBuffer image(COM_DT_COLOR, &rect);
+  MemoryBuffer constant_result(COM_DT_COLOR, &rect);
+  MemoryBuffer input_result(COM_DT_COLOR, &rect);
+  fill_test_image(&image);
+
+  /* A radius of 24 pixels, convolved at high quality. */
+  EXPECT_FALSE(bokeh_blur(&image, 6.0f, true, COM_QUALITY_MEDIUM, &constant_result));
+  EXPECT_FALSE(bokeh_blur(&image, 6.0f, false, COM_QUALITY_MEDIUM, &input_result));
+  EXPECT_EQ_ARRAY(constant_result.getBuffer(),
+                  input_result.getBuffer(),
+                  (size_t)IMAGE_WIDTH * IMAGE_HEIGHT * COM_NUM_CHANNELS_COLOR);
+}
+
+/* Blur the image with the size read from an input for every pixel, into result. */
+static void variable_size_bokeh_blur(MemoryBuffer *image,
+                                     MemoryBuffer *bokeh,
+                                     MemoryBuffer *size,
+                                     MemoryBuffer *result)
+{
+  TestImageOperation image_operation(image);
+  TestImageOperation bokeh_operation(bokeh);
+  TestImageOperation size_operation(size, COM_DT_VALUE);
+
+  VariableSizeBokehBlurOperation operation;
+  operation.getInputSocket(0)->setLink(image_operation.getOutputSocket());
+  operation.getInputSocket(1)->setLink(bokeh_operation.getOutputSocket());
+  operation.getInputSocket(2)->setLink(size_operation.getOutputSocket());
+  unsigned int resolution[2] = {IMAGE_WIDTH, IMAGE_HEIGHT};
+  operation.setResolution(resolution);
+  operation.setQuality(COM_QUALITY_HIGH);
+
+  operation.initExecution();
+  void *data = operation.initializeTileData(image->getRect());
+  for (int y = 0; y < IMAGE_HEIGHT; y++) {
+    for (int x = 0; x < IMAGE_WIDTH; x++) {
+      float color[4];
+      operation.executePixel(color, x, y, data);
+      result->writePixel(x, y, color);
+    }
+  }
+  operation.deinitializeTileData(image->getRect(), data);
+  operation.deinitExecution();
+}
+
+/* The bokeh input isn't resized, a smaller bokeh is read with clipping. That gives the same result
+ * as the bokeh at the corner of an otherwise empty bokeh of the size of the bokeh image node. */
+TEST(bokeh_blur, VariableSizeBokehInputSize)
+{
+  rcti rect, bokeh_rect, small_bokeh_rect;
+  BLI_rcti_init(&rect, 0, IMAGE_WIDTH, 0, IMAGE_HEIGHT);
+  BLI_rcti_init(&bokeh_rect, 0, COM_BLUR_BOKEH_PIXELS, 0, COM_BLUR_BOKEH_PIXELS);
+  BLI_rcti_init(&small_bokeh_rect, 0, BOKEH_SIZE, 0, BOKEH_SIZE);
+  MemoryBuffer image(COM_DT_COLOR, &rect);
+  MemoryBuffer size(COM_DT_VALUE, &rect);
+  MemoryBuffer bokeh(COM_DT_COLOR, &bokeh_rect);
+  MemoryBuffer small_bokeh(COM_DT_COLOR, &small_bokeh_rect);
+  MemoryBuffer result(COM_DT_COLOR, &rect);
+  MemoryBuffer small_result(COM_DT_COLOR, &rect);
+  fill_test_image(&image);
+
+  for (int y = 0; y < IMAGE_HEIGHT; y++) {
+    for (int x = 0; x < IMAGE_WIDTH; x++) {
+      const float value = 4.0f + (float)((x + y) % 5);
+      size.writePixel(x, y, &value);
+    }
+  }
+  bokeh.clear();
+  for (int y = 0; y < BOKEH_SIZE; y++) {
+    for (int x = 0; x < BOKEH_SIZE; x++) {
+      const float color[4] = {1.0f, 0.5f, 0.25f + 0.01f * x, 1.0f};
+      bokeh.writePixel(x, y, color);
+      small_bokeh.writePixel(x, y, color);
+    }
+  }
+
+  variable_size_bokeh_blur(&image, &bokeh, &size, &result);
+  variable_size_bokeh_blur(&image, &small_bokeh, &size, &small_result);
+  EXPECT_EQ_ARRAY(result.getBuffer(),
+                  small_result.getBuffer(),
+                  (size_t)IMAGE_WIDTH * IMAGE_HEIGHT * COM_NUM_CHANNELS_COLOR);
+}
@@ -63,6 +63,10 @@
 
 #include "WM_api.h"
 
+#ifdef WITH_COMPOSITOR
+#  include "COM_compositor.h"
+#endif
+
 #include "render_intern.h"  // own include
 
 /***************************** Render Engines ********************************/
@@ -216,6 +220,35 @@ void ED_render_view_layer_changed(Main *bmain, bScreen *screen)
  * editor level updates when the ID changes. when these ID blocks are in *
  * the dependency graph, we can get rid of the manual dependency checks  */
 
+static bool node_tree_uses_id(bNodeTree *ntree, ID *id)
+{
+  LISTBASE_FOREACH (bNode *, node, &ntree->nodes) {
+    if (node->id == id) {
+      return true;
+    }
+    if (node->type == NODE_GROUP && node->id && node_tree_uses_id((bNodeTree *)node->id, id)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void compositor_id_changed(Main *bmain, ID *id)
+{
+#ifdef WITH_COMPOSITOR
+  /* Node results kept by the compositor would still show the old data, also when no node
+   * editor is open. */
+  LISTBASE_FOREACH (Scene *, scene, &bmain->scenes) {
+    if (scene->use_nodes && scene->nodetree && node_tree_uses_id(scene->nodetree, id)) {
+      COM_clearCaches();
+      return;
+    }
+  }
+#else
+  UNUSED_VARS(bmain, id);
+#endif
+}
+
 static void material_changed(Main *UNUSED(bmain), Material *ma)
 {
   /* icons */
@@ -237,6 +270,8 @@ static void texture_changed(Main *bmain, Tex *tex)
   /* icons */
   BKE_icon_changed(BKE_icon_id_ensure(&tex->id));
 
+  compositor_id_changed(bmain, &tex->id);
+
   for (scene = bmain->scenes.first; scene; scene = scene->id.next) {
     /* paint overlays */
     for (view_layer = scene->view_layers.first; view_layer; view_layer = view_layer->next) {
@@ -266,6 +301,8 @@ static void image_changed(Main *bmain, Image *ima)
   /* icons */
   BKE_icon_changed(BKE_icon_id_ensure(&ima->id));
 
+  compositor_id_changed(bmain, &ima->id);
+
   /* textures */
   for (tex = bmain->textures.first; tex; tex = tex->id.next) {
     if (tex->type == TEX_IMAGE && tex->ima == ima) {
@@ -316,6 +353,10 @@ void ED_render_id_flush_update(const DEGEditorUpdateContext *update_ctx, ID *id)
     case ID_SCE:
       scene_changed(bmain, (Scene *)id);
       break;
+    case ID_MC:
+    case ID_MSK:
+      compositor_id_changed(bmain, id);
+      break;
     default:
       break;
   }
@@ -77,6 +77,16 @@ static bool memfile_undosys_poll(bContext *C)
   return true;
 }
 
+/**
+ * Update the size used for the undo memory limit,
+ * after the memfile was compressed, uncompressed or merged into.
+ */
+static void memfile_undosys_step_size_update(MemFileUndoStep *us)
+{
+  us->data->undo_size = us->data->memfile.size;
+  us->step.data_size = us->data->undo_size;
+}
+
 static bool memfile_undosys_step_encode(struct bContext *UNUSED(C),
                                         struct Main *bmain,
                                         UndoStep *us_p)
@@ -96,6 +106,17 @@ static bool memfile_undosys_step_encode(struct bContext *UNUSED(C),
   us->data = BKE_memfile_undo_encode(bmain, us_prev ? us_prev->data : NULL);
   us->step.data_size = us->data->undo_size;
 
+  /* The previous step is kept as-is since undoing is likely to load it,
+   * steps before it are compressed (their size is updated for the undo memory limit). */
+  if (us_prev != NULL) {
+    MemFileUndoStep *us_cold = (MemFileUndoStep *)BKE_undosys_step_same_type_prev(
+        &us_prev->step);
+    if (us_cold != NULL) {
+      BLO_memfile_compress(&us_cold->data->memfile);
+      memfile_undosys_step_size_update(us_cold);
+    }
+  }
+
   /* Store the fact that we should not re-use old data with that undo step, and reset the Main
    * flag. */
   us->step.use_old_bmain_data = !bmain->use_memfile_full_barrier;
@@ -188,6 +209,8 @@ static void memfile_undosys_step_decode(struct bContext *C,
 
   MemFileUndoStep *us = (MemFileUndoStep *)us_p;
   BKE_memfile_undo_decode(us->data, undo_direction, use_old_bmain_data, C);
+  /* Reading uncompressed the memfile. */
+  memfile_undosys_step_size_update(us);
 
   for (UndoStep *us_iter = us_p->next; us_iter; us_iter = us_iter->next) {
     if (BKE_UNDOSYS_TYPE_IS_MEMFILE_SKIP(us_iter->type)) {
@@ -262,6 +285,7 @@ static void memfile_undosys_step_free(UndoStep *us_p)
     if (us_next_p != NULL) {
       MemFileUndoStep *us_next = (MemFileUndoStep *)us_next_p;
       BLO_memfile_merge(&us->data->memfile, &us_next->data->memfile);
+      memfile_undosys_step_size_update(us_next);
     }
   }
 
@@ -3668,6 +3668,7 @@ static int uv_select_overlap(bContext *C, const bool extend)
   MEM_freeN(indices);
 
   BLI_bvhtree_balance(uv_tree);
+  BLI_bvhtree_compact_layout_build(uv_tree);
 
   uint tree_overlap_len;
   BVHTreeOverlap *overlap = BLI_bvhtree_overlap(uv_tree, uv_tree, &tree_overlap_len, NULL, NULL);
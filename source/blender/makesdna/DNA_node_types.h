@@ -476,7 +476,8 @@ typedef struct bNodeTree {
    * in case multiple different editors are used and make context ambiguous.
    */
   bNodeInstanceKey active_viewer_key;
-  char _pad[4];
+  /** Memory in megabytes used by the compositor to keep node results between executions. */
+  int cache_size;
 
   /** Execution data.
    *
@@ -518,6 +519,8 @@ typedef struct bNodeTree {
 
 /* tree is localized copy, free when deleting node groups */
 /* #define NTREE_IS_LOCALIZED           (1 << 5) */
+#define NTREE_COM_FULL_FRAME (1 << 6) /* execute compositor operations buffer-at-a-time */
+#define NTREE_COM_HALF_FLOAT (1 << 7) /* store buffered color results as half float */
 
 /* ntree->update */
 typedef enum eNodeTreeUpdate {
@@ -305,6 +305,11 @@ void ntreeCompositTagRender(Scene *curscene)
 {
   Scene *sce;
 
+#ifdef WITH_COMPOSITOR
+  /* Node results kept for later executions contain the previous render result. */
+  COM_clearCaches();
+#endif
+
   /* XXX Think using G_MAIN here is valid, since you want to update current file's scene nodes,
    * not the ones in temp main generated for rendering?
    * This is still rather weak though,
@@ -125,6 +125,11 @@ static PyObject *bvhtree_CreatePyObject(BVHTree *tree,
 {
   PyBVHTree *result = PyObject_New(PyBVHTree, &PyBVHTree_Type);
 
+  /* Python trees only exist to be queried, use the faster layout for nearest & overlap. */
+  if (tree) {
+    BLI_bvhtree_compact_layout_build(tree);
+  }
+
   result->tree = tree;
   result->epsilon = epsilon;
 
@@ -1640,6 +1640,7 @@ static PyObject *M_Geometry_delaunay_2d_cdt(PyObject *UNUSED(self), PyObject *ar
   in.faces_len_table = in_faces_len_table;
   in.epsilon = epsilon;
   in.skip_input_modify = false;
+  in.use_threading = true;
 
   res = BLI_delaunay_2d_cdt_calc(&in, output_type);
 
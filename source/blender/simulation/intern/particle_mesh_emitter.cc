@@ -17,6 +17,7 @@
 #include "particle_mesh_emitter.hh"
 
 #include "BLI_float4x4.hh"
+#include "BLI_math_batch.hh"
 #include "BLI_rand.hh"
 #include "BLI_vector_adaptor.hh"
 
@@ -283,15 +284,11 @@ static BLI_NOINLINE bool compute_new_particle_attributes(ParticleEmitterContext
   else {
     const float4x4 position_to_world = settings.object->obmat;
     const float4x4 normal_to_world = position_to_world.inverted_transposed_affine();
-    for (int i : IndexRange(particle_amount)) {
-      r_positions[i] = position_to_world * r_positions[i];
-      r_velocities[i] = normal_to_world * r_velocities[i];
-    }
+    transform_points(position_to_world, r_positions);
+    transform_points(normal_to_world, r_velocities);
   }
 
-  for (int i : IndexRange(particle_amount)) {
-    r_velocities[i].normalize();
-  }
+  normalize_vectors(r_velocities);
 
   state.last_birth_time = last_birth_time;
   return true;
@@ -719,6 +719,7 @@ enum {
   WM_JOB_TYPE_LIGHT_BAKE,
   WM_JOB_TYPE_FSMENU_BOOKMARK_VALIDATE,
   WM_JOB_TYPE_QUADRIFLOW_REMESH,
+  WM_JOB_TYPE_FILE_WRITE,
   /* add as needed, bake, seq proxy build
    * if having hard coded values is a problem */
 };
@@ -762,6 +763,7 @@ void WM_jobs_kill(struct wmWindowManager *wm,
 void WM_jobs_kill_all(struct wmWindowManager *wm);
 void WM_jobs_kill_all_except(struct wmWindowManager *wm, void *owner);
 void WM_jobs_kill_type(struct wmWindowManager *wm, void *owner, int job_type);
+void WM_jobs_wait_type(struct wmWindowManager *wm, void *owner, int job_type);
 
 bool WM_jobs_has_running(struct wmWindowManager *wm);
 
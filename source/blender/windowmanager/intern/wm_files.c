@@ -99,6 +99,7 @@
 #include "IMB_imbuf_types.h"
 #include "IMB_thumbs.h"
 
+
 #include "ED_datafiles.h"
 #include "ED_fileselect.h"
 #include "ED_image.h"
@@ -188,6 +189,8 @@ static void wm_window_match_init(bContext *C, ListBase *wmlist)
   /* code copied from wm_init_exit.c */
   for (wm = wmlist->first; wm; wm = wm->id.next) {
 
+    /* Complete saving, killing the job would cancel it. */
+    wm_file_write_job_wait(wm);
     WM_jobs_kill_all(wm);
 
     for (win = wm->windows.first; win; win = win->next) {
@@ -456,6 +459,12 @@ static int wm_read_exotic(const char *name)
       if (len == sizeof(header) && STREQLEN(header, "BLENDER", 7)) {
         retval = BKE_READ_EXOTIC_OK_BLEND;
       }
+      else if (len >= 4 && (uchar)header[0] == 0x28 && (uchar)header[1] == 0xb5 &&
+               (uchar)header[2] == 0x2f && (uchar)header[3] == 0xfd) {
+        /* Zstd compressed file (gzip reading passes the data through as-is),
+         * the header is checked once the file is decompressed by the loader. */
+        retval = BKE_READ_EXOTIC_OK_BLEND;
+      }
       else {
         /* We may want to support loading other file formats
          * from their header bytes or file extension.
@@ -1278,6 +1287,130 @@ static void wm_history_file_update(void)
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name Save Main Blend-File in a Thread (internal)
+ *
+ * Only storing the file in memory blocks the user,
+ * compression & disk access run in a job, see #BLO_write_file_snapshot.
+ * \{ */
+
+typedef struct FileWriteJob {
+  BlendFileWriteSnapshot *snapshot;
+  /** Owns the job, so it's valid for as long as the job exists, unlike the #Main. */
+  wmWindowManager *wm;
+  char filepath[FILE_MAX];
+  /** Written once the file exists (owned by the job). */
+  ImBuf *ibuf_thumb;
+  /** Reports from the thread, passed to the window-manager when the job ends. */
+  ReportList reports;
+  bool is_autosave;
+  bool success;
+  bool is_stopped;
+} FileWriteJob;
+
+static void wm_file_write_job_startjob(void *customdata,
+                                       short *stop,
+                                       short *do_update,
+                                       float *progress)
+{
+  FileWriteJob *job = customdata;
+
+  /* Stopping removes the temporary file, the existing file is left as is. */
+  job->success = BLO_write_file_snapshot_write(job->snapshot, stop, progress, &job->reports);
+  job->is_stopped = !job->success && *stop;
+  *do_update = true;
+}
+
+static void wm_file_write_job_endjob(void *customdata)
+{
+  FileWriteJob *job = customdata;
+
+  LISTBASE_FOREACH (Report *, report, &job->reports.list) {
+    WM_report(report->type, report->message);
+  }
+
+  if (job->is_autosave) {
+    return;
+  }
+
+  if (!job->success) {
+    /* Was set when saving started, there are still unsaved changes. */
+    job->wm->file_saved = 0;
+    if (job->is_stopped) {
+      WM_reportf(RPT_WARNING, "Saving \"%s\" cancelled", BLI_path_basename(job->filepath));
+    }
+    return;
+  }
+
+  /* run this function after because the file cant be written before the blend is */
+  if (job->ibuf_thumb) {
+    IMB_thumb_delete(job->filepath, THB_FAIL); /* without this a failed thumb overrides */
+    job->ibuf_thumb = IMB_thumb_create(
+        job->filepath, THB_LARGE, THB_SOURCE_BLEND, job->ibuf_thumb);
+  }
+
+  /* Without this there is no feedback the file was saved. */
+  WM_reportf(RPT_INFO, "Saved \"%s\"", BLI_path_basename(job->filepath));
+}
+
+static void wm_file_write_job_free(void *customdata)
+{
+  FileWriteJob *job = customdata;
+
+  BLO_write_file_snapshot_free(job->snapshot);
+  if (job->ibuf_thumb) {
+    IMB_freeImBuf(job->ibuf_thumb);
+  }
+  BKE_reports_clear(&job->reports);
+  MEM_freeN(job);
+}
+
+/**
+ * Wait for a file being written in the background, stopping the job would cancel saving.
+ * Call before exiting, loading another file or saving again.
+ */
+void wm_file_write_job_wait(wmWindowManager *wm)
+{
+  /* Joins the thread, then runs the end callback, reporting errors & writing the thumbnail. */
+  WM_jobs_wait_type(wm, wm, WM_JOB_TYPE_FILE_WRITE);
+}
+
+/**
+ * Write \a snapshot to disk in a job, taking ownership of \a snapshot & \a ibuf_thumb.
+ */
+static void wm_file_write_job_start(wmWindowManager *wm,
+                                    wmWindow *win,
+                                    BlendFileWriteSnapshot *snapshot,
+                                    const char *filepath,
+                                    ImBuf *ibuf_thumb,
+                                    const bool is_autosave)
+{
+  /* Only write one file at a time, so saving twice can't write an older snapshot last. */
+  wm_file_write_job_wait(wm);
+
+  FileWriteJob *job = MEM_callocN(sizeof(*job), __func__);
+  job->snapshot = snapshot;
+  job->wm = wm;
+  BLI_strncpy(job->filepath, filepath, sizeof(job->filepath));
+  job->ibuf_thumb = ibuf_thumb;
+  job->is_autosave = is_autosave;
+  /* Auto-save errors are only reported in the console. */
+  BKE_reports_init(&job->reports, is_autosave ? RPT_PRINT : RPT_STORE);
+
+  wmJob *wm_job = WM_jobs_get(wm,
+                              win,
+                              wm,
+                              is_autosave ? "Auto-Saving" : "Saving",
+                              WM_JOB_PROGRESS,
+                              WM_JOB_TYPE_FILE_WRITE);
+  WM_jobs_customdata_set(wm_job, job, wm_file_write_job_free);
+  WM_jobs_timer(wm_job, 0.1, 0, 0);
+  WM_jobs_callbacks(wm_job, wm_file_write_job_startjob, NULL, NULL, wm_file_write_job_endjob);
+  WM_jobs_start(wm, wm_job);
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name Save Main Blend-File (internal)
  * \{ */
@@ -1417,6 +1550,7 @@ static bool wm_file_write(bContext *C,
                           int fileflags,
                           eBLO_WritePathRemap remap_mode,
                           bool use_save_as_copy,
+                          const bool use_async,
                           ReportList *reports)
 {
   Main *bmain = CTX_data_main(C);
@@ -1492,16 +1626,18 @@ static bool wm_file_write(bContext *C,
   /* XXX temp solution to solve bug, real fix coming (ton) */
   bmain->recovered = 0;
 
-  if (BLO_write_file(CTX_data_main(C),
-                     filepath,
-                     fileflags,
-                     &(const struct BlendFileWriteParams){
-                         .remap_mode = remap_mode,
-                         .use_save_versions = true,
-                         .use_save_as_copy = use_save_as_copy,
-                         .thumb = thumb,
-                     },
-                     reports)) {
+  const struct BlendFileWriteParams params = {
+      .remap_mode = remap_mode,
+      .use_save_versions = true,
+      .use_save_as_copy = use_save_as_copy,
+      .thumb = thumb,
+  };
+  BlendFileWriteSnapshot *snapshot = NULL;
+  if (use_async) {
+    snapshot = BLO_write_file_snapshot(bmain, filepath, fileflags, &params, reports);
+  }
+
+  if (snapshot || (!use_async && BLO_write_file(bmain, filepath, fileflags, &params, reports))) {
     const bool do_history_file_update = (G.background == false) &&
                                         (CTX_wm_manager(C)->op_undo_depth == 0);
 
@@ -1521,14 +1657,22 @@ static bool wm_file_write(bContext *C,
 
     BKE_callback_exec_null(bmain, BKE_CB_EVT_SAVE_POST);
 
-    /* run this function after because the file cant be written before the blend is */
-    if (ibuf_thumb) {
-      IMB_thumb_delete(filepath, THB_FAIL); /* without this a failed thumb overrides */
-      ibuf_thumb = IMB_thumb_create(filepath, THB_LARGE, THB_SOURCE_BLEND, ibuf_thumb);
+    if (snapshot) {
+      /* The thumbnail & reports are handled once the file is written. */
+      wm_file_write_job_start(
+          CTX_wm_manager(C), CTX_wm_window(C), snapshot, filepath, ibuf_thumb, false);
+      ibuf_thumb = NULL;
     }
+    else {
+      /* run this function after because the file cant be written before the blend is */
+      if (ibuf_thumb) {
+        IMB_thumb_delete(filepath, THB_FAIL); /* without this a failed thumb overrides */
+        ibuf_thumb = IMB_thumb_create(filepath, THB_LARGE, THB_SOURCE_BLEND, ibuf_thumb);
+      }
 
-    /* Without this there is no feedback the file was saved. */
-    BKE_reportf(reports, RPT_INFO, "Saved \"%s\"", BLI_path_basename(filepath));
+      /* Without this there is no feedback the file was saved. */
+      BKE_reportf(reports, RPT_INFO, "Saved \"%s\"", BLI_path_basename(filepath));
+    }
 
     /* Success. */
     ok = true;
@@ -1619,11 +1763,14 @@ void wm_autosave_timer(Main *bmain, wmWindowManager *wm, wmTimer *UNUSED(wt))
 
   wm_autosave_location(filepath);
 
+  /* Only copy the data here, it's written to disk in a job. */
+  BlendFileWriteSnapshot *snapshot = NULL;
+
   if (U.uiflag & USER_GLOBALUNDO) {
     /* fast save of last undobuffer, now with UI */
     struct MemFile *memfile = ED_undosys_stack_memfile_get_active(wm->undo_stack);
     if (memfile) {
-      BLO_memfile_write_file(memfile, filepath);
+      snapshot = BLO_write_file_snapshot_from_memfile(memfile, filepath);
     }
   }
   else {
@@ -1633,7 +1780,12 @@ void wm_autosave_timer(Main *bmain, wmWindowManager *wm, wmTimer *UNUSED(wt))
     ED_editors_flush_edits(bmain);
 
     /* Error reporting into console. */
-    BLO_write_file(bmain, filepath, fileflags, &(const struct BlendFileWriteParams){0}, NULL);
+    snapshot = BLO_write_file_snapshot(
+        bmain, filepath, fileflags, &(const struct BlendFileWriteParams){0}, NULL);
+  }
+
+  if (snapshot) {
+    wm_file_write_job_start(wm, NULL, snapshot, filepath, NULL, true);
   }
   /* do timer after file write, just in case file write takes a long time */
   wm->autosavetimer = WM_event_add_timer(wm, NULL, TIMERAUTOSAVE, U.savetime * 60.0);
@@ -2689,7 +2841,13 @@ static int wm_save_as_mainfile_exec(bContext *C, wmOperator *op)
   /* set compression flag */
   SET_FLAG_FROM_TEST(fileflags, RNA_boolean_get(op->ptr, "compress"), G_FILE_COMPRESS);
 
-  const bool ok = wm_file_write(C, path, fileflags, remap_mode, use_save_as_copy, op->reports);
+  /* Scripts expect the file to be written once the operator returns,
+   * only write in the background when saving from the interface. */
+  const bool use_async = (op->flag & OP_IS_INVOKE) && (G.background == false) &&
+                         (CTX_wm_window(C) != NULL);
+
+  const bool ok = wm_file_write(
+      C, path, fileflags, remap_mode, use_save_as_copy, use_async, op->reports);
 
   if ((op->flag & OP_IS_INVOKE) == 0) {
     /* OP_IS_INVOKE is set when the operator is called from the GUI.
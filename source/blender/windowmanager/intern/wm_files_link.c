@@ -240,12 +240,12 @@ static void wm_link_do(WMLinkAppendData *lapp_data,
       bh = BLO_blendhandle_from_memory(datatoc_startup_blend, datatoc_startup_blend_size);
     }
     else {
-      bh = BLO_blendhandle_from_file(libname, reports);
+      bh = BLO_blendhandle_from_file_for_link(libname, reports);
     }
 
     if (bh == NULL) {
       /* Unlikely since we just browsed it, but possible
-       * Error reports will have been made by BLO_blendhandle_from_file() */
+       * Error reports will have been made by BLO_blendhandle_from_file_for_link() */
       continue;
     }
 
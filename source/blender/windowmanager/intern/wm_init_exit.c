@@ -506,6 +506,8 @@ void WM_exit_ex(bContext *C, const bool do_python)
       }
     }
 
+    /* Complete saving, killing the job would cancel it. */
+    wm_file_write_job_wait(wm);
     WM_jobs_kill_all(wm);
 
     for (win = wm->windows.first; win; win = win->next) {
@@ -645,6 +647,9 @@ void WM_exit_ex(bContext *C, const bool do_python)
   DNA_sdna_current_free();
 
   BLI_threadapi_exit();
+  if (G.debug & G_DEBUG_TASK_STATS) {
+    BLI_task_scheduler_stats_print();
+  }
   BLI_task_scheduler_exit();
 
   /* No need to call this early, rather do it late so that other
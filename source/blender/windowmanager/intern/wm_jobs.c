@@ -591,6 +591,28 @@ void WM_jobs_kill_type(struct wmWindowManager *wm, void *owner, int job_type)
   }
 }
 
+/* wait for job(s) of this type to finish without stopping them, then end them like
+ * WM_jobs_kill_type */
+void WM_jobs_wait_type(struct wmWindowManager *wm, void *owner, int job_type)
+{
+  wmJob *wm_job, *next_job;
+
+  for (wm_job = wm->jobs.first; wm_job; wm_job = next_job) {
+    next_job = wm_job->next;
+
+    if (!owner || wm_job->owner == owner) {
+      if (job_type == WM_JOB_TYPE_ANY || wm_job->job_type == job_type) {
+        if (wm_job->running) {
+          WM_job_main_thread_lock_release(wm_job);
+          BLI_threadpool_end(&wm_job->threads);
+          WM_job_main_thread_lock_acquire(wm_job);
+        }
+        wm_jobs_kill_job(wm, wm_job);
+      }
+    }
+  }
+}
+
 /* signal job(s) from this owner or callback to stop, timer is required to get handled */
 void WM_jobs_stop(wmWindowManager *wm, void *owner, void *startjob)
 {
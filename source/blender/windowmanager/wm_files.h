@@ -43,6 +43,7 @@ void wm_homefile_read(struct bContext *C,
                       const char *app_template_override,
                       bool *r_is_factory_startup);
 void wm_file_read_report(bContext *C, struct Main *bmain);
+void wm_file_write_job_wait(wmWindowManager *wm);
 
 void wm_close_file_dialog(bContext *C, struct wmGenericCallback *post_action);
 bool wm_file_or_image_is_modified(const Main *bmain, const wmWindowManager *wm);
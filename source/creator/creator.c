@@ -122,6 +122,10 @@ struct ApplicationState app_state = {
             .use_crash_handler = true,
             .use_abort_handler = true,
         },
+    .task =
+        {
+            .use_numa_arenas = false,
+        },
     .exit_code_on_error =
         {
             .python = 0,
@@ -411,6 +415,14 @@ int main(int argc,
 
   /* After parsing number of threads argument. */
   BLI_task_scheduler_init();
+  if (app_state.task.use_numa_arenas) {
+    if (!BLI_task_scheduler_numa_arenas_enable()) {
+      printf("NUMA task arenas not used, there is only one NUMA node or thread.\n");
+    }
+  }
+  if (G.debug & G_DEBUG_TASK_STATS) {
+    BLI_task_scheduler_stats_enable(true);
+  }
 
 #ifdef WITH_FFMPEG
   IMB_ffmpeg_init();
@@ -43,7 +43,7 @@
 #  include "BLI_threads.h"
 #  include "BLI_utildefines.h"
 
-#  include "BLO_readfile.h" /* only for BLO_has_bfile_extension */
+#  include "BLO_readfile.h" /* for BLO_has_bfile_extension & BLO_read_profile_json_filepath_set */
 
 #  include "BKE_blender_version.h"
 #  include "BKE_context.h"
@@ -527,6 +527,7 @@ static int arg_handle_print_help(int UNUSED(argc), const char **UNUSED(argv), vo
   BLI_argsPrintArgDoc(ba, "--render-output");
   BLI_argsPrintArgDoc(ba, "--engine");
   BLI_argsPrintArgDoc(ba, "--threads");
+  BLI_argsPrintArgDoc(ba, "--threads-numa");
 
   printf("\n");
   printf("Format Options:\n");
@@ -609,6 +610,9 @@ static int arg_handle_print_help(int UNUSED(argc), const char **UNUSED(argv), vo
 #  endif
   BLI_argsPrintArgDoc(ba, "--debug-all");
   BLI_argsPrintArgDoc(ba, "--debug-io");
+  BLI_argsPrintArgDoc(ba, "--debug-io-timing");
+  BLI_argsPrintArgDoc(ba, "--debug-io-timing-json");
+  BLI_argsPrintArgDoc(ba, "--debug-task-stats");
 
   printf("\n");
   BLI_argsPrintArgDoc(ba, "--debug-fpe");
@@ -998,6 +1002,9 @@ static const char arg_handle_debug_mode_generic_set_doc_depsgraph_no_threads[] =
 static const char arg_handle_debug_mode_generic_set_doc_depsgraph_pretty[] =
     "\n\t"
     "Enable colors for dependency graph debug messages.";
+static const char arg_handle_debug_mode_generic_set_doc_task_stats[] =
+    "\n\t"
+    "Enable task scheduler statistics (tasks, busy & idle time per worker), printed on exit.";
 static const char arg_handle_debug_mode_generic_set_doc_gpumem[] =
     "\n\t"
     "Enable GPU memory stats in status bar.";
@@ -1021,6 +1028,39 @@ static int arg_handle_debug_mode_io(int UNUSED(argc),
   return 0;
 }
 
+static const char arg_handle_debug_mode_io_timing_doc[] =
+    "\n\t"
+    "Enable timing of reading blend-files (per phase, versioning pass & data-block type),\n"
+    "\tlogged as 'blo.readfile.timing' at the default log level (1).\n"
+    "\tUse '--log-level 2' to also list the slowest data-blocks.";
+static int arg_handle_debug_mode_io_timing(int UNUSED(argc),
+                                           const char **UNUSED(argv),
+                                           void *UNUSED(data))
+{
+  const char *log_type = "blo.readfile.timing";
+  G.debug |= G_DEBUG_IO_TIMING;
+  CLG_type_filter_include(log_type, strlen(log_type));
+  return 0;
+}
+
+static const char arg_handle_debug_mode_io_timing_json_doc[] =
+    "<filepath>\n"
+    "\tEnable timing of reading blend-files (see '--debug-io-timing'),\n"
+    "\talso writing the timing of the last file read as JSON to <filepath>.";
+static int arg_handle_debug_mode_io_timing_json(int argc, const char **argv, void *data)
+{
+  const char *arg_id = "--debug-io-timing-json";
+  if (argc > 1) {
+    arg_handle_debug_mode_io_timing(argc, argv, data);
+    BLO_read_profile_json_filepath_set(argv[1]);
+    return 1;
+  }
+  else {
+    printf("\nError: '%s' no args given.\n", arg_id);
+    return 0;
+  }
+}
+
 static const char arg_handle_debug_mode_all_doc[] =
     "\n\t"
     "Enable all debug messages.";
@@ -1501,6 +1541,18 @@ static int arg_handle_threads_set(int argc, const char **argv, void *UNUSED(data
   }
 }
 
+static const char arg_handle_threads_numa_set_doc[] =
+    "\n\t"
+    "Split parallel loops over one task arena per NUMA node, with worker threads pinned to\n"
+    "\ttheir node. Only has an effect on systems with multiple NUMA nodes.";
+static int arg_handle_threads_numa_set(int UNUSED(argc),
+                                       const char **UNUSED(argv),
+                                       void *UNUSED(data))
+{
+  app_state.task.use_numa_arenas = true;
+  return 0;
+}
+
 static const char arg_handle_verbosity_set_doc[] =
     "<verbose>\n"
     "\tSet the logging verbosity level for debug messages that support it.";
@@ -2143,6 +2195,15 @@ void main_args_setup(bContext *C, bArgs *ba)
   BLI_argsAdd(ba, 1, NULL, "--debug-all", CB(arg_handle_debug_mode_all), NULL);
 
   BLI_argsAdd(ba, 1, NULL, "--debug-io", CB(arg_handle_debug_mode_io), NULL);
+  BLI_argsAdd(ba, 1, NULL, "--debug-io-timing", CB(arg_handle_debug_mode_io_timing), NULL);
+  BLI_argsAdd(
+      ba, 1, NULL, "--debug-io-timing-json", CB(arg_handle_debug_mode_io_timing_json), NULL);
+  BLI_argsAdd(ba,
+              1,
+              NULL,
+              "--debug-task-stats",
+              CB_EX(arg_handle_debug_mode_generic_set, task_stats),
+              (void *)G_DEBUG_TASK_STATS);
 
   BLI_argsAdd(ba, 1, NULL, "--debug-fpe", CB(arg_handle_debug_fpe_set), NULL);
 
@@ -2285,6 +2346,7 @@ void main_args_setup(bContext *C, bArgs *ba)
 
   BLI_argsAdd(ba, 4, "-F", "--render-format", CB(arg_handle_image_type_set), C);
   BLI_argsAdd(ba, 1, "-t", "--threads", CB(arg_handle_threads_set), NULL);
+  BLI_argsAdd(ba, 1, NULL, "--threads-numa", CB(arg_handle_threads_numa_set), NULL);
   BLI_argsAdd(ba, 4, "-x", "--use-extension", CB(arg_handle_extension_set), C);
 
 #  undef CB
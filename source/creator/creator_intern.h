@@ -45,6 +45,10 @@ struct ApplicationState {
     bool use_abort_handler;
   } signal;
 
+  struct {
+    bool use_numa_arenas;
+  } task;
+
   /* we may want to set different exit codes for other kinds of errors */
   struct {
     unsigned char python;
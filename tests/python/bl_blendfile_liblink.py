@@ -42,9 +42,54 @@ class TestBlendLibLinkSaveLoadBasic(TestHelper):
         assert(orig_data == read_data)
 
 
+class TestBlendLibLinkDependencies(TestHelper):
+
+    def __init__(self, args):
+        self.args = args
+
+    def test_link_dependencies(self):
+        bpy.ops.wm.read_factory_settings(use_empty=True)
+        for i in range(100):
+            me = bpy.data.meshes.new("LibMeshUnused.%03d" % i)
+            me.use_fake_user = True
+        ma = bpy.data.materials.new("LibMaterial")
+        me = bpy.data.meshes.new("LibMesh")
+        me.materials.append(ma)
+        ob = bpy.data.objects.new("LibObject", me)
+        ob.use_fake_user = True
+
+        output_dir = self.args.output_dir
+        self.ensure_path(output_dir)
+        output_path = os.path.join(output_dir, "blendlib_deps.blend")
+
+        bpy.ops.wm.save_as_mainfile(filepath=output_path, check_existing=False, compress=False)
+
+        bpy.ops.wm.read_factory_settings(use_empty=True)
+
+        # Linking only reads the data-blocks needed by the linked object.
+        link_dir = os.path.join(output_path, "Object")
+        bpy.ops.wm.link(directory=link_dir, filename="LibObject")
+
+        ob = bpy.data.objects["LibObject"]
+        assert(ob.data == bpy.data.meshes["LibMesh"])
+        assert(ob.data.materials[0] == bpy.data.materials["LibMaterial"])
+        assert(len(bpy.data.meshes) == 1)
+
+        orig_data = self.blender_data_to_tuple(bpy.data, "orig_data")
+
+        # Reading the library again when loading the file.
+        output_path = os.path.join(output_dir, "blendfile_deps.blend")
+        bpy.ops.wm.save_as_mainfile(filepath=output_path, check_existing=False, compress=False)
+        bpy.ops.wm.open_mainfile(filepath=output_path, load_ui=False)
+
+        read_data = self.blender_data_to_tuple(bpy.data, "read_data")
+
+        assert(orig_data == read_data)
+
 
 TESTS = (
     TestBlendLibLinkSaveLoadBasic,
+    TestBlendLibLinkDependencies,
     )
 
 
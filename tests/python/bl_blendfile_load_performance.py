@@ -0,0 +1,147 @@
+# Apache License, Version 2.0
+
+"""
+Benchmark loading a blend file with many data-blocks using a different number of threads.
+
+Example usage:
+
+    python3 tests/python/bl_blendfile_load_performance.py \
+        --blender ./blender.bin --output-dir /tmp/blendfile_io/
+"""
+
+import os
+import subprocess
+import sys
+
+
+# Creates a file with `count` objects, each using its own mesh and material.
+GENERATE_SCRIPT = """
+import bpy
+import bmesh
+
+bpy.ops.wm.read_factory_settings(use_empty=True)
+scene = bpy.context.scene
+for i in range({count}):
+    mesh = bpy.data.meshes.new("Mesh.%06d" % i)
+    bm = bmesh.new()
+    bmesh.ops.create_uvsphere(bm, u_segments=8, v_segments=4, diameter=1.0)
+    bm.to_mesh(mesh)
+    bm.free()
+    mesh.materials.append(bpy.data.materials.new("Material.%06d" % i))
+    ob = bpy.data.objects.new("Object.%06d" % i, mesh)
+    ob.location = (i % 100, i // 100, 0.0)
+    scene.collection.objects.link(ob)
+bpy.ops.wm.save_as_mainfile(filepath={filepath!r}, check_existing=False, compress={compress})
+"""
+
+LOAD_SCRIPT = """
+import bpy
+import time
+
+time_start = time.perf_counter()
+bpy.ops.wm.open_mainfile(filepath={filepath!r}, load_ui=False)
+print("LOAD_TIME: %f" % (time.perf_counter() - time_start))
+"""
+
+
+def run_blender(blender, args, script):
+    command = [blender, "--background", "--factory-startup", "-noaudio", *args, "--python-expr", script]
+    output = subprocess.check_output(command, stderr=subprocess.STDOUT, universal_newlines=True)
+    return output
+
+
+def load_time(blender, filepath, threads, repeat):
+    times = []
+    for _ in range(repeat):
+        output = run_blender(blender, ["--threads", str(threads)], LOAD_SCRIPT.format(filepath=filepath))
+        for line in output.splitlines():
+            if line.startswith("LOAD_TIME: "):
+                times.append(float(line.split(":", 1)[1]))
+                break
+        else:
+            raise Exception("Load time not found in output:\n" + output)
+    # The minimum is least affected by other processes.
+    return min(times)
+
+
+def thread_counts():
+    count_max = os.cpu_count() or 1
+    counts = []
+    count = 1
+    while count < count_max:
+        counts.append(count)
+        count *= 2
+    counts.append(count_max)
+    return counts
+
+
+def argparse_create():
+    import argparse
+
+    description = "Benchmark loading a blend file with many data-blocks."
+    parser = argparse.ArgumentParser(description=description)
+    parser.add_argument(
+        "--blender",
+        dest="blender",
+        required=True,
+        help="Blender executable",
+    )
+    parser.add_argument(
+        "--output-dir",
+        dest="output_dir",
+        default=".",
+        help="Where to output the generated blend file",
+        required=False,
+    )
+    parser.add_argument(
+        "--count",
+        dest="count",
+        type=int,
+        default=10000,
+        help="Number of objects to generate (each with its own mesh & material)",
+        required=False,
+    )
+    parser.add_argument(
+        "--repeat",
+        dest="repeat",
+        type=int,
+        default=3,
+        help="Number of times each file is loaded, the fastest load is reported",
+        required=False,
+    )
+    parser.add_argument(
+        "--compress",
+        dest="compress",
+        action="store_true",
+        help="Save the generated file with compression",
+        required=False,
+    )
+
+    return parser
+
+
+def main():
+    args = argparse_create().parse_args()
+
+    if not os.path.exists(args.output_dir):
+        os.makedirs(args.output_dir)
+    filepath = os.path.join(args.output_dir, "load_performance_%d.blend" % args.count)
+
+    print("Generating %r with %d objects..." % (filepath, args.count))
+    run_blender(
+        args.blender, [],
+        GENERATE_SCRIPT.format(count=args.count, filepath=filepath, compress=args.compress),
+    )
+
+    print("%8s %12s %8s" % ("Threads", "Time (sec)", "Speedup"))
+    time_single = None
+    for threads in thread_counts():
+        time = load_time(args.blender, filepath, threads, args.repeat)
+        if time_single is None:
+            time_single = time
+        print("%8d %12.4f %7.2fx" % (threads, time, time_single / time))
+        sys.stdout.flush()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,127 @@
+# Apache License, Version 2.0
+
+"""
+Measure the cost of versioning blend files, per versioning pass (release block).
+
+Loads each file a number of times using `--debug-io-timing-json` and reports the time
+of each versioning pass. Passes that don't apply to a file (based on its version) are skipped
+by the loader and are listed as such.
+
+Example usage:
+
+    python3 tests/python/bl_blendfile_versioning_performance.py \
+        --blender ./blender.bin --output-dir /tmp/blendfile_io/ file_a.blend file_b.blend
+"""
+
+import json
+import os
+import subprocess
+import sys
+
+
+PHASES_VERSIONING = ("versioning", "versioning_after_linking")
+
+
+def load_timing(blender, filepath, json_filepath):
+    command = [
+        blender,
+        "--background",
+        "--factory-startup",
+        "-noaudio",
+        "--debug-io-timing-json", json_filepath,
+        filepath,
+    ]
+    subprocess.check_output(command, stderr=subprocess.STDOUT, universal_newlines=True)
+    with open(json_filepath, "r", encoding="utf-8") as fh:
+        timing = json.load(fh)
+    # The JSON file contains the last file read, make sure it's the file being measured.
+    if os.path.normpath(timing["filepath"]) != os.path.normpath(filepath):
+        raise Exception("Timing not found for %r (found %r)" % (filepath, timing["filepath"]))
+    return timing
+
+
+def versioning_timing(blender, filepath, json_filepath, repeat):
+    """
+    Return the minimum time of each versioning phase & pass over all runs,
+    the minimum is least affected by other processes.
+    """
+    phases = {}
+    passes = {}
+    for _ in range(repeat):
+        timing = load_timing(blender, filepath, json_filepath)
+        for phase in timing["phases"]:
+            if phase["name"] in PHASES_VERSIONING:
+                phases[phase["name"]] = min(phases.get(phase["name"], phase["time"]), phase["time"])
+        for pass_ in timing["passes"]:
+            if pass_["name"].startswith("do_versions"):
+                passes[pass_["name"]] = min(passes.get(pass_["name"], pass_["time"]), pass_["time"])
+    return phases, passes
+
+
+def argparse_create():
+    import argparse
+
+    description = "Measure the cost of versioning blend files, per versioning pass."
+    parser = argparse.ArgumentParser(description=description)
+    parser.add_argument(
+        "--blender",
+        dest="blender",
+        required=True,
+        help="Blender executable",
+    )
+    parser.add_argument(
+        "--output-dir",
+        dest="output_dir",
+        default=".",
+        help="Where to output the timing (JSON) files",
+        required=False,
+    )
+    parser.add_argument(
+        "--repeat",
+        dest="repeat",
+        type=int,
+        default=3,
+        help="Number of times each file is loaded, the fastest time of each pass is reported",
+        required=False,
+    )
+    parser.add_argument(
+        "files",
+        nargs="+",
+        help="Blend files to measure",
+    )
+
+    return parser
+
+
+def main():
+    args = argparse_create().parse_args()
+
+    if not os.path.exists(args.output_dir):
+        os.makedirs(args.output_dir)
+    json_filepath = os.path.join(args.output_dir, "versioning_timing.json")
+
+    # Passes in the order they're first reported.
+    pass_names = []
+    results = []
+    for filepath in args.files:
+        filepath = os.path.abspath(filepath)
+        phases, passes = versioning_timing(args.blender, filepath, json_filepath, args.repeat)
+        for name in passes:
+            if name not in pass_names:
+                pass_names.append(name)
+        results.append((filepath, phases, passes))
+
+    for filepath, phases, passes in results:
+        print(filepath)
+        for name in PHASES_VERSIONING:
+            print("  %-34s %12.6f sec" % (name, phases.get(name, 0.0)))
+        for name in pass_names:
+            if name in passes:
+                print("    %-32s %12.6f sec" % (name, passes[name]))
+            else:
+                print("    %-32s %16s" % (name, "skipped"))
+        sys.stdout.flush()
+
+
+if __name__ == "__main__":
+    main()
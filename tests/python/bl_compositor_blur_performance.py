@@ -0,0 +1,184 @@
+# Apache License, Version 2.0
+
+"""
+Benchmark the compositor blur operations for a range of blur radii.
+
+Example usage:
+
+    python3 tests/python/bl_compositor_blur_performance.py --blender ./blender.bin
+"""
+
+import subprocess
+import sys
+
+
+BENCHMARK_SCRIPT = """
+import bpy
+import time
+
+bpy.ops.wm.read_factory_settings(use_empty=True)
+scene = bpy.context.scene
+scene.render.resolution_x = {width}
+scene.render.resolution_y = {height}
+scene.render.resolution_percentage = 100
+scene.render.use_compositing = True
+scene.render.use_sequencer = False
+camera = bpy.data.objects.new("Camera", bpy.data.cameras.new("Camera"))
+scene.collection.objects.link(camera)
+scene.camera = camera
+scene.use_nodes = True
+tree = scene.node_tree
+tree.chunk_size = '256'
+max_dim = max({width}, {height})
+
+image = bpy.data.images.new(
+    "Grid", {width}, {height}, alpha=True, float_buffer=True)
+image.generated_type = 'COLOR_GRID'
+
+
+def new_node(type, location_x, **settings):
+    node = tree.nodes.new(type)
+    node.location = (location_x * 200.0, 0.0)
+    for key, value in settings.items():
+        setattr(node, key, value)
+    return node
+
+
+# Gaussian X and Y blur operations.
+def build_gaussian(radius):
+    src = new_node("CompositorNodeImage", 0, image=image)
+    blur = new_node("CompositorNodeBlur", 1, filter_type='GAUSS', use_bokeh=False,
+                    use_relative=False, size_x=radius, size_y=radius)
+    out = new_node("CompositorNodeComposite", 2)
+    tree.links.new(src.outputs[0], blur.inputs[0])
+    tree.links.new(blur.outputs[0], out.inputs[0])
+
+
+# Bokeh blur operation, the size is a percentage of the image dimensions.
+def build_bokeh(radius):
+    src = new_node("CompositorNodeImage", 0, image=image)
+    bokeh = new_node("CompositorNodeBokehImage", 0, flaps=6)
+    blur = new_node("CompositorNodeBokehBlur", 1)
+    blur.inputs["Size"].default_value = (radius + 0.5) * 100.0 / max_dim
+    out = new_node("CompositorNodeComposite", 2)
+    tree.links.new(src.outputs[0], blur.inputs[0])
+    tree.links.new(bokeh.outputs[0], blur.inputs[1])
+    tree.links.new(blur.outputs[0], out.inputs[0])
+
+
+# Variable size bokeh blur operation, used when the size input is linked.
+def build_variable_size_bokeh(radius):
+    src = new_node("CompositorNodeImage", 0, image=image)
+    bokeh = new_node("CompositorNodeBokehImage", 0, flaps=6)
+    size = new_node("CompositorNodeValue", 0)
+    size.outputs[0].default_value = (radius + 0.5) * 100.0 / max_dim
+    blur = new_node("CompositorNodeBokehBlur", 1, use_variable_size=True, blur_max=radius)
+    out = new_node("CompositorNodeComposite", 2)
+    tree.links.new(src.outputs[0], blur.inputs[0])
+    tree.links.new(bokeh.outputs[0], blur.inputs[1])
+    tree.links.new(size.outputs[0], blur.inputs[2])
+    tree.links.new(blur.outputs[0], out.inputs[0])
+
+
+for build in (build_gaussian, build_bokeh, build_variable_size_bokeh):
+    for radius in {radii}:
+        tree.nodes.clear()
+        build(radius)
+        times = []
+        for _ in range({repeat}):
+            time_start = time.perf_counter()
+            bpy.ops.render.render()
+            times.append(time.perf_counter() - time_start)
+        # The minimum is least affected by other processes.
+        print("BLUR_TIME: %s %d %f" % (build.__name__[6:], radius, min(times)))
+"""
+
+
+def run_blender(blender, args, script):
+    command = [blender, "--background", "--factory-startup", "-noaudio", *args, "--python-expr", script]
+    output = subprocess.check_output(command, stderr=subprocess.STDOUT, universal_newlines=True)
+    return output
+
+
+def blur_times(blender, width, height, radii, threads, repeat):
+    script = BENCHMARK_SCRIPT.format(width=width, height=height, radii=radii, repeat=repeat)
+    output = run_blender(blender, ["--threads", str(threads)], script)
+    times = []
+    for line in output.splitlines():
+        if line.startswith("BLUR_TIME: "):
+            operation, radius, time = line.split(":", 1)[1].split()
+            times.append((operation, int(radius), float(time)))
+    if not times:
+        raise Exception("Blur times not found in output:\n" + output)
+    return times
+
+
+def argparse_create():
+    import argparse
+
+    description = "Benchmark the compositor blur operations for a range of blur radii."
+    parser = argparse.ArgumentParser(description=description)
+    parser.add_argument(
+        "--blender",
+        dest="blender",
+        required=True,
+        help="Blender executable",
+    )
+    parser.add_argument(
+        "--width",
+        dest="width",
+        type=int,
+        default=1920,
+        help="Width of the composited images",
+        required=False,
+    )
+    parser.add_argument(
+        "--height",
+        dest="height",
+        type=int,
+        default=1080,
+        help="Height of the composited images",
+        required=False,
+    )
+    parser.add_argument(
+        "--radii",
+        dest="radii",
+        type=int,
+        nargs="+",
+        default=[4, 16, 32, 64, 128],
+        help="Blur radii in pixels",
+        required=False,
+    )
+    parser.add_argument(
+        "--threads",
+        dest="threads",
+        type=int,
+        default=0,
+        help="Number of threads, 0 uses all processors",
+        required=False,
+    )
+    parser.add_argument(
+        "--repeat",
+        dest="repeat",
+        type=int,
+        default=3,
+        help="Number of times each tree is composited, the fastest time is reported",
+        required=False,
+    )
+
+    return parser
+
+
+def main():
+    args = argparse_create().parse_args()
+
+    times = blur_times(args.blender, args.width, args.height, args.radii, args.threads, args.repeat)
+
+    print("%-20s %8s %12s" % ("Operation", "Radius", "Time (sec)"))
+    for operation, radius, time in times:
+        print("%-20s %8d %12.4f" % (operation, radius, time))
+    sys.stdout.flush()
+
+
+if __name__ == "__main__":
+    main()
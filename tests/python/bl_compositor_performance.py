@@ -0,0 +1,193 @@
+# Apache License, Version 2.0
+
+"""
+Benchmark compositing common node trees pixel by pixel and with full-frame execution.
+
+Example usage:
+
+    python3 tests/python/bl_compositor_performance.py --blender ./blender.bin
+"""
+
+import subprocess
+import sys
+
+
+BENCHMARK_SCRIPT = """
+import bpy
+import time
+
+bpy.ops.wm.read_factory_settings(use_empty=True)
+scene = bpy.context.scene
+scene.render.resolution_x = {width}
+scene.render.resolution_y = {height}
+scene.render.resolution_percentage = 100
+scene.render.use_compositing = True
+scene.render.use_sequencer = False
+camera = bpy.data.objects.new("Camera", bpy.data.cameras.new("Camera"))
+scene.collection.objects.link(camera)
+scene.camera = camera
+scene.use_nodes = True
+tree = scene.node_tree
+tree.chunk_size = '256'
+
+image = bpy.data.images.new(
+    "Grid", {width}, {height}, alpha=True, float_buffer=True)
+image.generated_type = 'COLOR_GRID'
+
+
+def new_node(type, location_x, **settings):
+    node = tree.nodes.new(type)
+    node.location = (location_x * 200.0, 0.0)
+    for key, value in settings.items():
+        setattr(node, key, value)
+    return node
+
+
+def build_color_correct():
+    src = new_node("CompositorNodeImage", 0, image=image)
+    tint = new_node("CompositorNodeMixRGB", 1, blend_type='MULTIPLY')
+    tint.inputs[2].default_value = (1.0, 0.8, 0.6, 1.0)
+    screen = new_node("CompositorNodeMixRGB", 2, blend_type='SCREEN', use_alpha=True)
+    screen.inputs[0].default_value = 0.3
+    lift = new_node("CompositorNodeMixRGB", 3, blend_type='ADD', use_clamp=True)
+    lift.inputs[0].default_value = 0.1
+    out = new_node("CompositorNodeComposite", 4)
+    tree.links.new(src.outputs[0], tint.inputs[1])
+    tree.links.new(tint.outputs[0], screen.inputs[1])
+    tree.links.new(src.outputs[0], screen.inputs[2])
+    tree.links.new(screen.outputs[0], lift.inputs[1])
+    tree.links.new(src.outputs[0], lift.inputs[2])
+    tree.links.new(lift.outputs[0], out.inputs[0])
+
+
+def build_luminance_mask():
+    src = new_node("CompositorNodeImage", 0, image=image)
+    bw = new_node("CompositorNodeRGBToBW", 1)
+    gain = new_node("CompositorNodeMath", 2, operation='MULTIPLY')
+    gain.inputs[1].default_value = 1.5
+    power = new_node("CompositorNodeMath", 3, operation='POWER')
+    power.inputs[1].default_value = 2.2
+    mask = new_node("CompositorNodeMath", 4, operation='MINIMUM', use_clamp=True)
+    mask.inputs[1].default_value = 0.9
+    mix = new_node("CompositorNodeMixRGB", 5, blend_type='MIX')
+    mix.inputs[2].default_value = (0.1, 0.2, 0.4, 1.0)
+    out = new_node("CompositorNodeComposite", 6)
+    tree.links.new(src.outputs[0], bw.inputs[0])
+    tree.links.new(bw.outputs[0], gain.inputs[0])
+    tree.links.new(gain.outputs[0], power.inputs[0])
+    tree.links.new(power.outputs[0], mask.inputs[0])
+    tree.links.new(mask.outputs[0], mix.inputs[0])
+    tree.links.new(src.outputs[0], mix.inputs[1])
+    tree.links.new(mix.outputs[0], out.inputs[0])
+
+
+def build_alpha_over():
+    src = new_node("CompositorNodeImage", 0, image=image)
+    premul = new_node("CompositorNodePremulKey", 1, mapping='STRAIGHT_TO_PREMUL')
+    darken = new_node("CompositorNodeMixRGB", 2, blend_type='DARKEN')
+    darken.inputs[2].default_value = (0.5, 0.5, 0.5, 1.0)
+    difference = new_node("CompositorNodeMixRGB", 3, blend_type='DIFFERENCE')
+    straight = new_node("CompositorNodePremulKey", 4, mapping='PREMUL_TO_STRAIGHT')
+    out = new_node("CompositorNodeComposite", 5)
+    tree.links.new(src.outputs[0], premul.inputs[0])
+    tree.links.new(premul.outputs[0], darken.inputs[1])
+    tree.links.new(darken.outputs[0], difference.inputs[1])
+    tree.links.new(src.outputs[0], difference.inputs[2])
+    tree.links.new(difference.outputs[0], straight.inputs[0])
+    tree.links.new(straight.outputs[0], out.inputs[0])
+
+
+for build in (build_color_correct, build_luminance_mask, build_alpha_over):
+    tree.nodes.clear()
+    build()
+    for use_full_frame in (False, True):
+        tree.use_full_frame = use_full_frame
+        times = []
+        for _ in range({repeat}):
+            time_start = time.perf_counter()
+            bpy.ops.render.render()
+            times.append(time.perf_counter() - time_start)
+        # The minimum is least affected by other processes.
+        print("COMPOSITE_TIME: %s %d %f" % (build.__name__[6:], use_full_frame, min(times)))
+"""
+
+
+def run_blender(blender, args, script):
+    command = [blender, "--background", "--factory-startup", "-noaudio", *args, "--python-expr", script]
+    output = subprocess.check_output(command, stderr=subprocess.STDOUT, universal_newlines=True)
+    return output
+
+
+def composite_times(blender, width, height, threads, repeat):
+    script = BENCHMARK_SCRIPT.format(width=width, height=height, repeat=repeat)
+    output = run_blender(blender, ["--threads", str(threads)], script)
+    times = {}
+    for line in output.splitlines():
+        if line.startswith("COMPOSITE_TIME: "):
+            tree, use_full_frame, time = line.split(":", 1)[1].split()
+            times.setdefault(tree, [None, None])[int(use_full_frame)] = float(time)
+    if not times:
+        raise Exception("Composite times not found in output:\n" + output)
+    return times
+
+
+def argparse_create():
+    import argparse
+
+    description = "Benchmark compositing pixel by pixel and with full-frame execution."
+    parser = argparse.ArgumentParser(description=description)
+    parser.add_argument(
+        "--blender",
+        dest="blender",
+        required=True,
+        help="Blender executable",
+    )
+    parser.add_argument(
+        "--width",
+        dest="width",
+        type=int,
+        default=3840,
+        help="Width of the composited images",
+        required=False,
+    )
+    parser.add_argument(
+        "--height",
+        dest="height",
+        type=int,
+        default=2160,
+        help="Height of the composited images",
+        required=False,
+    )
+    parser.add_argument(
+        "--threads",
+        dest="threads",
+        type=int,
+        default=0,
+        help="Number of threads, 0 uses all processors",
+        required=False,
+    )
+    parser.add_argument(
+        "--repeat",
+        dest="repeat",
+        type=int,
+        default=3,
+        help="Number of times each tree is composited, the fastest time is reported",
+        required=False,
+    )
+
+    return parser
+
+
+def main():
+    args = argparse_create().parse_args()
+
+    times = composite_times(args.blender, args.width, args.height, args.threads, args.repeat)
+
+    print("%-20s %14s %16s %8s" % ("Tree", "Per-pixel (sec)", "Full-frame (sec)", "Speedup"))
+    for tree, (time_pixel, time_full_frame) in times.items():
+        print("%-20s %14.4f %16.4f %7.2fx" % (tree, time_pixel, time_full_frame, time_pixel / time_full_frame))
+    sys.stdout.flush()
+
+
+if __name__ == "__main__":
+    main()